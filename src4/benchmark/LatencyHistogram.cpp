@@ -0,0 +1,177 @@
+#include "LatencyHistogram.hpp"
+#include <iostream>
+#include <iomanip>
+
+namespace idioms
+{
+    namespace benchmark
+    {
+
+        LatencyHistogram::LatencyHistogram()
+            : totalCount(0), maxValue(0), minValue(0), sum(0)
+        {
+            // 64 power-of-two buckets of 32 sub-buckets covers the full
+            // uint64 range; values below 2^5 get exact unit buckets
+            counts.assign(64 * SUB_BUCKET_COUNT, 0);
+        }
+
+        size_t LatencyHistogram::bucketIndex(uint64_t nanos)
+        {
+            if (nanos < SUB_BUCKET_COUNT)
+            {
+                return static_cast<size_t>(nanos);
+            }
+
+            int exponent = 63 - __builtin_clzll(nanos);
+            uint64_t subBucket = (nanos >> (exponent - SUB_BUCKET_BITS)) &
+                                 (SUB_BUCKET_COUNT - 1);
+            return static_cast<size_t>(exponent - SUB_BUCKET_BITS + 1) *
+                       SUB_BUCKET_COUNT +
+                   static_cast<size_t>(subBucket);
+        }
+
+        uint64_t LatencyHistogram::bucketValue(size_t index)
+        {
+            if (index < SUB_BUCKET_COUNT)
+            {
+                return static_cast<uint64_t>(index);
+            }
+
+            int exponent = static_cast<int>(index / SUB_BUCKET_COUNT) +
+                           SUB_BUCKET_BITS - 1;
+            uint64_t subBucket = index % SUB_BUCKET_COUNT;
+
+            // Upper edge of the sub-bucket, so percentiles never
+            // under-report
+            uint64_t base = (uint64_t(1) << exponent) +
+                            (subBucket << (exponent - SUB_BUCKET_BITS));
+            return base + (uint64_t(1) << (exponent - SUB_BUCKET_BITS)) - 1;
+        }
+
+        void LatencyHistogram::record(uint64_t nanos)
+        {
+            counts[bucketIndex(nanos)]++;
+            totalCount++;
+            sum += nanos;
+            if (nanos > maxValue)
+            {
+                maxValue = nanos;
+            }
+            if (totalCount == 1 || nanos < minValue)
+            {
+                minValue = nanos;
+            }
+        }
+
+        uint64_t LatencyHistogram::valueAtPercentile(double percentile) const
+        {
+            if (totalCount == 0)
+            {
+                return 0;
+            }
+            if (percentile >= 100.0)
+            {
+                return maxValue;
+            }
+
+            uint64_t target = static_cast<uint64_t>(percentile / 100.0 *
+                                                    static_cast<double>(totalCount));
+            if (target == 0)
+            {
+                target = 1;
+            }
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                seen += counts[i];
+                if (seen >= target)
+                {
+                    return bucketValue(i);
+                }
+            }
+            return maxValue;
+        }
+
+        uint64_t LatencyHistogram::count() const
+        {
+            return totalCount;
+        }
+
+        uint64_t LatencyHistogram::max() const
+        {
+            return maxValue;
+        }
+
+        double LatencyHistogram::mean() const
+        {
+            if (totalCount == 0)
+            {
+                return 0.0;
+            }
+            return static_cast<double>(sum) / static_cast<double>(totalCount);
+        }
+
+        void LatencyHistogram::merge(const LatencyHistogram &other)
+        {
+            for (size_t i = 0; i < counts.size(); i++)
+            {
+                counts[i] += other.counts[i];
+            }
+            sum += other.sum;
+            if (other.totalCount > 0)
+            {
+                if (other.maxValue > maxValue)
+                {
+                    maxValue = other.maxValue;
+                }
+                if (totalCount == 0 || other.minValue < minValue)
+                {
+                    minValue = other.minValue;
+                }
+            }
+            totalCount += other.totalCount;
+        }
+
+        void LatencyHistogram::reset()
+        {
+            counts.assign(counts.size(), 0);
+            totalCount = 0;
+            maxValue = 0;
+            minValue = 0;
+            sum = 0;
+        }
+
+        void LatencyHistogram::printSummary(const std::string &name) const
+        {
+            // Everything in microseconds: the range our latencies live in
+            std::cout << std::left << std::setw(24) << name << std::right
+                      << " n=" << std::setw(9) << totalCount
+                      << std::fixed << std::setprecision(1)
+                      << "  mean=" << std::setw(10) << mean() / 1000.0
+                      << "  p50=" << std::setw(10) << valueAtPercentile(50) / 1000.0
+                      << "  p90=" << std::setw(10) << valueAtPercentile(90) / 1000.0
+                      << "  p99=" << std::setw(10) << valueAtPercentile(99) / 1000.0
+                      << "  p99.9=" << std::setw(10) << valueAtPercentile(99.9) / 1000.0
+                      << "  max=" << std::setw(10) << static_cast<double>(maxValue) / 1000.0
+                      << "  (us)" << std::endl;
+        }
+
+        void LatencyHistogram::printSpectrum(const std::string &name) const
+        {
+            static const double steps[] = {10, 25, 50, 75, 90, 95, 99,
+                                           99.9, 99.99, 100};
+
+            std::cout << "Percentile spectrum for " << name << " ("
+                      << totalCount << " samples, us):" << std::endl;
+            for (double p : steps)
+            {
+                std::cout << "  " << std::right << std::setw(6) << std::fixed
+                          << std::setprecision(2) << p << "%  "
+                          << std::setw(12) << std::setprecision(1)
+                          << valueAtPercentile(p) / 1000.0 << std::endl;
+            }
+        }
+
+    } // namespace benchmark
+} // namespace idioms
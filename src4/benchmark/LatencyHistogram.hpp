@@ -0,0 +1,116 @@
+#ifndef IDIOMS_LATENCY_HISTOGRAM_HPP
+#define IDIOMS_LATENCY_HISTOGRAM_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace idioms
+{
+    namespace benchmark
+    {
+
+        /**
+         * High-dynamic-range latency histogram
+         *
+         * Values (nanoseconds) land in power-of-two buckets split into 32
+         * linear sub-buckets, so recording is two shifts and an add, the
+         * relative error stays around 3% across the whole range, and a
+         * multi-second outlier costs no more memory than a microsecond
+         * one. Averages hide exactly the tail this reports: use the
+         * percentile accessors or the spectrum dump.
+         */
+        class LatencyHistogram
+        {
+        private:
+            // 32 linear sub-buckets per power-of-two bucket
+            static const int SUB_BUCKET_BITS = 5;
+            static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+            std::vector<uint64_t> counts;
+            uint64_t totalCount;
+            uint64_t maxValue;
+            uint64_t minValue;
+            uint64_t sum;
+
+            // Bucket index for a value
+            static size_t bucketIndex(uint64_t nanos);
+
+            // Representative (upper-edge) value of a bucket
+            static uint64_t bucketValue(size_t index);
+
+        public:
+            LatencyHistogram();
+
+            /**
+             * Record one latency sample
+             *
+             * @param nanos Latency in nanoseconds
+             */
+            void record(uint64_t nanos);
+
+            /**
+             * Value at a percentile
+             *
+             * @param percentile Percentile in [0, 100]
+             * @return Latency in nanoseconds at that percentile
+             */
+            uint64_t valueAtPercentile(double percentile) const;
+
+            /**
+             * Number of recorded samples
+             *
+             * @return The sample count
+             */
+            uint64_t count() const;
+
+            /**
+             * Largest recorded sample
+             *
+             * @return Maximum latency in nanoseconds
+             */
+            uint64_t max() const;
+
+            /**
+             * Mean of the recorded samples
+             *
+             * @return Mean latency in nanoseconds
+             */
+            double mean() const;
+
+            /**
+             * Fold another histogram's samples into this one
+             *
+             * Bucket layouts are identical, so merging is one pass of
+             * count additions; used to combine per-thread histograms
+             * after a benchmark step.
+             *
+             * @param other Histogram to merge in
+             */
+            void merge(const LatencyHistogram &other);
+
+            /**
+             * Forget all recorded samples
+             */
+            void reset();
+
+            /**
+             * Print a one-line summary: count, mean, p50/p90/p99/p99.9, max
+             *
+             * @param name Label for the line
+             */
+            void printSummary(const std::string &name) const;
+
+            /**
+             * Print the percentile spectrum, one line per step, suitable
+             * for diffing across runs
+             *
+             * @param name Label for the dump
+             */
+            void printSpectrum(const std::string &name) const;
+        };
+
+    } // namespace benchmark
+} // namespace idioms
+
+#endif // IDIOMS_LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,248 @@
+#include "WorkloadGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+    // Trim leading and trailing whitespace from a config token
+    std::string trim(const std::string &s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = s.find_last_not_of(" \t\r");
+        return s.substr(begin, end - begin + 1);
+    }
+
+} // namespace
+
+namespace idioms
+{
+    namespace benchmark
+    {
+
+        WorkloadConfig WorkloadConfig::fromFile(const std::string &path)
+        {
+            std::ifstream in(path);
+            if (!in.is_open())
+            {
+                throw std::runtime_error("Cannot open workload config: " + path);
+            }
+
+            WorkloadConfig config;
+            std::string line;
+            while (std::getline(in, line))
+            {
+                // Strip comments and blank lines
+                size_t hash = line.find('#');
+                if (hash != std::string::npos)
+                {
+                    line = line.substr(0, hash);
+                }
+                size_t eq = line.find('=');
+                if (eq == std::string::npos)
+                {
+                    continue;
+                }
+
+                std::string name = trim(line.substr(0, eq));
+                std::string value = trim(line.substr(eq + 1));
+                if (name.empty() || value.empty())
+                {
+                    continue;
+                }
+
+                if (name == "seed")
+                {
+                    config.seed = std::stoull(value);
+                }
+                else if (name == "numOperations")
+                {
+                    config.numOperations = std::stoull(value);
+                }
+                else if (name == "keyCardinality")
+                {
+                    config.keyCardinality = std::stoull(value);
+                }
+                else if (name == "valueCardinality")
+                {
+                    config.valueCardinality = std::stoull(value);
+                }
+                else if (name == "keyLengthMin")
+                {
+                    config.keyLengthMin = std::stoull(value);
+                }
+                else if (name == "keyLengthMax")
+                {
+                    config.keyLengthMax = std::stoull(value);
+                }
+                else if (name == "valueLengthDist")
+                {
+                    config.valueLengthDist = value;
+                }
+                else if (name == "valueLengthLogMean")
+                {
+                    config.valueLengthLogMean = std::stod(value);
+                }
+                else if (name == "valueLengthLogSigma")
+                {
+                    config.valueLengthLogSigma = std::stod(value);
+                }
+                else if (name == "valueLengthMin")
+                {
+                    config.valueLengthMin = std::stoull(value);
+                }
+                else if (name == "valueLengthMax")
+                {
+                    config.valueLengthMax = std::stoull(value);
+                }
+                else if (name == "zipfSkew")
+                {
+                    config.zipfSkew = std::stod(value);
+                }
+                else if (name == "readFraction")
+                {
+                    config.readFraction = std::stod(value);
+                }
+                else if (name == "arrival")
+                {
+                    config.arrival = value;
+                }
+                else if (name == "targetOpsPerSec")
+                {
+                    config.targetOpsPerSec = std::stod(value);
+                }
+                else
+                {
+                    std::cout << "Ignoring unknown workload option '" << name
+                              << "'" << std::endl;
+                }
+            }
+
+            return config;
+        }
+
+        WorkloadGenerator::WorkloadGenerator(const WorkloadConfig &cfg)
+            : config(cfg), gen(cfg.seed), unitDist(0.0, 1.0)
+        {
+            // Fixed pools drawn first, so the operation stream that
+            // follows is reproducible from the seed alone
+            keyPool.reserve(config.keyCardinality);
+            for (size_t i = 0; i < config.keyCardinality; i++)
+            {
+                keyPool.push_back(makeString(config.keyLengthMin, config.keyLengthMax));
+            }
+
+            valuePool.reserve(config.valueCardinality);
+            for (size_t i = 0; i < config.valueCardinality; i++)
+            {
+                size_t length = drawValueLength();
+                valuePool.push_back(makeString(length, length));
+            }
+
+            // Zipfian CDF over key ranks; sampling is a binary search,
+            // which keeps the per-op cost flat in the cardinality
+            if (config.zipfSkew > 0.0)
+            {
+                zipfCdf.reserve(config.keyCardinality);
+                double sum = 0.0;
+                for (size_t rank = 1; rank <= config.keyCardinality; rank++)
+                {
+                    sum += 1.0 / std::pow(static_cast<double>(rank), config.zipfSkew);
+                    zipfCdf.push_back(sum);
+                }
+                for (double &cumulative : zipfCdf)
+                {
+                    cumulative /= sum;
+                }
+            }
+        }
+
+        std::string WorkloadGenerator::makeString(size_t minLen, size_t maxLen)
+        {
+            static const std::string alphabet =
+                "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.";
+            std::uniform_int_distribution<size_t> lenDist(minLen, maxLen);
+            std::uniform_int_distribution<size_t> charDist(0, alphabet.length() - 1);
+
+            std::string s(lenDist(gen), ' ');
+            for (char &c : s)
+            {
+                c = alphabet[charDist(gen)];
+            }
+            return s;
+        }
+
+        size_t WorkloadGenerator::drawValueLength()
+        {
+            if (config.valueLengthDist == "lognormal")
+            {
+                std::lognormal_distribution<double> dist(config.valueLengthLogMean,
+                                                         config.valueLengthLogSigma);
+                double length = dist(gen);
+                return std::min(config.valueLengthMax,
+                                std::max(config.valueLengthMin,
+                                         static_cast<size_t>(length)));
+            }
+
+            std::uniform_int_distribution<size_t> dist(config.valueLengthMin,
+                                                       config.valueLengthMax);
+            return dist(gen);
+        }
+
+        size_t WorkloadGenerator::drawKeyIndex()
+        {
+            if (zipfCdf.empty())
+            {
+                std::uniform_int_distribution<size_t> dist(0, keyPool.size() - 1);
+                return dist(gen);
+            }
+
+            double u = unitDist(gen);
+            auto it = std::lower_bound(zipfCdf.begin(), zipfCdf.end(), u);
+            return static_cast<size_t>(it - zipfCdf.begin());
+        }
+
+        bool WorkloadGenerator::hasNext() const
+        {
+            return emitted < config.numOperations;
+        }
+
+        Operation WorkloadGenerator::next()
+        {
+            Operation op;
+            op.type = unitDist(gen) < config.readFraction ? OpType::READ
+                                                          : OpType::WRITE;
+            op.key = keyPool[drawKeyIndex()];
+
+            std::uniform_int_distribution<size_t> valueDist(0, valuePool.size() - 1);
+            op.value = valuePool[valueDist(gen)];
+
+            if (config.arrival == "open")
+            {
+                // Poisson arrivals at the target rate: release times are
+                // fixed up front, so a slow system builds queueing delay
+                // instead of silently slowing the offered load
+                std::exponential_distribution<double> gap(config.targetOpsPerSec / 1e6);
+                nextReleaseUs += gap(gen);
+                op.releaseAtUs = nextReleaseUs;
+            }
+
+            emitted++;
+            return op;
+        }
+
+        const WorkloadConfig &WorkloadGenerator::getConfig() const
+        {
+            return config;
+        }
+
+    } // namespace benchmark
+} // namespace idioms
@@ -0,0 +1,165 @@
+#ifndef IDIOMS_WORKLOAD_GENERATOR_HPP
+#define IDIOMS_WORKLOAD_GENERATOR_HPP
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+namespace idioms
+{
+    namespace benchmark
+    {
+
+        /**
+         * Operation kinds emitted by the workload generator
+         */
+        enum class OpType
+        {
+            READ,
+            WRITE
+        };
+
+        /**
+         * One generated operation
+         *
+         * releaseAtUs is the open-loop release time in microseconds from
+         * the start of the run; closed-loop workloads leave it at zero
+         * and issue operations back to back.
+         */
+        struct Operation
+        {
+            OpType type;
+            std::string key;
+            std::string value;
+            double releaseAtUs;
+
+            Operation() : type(OpType::READ), releaseAtUs(0.0) {}
+        };
+
+        /**
+         * Workload shape, loadable from a key = value config file
+         *
+         * File format: one "name = value" per line, '#' starts a comment,
+         * unknown names are reported and ignored. Every field below is a
+         * valid name; anything not set keeps its default.
+         */
+        struct WorkloadConfig
+        {
+            // Reproducibility: the same seed and config yield the same
+            // operation stream
+            uint64_t seed = 42;
+            size_t numOperations = 100000;
+
+            // Distinct keys and values in the pools
+            size_t keyCardinality = 1000;
+            size_t valueCardinality = 10000;
+
+            // Key lengths, uniform in [min, max]
+            size_t keyLengthMin = 4;
+            size_t keyLengthMax = 24;
+
+            // Value lengths: "lognormal" (logMean/logSigma, clamped to
+            // [min, max]) or "uniform" over [min, max]
+            std::string valueLengthDist = "lognormal";
+            double valueLengthLogMean = 2.5;
+            double valueLengthLogSigma = 0.6;
+            size_t valueLengthMin = 1;
+            size_t valueLengthMax = 256;
+
+            // Key popularity skew (Zipfian theta); 0 means uniform
+            double zipfSkew = 0.99;
+
+            // Operation mix
+            double readFraction = 0.95;
+
+            // Arrival pattern: "closed" issues back to back, "open"
+            // schedules Poisson arrivals at the target rate regardless of
+            // completion times
+            std::string arrival = "closed";
+            double targetOpsPerSec = 10000.0;
+
+            /**
+             * Load a config from a file, starting from the defaults
+             *
+             * @param path Path of the config file
+             * @return The parsed config
+             * @throws std::runtime_error if the file cannot be read
+             */
+            static WorkloadConfig fromFile(const std::string &path);
+        };
+
+        /**
+         * Generates a reproducible operation stream with production-like
+         * skew: Zipfian key popularity, configurable length
+         * distributions, a fixed read/write mix and open- or closed-loop
+         * arrivals. Used by the benchmark binaries so capacity numbers
+         * are measured under the shape production actually sees.
+         */
+        class WorkloadGenerator
+        {
+        private:
+            WorkloadConfig config;
+            std::mt19937_64 gen;
+
+            // Pre-generated pools, fixed for the life of the run
+            std::vector<std::string> keyPool;
+            std::vector<std::string> valuePool;
+
+            // Cumulative Zipfian probabilities over the key pool, sampled
+            // by binary search; empty when the skew is zero
+            std::vector<double> zipfCdf;
+
+            std::uniform_real_distribution<double> unitDist;
+
+            // Open-loop arrival clock, microseconds from run start
+            double nextReleaseUs = 0.0;
+            size_t emitted = 0;
+
+            // Draw a random string with length uniform in [minLen, maxLen]
+            std::string makeString(size_t minLen, size_t maxLen);
+
+            // Draw a value length from the configured distribution
+            size_t drawValueLength();
+
+            // Draw a key index from the Zipfian (or uniform) popularity
+            size_t drawKeyIndex();
+
+        public:
+            /**
+             * Constructor
+             *
+             * Builds the key and value pools up front; generation after
+             * that is allocation-light.
+             *
+             * @param cfg Workload configuration
+             */
+            explicit WorkloadGenerator(const WorkloadConfig &cfg);
+
+            /**
+             * Whether the configured operation count has been emitted
+             *
+             * @return True while more operations remain
+             */
+            bool hasNext() const;
+
+            /**
+             * Generate the next operation
+             *
+             * @return The operation, with its open-loop release time set
+             *         when the arrival pattern is "open"
+             */
+            Operation next();
+
+            /**
+             * Get the active configuration
+             *
+             * @return The configuration this generator runs with
+             */
+            const WorkloadConfig &getConfig() const;
+        };
+
+    } // namespace benchmark
+} // namespace idioms
+
+#endif // IDIOMS_WORKLOAD_GENERATOR_HPP
@@ -1,15 +1,20 @@
 #include "Client.hpp"
 #include "../server/Server.hpp"
+#include "../query/ResultSet.hpp"
+#include "../query/MultiConditionQuery.hpp"
+#include "../numa/NumaPolicy.hpp"
 #include <algorithm>
+#include <atomic>
 #include <iostream>
-#include <unordered_set>
+#include <string_view>
+#include <thread>
 
 namespace idioms
 {
 
     DistributedIdiomsClient::DistributedIdiomsClient(int numServers, const std::string &dataDirectory,
                                                      bool useSuffixMode)
-        : useSuffixTreeMode(useSuffixMode)
+        : dataDir(dataDirectory), useSuffixTreeMode(useSuffixMode)
     {
 
         // Create DART router
@@ -21,6 +26,16 @@ namespace idioms
             servers.push_back(std::make_shared<DistributedIdiomsServer>(
                 i, dataDirectory, router, useSuffixTreeMode));
         }
+
+        filterCaches.resize(numServers);
+    }
+
+    void DistributedIdiomsClient::setNumaPolicy(const std::vector<int> &serverToNode)
+    {
+        for (size_t i = 0; i < servers.size() && i < serverToNode.size(); i++)
+        {
+            servers[i]->setNumaNode(serverToNode[i]);
+        }
     }
 
     DistributedIdiomsClient::~DistributedIdiomsClient()
@@ -46,6 +61,35 @@ namespace idioms
         std::cout << std::endl;
     }
 
+    void DistributedIdiomsClient::create_md_index_batch(const std::vector<IndexRecord> &records)
+    {
+        // Partition the batch by destination server; a record goes to every
+        // server responsible for its key, same as create_md_index
+        std::vector<std::vector<IndexRecord>> perServer(servers.size());
+
+        for (const auto &record : records)
+        {
+            for (int serverId : router->getServersForKey(record.key))
+            {
+                perServer[serverId].push_back(record);
+            }
+        }
+
+        std::cout << "Bulk loading " << records.size() << " index records..." << std::endl;
+
+        for (size_t serverId = 0; serverId < perServer.size(); serverId++)
+        {
+            if (perServer[serverId].empty())
+            {
+                continue;
+            }
+
+            std::cout << "  Server " << serverId << ": "
+                      << perServer[serverId].size() << " records" << std::endl;
+            servers[serverId]->bulkLoadIndexedKeys(std::move(perServer[serverId]));
+        }
+    }
+
     void DistributedIdiomsClient::delete_md_index(const std::string &key, const std::string &value, int objectId)
     {
         // Determine which servers should store this index record
@@ -64,6 +108,45 @@ namespace idioms
         std::cout << std::endl;
     }
 
+    bool DistributedIdiomsClient::filtersRuleOut(int serverId, const std::string &queryStr) const
+    {
+        // Only exact-key and suffix-key conditions have a filter to consult
+        std::string_view keyPart(queryStr);
+        size_t pos = keyPart.find('=');
+        if (pos != std::string_view::npos)
+        {
+            keyPart = keyPart.substr(0, pos);
+        }
+
+        if (keyPart.empty() || keyPart == "*" || keyPart.back() == '*')
+        {
+            return false;
+        }
+
+        bool suffixQuery = keyPart.front() == '*';
+        if (suffixQuery && !useSuffixTreeMode)
+        {
+            return false;
+        }
+
+        // Refresh the cached digest when the server's filters have changed
+        ServerFilterCache &cache = filterCaches[serverId];
+        uint64_t version = servers[serverId]->getFilterVersion();
+        if (!cache.valid || cache.version != version)
+        {
+            cache.keyFilter.loadDigest(servers[serverId]->getKeyFilterDigest());
+            cache.keySuffixFilter.loadDigest(servers[serverId]->getKeySuffixFilterDigest());
+            cache.version = version;
+            cache.valid = true;
+        }
+
+        if (suffixQuery)
+        {
+            return !cache.keySuffixFilter.mightContain(keyPart.substr(1));
+        }
+        return !cache.keyFilter.mightContain(keyPart);
+    }
+
     std::vector<int> DistributedIdiomsClient::findServersForQuery(const std::string &queryStr) const
     {
         // Determine which servers should receive this query
@@ -86,6 +169,13 @@ namespace idioms
 
         for (int serverId : destinationServers)
         {
+            // Skip servers whose filter digest proves they hold no match,
+            // without issuing the query at all
+            if (filtersRuleOut(serverId, queryStr))
+            {
+                continue;
+            }
+
             if (servers[serverId]->canHandleQuery(queryStr))
             {
                 if (!first)
@@ -104,29 +194,353 @@ namespace idioms
         return handlingServers;
     }
 
+    std::vector<int> DistributedIdiomsClient::findServersForCompoundQuery(const std::string &condition) const
+    {
+        // Repeated query shapes reuse the cached parse for routing too
+        std::shared_ptr<const query::MultiConditionQuery> multiQuery = query::parsedQuery(condition);
+        const std::vector<query::QueryCondition> &conditions = multiQuery->getConditions();
+        const std::vector<query::LogicalOperator> &logicalOps = multiQuery->getOperators();
+
+        // Per-condition handling sets, routed on each condition's own key
+        std::vector<std::vector<int>> conditionServers;
+        conditionServers.reserve(conditions.size());
+        for (const query::QueryCondition &cond : conditions)
+        {
+            conditionServers.push_back(findServersForQuery(cond.key + "=" + cond.value));
+        }
+
+        bool pureAnd = true;
+        for (query::LogicalOperator op : logicalOps)
+        {
+            if (op != query::AND)
+            {
+                pureAnd = false;
+                break;
+            }
+        }
+
+        if (pureAnd)
+        {
+            // Servers holding every condition's key can evaluate the whole
+            // conjunction locally via the semi-join path; one replica is
+            // enough because each holds the complete postings
+            std::vector<int> common = conditionServers[0];
+            for (size_t i = 1; i < conditionServers.size(); i++)
+            {
+                std::vector<int> kept;
+                for (int serverId : common)
+                {
+                    if (std::find(conditionServers[i].begin(), conditionServers[i].end(),
+                                  serverId) != conditionServers[i].end())
+                    {
+                        kept.push_back(serverId);
+                    }
+                }
+                common.swap(kept);
+            }
+
+            if (!common.empty())
+            {
+                int chosen = pickReplica(common);
+                std::cout << "Compound query served by server " << chosen << std::endl;
+                return {chosen};
+            }
+        }
+
+        // OR queries, or a conjunction whose keys share no replica: every
+        // condition's servers evaluate the full query and the client
+        // unions the partials. For now a conjunction split this way can
+        // under-report when no queried server holds all of its keys.
+        std::vector<int> all;
+        for (const std::vector<int> &serverIds : conditionServers)
+        {
+            for (int serverId : serverIds)
+            {
+                if (std::find(all.begin(), all.end(), serverId) == all.end())
+                {
+                    all.push_back(serverId);
+                }
+            }
+        }
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+
+    int DistributedIdiomsClient::pickReplica(const std::vector<int> &serverIds) const
+    {
+        // Round-robin across the healthy candidates. For now every local
+        // server instance is healthy; the MPI path can narrow the set via
+        // FaultManager status once that is wired into routing.
+        return serverIds[replicaCursor++ % serverIds.size()];
+    }
+
+    std::vector<int> DistributedIdiomsClient::fanOutQuery(const std::string &queryStr,
+                                                          const std::vector<int> &serverIds)
+    {
+        if (serverIds.empty())
+        {
+            return {};
+        }
+        if (serverIds.size() == 1)
+        {
+            return servers[serverIds[0]]->executeQuery(queryStr);
+        }
+
+        // One partial per destination; a bounded worker pool pulls
+        // server indices off a shared cursor, so a wildcard query over
+        // 32 virtual servers runs 32 executions concurrently
+        std::vector<query::ResultSet> partials(serverIds.size());
+
+        size_t numWorkers = std::thread::hardware_concurrency();
+        if (numWorkers == 0)
+        {
+            numWorkers = 1;
+        }
+        numWorkers = std::min(numWorkers, serverIds.size());
+
+        std::atomic<size_t> nextServer{0};
+        std::vector<std::thread> workers;
+        workers.reserve(numWorkers);
+
+        for (size_t w = 0; w < numWorkers; w++)
+        {
+            workers.emplace_back(
+                [&]()
+                {
+                    size_t i;
+                    int boundNode = -1;
+                    while ((i = nextServer.fetch_add(1)) < serverIds.size())
+                    {
+                        // Follow the server's NUMA assignment so the trie
+                        // traversal runs on the socket holding the trie
+                        int node = servers[serverIds[i]]->getNumaNode();
+                        if (node >= 0 && node != boundNode &&
+                            numa::bindCurrentThreadToNode(node))
+                        {
+                            boundNode = node;
+                        }
+                        partials[i] = query::ResultSet(
+                            servers[serverIds[i]]->executeQuery(queryStr));
+                    }
+                });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        // Pairwise reduction: each round folds the top half of the live
+        // partials into the bottom half on separate threads, so the
+        // merge takes log2(n) rounds instead of a serial chain
+        size_t live = partials.size();
+        while (live > 1)
+        {
+            size_t half = (live + 1) / 2;
+
+            std::vector<std::thread> mergers;
+            mergers.reserve(live - half);
+            for (size_t i = half; i < live; i++)
+            {
+                mergers.emplace_back(
+                    [&partials, i, half]()
+                    {
+                        partials[i - half].unionWith(partials[i]);
+                    });
+            }
+            for (auto &merger : mergers)
+            {
+                merger.join();
+            }
+
+            live = half;
+        }
+
+        return partials[0].takeVector();
+    }
+
     std::vector<int> DistributedIdiomsClient::md_search(const std::string &queryStr)
     {
-        // Find which servers can handle this query
-        std::vector<int> handlingServers = findServersForQuery(queryStr);
+        if (query::isCountDistinctQuery(queryStr))
+        {
+            // COUNT(DISTINCT key) computes one integer on one replica of
+            // the key; every replica holds the complete entries for it
+            std::vector<int> serverIds =
+                router->getServersForKey(query::countDistinctKey(queryStr));
+            if (serverIds.empty())
+            {
+                return {0};
+            }
+            return servers[pickReplica(serverIds)]->executeQuery(queryStr);
+        }
 
-        // Send query to selected servers and collect results
-        std::unordered_set<int> resultSet;
+        if (query::isCountQuery(queryStr))
+        {
+            std::string condition = query::countQueryCondition(queryStr);
+
+            size_t pos = condition.find('=');
+            std::string keyPart = pos != std::string::npos ? condition.substr(0, pos) : condition;
+            bool exactKey = !keyPart.empty() && keyPart != "*" &&
+                            keyPart.front() != '*' && keyPart.back() != '*';
+
+            if (exactKey)
+            {
+                // Every replica of an exact key holds the same postings, so
+                // one server's count is the cluster count — no IDs shipped
+                std::vector<int> handlingServers = findServersForQuery(condition);
+                if (handlingServers.empty())
+                {
+                    return {0};
+                }
+                return servers[pickReplica(handlingServers)]->executeQuery(queryStr);
+            }
+
+            // For now, wildcard-key counts still union the IDs client-side:
+            // per-server counts overlap through replication and cannot be
+            // summed without double counting
+            return {static_cast<int>(md_search(condition).size())};
+        }
 
-        for (int serverId : handlingServers)
+        // Route on the bare condition; the full query string (including any
+        // LIMIT modifier) is what each server executes
+        std::string condition;
+        size_t limit = query::parseLimitModifier(queryStr, condition);
+
+        // Compound conditions route on every condition's key, not just
+        // the first one, so the chosen server(s) can evaluate all of them
+        if (condition.find(" AND ") != std::string::npos ||
+            condition.find(" OR ") != std::string::npos)
         {
-            // Execute query on this server
-            std::vector<int> serverResults = servers[serverId]->executeQuery(queryStr);
+            std::vector<int> merged =
+                fanOutQuery(queryStr, findServersForCompoundQuery(condition));
+            if (limit > 0 && merged.size() > limit)
+            {
+                merged.resize(limit);
+            }
+            return merged;
+        }
+
+        // Find which servers can handle this query
+        std::vector<int> handlingServers = findServersForQuery(condition);
 
-            // Merge results
-            resultSet.insert(serverResults.begin(), serverResults.end());
+        // Exact-key conditions are fully replicated, so any one replica
+        // holds the complete answer; rotate reads across them instead of
+        // asking every replica for the same postings
+        size_t eqPos = condition.find('=');
+        std::string keyPart = eqPos != std::string::npos ? condition.substr(0, eqPos) : condition;
+        bool exactKey = !keyPart.empty() && keyPart != "*" &&
+                        keyPart.front() != '*' && keyPart.back() != '*';
+
+        if (exactKey && handlingServers.size() > 1)
+        {
+            int chosen = pickReplica(handlingServers);
+            std::cout << "Read served by replica on server " << chosen << std::endl;
+            handlingServers.assign(1, chosen);
         }
 
-        // Convert set to vector for return
-        std::vector<int> results(resultSet.begin(), resultSet.end());
-        std::sort(results.begin(), results.end()); // Sort for deterministic output
+        // Dispatch to every selected server concurrently and merge their
+        // sorted results with the parallel reduction
+        std::vector<int> results = fanOutQuery(queryStr, handlingServers);
+
+        // Each server already capped its own results; cap the merged set too
+        if (limit > 0 && results.size() > limit)
+        {
+            results.resize(limit);
+        }
         return results;
     }
 
+    std::vector<int> DistributedIdiomsClient::md_range_search(const std::string &key,
+                                                              double minValue, double maxValue)
+    {
+        // Range queries route like exact-key lookups: only the servers
+        // responsible for the key hold its numeric entries, and every
+        // replica holds all of them, so one replica serves the read
+        std::vector<int> serverIds = router->getServersForKey(key);
+        if (serverIds.empty())
+        {
+            return {};
+        }
+
+        return servers[pickReplica(serverIds)]->executeRangeQuery(key, minValue, maxValue);
+    }
+
+    std::vector<std::pair<std::string, int>> DistributedIdiomsClient::md_group_by(const std::string &key)
+    {
+        // Like range queries, grouping routes to the servers responsible
+        // for the key; one replica holds all of its entries
+        std::vector<int> serverIds = router->getServersForKey(key);
+        if (serverIds.empty())
+        {
+            return {};
+        }
+
+        return servers[pickReplica(serverIds)]->executeGroupByQuery(key);
+    }
+
+    int DistributedIdiomsClient::md_subscribe(const std::string &queryStr, std::vector<int> &initialResults)
+    {
+        initialResults.clear();
+
+        // Route like a one-shot read: a pure conjunction registers on one
+        // replica holding every condition's key. For now an OR whose keys
+        // span servers misses matches held only elsewhere, the same caveat
+        // as split compound reads.
+        bool compound = queryStr.find(" AND ") != std::string::npos ||
+                        queryStr.find(" OR ") != std::string::npos;
+        std::vector<int> handlingServers = compound ? findServersForCompoundQuery(queryStr)
+                                                    : findServersForQuery(queryStr);
+        if (handlingServers.empty())
+        {
+            return -1;
+        }
+
+        int serverId = pickReplica(handlingServers);
+        int serverSubId = servers[serverId]->registerStandingQuery(queryStr, initialResults);
+
+        int handle = nextSubscriptionHandle++;
+        subscriptions[handle] = {serverId, serverSubId};
+        return handle;
+    }
+
+    void DistributedIdiomsClient::md_poll_subscription(int handle, std::vector<int> &added,
+                                                       std::vector<int> &removed)
+    {
+        added.clear();
+        removed.clear();
+
+        auto it = subscriptions.find(handle);
+        if (it == subscriptions.end())
+        {
+            return;
+        }
+
+        auto delta = servers[it->second.first]->drainStandingQueryDeltas(it->second.second);
+        added = std::move(delta.added);
+        removed = std::move(delta.removed);
+    }
+
+    void DistributedIdiomsClient::md_unsubscribe(int handle)
+    {
+        auto it = subscriptions.find(handle);
+        if (it == subscriptions.end())
+        {
+            return;
+        }
+
+        servers[it->second.first]->unregisterStandingQuery(it->second.second);
+        subscriptions.erase(it);
+    }
+
+    void DistributedIdiomsClient::freezeAllIndexes()
+    {
+        std::cout << "Freezing indices into traversal order..." << std::endl;
+        for (const auto &server : servers)
+        {
+            server->freezeIndexes();
+        }
+    }
+
     void DistributedIdiomsClient::checkpointAllIndices()
     {
         std::cout << "Checkpointing indices to disk..." << std::endl;
@@ -145,16 +559,112 @@ namespace idioms
     void DistributedIdiomsClient::recoverAllIndices()
     {
         std::cout << "Recovering indices from disk..." << std::endl;
+
+        // Each server recovers from its own checkpoint file, so cold-start
+        // is embarrassingly parallel: one thread per server overlaps the
+        // file reads and trie rebuilds instead of serializing them
+        std::vector<std::thread> workers;
+        workers.reserve(servers.size());
+
         for (const auto &server : servers)
         {
-            bool success = server->recoverIndex();
-            if (!success)
+            workers.emplace_back(
+                [&server]()
+                {
+                    bool success = server->recoverIndex();
+                    if (!success)
+                    {
+                        std::cerr << "Warning: Failed to recover index for server "
+                                  << server->getId() << std::endl;
+                    }
+                });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        std::cout << "Recovery complete." << std::endl;
+    }
+
+    void DistributedIdiomsClient::rebalanceServers(int newNumServers)
+    {
+        int oldNumServers = static_cast<int>(servers.size());
+        if (newNumServers <= 0 || newNumServers == oldNumServers)
+        {
+            return;
+        }
+
+        // Grow the fleet first so migration targets exist
+        for (int i = oldNumServers; i < newNumServers; i++)
+        {
+            servers.push_back(std::make_shared<DistributedIdiomsServer>(
+                i, dataDir, router, useSuffixTreeMode));
+        }
+
+        // Remapping only changes vnode-to-server ownership; key-to-vnode
+        // assignment is stable, so sources can still locate their entries
+        std::vector<VnodeMigration> migrations = router->remapServers(newNumServers);
+
+        applyMigrations(migrations);
+
+        // Shrinking: the remap moved every vnode off the removed servers,
+        // so they can simply be retired
+        if (newNumServers < oldNumServers)
+        {
+            servers.resize(newNumServers);
+        }
+
+        // Cached filter digests are stale for every server that gained or
+        // lost vnodes; refetch lazily
+        filterCaches.assign(servers.size(), ServerFilterCache());
+    }
+
+    void DistributedIdiomsClient::applyMigrations(const std::vector<VnodeMigration> &migrations)
+    {
+        // Ship each migrating vnode's entries to its new owner, then drop
+        // them at the source in one rebuild per server
+        std::unordered_map<int, std::vector<uint32_t>> outgoing;
+        for (const auto &migration : migrations)
+        {
+            std::vector<IndexRecord> records =
+                servers[migration.fromServer]->exportVirtualNodes({migration.vnodeId});
+
+            std::cout << "Migrating vnode " << migration.vnodeId << " ("
+                      << records.size() << " entries) from server "
+                      << migration.fromServer << " to server "
+                      << migration.toServer << std::endl;
+
+            if (!records.empty())
             {
-                std::cerr << "Warning: Failed to recover index for server "
-                          << server->getId() << std::endl;
+                servers[migration.toServer]->bulkLoadIndexedKeys(std::move(records));
             }
+            outgoing[migration.fromServer].push_back(migration.vnodeId);
         }
-        std::cout << "Recovery complete." << std::endl;
+
+        for (const auto &[sourceServer, vnodeIds] : outgoing)
+        {
+            servers[sourceServer]->dropVirtualNodes(vnodeIds);
+        }
+    }
+
+    void DistributedIdiomsClient::enableLoadRebalancing(int intervalSeconds)
+    {
+        // The router computes migration plans from its per-vnode load
+        // accounting; data movement comes back through the same machinery
+        // server-count rebalancing uses
+        router->startRebalancer(intervalSeconds,
+                                [this](const std::vector<VnodeMigration> &migrations)
+                                {
+                                    applyMigrations(migrations);
+                                    filterCaches.assign(servers.size(), ServerFilterCache());
+                                });
+    }
+
+    void DistributedIdiomsClient::disableLoadRebalancing()
+    {
+        router->stopRebalancer();
     }
 
 } // namespace idioms
\ No newline at end of file
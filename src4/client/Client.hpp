@@ -6,12 +6,14 @@
 #include <memory>
 #include <unordered_map>
 #include "../dart/DART.hpp"
+#include "../index/KeyBloomFilter.hpp"
 
 namespace idioms
 {
 
     // Forward declarations
     class DistributedIdiomsServer;
+    struct IndexRecord;
 
     /**
      * Client for the distributed IDIOMS system
@@ -22,11 +24,63 @@ namespace idioms
     private:
         std::shared_ptr<DARTRouter> router;
         std::vector<std::shared_ptr<DistributedIdiomsServer>> servers;
+        std::string dataDir;
         bool useSuffixTreeMode;
 
+        /**
+         * Cached copy of one server's key-filter digests
+         *
+         * Refetched whenever the server's filter version moves. Filters only
+         * grow, so a digest that is fresher than its recorded version can
+         * never wrongly rule a server out.
+         */
+        struct ServerFilterCache
+        {
+            uint64_t version = 0;
+            bool valid = false;
+            KeyBloomFilter keyFilter;
+            KeyBloomFilter keySuffixFilter;
+        };
+
+        mutable std::vector<ServerFilterCache> filterCaches;
+
+        // True if the cached filters prove the server holds no match for the
+        // query's key part
+        bool filtersRuleOut(int serverId, const std::string &queryStr) const;
+
         // Internal method to track servers that can handle a specific query
         std::vector<int> findServersForQuery(const std::string &queryStr) const;
 
+        // Route a compound (AND/OR) condition: a pure conjunction goes to
+        // one replica holding every condition's key so the server can run
+        // its semi-join locally; otherwise every condition's servers get
+        // the full query and the client unions the partial results
+        std::vector<int> findServersForCompoundQuery(const std::string &condition) const;
+
+        // Ship each migrating vnode's index entries from its old owner to
+        // its new one and drop them at the source
+        void applyMigrations(const std::vector<VnodeMigration> &migrations);
+
+        // Rotates exact-key reads across replicas so replication buys read
+        // throughput instead of only durability
+        mutable uint64_t replicaCursor = 0;
+
+        // Pick one replica from a candidate set, round-robin
+        int pickReplica(const std::vector<int> &serverIds) const;
+
+        // Execute the query on every listed server concurrently and merge
+        // the sorted partials with a pairwise parallel reduction; the
+        // in-process servers are only a function call away, so a wildcard
+        // fan-out should use the cores instead of a serial loop
+        std::vector<int> fanOutQuery(const std::string &queryStr,
+                                     const std::vector<int> &serverIds);
+
+        // Standing-query subscriptions: client handle -> (server ID, the
+        // server's own subscription ID). Handles stay unique across
+        // servers, which each number their subscriptions independently.
+        std::unordered_map<int, std::pair<int, int>> subscriptions;
+        int nextSubscriptionHandle = 1;
+
     public:
         /**
          * Constructor
@@ -38,6 +92,20 @@ namespace idioms
         DistributedIdiomsClient(int numServers, const std::string &dataDirectory,
                                 bool useSuffixMode = false);
 
+        /**
+         * Assign each server to a NUMA node
+         *
+         * Later index mutations bind their arena blocks to the server's
+         * node, and the query fan-out workers pin themselves to it
+         * before traversing the server's tries. Call it right after
+         * construction, before data is loaded; the assignment is a
+         * deployment decision made in main's setup.
+         *
+         * @param serverToNode Node ID per server ID (-1 leaves a server
+         *        to the kernel's default placement)
+         */
+        void setNumaPolicy(const std::vector<int> &serverToNode);
+
         /**
          * Destructor
          */
@@ -52,6 +120,17 @@ namespace idioms
          */
         void create_md_index(const std::string &key, const std::string &value, int objectId);
 
+        /**
+         * Bulk-load a batch of metadata index records
+         *
+         * Records are partitioned by destination server and handed to each
+         * server's bulk loader in one call, bypassing per-record locking and
+         * per-record trie traversal.
+         *
+         * @param records Index records to load
+         */
+        void create_md_index_batch(const std::vector<IndexRecord> &records);
+
         /**
          * Delete a metadata index record
          *
@@ -69,6 +148,71 @@ namespace idioms
          */
         std::vector<int> md_search(const std::string &queryStr);
 
+        /**
+         * Perform a numeric range search over a metadata key
+         *
+         * Served from the servers' numeric secondary indices; only values
+         * that parsed as numbers at index time are considered.
+         *
+         * @param key Metadata attribute key
+         * @param minValue Lower bound (inclusive)
+         * @param maxValue Upper bound (inclusive)
+         * @return Vector of matching object IDs
+         */
+        std::vector<int> md_range_search(const std::string &key, double minValue, double maxValue);
+
+        /**
+         * Group the objects carrying a metadata key by its values
+         *
+         * The grouping runs server-side and only the (value, count) rows
+         * travel back, so reporting over a large key costs a few rows
+         * instead of the full ID set per value.
+         *
+         * @param key Metadata attribute key
+         * @return Sorted (value, object count) rows
+         */
+        std::vector<std::pair<std::string, int>> md_group_by(const std::string &key);
+
+        /**
+         * Register a standing query on the server holding its keys
+         *
+         * The server evaluates the query once, then re-tests changed
+         * objects on every insert and delete, so a poller's recurring
+         * full evaluation becomes O(changes) drained via
+         * md_poll_subscription.
+         *
+         * @param queryStr Conditions joined with " AND " / " OR "
+         * @param initialResults Receives the objects matching at registration
+         * @return Subscription handle, or -1 if no server handles the query
+         */
+        int md_subscribe(const std::string &queryStr, std::vector<int> &initialResults);
+
+        /**
+         * Drain one subscription's membership changes since the last poll
+         *
+         * @param handle Handle returned by md_subscribe
+         * @param added Receives the objects that started matching
+         * @param removed Receives the objects that stopped matching
+         */
+        void md_poll_subscription(int handle, std::vector<int> &added,
+                                  std::vector<int> &removed);
+
+        /**
+         * Drop a standing query
+         *
+         * @param handle Handle returned by md_subscribe
+         */
+        void md_unsubscribe(int handle);
+
+        /**
+         * Rewrite every server's key tries into traversal order
+         *
+         * Call after the bulk load, before the read-mostly phase: the
+         * relayout pays one pass over the tries so every subsequent
+         * prefix descent reads sequential cache lines.
+         */
+        void freezeAllIndexes();
+
         /**
          * Checkpoint all server indices to disk
          */
@@ -78,6 +222,33 @@ namespace idioms
          * Recover all server indices from disk
          */
         void recoverAllIndices();
+
+        /**
+         * Change the server count, migrating only the affected virtual nodes
+         *
+         * Remaps the DART router, then ships each migrating vnode's index
+         * entries from its old owner to its new one and drops them at the
+         * source; vnodes whose owner is unchanged move no data.
+         *
+         * @param newNumServers New number of servers (grow or shrink)
+         */
+        void rebalanceServers(int newNumServers);
+
+        /**
+         * Start the router's background load rebalancer
+         *
+         * Periodically moves hot virtual nodes from overloaded servers to
+         * underloaded ones, based on the per-vnode record and query counts
+         * the servers feed into the router.
+         *
+         * @param intervalSeconds Seconds between rebalancing passes
+         */
+        void enableLoadRebalancing(int intervalSeconds);
+
+        /**
+         * Stop the background load rebalancer
+         */
+        void disableLoadRebalancing();
     };
 
 } // namespace idioms
@@ -1,4 +1,5 @@
 #include "ClientManager.hpp"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <chrono>
@@ -10,7 +11,7 @@ namespace idioms
 
         ClientManager::ClientManager(int mpiWorldSize, const std::string &dataDirectory, bool useSuffixMode)
             : worldSize(mpiWorldSize), dataDir(dataDirectory), useSuffixTreeMode(useSuffixMode),
-              clientIdCounter(0), running(false)
+              clientIdCounter(0), running(false), requestSequence(1)
         {
 
             // Create shared DART router
@@ -24,17 +25,31 @@ namespace idioms
             stop();
         }
 
-        void ClientManager::start()
+        bool ClientManager::start()
         {
             if (running.load())
             {
-                return; // Already running
+                return true; // Already running
+            }
+
+            // The engine thread probes and receives while submitters send,
+            // which needs full MPI thread support — same guard as the
+            // server's worker pool. Refusing here turns what would be
+            // silent message-matching corruption into a diagnostic.
+            int provided;
+            MPI_Query_thread(&provided);
+            if (provided != MPI_THREAD_MULTIPLE)
+            {
+                std::cerr << "Client Manager engine disabled: MPI_THREAD_MULTIPLE "
+                          << "not available (initialize with MPI_Init_thread)" << std::endl;
+                return false;
             }
 
             running.store(true);
             clientThread = std::thread(&ClientManager::processClientRequests, this);
 
             std::cout << "Client Manager started" << std::endl;
+            return true;
         }
 
         void ClientManager::stop()
@@ -51,6 +66,20 @@ namespace idioms
                 clientThread.join();
             }
 
+            // Wake anyone still blocked in waitForResult
+            completionCv.notify_all();
+
+            // Futures still pending when the engine stops resolve to
+            // empty results, matching waitForResult's behavior
+            {
+                std::lock_guard<std::mutex> lock(completionMutex);
+                for (auto &entry : resultPromises)
+                {
+                    entry.second.set_value({});
+                }
+                resultPromises.clear();
+            }
+
             // Clean up clients
             std::lock_guard<std::mutex> lock(clientsMutex);
             clients.clear();
@@ -126,17 +155,238 @@ namespace idioms
             return clientIdCounter.fetch_add(1);
         }
 
+        uint64_t ClientManager::packRequestId(int clientId, uint64_t sequence)
+        {
+            // The servers echo the ID untouched, so the client lives in
+            // the high half and the sequence in the low half
+            return (static_cast<uint64_t>(static_cast<uint32_t>(clientId)) << 32) |
+                   (sequence & 0xffffffffu);
+        }
+
+        uint64_t ClientManager::submitQuery(int clientId, const std::string &queryStr)
+        {
+            uint64_t requestId = packRequestId(clientId, requestSequence.fetch_add(1));
+
+            {
+                std::lock_guard<std::mutex> lock(submissionMutex);
+                submissions.push_back({clientId, requestId, queryStr});
+            }
+
+            return requestId;
+        }
+
+        std::future<std::vector<int>> ClientManager::queryAsync(int clientId, const std::string &queryStr)
+        {
+            uint64_t requestId = packRequestId(clientId, requestSequence.fetch_add(1));
+
+            std::promise<std::vector<int>> promise;
+            std::future<std::vector<int>> future = promise.get_future();
+
+            // Register the promise before the submission is visible, so
+            // the engine cannot complete the request first
+            {
+                std::lock_guard<std::mutex> lock(completionMutex);
+                resultPromises.emplace(requestId, std::move(promise));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(submissionMutex);
+                submissions.push_back({clientId, requestId, queryStr});
+            }
+
+            return future;
+        }
+
+        bool ClientManager::tryGetResult(int clientId, uint64_t requestId, std::vector<int> &results)
+        {
+            std::lock_guard<std::mutex> lock(completionMutex);
+
+            auto queueIt = completionQueues.find(clientId);
+            if (queueIt == completionQueues.end())
+            {
+                return false;
+            }
+
+            for (auto it = queueIt->second.begin(); it != queueIt->second.end(); ++it)
+            {
+                if (it->requestId == requestId)
+                {
+                    results = std::move(it->results);
+                    queueIt->second.erase(it);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        std::vector<int> ClientManager::waitForResult(int clientId, uint64_t requestId)
+        {
+            std::unique_lock<std::mutex> lock(completionMutex);
+
+            while (true)
+            {
+                auto queueIt = completionQueues.find(clientId);
+                if (queueIt != completionQueues.end())
+                {
+                    for (auto it = queueIt->second.begin(); it != queueIt->second.end(); ++it)
+                    {
+                        if (it->requestId == requestId)
+                        {
+                            std::vector<int> results = std::move(it->results);
+                            queueIt->second.erase(it);
+                            return results;
+                        }
+                    }
+                }
+
+                if (!running.load())
+                {
+                    // The engine stopped underneath the waiter
+                    return {};
+                }
+
+                completionCv.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+
+        void ClientManager::completeRequest(uint64_t requestId, InFlightQuery &query)
+        {
+            // Servers return sorted, deduplicated postings; merged streams
+            // only need the duplicates across servers removed
+            std::sort(query.results.begin(), query.results.end());
+            query.results.erase(std::unique(query.results.begin(), query.results.end()),
+                                query.results.end());
+
+            {
+                std::lock_guard<std::mutex> lock(completionMutex);
+
+                // A registered future takes delivery directly; everything
+                // else parks in the client's completion queue
+                auto promiseIt = resultPromises.find(requestId);
+                if (promiseIt != resultPromises.end())
+                {
+                    promiseIt->second.set_value(std::move(query.results));
+                    resultPromises.erase(promiseIt);
+                }
+                else
+                {
+                    completionQueues[query.clientId].push_back(
+                        {requestId, std::move(query.results)});
+                }
+            }
+            completionCv.notify_all();
+        }
+
+        void ClientManager::dispatchSubmissions()
+        {
+            std::deque<PendingSubmission> batch;
+            {
+                std::lock_guard<std::mutex> lock(submissionMutex);
+                batch.swap(submissions);
+            }
+
+            for (const PendingSubmission &submission : batch)
+            {
+                std::vector<int> serverIds = router->getDestinationServers(submission.queryStr);
+
+                InFlightQuery query;
+                query.clientId = submission.clientId;
+                query.outstanding = serverIds.size();
+
+                if (serverIds.empty())
+                {
+                    completeRequest(submission.requestId, query);
+                    continue;
+                }
+
+                // Fan the query out without waiting for any response; the
+                // echoed request ID reunites the responses with this entry
+                mpi::QueryMessage msg(submission.queryStr, router->getRoutingEpoch(),
+                                      submission.requestId);
+                auto buffer = msg.serialize();
+                for (int serverId : serverIds)
+                {
+                    // MPI ranks start at 0, but rank 0 is reserved for client
+                    int serverRank = serverId + 1;
+                    MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, serverRank,
+                             mpi::QUERY_TAG, MPI_COMM_WORLD);
+                }
+                mpi::messageBufferPool().release(std::move(buffer));
+
+                inFlight[submission.requestId] = std::move(query);
+            }
+        }
+
+        bool ClientManager::drainResponses()
+        {
+            bool anyArrived = false;
+
+            int flag = 1;
+            while (flag)
+            {
+                MPI_Status status;
+                MPI_Iprobe(MPI_ANY_SOURCE, mpi::RESULT_TAG, MPI_COMM_WORLD, &flag, &status);
+                if (!flag)
+                {
+                    break;
+                }
+
+                int msgSize;
+                MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+                auto buffer = mpi::messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, status.MPI_SOURCE,
+                         mpi::RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                auto response = mpi::ResponseMessage::deserialize(buffer);
+                mpi::messageBufferPool().release(std::move(buffer));
+                anyArrived = true;
+
+                auto it = inFlight.find(response.requestId);
+                if (it == inFlight.end())
+                {
+                    // Not ours — a stray response from outside the engine
+                    continue;
+                }
+
+                InFlightQuery &query = it->second;
+                query.results.insert(query.results.end(),
+                                     response.results.begin(), response.results.end());
+
+                if (--query.outstanding == 0)
+                {
+                    completeRequest(response.requestId, query);
+                    inFlight.erase(it);
+                }
+            }
+
+            return anyArrived;
+        }
+
         void ClientManager::processClientRequests()
         {
-            // In a real implementation, this would handle client requests from a queue
-            // For now, we'll just periodically check for inactive clients
+            // The multiplexing engine: one thread sends every client's
+            // queries as they are submitted and matches responses back by
+            // their echoed (clientId, sequence) request ID, so many
+            // requests from many clients stay in flight at once instead
+            // of serializing on one blocked receive.
+            //
+            // For now queries routed through the engine should use
+            // submitQuery rather than a per-client md_search: both paths
+            // receive on RESULT_TAG, and the engine would swallow the
+            // direct call's response.
 
             while (running.load())
             {
-                // Do any periodic tasks
+                dispatchSubmissions();
 
-                // Sleep to avoid busy-waiting
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (!drainResponses())
+                {
+                    // Nothing arrived; yield before probing again
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
             }
         }
 
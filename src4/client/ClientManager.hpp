@@ -8,6 +8,9 @@
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include <deque>
+#include <future>
+#include <condition_variable>
 #include <mpi.h>
 #include "../dart/DART.hpp"
 #include "../mpi/MPIClient.hpp"
@@ -45,6 +48,73 @@ namespace idioms
             // Assign a client ID to a new client
             int assignClientId();
 
+            /**
+             * One query handed to the multiplexer, tagged with the
+             * submitting client so its responses find their way back
+             */
+            struct PendingSubmission
+            {
+                int clientId;
+                uint64_t requestId;
+                std::string queryStr;
+            };
+
+            /**
+             * Fan-out state of one request the engine is still collecting
+             * server responses for
+             */
+            struct InFlightQuery
+            {
+                int clientId;
+                size_t outstanding;
+                std::vector<int> results;
+            };
+
+            /**
+             * A finished request sitting in its client's completion queue
+             */
+            struct CompletedQuery
+            {
+                uint64_t requestId;
+                std::vector<int> results;
+            };
+
+            // Queries submitted but not yet sent; drained by the engine
+            std::mutex submissionMutex;
+            std::deque<PendingSubmission> submissions;
+
+            // Requests with responses still outstanding, keyed by the wire
+            // request ID. Touched only by the engine thread.
+            std::unordered_map<uint64_t, InFlightQuery> inFlight;
+
+            // Per-client completion queues the engine demultiplexes into
+            std::mutex completionMutex;
+            std::condition_variable completionCv;
+            std::unordered_map<int, std::deque<CompletedQuery>> completionQueues;
+
+            // Promises registered by queryAsync for requests still in
+            // flight; the engine fulfills these directly instead of
+            // parking the result in a completion queue. Guarded by
+            // completionMutex.
+            std::unordered_map<uint64_t, std::promise<std::vector<int>>> resultPromises;
+
+            // Low half of the packed wire request ID
+            std::atomic<uint64_t> requestSequence;
+
+            // Pack (clientId, sequence) into the request ID the servers
+            // echo, so one demultiplexer serves every client
+            static uint64_t packRequestId(int clientId, uint64_t sequence);
+
+            // Send newly submitted queries into the MPI fan-out
+            void dispatchSubmissions();
+
+            // Pull arrived responses off the wire and complete requests;
+            // true if anything arrived
+            bool drainResponses();
+
+            // Park a finished request in its client's completion queue
+            void completeRequest(uint64_t requestId, InFlightQuery &query);
+
         public:
             /**
              * Constructor
@@ -62,8 +132,15 @@ namespace idioms
 
             /**
              * Start the client manager
+             *
+             * The multiplexing engine runs on its own thread and makes MPI
+             * calls concurrently with the submitters, which needs full MPI
+             * thread support.
+             *
+             * @return True if the engine started; false if the MPI library
+             *         does not provide MPI_THREAD_MULTIPLE
              */
-            void start();
+            bool start();
 
             /**
              * Stop the client manager
@@ -113,6 +190,55 @@ namespace idioms
              * @return True if the client ID is valid, false otherwise
              */
             bool isValidClientId(int clientId);
+
+            /**
+             * Submit a query to the multiplexed send/receive engine
+             *
+             * The engine keeps every client's requests in flight at once
+             * and demultiplexes responses by their echoed request ID, so
+             * concurrent clients no longer serialize on one blocked
+             * receive. The call returns immediately; collect the answer
+             * with tryGetResult or waitForResult.
+             *
+             * @param clientId Client ID the result should be delivered to
+             * @param queryStr Query string in the format "key=value" with optional wildcards (*)
+             * @return Request ID identifying the eventual completion
+             */
+            uint64_t submitQuery(int clientId, const std::string &queryStr);
+
+            /**
+             * Collect a completed query without blocking
+             *
+             * @param clientId Client ID the query was submitted under
+             * @param requestId Request ID returned by submitQuery
+             * @param results Receives the merged results on success
+             * @return True if the request had completed
+             */
+            bool tryGetResult(int clientId, uint64_t requestId, std::vector<int> &results);
+
+            /**
+             * Block until a submitted query completes
+             *
+             * @param clientId Client ID the query was submitted under
+             * @param requestId Request ID returned by submitQuery
+             * @return Merged results from every responding server
+             */
+            std::vector<int> waitForResult(int clientId, uint64_t requestId);
+
+            /**
+             * Submit a query and receive its completion as a future
+             *
+             * Backed by the same multiplexed engine as submitQuery, so one
+             * application thread can hold hundreds of futures while the
+             * engine keeps every request in flight; no thread blocks until
+             * someone calls get(). A future still pending when the manager
+             * stops resolves to empty results, matching waitForResult.
+             *
+             * @param clientId Client ID the query is submitted under
+             * @param queryStr Query string in the format "key=value" with optional wildcards (*)
+             * @return Future resolving to the merged results
+             */
+            std::future<std::vector<int>> queryAsync(int clientId, const std::string &queryStr);
         };
 
     } // namespace client
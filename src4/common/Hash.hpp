@@ -0,0 +1,78 @@
+#ifndef IDIOMS_COMMON_HASH_HPP
+#define IDIOMS_COMMON_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace idioms
+{
+    namespace common
+    {
+
+        /**
+         * Shared FNV-1a hash kernels
+         *
+         * One definition for every module that hashes strings — routing
+         * (consistent-hash ring, vnode dispatch), the key Bloom filter,
+         * the popularity sketch — so the kernels inline and specialize at
+         * each call site instead of paying a cross-TU call per record.
+         *
+         * Word-at-a-time folding cuts the dependent multiply chain by 8x
+         * (4x for the 32-bit variant) on long keys compared to the byte
+         * loop. The results differ from classic byte-wise FNV-1a, which
+         * is fine: hashes are only ever compared against hashes from the
+         * same build.
+         */
+
+        // Classic FNV offset bases, for callers that seed explicitly
+        const uint64_t FNV64_BASIS = 14695981039346656037ULL;
+        const uint32_t FNV32_BASIS = 2166136261u;
+
+        inline uint64_t fnvHash64(const char *data, size_t length,
+                                  uint64_t hash = FNV64_BASIS)
+        {
+            while (length >= sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, data, sizeof(word));
+                hash = (hash ^ word) * 1099511628211ULL;
+                data += sizeof(word);
+                length -= sizeof(word);
+            }
+
+            // Tail bytes fold one at a time
+            while (length > 0)
+            {
+                hash = (hash ^ static_cast<unsigned char>(*data)) * 1099511628211ULL;
+                data++;
+                length--;
+            }
+            return hash;
+        }
+
+        inline uint32_t fnvHash32(const char *data, size_t length,
+                                  uint32_t hash = FNV32_BASIS)
+        {
+            while (length >= sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, data, sizeof(word));
+                hash = (hash ^ word) * 16777619;
+                data += sizeof(word);
+                length -= sizeof(word);
+            }
+
+            while (length > 0)
+            {
+                hash = (hash ^ static_cast<unsigned char>(*data)) * 16777619;
+                data++;
+                length--;
+            }
+            return hash;
+        }
+
+    } // namespace common
+} // namespace idioms
+
+#endif // IDIOMS_COMMON_HASH_HPP
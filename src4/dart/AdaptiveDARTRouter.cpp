@@ -139,4 +139,19 @@ namespace idioms
         return popularityTracker->getReplicationFactor(keyPattern);
     }
 
+    bool AdaptiveDARTRouter::savePopularityState(const std::string &filename) const
+    {
+        return popularityTracker->saveState(filename);
+    }
+
+    bool AdaptiveDARTRouter::loadPopularityState(const std::string &filename)
+    {
+        return popularityTracker->loadState(filename);
+    }
+
+    void AdaptiveDARTRouter::enablePopularityPersistence(const std::string &filename)
+    {
+        popularityTracker->enablePersistence(filename);
+    }
+
 } // namespace idioms
\ No newline at end of file
@@ -80,6 +80,32 @@ namespace idioms
          * @return Current replication factor
          */
         int getCurrentReplicationFactor(const std::string &keyPattern) const;
+
+        /**
+         * Save the popularity table next to the DART mapping
+         *
+         * @param filename Path to save the popularity state to
+         * @return True if saved successfully
+         */
+        bool savePopularityState(const std::string &filename) const;
+
+        /**
+         * Load a saved popularity table, aged for the elapsed downtime, so
+         * hot keys route with their adaptive replication factors right
+         * after a restart instead of re-accumulating popularity from zero
+         *
+         * @param filename Path to load the popularity state from
+         * @return True if loaded successfully
+         */
+        bool loadPopularityState(const std::string &filename);
+
+        /**
+         * Load any saved popularity state from the file and keep saving
+         * the table there periodically in the background
+         *
+         * @param filename Path for the persistent popularity state
+         */
+        void enablePopularityPersistence(const std::string &filename);
     };
 
 } // namespace idioms
@@ -1,119 +1,36 @@
 #include "DART.hpp"
+#include "VnodePrefixTable.hpp"
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
 namespace idioms
 {
 
-    // ConsistentHash implementation
-    uint64_t ConsistentHash::hash(const std::string &key, int seed) const
-    {
-        uint64_t hash = 14695981039346656037ULL + seed;
-        for (char c : key)
-        {
-            hash = (hash ^ c) * 1099511628211ULL;
-        }
-        return hash;
-    }
+    // ConsistentHash is header-only (see DART.hpp): its hashing and ring
+    // search sit on the per-record routing path and inline at call sites
 
-    void ConsistentHash::sortRing()
-    {
-        std::sort(ring.begin(), ring.end(),
-                  [](const auto &a, const auto &b)
-                  { return a.first < b.first; });
-    }
-
-    ConsistentHash::ConsistentHash(int numServers) : numServers(numServers)
-    {
-        // Initialize the hash ring with multiple positions for each server
-        for (int server = 0; server < numServers; server++)
-        {
-            for (int i = 0; i < RING_SIZE; i++)
-            {
-                std::string key = "server" + std::to_string(server) + "_" + std::to_string(i);
-                uint64_t position = hash(key);
-                ring.push_back({position, server});
-            }
-        }
-        sortRing();
-    }
-
-    int ConsistentHash::getServer(const std::string &key) const
+    // VirtualNode implementation
+    VirtualNode::VirtualNode(uint32_t id, const std::string &prefix)
+        : id(id), prefix(prefix),
+          prefixLength(static_cast<uint8_t>(prefix.size() > 2 ? 2 : prefix.size())),
+          prefixCode(0)
     {
-        if (ring.empty())
+        // Pack the first bytes once so containsKey never touches the string
+        if (prefix.size() == 1)
         {
-            return 0;
+            prefixCode = static_cast<unsigned char>(prefix[0]);
         }
-
-        uint64_t keyHash = hash(key);
-
-        // Find the first position in the ring >= keyHash
-        auto it = std::lower_bound(ring.begin(), ring.end(),
-                                   std::make_pair(keyHash, 0),
-                                   [](const auto &a, const auto &b)
-                                   { return a.first < b.first; });
-
-        // If we reached the end, wrap around to the beginning
-        if (it == ring.end())
+        else if (prefix.size() >= 2)
         {
-            it = ring.begin();
+            prefixCode = static_cast<uint16_t>(
+                (static_cast<unsigned char>(prefix[0]) << 8) |
+                static_cast<unsigned char>(prefix[1]));
         }
-
-        return it->second;
     }
 
-    std::vector<int> ConsistentHash::getReplicaServers(const std::string &key, int replicationFactor) const
-    {
-        std::vector<int> servers;
-        std::unordered_set<int> uniqueServers;
-
-        if (ring.empty() || replicationFactor <= 0)
-        {
-            return servers;
-        }
-
-        uint64_t keyHash = hash(key);
-
-        // Find the first position in the ring >= keyHash
-        auto it = std::lower_bound(ring.begin(), ring.end(),
-                                   std::make_pair(keyHash, 0),
-                                   [](const auto &a, const auto &b)
-                                   { return a.first < b.first; });
-
-        // If we reached the end, wrap around to the beginning
-        if (it == ring.end())
-        {
-            it = ring.begin();
-        }
-
-        // Add the primary server
-        servers.push_back(it->second);
-        uniqueServers.insert(it->second);
-
-        // Add replica servers, advancing around the ring
-        while (uniqueServers.size() < std::min(replicationFactor + 1, numServers))
-        {
-            ++it;
-            if (it == ring.end())
-            {
-                it = ring.begin();
-            }
-
-            if (uniqueServers.find(it->second) == uniqueServers.end())
-            {
-                uniqueServers.insert(it->second);
-                servers.push_back(it->second);
-            }
-        }
-
-        return servers;
-    }
-
-    // VirtualNode implementation
-    VirtualNode::VirtualNode(uint32_t id, const std::string &prefix)
-        : id(id), prefix(prefix) {}
-
     uint32_t VirtualNode::getId() const
     {
         return id;
@@ -124,9 +41,27 @@ namespace idioms
         return prefix;
     }
 
-    bool VirtualNode::containsKey(const std::string &key) const
+    bool VirtualNode::containsKey(std::string_view key) const
     {
-        return key.find(prefix) == 0; // Check if key starts with prefix
+        // Integer comparison on the packed first bytes; the canonical
+        // table never exceeds two bytes, so the string compare below only
+        // runs for prefixes loaded from a non-canonical mapping file
+        switch (prefixLength)
+        {
+        case 0:
+            return true;
+        case 1:
+            return !key.empty() &&
+                   static_cast<unsigned char>(key[0]) == prefixCode;
+        default:
+            if (key.size() < 2 ||
+                static_cast<uint16_t>((static_cast<unsigned char>(key[0]) << 8) |
+                                      static_cast<unsigned char>(key[1])) != prefixCode)
+            {
+                return false;
+            }
+            return prefix.size() <= 2 || key.compare(0, prefix.size(), prefix) == 0;
+        }
     }
 
     // DARTRouter implementation
@@ -145,69 +80,35 @@ namespace idioms
         std::cout << "Total virtual nodes: " << virtualNodes.size() << std::endl;
     }
 
-    uint32_t DARTRouter::hash(const std::string &key) const
-    {
-        uint32_t hash = 2166136261;
-        for (char c : key)
-        {
-            hash = (hash ^ c) * 16777619;
-        }
-        return hash;
-    }
-
     void DARTRouter::initializeVirtualNodes()
     {
         virtualNodes.clear();
         virtualNodeToServer.clear();
         serverToVirtualNodes.clear();
 
-        // Create a set of virtual nodes with different prefixes
-        // For simplicity, we'll use 1-character prefixes for this demo
-        std::vector<std::string> prefixes;
-
-        // Add single-character prefixes (a-z, A-Z, 0-9)
-        for (char c = 'a'; c <= 'z'; c++)
-        {
-            prefixes.push_back(std::string(1, c));
-        }
-        for (char c = 'A'; c <= 'Z'; c++)
-        {
-            prefixes.push_back(std::string(1, c));
-        }
-        for (char c = '0'; c <= '9'; c++)
-        {
-            prefixes.push_back(std::string(1, c));
-        }
-
-        // Add special character prefixes
-        std::string specialChars = "_-./,:;!@#$%^&*()";
-        for (char c : specialChars)
-        {
-            prefixes.push_back(std::string(1, c));
-        }
-
-        // Add two-character prefixes for common combinations
-        std::vector<std::string> commonPrefixes = {
-            "St", "Fi", "Da", "Ti", "Us", "Pr", "Sp", "Ke", "Va", "Ex",
-            "Co", "In", "Re", "De", "Tr", "Lo", "Po", "Pa", "Mo", "Se"};
-        prefixes.insert(prefixes.end(), commonPrefixes.begin(), commonPrefixes.end());
-
-        // Use empty prefix for keys that don't match any specific prefix
-        prefixes.push_back("");
-
-        // Create virtual nodes for each prefix
-        // Ensure we have at least NUM_VIRTUAL_NODES
-        while (virtualNodes.size() < NUM_VIRTUAL_NODES)
-        {
-            for (const auto &prefix : prefixes)
+        // The prefix table is generated at compile time (see
+        // VnodePrefixTable.hpp); only the VirtualNode objects themselves
+        // are materialized here
+        static_assert(NUM_VIRTUAL_NODES == VNODE_TABLE_SIZE,
+                      "compile-time prefix table must cover every vnode");
+        virtualNodes.reserve(VNODE_TABLE_SIZE);
+        for (int i = 0; i < VNODE_TABLE_SIZE; i++)
+        {
+            const VnodePrefixEntry &entry = VNODE_PREFIX_TABLE[i];
+            char chars[2] = {static_cast<char>(entry.code >> 8),
+                             static_cast<char>(entry.code & 0xFF)};
+            std::string prefix;
+            if (entry.length == 1)
             {
-                if (virtualNodes.size() >= NUM_VIRTUAL_NODES)
-                    break;
-
-                uint32_t id = virtualNodes.size();
-                virtualNodes.emplace_back(id, prefix);
+                prefix.assign(1, chars[1]);
             }
+            else if (entry.length == 2)
+            {
+                prefix.assign(chars, 2);
+            }
+            virtualNodes.emplace_back(static_cast<uint32_t>(i), prefix);
         }
+        canonicalVnodeTable = true;
 
         // Assign virtual nodes to servers using consistent hashing
         for (const auto &vnode : virtualNodes)
@@ -220,8 +121,20 @@ namespace idioms
         }
     }
 
-    uint32_t DARTRouter::getVirtualNodeId(const std::string &key) const
+    uint32_t DARTRouter::getVirtualNodeId(std::string_view key) const
     {
+        // Canonical table: the first matching vnode is a compile-time
+        // function of the key's first byte, so routing a record costs one
+        // table load instead of a prefix scan
+        if (canonicalVnodeTable)
+        {
+            if (key.empty())
+            {
+                return VNODE_EMPTY_PREFIX_ID;
+            }
+            return VNODE_FIRST_BYTE_DISPATCH[static_cast<unsigned char>(key[0])];
+        }
+
         // Find the first virtual node whose prefix matches the key
         for (const auto &vnode : virtualNodes)
         {
@@ -235,6 +148,26 @@ namespace idioms
         return hash(key) % virtualNodes.size();
     }
 
+    std::vector<uint32_t> DARTRouter::getVirtualNodeIds(const std::vector<std::string> &keys) const
+    {
+        std::vector<uint32_t> ids;
+        ids.reserve(keys.size());
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            // Bulk ingest sorts its batches, so identical keys arrive in
+            // runs; resolve each run with a single prefix scan
+            if (i > 0 && keys[i] == keys[i - 1])
+            {
+                ids.push_back(ids.back());
+                continue;
+            }
+            ids.push_back(getVirtualNodeId(keys[i]));
+        }
+
+        return ids;
+    }
+
     int DARTRouter::getServerForVirtualNode(uint32_t virtualNodeId) const
     {
         auto it = virtualNodeToServer.find(virtualNodeId);
@@ -282,6 +215,7 @@ namespace idioms
             }
         }
 
+        filterDownServers(servers);
         return servers;
     }
 
@@ -316,6 +250,7 @@ namespace idioms
             }
         }
 
+        filterDownServers(servers);
         return servers;
     }
 
@@ -346,6 +281,7 @@ namespace idioms
             }
         }
 
+        filterDownServers(servers);
         return servers;
     }
 
@@ -364,6 +300,7 @@ namespace idioms
         {
             servers.push_back(i);
         }
+        filterDownServers(servers);
         return servers;
     }
 
@@ -417,8 +354,9 @@ namespace idioms
         }
 
         // Write format version
-        file << "DART_MAPPING_V1" << std::endl;
+        file << "DART_MAPPING_V2" << std::endl;
         file << numServers << " " << replicationFactor << std::endl;
+        file << routingEpoch.load() << std::endl;
 
         // Write virtual node count
         file << virtualNodes.size() << std::endl;
@@ -448,7 +386,7 @@ namespace idioms
 
         std::string version;
         file >> version;
-        if (version != "DART_MAPPING_V1")
+        if (version != "DART_MAPPING_V1" && version != "DART_MAPPING_V2")
         {
             return false;
         }
@@ -456,6 +394,15 @@ namespace idioms
         int storedNumServers, storedReplicationFactor;
         file >> storedNumServers >> storedReplicationFactor;
 
+        // V2 persists the routing epoch so a restarted process resumes
+        // ahead of any epoch its clients have seen
+        if (version == "DART_MAPPING_V2")
+        {
+            uint64_t storedEpoch;
+            file >> storedEpoch;
+            adoptRoutingEpoch(storedEpoch);
+        }
+
         // Only update if server count matches
         if (storedNumServers != numServers)
         {
@@ -476,7 +423,10 @@ namespace idioms
         int vnodeCount;
         file >> vnodeCount;
 
-        // Read virtual node details
+        // Read virtual node details, checking whether the stored table is
+        // still the canonical compile-time one so the first-byte dispatch
+        // can stay enabled
+        canonicalVnodeTable = (vnodeCount == VNODE_TABLE_SIZE);
         for (int i = 0; i < vnodeCount; i++)
         {
             uint32_t id;
@@ -485,6 +435,25 @@ namespace idioms
             file.ignore(); // Skip whitespace
             std::getline(file, prefix);
             virtualNodes.emplace_back(id, prefix);
+
+            if (canonicalVnodeTable)
+            {
+                const VnodePrefixEntry &entry = VNODE_PREFIX_TABLE[i];
+                uint16_t code = 0;
+                if (prefix.size() == 1)
+                {
+                    code = static_cast<unsigned char>(prefix[0]);
+                }
+                else if (prefix.size() == 2)
+                {
+                    code = static_cast<uint16_t>(
+                        (static_cast<unsigned char>(prefix[0]) << 8) |
+                        static_cast<unsigned char>(prefix[1]));
+                }
+                canonicalVnodeTable = id == static_cast<uint32_t>(i) &&
+                                      prefix.size() == entry.length &&
+                                      code == entry.code;
+            }
         }
 
         // Read virtual node to server mapping
@@ -502,11 +471,13 @@ namespace idioms
         return true;
     }
 
-    void DARTRouter::remapServers(int newNumServers)
+    std::vector<VnodeMigration> DARTRouter::remapServers(int newNumServers)
     {
+        std::vector<VnodeMigration> migrations;
+
         if (newNumServers <= 0)
         {
-            return;
+            return migrations;
         }
 
         // Save previous mapping for data migration planning
@@ -526,7 +497,8 @@ namespace idioms
         // Clear existing server to virtual node mapping
         serverToVirtualNodes.clear();
 
-        // Reassign virtual nodes to servers
+        // Reassign virtual nodes to servers; consistent hashing keeps most
+        // assignments stable, so only ~1/N of the vnodes change owner
         for (const auto &vnode : virtualNodes)
         {
             std::string key = "vnode_" + std::to_string(vnode.getId());
@@ -540,26 +512,333 @@ namespace idioms
         std::cout << "Server count changed to " << numServers
                   << ". Replication factor adjusted to " << replicationFactor << std::endl;
 
-        int migrationsNeeded = 0;
+        // Emit exactly the vnodes whose owner changed; everything else
+        // stays in place and needs no data movement
         for (const auto &vnode : virtualNodes)
         {
             uint32_t vnodeId = vnode.getId();
-            int oldServerId = -1;
             auto it = previousMapping.find(vnodeId);
-            if (it != previousMapping.end())
+            if (it == previousMapping.end())
             {
-                oldServerId = it->second;
+                continue;
             }
 
             int newServerId = virtualNodeToServer[vnodeId];
-
-            if (oldServerId != -1 && oldServerId != newServerId)
+            if (it->second != newServerId)
             {
-                migrationsNeeded++;
+                migrations.push_back({vnodeId, it->second, newServerId});
             }
         }
 
-        std::cout << "Migration plan: " << migrationsNeeded
+        std::cout << "Migration plan: " << migrations.size()
                   << " virtual nodes need to be migrated." << std::endl;
+
+        routingEpoch.fetch_add(1);
+        return migrations;
+    }
+
+    void DARTRouter::recordVnodeInsert(uint32_t vnodeId, uint64_t count)
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        vnodeLoads[vnodeId].recordCount += count;
+    }
+
+    void DARTRouter::recordVnodeQuery(uint32_t vnodeId)
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        vnodeLoads[vnodeId].queryCount++;
+    }
+
+    uint64_t DARTRouter::getRoutingEpoch() const
+    {
+        return routingEpoch.load();
+    }
+
+    void DARTRouter::filterDownServers(std::vector<int> &servers) const
+    {
+        std::lock_guard<std::mutex> lock(membershipMutex);
+        if (downServers.empty())
+        {
+            return;
+        }
+        servers.erase(std::remove_if(servers.begin(), servers.end(),
+                                     [this](int serverId)
+                                     { return downServers.count(serverId) > 0; }),
+                      servers.end());
+    }
+
+    void DARTRouter::markServerDown(int serverId)
+    {
+        {
+            std::lock_guard<std::mutex> lock(membershipMutex);
+            if (!downServers.insert(serverId).second)
+            {
+                return; // Already marked
+            }
+        }
+        std::cout << "Routing epoch: server " << serverId
+                  << " marked down, rerouting to replicas." << std::endl;
+        routingEpoch.fetch_add(1);
+    }
+
+    void DARTRouter::markServerUp(int serverId)
+    {
+        {
+            std::lock_guard<std::mutex> lock(membershipMutex);
+            if (downServers.erase(serverId) == 0)
+            {
+                return; // Was not marked down
+            }
+        }
+        std::cout << "Routing epoch: server " << serverId
+                  << " back in rotation." << std::endl;
+        routingEpoch.fetch_add(1);
+    }
+
+    bool DARTRouter::isServerDown(int serverId) const
+    {
+        std::lock_guard<std::mutex> lock(membershipMutex);
+        return downServers.count(serverId) > 0;
+    }
+
+    std::vector<int> DARTRouter::getDownServers() const
+    {
+        std::lock_guard<std::mutex> lock(membershipMutex);
+        return std::vector<int>(downServers.begin(), downServers.end());
+    }
+
+    void DARTRouter::adoptRoutingEpoch(uint64_t epoch)
+    {
+        // Monotonic: a delayed update must never roll the epoch back
+        uint64_t current = routingEpoch.load();
+        while (epoch > current && !routingEpoch.compare_exchange_weak(current, epoch))
+        {
+        }
+    }
+
+    void DARTRouter::adoptMembershipView(const std::vector<int> &downSet, uint64_t epoch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(membershipMutex);
+            downServers.clear();
+            downServers.insert(downSet.begin(), downSet.end());
+        }
+        adoptRoutingEpoch(epoch);
+    }
+
+    std::vector<VnodeMigration> DARTRouter::reassignServerVnodes(int failedServerId)
+    {
+        std::vector<VnodeMigration> migrations;
+
+        // Surviving servers in a fixed order, so every process computing
+        // this assignment from the same membership view agrees on it
+        std::vector<int> survivors;
+        {
+            std::lock_guard<std::mutex> lock(membershipMutex);
+            for (int serverId = 0; serverId < numServers; serverId++)
+            {
+                if (serverId != failedServerId && downServers.count(serverId) == 0)
+                {
+                    survivors.push_back(serverId);
+                }
+            }
+        }
+
+        if (survivors.empty())
+        {
+            std::cerr << "No surviving servers to take over server "
+                      << failedServerId << "'s virtual nodes" << std::endl;
+            return migrations;
+        }
+
+        // Hand the failed server's vnodes out round-robin so the recovery
+        // load spreads instead of doubling up one survivor
+        std::vector<uint32_t> orphaned = serverToVirtualNodes[failedServerId];
+        size_t cursor = 0;
+        for (uint32_t vnodeId : orphaned)
+        {
+            int newOwner = survivors[cursor++ % survivors.size()];
+
+            virtualNodeToServer[vnodeId] = newOwner;
+            serverToVirtualNodes[newOwner].push_back(vnodeId);
+
+            migrations.push_back({vnodeId, failedServerId, newOwner});
+        }
+        serverToVirtualNodes[failedServerId].clear();
+
+        if (!migrations.empty())
+        {
+            std::cout << "Reassigned " << migrations.size() << " virtual nodes from failed server "
+                      << failedServerId << " across " << survivors.size()
+                      << " survivors." << std::endl;
+            routingEpoch.fetch_add(1);
+        }
+
+        return migrations;
+    }
+
+    std::vector<VnodeMigration> DARTRouter::rebalanceLoad()
+    {
+        std::vector<VnodeMigration> migrations;
+
+        // Work on a copy of the load table so the servers keep feeding it
+        // while the plan is computed
+        std::unordered_map<uint32_t, VnodeLoad> loads;
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            loads = vnodeLoads;
+        }
+
+        // A vnode's weight combines how much data it holds with how often
+        // it is queried; queries weigh more since they are the recurring
+        // cost of a misplaced hot vnode
+        auto vnodeWeight = [&loads](uint32_t vnodeId) -> double
+        {
+            auto it = loads.find(vnodeId);
+            if (it == loads.end())
+            {
+                return 0.0;
+            }
+            return static_cast<double>(it->second.recordCount) +
+                   4.0 * static_cast<double>(it->second.queryCount);
+        };
+
+        std::vector<double> serverLoad(numServers, 0.0);
+        for (const auto &[vnodeId, owner] : virtualNodeToServer)
+        {
+            if (owner >= 0 && owner < numServers)
+            {
+                serverLoad[owner] += vnodeWeight(vnodeId);
+            }
+        }
+
+        double totalLoad = 0.0;
+        for (double load : serverLoad)
+        {
+            totalLoad += load;
+        }
+        double targetLoad = totalLoad / numServers;
+        if (targetLoad <= 0.0)
+        {
+            return migrations;
+        }
+
+        // Greedy plan: repeatedly move the hottest movable vnode from the
+        // most loaded server to the least loaded one, as long as the source
+        // is over tolerance and the move does not overshoot the target
+        for (int round = 0; round < NUM_VIRTUAL_NODES; round++)
+        {
+            int hottest = static_cast<int>(
+                std::max_element(serverLoad.begin(), serverLoad.end()) - serverLoad.begin());
+            int coldest = static_cast<int>(
+                std::min_element(serverLoad.begin(), serverLoad.end()) - serverLoad.begin());
+
+            if (serverLoad[hottest] <= targetLoad * REBALANCE_TOLERANCE)
+            {
+                break; // Within tolerance everywhere
+            }
+
+            // Pick the heaviest vnode on the hottest server whose move
+            // still shrinks the gap between the two servers
+            uint32_t bestVnode = 0;
+            double bestWeight = 0.0;
+            double gap = serverLoad[hottest] - serverLoad[coldest];
+            for (uint32_t vnodeId : serverToVirtualNodes[hottest])
+            {
+                double weight = vnodeWeight(vnodeId);
+                if (weight > bestWeight && weight < gap)
+                {
+                    bestVnode = vnodeId;
+                    bestWeight = weight;
+                }
+            }
+
+            if (bestWeight <= 0.0)
+            {
+                break; // Nothing movable improves the balance
+            }
+
+            auto &sourceVnodes = serverToVirtualNodes[hottest];
+            sourceVnodes.erase(std::remove(sourceVnodes.begin(), sourceVnodes.end(), bestVnode),
+                               sourceVnodes.end());
+            serverToVirtualNodes[coldest].push_back(bestVnode);
+            virtualNodeToServer[bestVnode] = coldest;
+
+            serverLoad[hottest] -= bestWeight;
+            serverLoad[coldest] += bestWeight;
+
+            migrations.push_back({bestVnode, hottest, coldest});
+        }
+
+        if (!migrations.empty())
+        {
+            std::cout << "Load rebalancer: migrating " << migrations.size()
+                      << " hot virtual nodes." << std::endl;
+            routingEpoch.fetch_add(1);
+        }
+
+        return migrations;
+    }
+
+    void DARTRouter::startRebalancer(int intervalSeconds,
+                                     std::function<void(const std::vector<VnodeMigration> &)> onMigrations)
+    {
+        {
+            std::lock_guard<std::mutex> lock(rebalancerMutex);
+            if (rebalancerRunning)
+            {
+                return;
+            }
+            rebalancerRunning = true;
+        }
+
+        rebalancerThread = std::thread(
+            [this, intervalSeconds, onMigrations]()
+            {
+                std::unique_lock<std::mutex> lock(rebalancerMutex);
+                while (rebalancerRunning)
+                {
+                    rebalancerCv.wait_for(lock, std::chrono::seconds(intervalSeconds),
+                                          [this]()
+                                          { return !rebalancerRunning; });
+                    if (!rebalancerRunning)
+                    {
+                        break;
+                    }
+
+                    // Compute and apply the plan outside the wait lock so
+                    // stopRebalancer is never blocked on a migration
+                    lock.unlock();
+                    std::vector<VnodeMigration> migrations = rebalanceLoad();
+                    if (!migrations.empty())
+                    {
+                        onMigrations(migrations);
+                    }
+                    lock.lock();
+                }
+            });
+    }
+
+    void DARTRouter::stopRebalancer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(rebalancerMutex);
+            if (!rebalancerRunning)
+            {
+                return;
+            }
+            rebalancerRunning = false;
+        }
+        rebalancerCv.notify_all();
+
+        if (rebalancerThread.joinable())
+        {
+            rebalancerThread.join();
+        }
+    }
+
+    DARTRouter::~DARTRouter()
+    {
+        stopRebalancer();
     }
 } // namespace idioms
\ No newline at end of file
@@ -1,18 +1,29 @@
 #ifndef IDIOMS_DART_HPP
 #define IDIOMS_DART_HPP
 
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "../common/Hash.hpp"
 
 namespace idioms
 {
 
     /**
      * A consistent hash function for DART node mapping
+     *
+     * Header-only: getServer sits on the per-record routing path, so its
+     * hash and ring search inline into the dispatch call sites.
      */
     class ConsistentHash
     {
@@ -22,19 +33,98 @@ namespace idioms
         std::vector<std::pair<uint64_t, int>> ring; // Hash ring: (position, server_id)
 
         // FNV-1a hash function for strings
-        uint64_t hash(const std::string &key, int seed = 0) const;
+        uint64_t hash(const std::string &key, int seed = 0) const
+        {
+            return common::fnvHash64(key.data(), key.length(),
+                                     common::FNV64_BASIS + seed);
+        }
 
         // Helper to sort the ring
-        void sortRing();
+        void sortRing()
+        {
+            std::sort(ring.begin(), ring.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.first < b.first; });
+        }
+
+        // First ring position >= the key's hash, wrapping at the end
+        std::vector<std::pair<uint64_t, int>>::const_iterator
+        ringPosition(const std::string &key) const
+        {
+            uint64_t keyHash = hash(key);
+            auto it = std::lower_bound(ring.begin(), ring.end(),
+                                       std::make_pair(keyHash, 0),
+                                       [](const auto &a, const auto &b)
+                                       { return a.first < b.first; });
+            if (it == ring.end())
+            {
+                it = ring.begin();
+            }
+            return it;
+        }
 
     public:
-        ConsistentHash(int numServers);
+        ConsistentHash(int numServers) : numServers(numServers)
+        {
+            // Initialize the hash ring with multiple positions for each server
+            for (int server = 0; server < numServers; server++)
+            {
+                for (int i = 0; i < RING_SIZE; i++)
+                {
+                    std::string key = "server" + std::to_string(server) + "_" + std::to_string(i);
+                    uint64_t position = hash(key);
+                    ring.push_back({position, server});
+                }
+            }
+            sortRing();
+        }
 
         // Find the server responsible for a given key
-        int getServer(const std::string &key) const;
+        int getServer(const std::string &key) const
+        {
+            if (ring.empty())
+            {
+                return 0;
+            }
+            return ringPosition(key)->second;
+        }
 
         // Get a list of servers for replication
-        std::vector<int> getReplicaServers(const std::string &key, int replicationFactor) const;
+        std::vector<int> getReplicaServers(const std::string &key, int replicationFactor) const
+        {
+            std::vector<int> servers;
+            std::unordered_set<int> uniqueServers;
+
+            if (ring.empty() || replicationFactor <= 0)
+            {
+                return servers;
+            }
+
+            auto it = ringPosition(key);
+
+            // Add the primary server
+            servers.push_back(it->second);
+            uniqueServers.insert(it->second);
+
+            // Add replica servers, advancing around the ring
+            size_t wanted = static_cast<size_t>(std::min(replicationFactor + 1, numServers));
+            while (uniqueServers.size() < wanted)
+            {
+                ++it;
+                if (it == ring.end())
+                {
+                    it = ring.begin();
+                }
+
+                if (uniqueServers.find(it->second) == uniqueServers.end())
+                {
+                    uniqueServers.insert(it->second);
+                    servers.push_back(it->second);
+                }
+            }
+
+            return servers;
+        }
     };
 
     /**
@@ -46,6 +136,11 @@ namespace idioms
         uint32_t id;
         std::string prefix;
 
+        // The prefix packed into an integer (see VnodePrefixTable.hpp) so
+        // containsKey compares integers instead of strings
+        uint8_t prefixLength;
+        uint16_t prefixCode;
+
     public:
         VirtualNode(uint32_t id, const std::string &prefix);
 
@@ -53,7 +148,17 @@ namespace idioms
         const std::string &getPrefix() const;
 
         // Check if a key belongs to this virtual node
-        bool containsKey(const std::string &key) const;
+        bool containsKey(std::string_view key) const;
+    };
+
+    /**
+     * One virtual node changing owner during a server-count change
+     */
+    struct VnodeMigration
+    {
+        uint32_t vnodeId;
+        int fromServer;
+        int toServer;
     };
 
     /**
@@ -76,8 +181,49 @@ namespace idioms
         // Number of virtual nodes in the system
         static const int NUM_VIRTUAL_NODES = 256;
 
-        // FNV-1a hash function for strings
-        uint32_t hash(const std::string &key) const;
+        // True while virtualNodes matches the compile-time prefix table,
+        // letting getVirtualNodeId dispatch on the key's first byte;
+        // cleared if loadMapping reads a table that diverges from it
+        bool canonicalVnodeTable = false;
+
+        // Per-vnode load accounting: how many records a vnode holds and how
+        // often it is queried. Fed by the servers; drives the rebalancer.
+        struct VnodeLoad
+        {
+            uint64_t recordCount = 0;
+            uint64_t queryCount = 0;
+        };
+
+        mutable std::mutex loadMutex;
+        std::unordered_map<uint32_t, VnodeLoad> vnodeLoads;
+
+        // Bumped whenever vnode ownership or membership changes so clients
+        // can notice that cached routing decisions are stale
+        std::atomic<uint64_t> routingEpoch{1};
+
+        // Servers confirmed down; routing skips them until they recover
+        mutable std::mutex membershipMutex;
+        std::unordered_set<int> downServers;
+
+        // Remove confirmed-down servers from a routing result
+        void filterDownServers(std::vector<int> &servers) const;
+
+        // Background rebalancer state
+        std::thread rebalancerThread;
+        std::mutex rebalancerMutex;
+        std::condition_variable rebalancerCv;
+        bool rebalancerRunning = false;
+
+        // A server is considered overloaded beyond this multiple of the
+        // average per-server load
+        static constexpr double REBALANCE_TOLERANCE = 1.2;
+
+        // FNV-1a hash function for strings; inline so vnode dispatch
+        // hashes without a cross-TU call per key
+        uint32_t hash(std::string_view key) const
+        {
+            return common::fnvHash32(key.data(), key.length());
+        }
 
         // Initialize virtual nodes with different prefixes
         void initializeVirtualNodes();
@@ -86,7 +232,11 @@ namespace idioms
         DARTRouter(int numServers, double replicationRatio = 0.1);
 
         // Get the virtual node ID for a key
-        uint32_t getVirtualNodeId(const std::string &key) const;
+        uint32_t getVirtualNodeId(std::string_view key) const;
+
+        // Get the virtual node IDs for a batch of keys; runs of identical
+        // keys (common in sorted bulk-ingest batches) are resolved once
+        std::vector<uint32_t> getVirtualNodeIds(const std::vector<std::string> &keys) const;
 
         // Get the server ID for a given virtual node
         int getServerForVirtualNode(uint32_t virtualNodeId) const;
@@ -118,8 +268,54 @@ namespace idioms
         // Load the virtual node to server mapping from persistence
         bool loadMapping(const std::string &filename);
 
-        // Remap virtual nodes to servers after server count change
-        void remapServers(int newNumServers);
+        // Remap virtual nodes to servers after server count change;
+        // returns exactly the virtual nodes that changed owner so callers
+        // can migrate only those shards
+        std::vector<VnodeMigration> remapServers(int newNumServers);
+
+        // Record records being added to, or a query touching, a vnode
+        void recordVnodeInsert(uint32_t vnodeId, uint64_t count = 1);
+        void recordVnodeQuery(uint32_t vnodeId);
+
+        // Current routing epoch; changes whenever vnode ownership moves
+        uint64_t getRoutingEpoch() const;
+
+        // Membership changes: marking a server down publishes a new epoch
+        // and reroutes its traffic to replicas immediately; marking it up
+        // restores it. Both are idempotent.
+        void markServerDown(int serverId);
+        void markServerUp(int serverId);
+        bool isServerDown(int serverId) const;
+        std::vector<int> getDownServers() const;
+
+        // Adopt an epoch published elsewhere (never moves backwards)
+        void adoptRoutingEpoch(uint64_t epoch);
+
+        // Adopt a published membership view verbatim: replace the down
+        // set and raise the epoch to the published one, without the
+        // per-transition bumps of markServerDown/Up — every rank adopting
+        // the same update must land on the same epoch
+        void adoptMembershipView(const std::vector<int> &downSet, uint64_t epoch);
+
+        // Reassign a confirmed-down server's virtual nodes round-robin
+        // across the surviving servers, bumping the routing epoch; returns
+        // one migration per vnode so recovery can re-replicate each shard
+        // independently. Deterministic given the same membership view.
+        std::vector<VnodeMigration> reassignServerVnodes(int failedServerId);
+
+        // Move hot vnodes from overloaded servers to underloaded ones,
+        // updating the ownership maps and bumping the routing epoch;
+        // returns the migrations so the caller can ship the index data
+        std::vector<VnodeMigration> rebalanceLoad();
+
+        // Run rebalanceLoad periodically on a background thread; the
+        // callback receives each non-empty migration set and is expected
+        // to move the affected index entries between servers
+        void startRebalancer(int intervalSeconds,
+                             std::function<void(const std::vector<VnodeMigration> &)> onMigrations);
+        void stopRebalancer();
+
+        virtual ~DARTRouter();
     };
 
 } // namespace idioms
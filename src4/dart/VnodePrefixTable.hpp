@@ -0,0 +1,133 @@
+#ifndef IDIOMS_VNODE_PREFIX_TABLE_HPP
+#define IDIOMS_VNODE_PREFIX_TABLE_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace idioms
+{
+
+    /**
+     * Compile-time virtual node prefix table
+     *
+     * The vnode prefix alphabet and NUM_VIRTUAL_NODES are fixed, so the
+     * 256-entry prefix table and the first-byte dispatch table are
+     * generated here as constexpr data instead of being rebuilt on every
+     * process start on every rank. Prefixes are at most two bytes, packed
+     * into an integer so membership tests compare integers instead of
+     * strings.
+     *
+     * The sequence below must stay byte-identical to what
+     * DARTRouter::initializeVirtualNodes historically produced: vnode IDs
+     * feed the consistent-hash server assignment and are persisted in
+     * mapping files, so reordering the table would silently remap every
+     * deployment.
+     */
+
+    // One vnode prefix: up to two bytes, integer-packed for comparison
+    struct VnodePrefixEntry
+    {
+        uint8_t length; // 0, 1 or 2
+        uint16_t code;  // length 1: the byte; length 2: (first << 8) | second
+    };
+
+    namespace detail
+    {
+        // One cycle of the historical prefix sequence: a-z, A-Z, 0-9,
+        // the special characters, twenty two-character prefixes, then
+        // the empty catch-all prefix
+        constexpr int VNODE_PREFIX_CYCLE = 100;
+
+        constexpr std::array<VnodePrefixEntry, VNODE_PREFIX_CYCLE> makePrefixCycle()
+        {
+            std::array<VnodePrefixEntry, VNODE_PREFIX_CYCLE> cycle{};
+            int n = 0;
+
+            for (char c = 'a'; c <= 'z'; c++)
+            {
+                cycle[n++] = {1, static_cast<uint16_t>(static_cast<unsigned char>(c))};
+            }
+            for (char c = 'A'; c <= 'Z'; c++)
+            {
+                cycle[n++] = {1, static_cast<uint16_t>(static_cast<unsigned char>(c))};
+            }
+            for (char c = '0'; c <= '9'; c++)
+            {
+                cycle[n++] = {1, static_cast<uint16_t>(static_cast<unsigned char>(c))};
+            }
+
+            constexpr char specialChars[] = "_-./,:;!@#$%^&*()";
+            for (int i = 0; specialChars[i] != '\0'; i++)
+            {
+                cycle[n++] = {1, static_cast<uint16_t>(static_cast<unsigned char>(specialChars[i]))};
+            }
+
+            constexpr const char *commonPrefixes[] = {
+                "St", "Fi", "Da", "Ti", "Us", "Pr", "Sp", "Ke", "Va", "Ex",
+                "Co", "In", "Re", "De", "Tr", "Lo", "Po", "Pa", "Mo", "Se"};
+            for (const char *prefix : commonPrefixes)
+            {
+                cycle[n++] = {2, static_cast<uint16_t>(
+                                     (static_cast<unsigned char>(prefix[0]) << 8) |
+                                     static_cast<unsigned char>(prefix[1]))};
+            }
+
+            // Empty prefix: matches every key
+            cycle[n++] = {0, 0};
+            return cycle;
+        }
+
+        constexpr auto VNODE_PREFIX_CYCLE_TABLE = makePrefixCycle();
+    } // namespace detail
+
+    // The full table: the cycle repeated until every vnode has a prefix
+    constexpr int VNODE_TABLE_SIZE = 256;
+
+    constexpr std::array<VnodePrefixEntry, VNODE_TABLE_SIZE> makeVnodePrefixTable()
+    {
+        std::array<VnodePrefixEntry, VNODE_TABLE_SIZE> table{};
+        for (int i = 0; i < VNODE_TABLE_SIZE; i++)
+        {
+            table[i] = detail::VNODE_PREFIX_CYCLE_TABLE[i % detail::VNODE_PREFIX_CYCLE];
+        }
+        return table;
+    }
+
+    constexpr auto VNODE_PREFIX_TABLE = makeVnodePrefixTable();
+
+    // First-match dispatch: the lowest vnode whose prefix covers a key is
+    // decided by the key's first byte alone, because every one-character
+    // prefix precedes every two-character prefix sharing its first byte
+    // and the empty prefix closes the first cycle. The table maps a first
+    // byte to that vnode ID; bytes outside the alphabet land on the
+    // empty-prefix vnode.
+    constexpr std::array<uint16_t, 256> makeFirstByteDispatchTable()
+    {
+        // The empty prefix sits at the end of the first cycle
+        constexpr uint16_t emptyPrefixVnode = detail::VNODE_PREFIX_CYCLE - 1;
+
+        std::array<uint16_t, 256> dispatch{};
+        for (int b = 0; b < 256; b++)
+        {
+            dispatch[b] = emptyPrefixVnode;
+            for (uint16_t i = 0; i < emptyPrefixVnode; i++)
+            {
+                if (VNODE_PREFIX_TABLE[i].length == 1 &&
+                    VNODE_PREFIX_TABLE[i].code == b)
+                {
+                    dispatch[b] = i;
+                    break;
+                }
+            }
+        }
+        return dispatch;
+    }
+
+    constexpr auto VNODE_FIRST_BYTE_DISPATCH = makeFirstByteDispatchTable();
+
+    // Vnode ID for the empty-prefix catch-all (also where empty keys go)
+    constexpr uint16_t VNODE_EMPTY_PREFIX_ID = detail::VNODE_PREFIX_CYCLE - 1;
+
+} // namespace idioms
+
+#endif // IDIOMS_VNODE_PREFIX_TABLE_HPP
@@ -0,0 +1,424 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include "dart/DART.hpp"
+#include "dart/AdaptiveDARTRouter.hpp"
+#include "benchmark/WorkloadGenerator.hpp"
+
+// Offline routing-quality analysis for the DART placement. Feeds a key
+// sample — either a file of keys or a workload-generator config — through
+// both DARTRouter and AdaptiveDARTRouter and reports per-server record
+// counts, the vnode load histogram, replica overlap between servers,
+// expected fan-out per query class and the movement cost of a simulated
+// server add/remove. Placement changes get validated here before they
+// touch production routing.
+//
+// Usage: idioms_dart_analysis [--servers N] [--keys keyfile | workload.conf]
+//   --keys takes one key per line; otherwise the workload generator
+//   supplies the sample (and its read stream drives the adaptive
+//   router's popularity tracking).
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -Wall -Wextra -pthread -I. -c src4/dart_analysis.cpp -o bin/dart_analysis.o
+//   g++ -std=c++17 bin/dart_analysis.o bin/dart/*.o bin/popularity/*.o bin/benchmark/WorkloadGenerator.o -o idioms_dart_analysis
+
+using idioms::AdaptiveDARTRouter;
+using idioms::DARTRouter;
+using idioms::VnodeMigration;
+using idioms::benchmark::Operation;
+using idioms::benchmark::OpType;
+using idioms::benchmark::WorkloadConfig;
+using idioms::benchmark::WorkloadGenerator;
+
+// The sample under analysis: the stored keys, plus the query stream that
+// feeds the adaptive router's popularity tracker
+struct KeySample
+{
+    std::vector<std::string> storedKeys;
+    std::vector<std::string> queriedKeys;
+};
+
+// Load one key per line; the query stream is the keys themselves
+static KeySample loadKeyFile(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot read key file: " << path << std::endl;
+        std::exit(1);
+    }
+
+    KeySample sample;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty())
+        {
+            sample.storedKeys.push_back(line);
+        }
+    }
+    sample.queriedKeys = sample.storedKeys;
+    return sample;
+}
+
+// Draw the sample from the workload generator: writes become stored
+// keys, reads become the query stream with the generator's Zipfian skew
+static KeySample generateSample(const WorkloadConfig &config)
+{
+    WorkloadGenerator generator(config);
+    KeySample sample;
+    std::set<std::string> seen;
+
+    while (generator.hasNext())
+    {
+        Operation op = generator.next();
+        if (op.type == OpType::WRITE)
+        {
+            if (seen.insert(op.key).second)
+            {
+                sample.storedKeys.push_back(op.key);
+            }
+        }
+        else
+        {
+            sample.queriedKeys.push_back(op.key);
+        }
+    }
+
+    // A pure-read config still needs something stored to analyze
+    if (sample.storedKeys.empty())
+    {
+        seen.clear();
+        for (const std::string &key : sample.queriedKeys)
+        {
+            if (seen.insert(key).second)
+            {
+                sample.storedKeys.push_back(key);
+            }
+        }
+    }
+    return sample;
+}
+
+// Per-server record counts with the imbalance factor (max over mean)
+static void reportServerCounts(const DARTRouter &router, int numServers,
+                               const KeySample &sample)
+{
+    std::vector<uint64_t> counts(numServers, 0);
+    uint64_t totalPlacements = 0;
+
+    for (const std::string &key : sample.storedKeys)
+    {
+        for (int server : router.getServersForKey(key))
+        {
+            counts[server]++;
+            totalPlacements++;
+        }
+    }
+
+    double mean = static_cast<double>(totalPlacements) / numServers;
+    uint64_t maxCount = *std::max_element(counts.begin(), counts.end());
+
+    std::cout << "  Per-server record counts:" << std::endl;
+    for (int server = 0; server < numServers; server++)
+    {
+        std::cout << "    server " << server << ": " << std::setw(8) << counts[server]
+                  << "  (" << std::fixed << std::setprecision(1)
+                  << (totalPlacements > 0 ? counts[server] * 100.0 / totalPlacements : 0.0)
+                  << "%)" << std::endl;
+    }
+    std::cout << "    imbalance (max/mean): " << std::setprecision(2)
+              << (mean > 0 ? maxCount / mean : 0.0) << std::endl;
+}
+
+// Vnode load histogram: keys per vnode, bucketed by load
+static void reportVnodeHistogram(const DARTRouter &router, int numServers,
+                                 const KeySample &sample)
+{
+    // The router does not expose its vnode count directly; the union of
+    // every server's vnode list is the full set
+    std::set<uint32_t> allVnodes;
+    for (int server = 0; server < numServers; server++)
+    {
+        for (uint32_t vnode : router.getVirtualNodesForServer(server))
+        {
+            allVnodes.insert(vnode);
+        }
+    }
+
+    std::map<uint32_t, uint64_t> loads;
+    for (const std::string &key : sample.storedKeys)
+    {
+        loads[router.getVirtualNodeId(key)]++;
+    }
+
+    uint64_t maxLoad = 0;
+    double sum = 0.0;
+    for (const auto &entry : loads)
+    {
+        maxLoad = std::max(maxLoad, entry.second);
+        sum += entry.second;
+    }
+    double mean = loads.empty() ? 0.0 : sum / allVnodes.size();
+    double variance = 0.0;
+    for (uint32_t vnode : allVnodes)
+    {
+        auto it = loads.find(vnode);
+        double load = it != loads.end() ? static_cast<double>(it->second) : 0.0;
+        variance += (load - mean) * (load - mean);
+    }
+    double stddev = allVnodes.empty() ? 0.0 : std::sqrt(variance / allVnodes.size());
+
+    std::cout << "  Vnode load (" << loads.size() << "/" << allVnodes.size()
+              << " vnodes loaded, mean " << std::fixed << std::setprecision(1)
+              << mean << ", max " << maxLoad << ", stddev " << stddev
+              << "):" << std::endl;
+
+    // Up to eight equal-width buckets over [0, maxLoad]
+    if (maxLoad > 0)
+    {
+        const int NUM_BUCKETS = static_cast<int>(std::min<uint64_t>(8, maxLoad + 1));
+        std::vector<int> buckets(NUM_BUCKETS, 0);
+        for (uint32_t vnode : allVnodes)
+        {
+            auto it = loads.find(vnode);
+            uint64_t load = it != loads.end() ? it->second : 0;
+            int bucket = static_cast<int>(load * (NUM_BUCKETS - 1) / maxLoad);
+            buckets[bucket]++;
+        }
+        for (int b = 0; b < NUM_BUCKETS; b++)
+        {
+            uint64_t lo = maxLoad * b / NUM_BUCKETS;
+            uint64_t hi = maxLoad * (b + 1) / NUM_BUCKETS;
+            std::cout << "    [" << std::setw(6) << lo << ", " << std::setw(6) << hi
+                      << "]: " << std::setw(4) << buckets[b] << " "
+                      << std::string(buckets[b] * 40 / static_cast<int>(allVnodes.size()) + (buckets[b] > 0 ? 1 : 0), '#')
+                      << std::endl;
+        }
+    }
+}
+
+// Replica overlap: replication factor distribution and the server pairs
+// co-hosting the most records
+static void reportReplicaOverlap(const DARTRouter &router, int numServers,
+                                 const KeySample &sample)
+{
+    std::map<std::pair<int, int>, uint64_t> pairCounts;
+    uint64_t totalReplicas = 0;
+    uint64_t maxFactor = 0;
+
+    for (const std::string &key : sample.storedKeys)
+    {
+        std::vector<int> servers = router.getServersForKey(key);
+        totalReplicas += servers.size();
+        maxFactor = std::max(maxFactor, static_cast<uint64_t>(servers.size()));
+        std::sort(servers.begin(), servers.end());
+        for (size_t i = 0; i < servers.size(); i++)
+        {
+            for (size_t j = i + 1; j < servers.size(); j++)
+            {
+                pairCounts[{servers[i], servers[j]}]++;
+            }
+        }
+    }
+
+    double meanFactor = sample.storedKeys.empty()
+                            ? 0.0
+                            : static_cast<double>(totalReplicas) / sample.storedKeys.size();
+    std::cout << "  Replica overlap: mean replication factor " << std::fixed
+              << std::setprecision(2) << meanFactor << ", max " << maxFactor
+              << std::endl;
+
+    std::vector<std::pair<uint64_t, std::pair<int, int>>> ranked;
+    for (const auto &entry : pairCounts)
+    {
+        ranked.push_back({entry.second, entry.first});
+    }
+    std::sort(ranked.rbegin(), ranked.rend());
+
+    size_t totalPairs = static_cast<size_t>(numServers) * (numServers - 1) / 2;
+    std::cout << "    server pairs sharing records: " << pairCounts.size() << "/"
+              << totalPairs << std::endl;
+    for (size_t i = 0; i < std::min<size_t>(5, ranked.size()); i++)
+    {
+        std::cout << "    (" << ranked[i].second.first << ", " << ranked[i].second.second
+                  << "): " << ranked[i].first << " shared records" << std::endl;
+    }
+}
+
+// Expected fan-out per query class, derived from the sampled keys
+static void reportQueryFanOut(const DARTRouter &router, const KeySample &sample)
+{
+    double exactSum = 0.0, prefixSum = 0.0, suffixSum = 0.0, infixSum = 0.0;
+    size_t count = 0;
+
+    for (const std::string &key : sample.storedKeys)
+    {
+        // Derive a prefix/suffix/infix probe from each key's middle half
+        size_t half = std::max<size_t>(key.size() / 2, 1);
+        std::string prefix = key.substr(0, half);
+        std::string suffix = key.substr(key.size() - half);
+        std::string infix = key.substr(key.size() / 4, half);
+
+        exactSum += router.getServersForKey(key).size();
+        prefixSum += router.getServersForPrefixQuery(prefix).size();
+        suffixSum += router.getServersForSuffixQuery(suffix).size();
+        infixSum += router.getServersForInfixQuery(infix).size();
+        count++;
+    }
+    double wildcard = router.getServersForWildcardQuery().size();
+
+    std::cout << "  Expected fan-out (servers per query):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "    exact:    " << (count ? exactSum / count : 0.0) << std::endl;
+    std::cout << "    prefix:   " << (count ? prefixSum / count : 0.0) << std::endl;
+    std::cout << "    suffix:   " << (count ? suffixSum / count : 0.0) << std::endl;
+    std::cout << "    infix:    " << (count ? infixSum / count : 0.0) << std::endl;
+    std::cout << "    wildcard: " << wildcard << std::endl;
+}
+
+// Movement cost of growing or shrinking the cluster by one server,
+// simulated on a scratch router so the analysis router stays untouched
+static void reportMovementCost(bool adaptive, int numServers, int newNumServers,
+                               const KeySample &sample)
+{
+    std::unique_ptr<DARTRouter> scratch;
+    if (adaptive)
+    {
+        scratch.reset(new AdaptiveDARTRouter(numServers));
+    }
+    else
+    {
+        scratch.reset(new DARTRouter(numServers));
+    }
+
+    // Vnode loads before the remap decide how many records each
+    // migration actually drags along
+    std::map<uint32_t, uint64_t> loads;
+    for (const std::string &key : sample.storedKeys)
+    {
+        loads[scratch->getVirtualNodeId(key)]++;
+    }
+
+    std::vector<VnodeMigration> migrations = scratch->remapServers(newNumServers);
+
+    uint64_t movedRecords = 0;
+    for (const VnodeMigration &migration : migrations)
+    {
+        auto it = loads.find(migration.vnodeId);
+        if (it != loads.end())
+        {
+            movedRecords += it->second;
+        }
+    }
+
+    std::cout << "    " << numServers << " -> " << newNumServers << " servers: "
+              << migrations.size() << " vnodes move, " << movedRecords << "/"
+              << sample.storedKeys.size() << " records (" << std::fixed
+              << std::setprecision(1)
+              << (sample.storedKeys.empty()
+                      ? 0.0
+                      : movedRecords * 100.0 / sample.storedKeys.size())
+              << "%)" << std::endl;
+}
+
+static void analyzeRouter(bool adaptive, int numServers, const KeySample &sample)
+{
+    std::unique_ptr<DARTRouter> router;
+    if (adaptive)
+    {
+        AdaptiveDARTRouter *adaptiveRouter = new AdaptiveDARTRouter(numServers);
+        // Warm the popularity tracker with the query stream so the
+        // report reflects adaptive replication, not the cold state
+        for (const std::string &key : sample.queriedKeys)
+        {
+            adaptiveRouter->recordQuery(key);
+        }
+        router.reset(adaptiveRouter);
+    }
+    else
+    {
+        router.reset(new DARTRouter(numServers));
+    }
+
+    std::cout << "--- " << (adaptive ? "AdaptiveDARTRouter" : "DARTRouter")
+              << " ---" << std::endl;
+    reportServerCounts(*router, numServers, sample);
+    reportVnodeHistogram(*router, numServers, sample);
+    reportReplicaOverlap(*router, numServers, sample);
+    reportQueryFanOut(*router, sample);
+
+    std::cout << "  Movement cost of a simulated add/remove:" << std::endl;
+    reportMovementCost(adaptive, numServers, numServers + 1, sample);
+    if (numServers > 1)
+    {
+        reportMovementCost(adaptive, numServers, numServers - 1, sample);
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int numServers = 4;
+    std::string keyFile;
+    std::string configFile;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--servers" && i + 1 < argc)
+        {
+            numServers = std::atoi(argv[++i]);
+        }
+        else if (arg == "--keys" && i + 1 < argc)
+        {
+            keyFile = argv[++i];
+        }
+        else
+        {
+            configFile = arg;
+        }
+    }
+
+    KeySample sample;
+    if (!keyFile.empty())
+    {
+        sample = loadKeyFile(keyFile);
+    }
+    else
+    {
+        WorkloadConfig config;
+        if (!configFile.empty())
+        {
+            try
+            {
+                config = WorkloadConfig::fromFile(configFile);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Failed to load workload config: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        sample = generateSample(config);
+    }
+
+    std::cout << "===== DART Routing Analysis =====" << std::endl;
+    std::cout << "Servers: " << numServers << ", stored keys: "
+              << sample.storedKeys.size() << ", query stream: "
+              << sample.queriedKeys.size() << std::endl;
+    std::cout << std::endl;
+
+    analyzeRouter(false, numServers, sample);
+    analyzeRouter(true, numServers, sample);
+
+    return 0;
+}
@@ -9,16 +9,18 @@ namespace idioms
     {
 
         // MPI tags for fault tolerance
-        const int HEARTBEAT_TAG = 10;
         const int RECOVERY_TAG = 11;
         const int RECOVERY_COORD_TAG = 12;
         const int RECOVERY_COMPLETE_TAG = 13;
+        const int GOSSIP_TAG = 14;
 
-        // Heartbeat message structure
-        struct HeartbeatMessage
+        // One piggybacked membership row on the wire: a gossip message is
+        // an array of these, one per known rank
+        struct GossipEntry
         {
-            int senderId;
-            int64_t timestamp;
+            int rank;
+            int status;
+            uint64_t heartbeatCounter;
         };
 
         // Recovery message structure
@@ -32,18 +34,19 @@ namespace idioms
                                    std::shared_ptr<DARTRouter> dartRouter,
                                    bool isClientProcess)
             : rank(mpiRank), worldSize(mpiWorldSize), isClient(isClientProcess),
-              running(false), router(dartRouter),
-              heartbeatInterval(std::chrono::milliseconds(500)), // 500ms between heartbeats
-              timeoutThreshold(std::chrono::milliseconds(2000)), // 2s to suspect failure
-              confirmationThreshold(std::chrono::milliseconds(5000))
-        { // 5s to confirm failure
-
-            // Initialize server status map
-            for (int i = 1; i < worldSize; i++)
-            { // Skip rank 0 (client)
-                serverStatus[i] = ServerStatus::ACTIVE;
-                // Initialize with current time
-                lastHeartbeat[i] = std::chrono::steady_clock::now();
+              running(false),
+              gossipInterval(std::chrono::milliseconds(200)),    // 200ms between gossip rounds
+              suspicionTimeout(std::chrono::milliseconds(2000)), // 2s stale to suspect failure
+              confirmationThreshold(std::chrono::milliseconds(5000)), // further 5s to confirm
+              router(dartRouter),
+              rng(std::random_device{}() + static_cast<unsigned>(mpiRank))
+        {
+            // Initialize the membership table with every rank, the client
+            // included: gossip treats all processes as peers
+            for (int i = 0; i < worldSize; i++)
+            {
+                members[i] = MemberState();
+                members[i].lastAdvance = std::chrono::steady_clock::now();
             }
 
             std::cout << "Fault Manager initialized on rank " << rank << std::endl;
@@ -63,8 +66,8 @@ namespace idioms
 
             running.store(true);
 
-            // Start heartbeat thread
-            heartbeatThread = std::thread(&FaultManager::heartbeatMonitor, this);
+            // Start gossip thread
+            gossipThread = std::thread(&FaultManager::gossipLoop, this);
 
             std::cout << "Fault Manager started on rank " << rank << std::endl;
         }
@@ -78,10 +81,10 @@ namespace idioms
 
             running.store(false);
 
-            // Join heartbeat thread if it exists
-            if (heartbeatThread.joinable())
+            // Join gossip thread if it exists
+            if (gossipThread.joinable())
             {
-                heartbeatThread.join();
+                gossipThread.join();
             }
 
             std::cout << "Fault Manager stopped on rank " << rank << std::endl;
@@ -90,10 +93,10 @@ namespace idioms
         bool FaultManager::isServerActive(int serverRank)
         {
             std::lock_guard<std::mutex> lock(statusMutex);
-            auto it = serverStatus.find(serverRank);
-            if (it != serverStatus.end())
+            auto it = members.find(serverRank);
+            if (it != members.end())
             {
-                return it->second == ServerStatus::ACTIVE;
+                return it->second.status == ServerStatus::ACTIVE;
             }
             return false;
         }
@@ -101,10 +104,10 @@ namespace idioms
         ServerStatus FaultManager::getServerStatus(int serverRank)
         {
             std::lock_guard<std::mutex> lock(statusMutex);
-            auto it = serverStatus.find(serverRank);
-            if (it != serverStatus.end())
+            auto it = members.find(serverRank);
+            if (it != members.end())
             {
-                return it->second;
+                return it->second.status;
             }
             throw std::runtime_error("Server rank not found in status map");
         }
@@ -114,9 +117,10 @@ namespace idioms
             std::vector<int> activeServers;
             std::lock_guard<std::mutex> lock(statusMutex);
 
-            for (const auto &entry : serverStatus)
+            for (const auto &entry : members)
             {
-                if (entry.second == ServerStatus::ACTIVE)
+                // Rank 0 is the client, not a server
+                if (entry.first != 0 && entry.second.status == ServerStatus::ACTIVE)
                 {
                     activeServers.push_back(entry.first);
                 }
@@ -129,15 +133,21 @@ namespace idioms
         {
             std::lock_guard<std::mutex> lock(statusMutex);
 
-            // Update last heartbeat time
-            lastHeartbeat[serverRank] = std::chrono::steady_clock::now();
+            // Direct liveness evidence advances the member's counter just
+            // as relayed gossip would
+            MemberState &member = members[serverRank];
+            member.heartbeatCounter++;
+            member.lastAdvance = std::chrono::steady_clock::now();
 
             // If server was suspect or recovering, mark it as active
-            if (serverStatus[serverRank] == ServerStatus::SUSPECT ||
-                serverStatus[serverRank] == ServerStatus::RECOVERING)
+            if (member.status == ServerStatus::SUSPECT ||
+                member.status == ServerStatus::RECOVERING)
             {
                 std::cout << "Server " << serverRank << " is back online" << std::endl;
-                serverStatus[serverRank] = ServerStatus::ACTIVE;
+                member.status = ServerStatus::ACTIVE;
+
+                // Restore the server in the routing table (rank - 1 = server ID)
+                router->markServerUp(serverRank - 1);
             }
         }
 
@@ -146,10 +156,14 @@ namespace idioms
             std::lock_guard<std::mutex> lock(statusMutex);
 
             // Mark the server as confirmed down
-            serverStatus[serverRank] = ServerStatus::CONFIRMED_DOWN;
+            members[serverRank].status = ServerStatus::CONFIRMED_DOWN;
 
             std::cout << "Server " << serverRank << " manually marked as failed" << std::endl;
 
+            // Publish a new routing epoch so queries reroute to replicas
+            // immediately (rank - 1 = server ID)
+            router->markServerDown(serverRank - 1);
+
             // Initiate recovery if this is the client
             if (isClient)
             {
@@ -162,96 +176,204 @@ namespace idioms
             return running.load();
         }
 
-        void FaultManager::heartbeatMonitor()
+        void FaultManager::gossipLoop()
         {
+            // Every rank runs the same loop: merge whatever gossip has
+            // arrived, and once per interval bump our own counter, send the
+            // view to a few random peers and age the suspicion timers. Per
+            // round the cluster sends O(ranks * GOSSIP_FANOUT) messages
+            // instead of every process probing every server.
+            auto lastRound = std::chrono::steady_clock::now() - gossipInterval;
+
             while (running.load())
             {
-                if (isClient)
+                drainGossip();
+
+                auto now = std::chrono::steady_clock::now();
+                if (now - lastRound >= gossipInterval)
                 {
-                    // Client sends heartbeats to all servers
-                    sendHeartbeats();
+                    lastRound = now;
+                    sendGossip();
+                    checkSuspicions();
+                }
+
+                // Sleep briefly between probes to avoid busy-waiting
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
 
-                    // Client checks heartbeats from all servers
-                    checkHeartbeats();
+        std::vector<int> FaultManager::pickGossipPeers()
+        {
+            std::vector<int> candidates;
+            {
+                std::lock_guard<std::mutex> lock(statusMutex);
+                for (const auto &entry : members)
+                {
+                    if (entry.first != rank &&
+                        entry.second.status != ServerStatus::CONFIRMED_DOWN)
+                    {
+                        candidates.push_back(entry.first);
+                    }
                 }
-                else
+            }
+
+            std::shuffle(candidates.begin(), candidates.end(), rng);
+            if (candidates.size() > static_cast<size_t>(GOSSIP_FANOUT))
+            {
+                candidates.resize(GOSSIP_FANOUT);
+            }
+            return candidates;
+        }
+
+        void FaultManager::sendGossip()
+        {
+            std::vector<GossipEntry> view;
+            {
+                std::lock_guard<std::mutex> lock(statusMutex);
+
+                // Our own counter advancing is the liveness signal the
+                // peers relay on our behalf
+                MemberState &self = members[rank];
+                self.heartbeatCounter++;
+                self.lastAdvance = std::chrono::steady_clock::now();
+
+                view.reserve(members.size());
+                for (const auto &entry : members)
                 {
-                    // Servers just send heartbeats to the client
-                    // Send a heartbeat to the client (rank 0)
-                    HeartbeatMessage msg;
-                    msg.senderId = rank;
-                    msg.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                        std::chrono::system_clock::now().time_since_epoch())
-                                        .count();
-
-                    MPI_Send(&msg, sizeof(msg), MPI_BYTE, 0, HEARTBEAT_TAG, MPI_COMM_WORLD);
+                    view.push_back({entry.first,
+                                    static_cast<int>(entry.second.status),
+                                    entry.second.heartbeatCounter});
                 }
+            }
 
-                // Sleep for heartbeat interval
-                std::this_thread::sleep_for(heartbeatInterval);
+            for (int peer : pickGossipPeers())
+            {
+                MPI_Send(view.data(), view.size() * sizeof(GossipEntry), MPI_BYTE,
+                         peer, GOSSIP_TAG, MPI_COMM_WORLD);
             }
         }
 
-        void FaultManager::sendHeartbeats()
+        void FaultManager::drainGossip()
         {
-            // Client sends heartbeats to all servers
-            HeartbeatMessage msg;
-            msg.senderId = rank;
-            msg.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                std::chrono::system_clock::now().time_since_epoch())
-                                .count();
-
-            for (int i = 1; i < worldSize; i++)
+            int flag = 1;
+            while (flag)
             {
-                // Only send to active or suspect servers
+                MPI_Status status;
+                MPI_Iprobe(MPI_ANY_SOURCE, GOSSIP_TAG, MPI_COMM_WORLD, &flag, &status);
+                if (!flag)
+                {
+                    break;
+                }
+
+                int msgBytes;
+                MPI_Get_count(&status, MPI_BYTE, &msgBytes);
+
+                std::vector<GossipEntry> view(msgBytes / sizeof(GossipEntry));
+                MPI_Recv(view.data(), msgBytes, MPI_BYTE, status.MPI_SOURCE,
+                         GOSSIP_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                auto now = std::chrono::steady_clock::now();
                 std::lock_guard<std::mutex> lock(statusMutex);
-                if (serverStatus[i] == ServerStatus::ACTIVE ||
-                    serverStatus[i] == ServerStatus::SUSPECT)
+
+                for (const GossipEntry &entry : view)
                 {
-                    MPI_Send(&msg, sizeof(msg), MPI_BYTE, i, HEARTBEAT_TAG, MPI_COMM_WORLD);
+                    if (entry.rank == rank)
+                    {
+                        // Nobody else's view of us overrides our own
+                        continue;
+                    }
+
+                    MemberState &member = members[entry.rank];
+
+                    // A confirmed death travels as fact; a stale counter
+                    // cannot resurrect it, only explicit recovery can
+                    if (entry.status == ServerStatus::CONFIRMED_DOWN &&
+                        member.status != ServerStatus::CONFIRMED_DOWN)
+                    {
+                        std::cout << "Server " << entry.rank
+                                  << " reported down via gossip" << std::endl;
+                        member.status = ServerStatus::CONFIRMED_DOWN;
+                        if (entry.rank > 0)
+                        {
+                            router->markServerDown(entry.rank - 1);
+                        }
+                        continue;
+                    }
+
+                    // A fresher counter is liveness evidence, whether the
+                    // sender saw the member directly or heard about it
+                    if (entry.heartbeatCounter > member.heartbeatCounter &&
+                        member.status != ServerStatus::CONFIRMED_DOWN)
+                    {
+                        member.heartbeatCounter = entry.heartbeatCounter;
+                        member.lastAdvance = now;
+
+                        if (member.status == ServerStatus::SUSPECT ||
+                            member.status == ServerStatus::RECOVERING)
+                        {
+                            std::cout << "Server " << entry.rank
+                                      << " is back online" << std::endl;
+                            member.status = ServerStatus::ACTIVE;
+                            if (entry.rank > 0)
+                            {
+                                router->markServerUp(entry.rank - 1);
+                            }
+                        }
+                    }
                 }
             }
         }
 
-        void FaultManager::checkHeartbeats()
+        void FaultManager::checkSuspicions()
         {
             auto now = std::chrono::steady_clock::now();
 
             std::lock_guard<std::mutex> lock(statusMutex);
 
-            for (auto &entry : serverStatus)
+            for (auto &entry : members)
             {
-                int serverRank = entry.first;
-                ServerStatus &status = entry.second;
+                int memberRank = entry.first;
+                MemberState &member = entry.second;
 
-                // Skip confirmed down servers
-                if (status == ServerStatus::CONFIRMED_DOWN)
+                // Skip ourselves and confirmed down members
+                if (memberRank == rank || member.status == ServerStatus::CONFIRMED_DOWN)
                 {
                     continue;
                 }
 
-                // Calculate time since last heartbeat
-                auto timeSinceLastHeartbeat = now - lastHeartbeat[serverRank];
+                // Time since any evidence of life, direct or relayed
+                auto staleness = now - member.lastAdvance;
 
-                if (status == ServerStatus::ACTIVE)
+                if (member.status == ServerStatus::ACTIVE)
                 {
-                    // Check if server has timed out
-                    if (timeSinceLastHeartbeat > timeoutThreshold)
+                    if (staleness > suspicionTimeout)
                     {
-                        std::cout << "Server " << serverRank << " is suspected to be down" << std::endl;
-                        status = ServerStatus::SUSPECT;
+                        std::cout << "Server " << memberRank
+                                  << " is suspected to be down" << std::endl;
+                        member.status = ServerStatus::SUSPECT;
                     }
                 }
-                else if (status == ServerStatus::SUSPECT)
+                else if (member.status == ServerStatus::SUSPECT)
                 {
-                    // Check if server has been suspect for too long
-                    if (timeSinceLastHeartbeat > confirmationThreshold)
+                    if (staleness > suspicionTimeout + confirmationThreshold)
                     {
-                        std::cout << "Server " << serverRank << " is confirmed to be down" << std::endl;
-                        status = ServerStatus::CONFIRMED_DOWN;
-
-                        // Initiate recovery
-                        initiateRecovery(serverRank);
+                        std::cout << "Server " << memberRank
+                                  << " is confirmed to be down" << std::endl;
+                        member.status = ServerStatus::CONFIRMED_DOWN;
+
+                        if (memberRank > 0)
+                        {
+                            // Publish a new routing epoch so queries reroute
+                            // to replicas immediately (rank - 1 = server ID)
+                            router->markServerDown(memberRank - 1);
+                        }
+
+                        // Recovery stays client-coordinated; the servers'
+                        // part is propagating the death through gossip
+                        if (isClient && memberRank > 0)
+                        {
+                            initiateRecovery(memberRank);
+                        }
                     }
                 }
             }
@@ -263,9 +385,9 @@ namespace idioms
 
             // Get list of active servers for recovery
             std::vector<int> activeServers;
-            for (const auto &entry : serverStatus)
+            for (const auto &entry : members)
             {
-                if (entry.second == ServerStatus::ACTIVE)
+                if (entry.first != 0 && entry.second.status == ServerStatus::ACTIVE)
                 {
                     activeServers.push_back(entry.first);
                 }
@@ -338,9 +460,9 @@ namespace idioms
         {
             // Get list of active server IDs (not MPI ranks)
             std::vector<int> activeServerIds;
-            for (const auto &entry : serverStatus)
+            for (const auto &entry : members)
             {
-                if (entry.second == ServerStatus::ACTIVE)
+                if (entry.first != 0 && entry.second.status == ServerStatus::ACTIVE)
                 {
                     // Convert MPI rank to server ID (subtract 1)
                     activeServerIds.push_back(entry.first - 1);
@@ -374,11 +496,5 @@ namespace idioms
             std::cout << "Data redistribution completed" << std::endl;
         }
 
-        void FaultManager::handleHeartbeat(int sourceRank)
-        {
-            // Update last heartbeat time
-            processHeartbeat(sourceRank);
-        }
-
     } // namespace fault
 } // namespace idioms
\ No newline at end of file
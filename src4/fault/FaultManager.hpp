@@ -10,6 +10,7 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <random>
 #include <mpi.h>
 #include "../dart/DART.hpp"
 
@@ -29,8 +30,11 @@ namespace idioms
 
         /**
          * Manages fault detection and recovery for the IDIOMS distributed system.
-         * Uses a heartbeat mechanism to detect server failures and coordinates
-         * recovery operations.
+         * Detects failures with a gossip protocol: each round every rank sends
+         * its membership view to a few random peers, and a member whose
+         * heartbeat counter stops advancing anywhere in the cluster ages
+         * through SUSPECT into CONFIRMED_DOWN. Total message load is
+         * O(ranks * fanout) per round instead of all-to-all.
          */
         class FaultManager
         {
@@ -40,28 +44,49 @@ namespace idioms
             bool isClient;             // Whether this is the client process
             std::atomic<bool> running; // Whether the fault manager is running
 
-            std::mutex statusMutex;                                                                    // Mutex for server status map
-            std::unordered_map<int, ServerStatus> serverStatus;                                        // Status of each server
-            std::unordered_map<int, std::chrono::time_point<std::chrono::steady_clock>> lastHeartbeat; // Last heartbeat time
+            /**
+             * One member's view in the gossip protocol: its status, the
+             * highest heartbeat counter seen for it (directly or relayed),
+             * and when that counter last advanced
+             */
+            struct MemberState
+            {
+                ServerStatus status = ServerStatus::ACTIVE;
+                uint64_t heartbeatCounter = 0;
+                std::chrono::time_point<std::chrono::steady_clock> lastAdvance;
+            };
+
+            std::mutex statusMutex;                       // Mutex for the membership table
+            std::unordered_map<int, MemberState> members; // Membership table, keyed by MPI rank
 
-            std::chrono::milliseconds heartbeatInterval;     // Interval between heartbeats
-            std::chrono::milliseconds timeoutThreshold;      // Timeout threshold for suspecting a server
-            std::chrono::milliseconds confirmationThreshold; // Threshold for confirming a server is down
+            // Peers each rank gossips its view to per round
+            static const int GOSSIP_FANOUT = 2;
+
+            std::chrono::milliseconds gossipInterval;        // Interval between gossip rounds
+            std::chrono::milliseconds suspicionTimeout;      // Stale-counter time before suspecting a member
+            std::chrono::milliseconds confirmationThreshold; // Further suspicion time before confirming down
 
             std::shared_ptr<DARTRouter> router; // DART router for coordinating recovery
-            std::thread heartbeatThread;        // Thread for sending/checking heartbeats
+            std::thread gossipThread;           // Thread running the gossip rounds
+
+            std::mt19937 rng; // Peer selection for gossip rounds
+
+            // Pick up to GOSSIP_FANOUT random live peers for this round
+            std::vector<int> pickGossipPeers();
 
-            // Send a heartbeat to all servers
-            void sendHeartbeats();
+            // Bump this rank's own counter and send the membership view to
+            // the round's peers
+            void sendGossip();
 
-            // Check heartbeats from all servers
-            void checkHeartbeats();
+            // Drain and merge incoming gossip messages
+            void drainGossip();
 
-            // Heartbeat monitoring function (runs in a separate thread)
-            void heartbeatMonitor();
+            // Age members whose counters have stopped advancing through
+            // SUSPECT into CONFIRMED_DOWN
+            void checkSuspicions();
 
-            // Handle a heartbeat message
-            void handleHeartbeat(int sourceRank);
+            // Gossip protocol loop (runs in a separate thread)
+            void gossipLoop();
 
             // Initiate recovery for a failed server
             void initiateRecovery(int failedRank);
@@ -190,6 +190,121 @@ namespace idioms
             return lowerRanked;
         }
 
+        bool LeaderElection::leaseValid() const
+        {
+            // Caller holds leaseMutex
+            return leaseTerm > 0 && std::chrono::steady_clock::now() < leaseExpiry;
+        }
+
+        void LeaderElection::renewSuccessorLease(const std::unordered_set<int> &downRanks)
+        {
+            if (!isLeader())
+            {
+                return;
+            }
+
+            // Successors in ascending rank order, skipping the leader and
+            // anything already down; every process derives the same order,
+            // so the broadcast is the arbitration
+            SuccessorLeaseMessage msg;
+            msg.leaderId = rank;
+            msg.successorCount = 0;
+            for (int i = 0; i < worldSize && msg.successorCount < MAX_SUCCESSORS; i++)
+            {
+                if (i != rank && downRanks.find(i) == downRanks.end())
+                {
+                    msg.successors[msg.successorCount++] = i;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(leaseMutex);
+                msg.term = ++leaseTerm;
+                leaseSuccessors.assign(msg.successors, msg.successors + msg.successorCount);
+                leaseExpiry = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(LEASE_DURATION_MS);
+            }
+
+            for (int i = 0; i < worldSize; i++)
+            {
+                if (i != rank && downRanks.find(i) == downRanks.end())
+                {
+                    MPI_Send(&msg, sizeof(msg), MPI_BYTE, i, LEASE_TAG, MPI_COMM_WORLD);
+                }
+            }
+        }
+
+        void LeaderElection::processSuccessorLease(uint64_t term, int leaderId,
+                                                   const std::vector<int> &successors)
+        {
+            std::lock_guard<std::mutex> lock(leaseMutex);
+
+            // A reordered older broadcast must not roll the lease back
+            if (term <= leaseTerm)
+            {
+                return;
+            }
+
+            leaseTerm = term;
+            leaseSuccessors = successors;
+            leaseExpiry = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(LEASE_DURATION_MS);
+
+            // The lease doubles as a leadership claim: accepting it means
+            // accepting its issuer
+            currentLeader.store(leaderId);
+        }
+
+        void LeaderElection::handleLeaderFailure(int failedRank,
+                                                 const std::unordered_set<int> &downRanks)
+        {
+            if (failedRank != currentLeader.load())
+            {
+                // Not the leader; membership handles ordinary failures
+                return;
+            }
+
+            int successor = -1;
+            {
+                std::lock_guard<std::mutex> lock(leaseMutex);
+                if (leaseValid())
+                {
+                    for (int candidate : leaseSuccessors)
+                    {
+                        if (candidate != failedRank &&
+                            downRanks.find(candidate) == downRanks.end())
+                        {
+                            successor = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (successor == -1)
+            {
+                // Lease expired or exhausted: the ambiguous case, so pay
+                // for a full election
+                std::cout << "No valid successor lease on rank " << rank
+                          << "; falling back to full election" << std::endl;
+                initiateElection();
+                return;
+            }
+
+            // Pre-arbitrated takeover: every process walks the same list,
+            // so all converge on the same successor without an election
+            std::cout << "Rank " << successor << " assumes leadership from lease "
+                      << "after failure of rank " << failedRank << std::endl;
+            currentLeader.store(successor);
+
+            if (successor == rank)
+            {
+                // Announce through the existing victory path so processes
+                // that missed the lease still converge
+                declareVictory();
+            }
+        }
+
         void LeaderElection::sendElectionMessage(ElectionMessageType type, int destRank)
         {
             ElectionMessage msg;
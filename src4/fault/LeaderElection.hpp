@@ -8,6 +8,8 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mpi.h>
 
 namespace idioms
@@ -34,6 +36,18 @@ namespace idioms
             static const int ELECTION_TAG = 20;
             static const int COORDINATOR_TAG = 21;
             static const int ALIVE_TAG = 22;
+            static const int LEASE_TAG = 23;
+
+            // How long a successor lease stays valid without renewal; the
+            // leader must renew well within this window. constexpr makes
+            // it implicitly inline, so odr-uses (it is passed by const
+            // reference into std::chrono ctors) need no out-of-line
+            // definition.
+            static constexpr int LEASE_DURATION_MS = 2000;
+
+            // Upper bound on the pre-arbitrated successor list; processes
+            // past this fall back to a full election anyway
+            static const int MAX_SUCCESSORS = 15;
 
             // Message types for leader election
             enum ElectionMessageType
@@ -50,6 +64,26 @@ namespace idioms
                 int senderId;
             };
 
+            // Lease message the leader broadcasts while healthy: an
+            // ordered successor list pre-arbitrating who takes over
+            struct SuccessorLeaseMessage
+            {
+                uint64_t term;
+                int leaderId;
+                int successorCount;
+                int successors[MAX_SUCCESSORS];
+            };
+
+            // Standby pre-arbitration state: the last lease this process
+            // accepted, and when it expires locally
+            std::mutex leaseMutex;
+            uint64_t leaseTerm = 0;
+            std::vector<int> leaseSuccessors;
+            std::chrono::steady_clock::time_point leaseExpiry;
+
+            // True if the current lease has not expired
+            bool leaseValid() const;
+
             // Start a new election
             void startElection();
 
@@ -119,6 +153,42 @@ namespace idioms
              * Called when leader failure is detected
              */
             void initiateElection();
+
+            /**
+             * Renew the successor lease (leader only)
+             *
+             * Broadcasts an ordered successor list so takeover is already
+             * arbitrated before any failure; call this periodically while
+             * healthy, well within the lease duration.
+             *
+             * @param downRanks Ranks currently considered failed
+             */
+            void renewSuccessorLease(const std::unordered_set<int> &downRanks);
+
+            /**
+             * Process a successor lease broadcast
+             * Used by the MPI message handler when it receives a lease message
+             *
+             * @param term Lease term from the message
+             * @param leaderId Rank of the leader that issued the lease
+             * @param successors Ordered successor list from the message
+             */
+            void processSuccessorLease(uint64_t term, int leaderId,
+                                       const std::vector<int> &successors);
+
+            /**
+             * Handle a confirmed leader failure
+             *
+             * With a valid lease, the first live successor assumes
+             * leadership immediately and no election runs; only when the
+             * lease is expired or exhausted does this fall back to a full
+             * election.
+             *
+             * @param failedRank Rank of the failed leader
+             * @param downRanks Ranks currently considered failed
+             */
+            void handleLeaderFailure(int failedRank,
+                                     const std::unordered_set<int> &downRanks);
         };
 
     } // namespace fault
@@ -0,0 +1,329 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <mpi.h>
+#include "mpi/MPIClient.hpp"
+#include "mpi/MPIServer.hpp"
+#include "benchmark/LatencyHistogram.hpp"
+
+// Fault-injection benchmark: kills a server rank under live query load
+// and reports the numbers every change to the fault path must move —
+// time-to-detect, time-to-reroute, recovery data rate, and the query
+// latency/availability impact through each phase. The phases are
+//
+//   baseline      healthy cluster under steady exact-key reads
+//   failure       victim killed; reads survive through hedged replicas
+//   rerouted      victim marked down, routing skips it epoch-wide
+//   recovery      the victim's vnodes re-replicated to survivors (timed)
+//   recovered     steady reads against the healed cluster
+//
+// The kill is injected by sending the victim a SHUTDOWN: its rank stops
+// serving but stays in the job, which is how a crashed peer looks to
+// everyone else under MPI. Detection mirrors the SUSPECT-then-confirm
+// aging of the gossip FaultManager, client-side: the victim is pinged
+// on an interval under the live load, and two consecutive missed ping
+// deadlines confirm it down. Time-to-detect is the time from the kill
+// to that confirmation; hedged replicas keep the reads answered
+// throughout, which is what the failure-phase latency row shows.
+//
+// The shared-memory transport stays off in this harness: a killed rank
+// never releases payload slots staged for it, which would wedge the
+// sender a slot-ring lap later.
+//
+// Usage: mpirun -np N idioms_fault_bench [recordCount] [victimServerId]
+//        (default: 20000 records, victim = last server)
+//
+// Build (from the repository root):
+//   mpic++ -std=c++17 -Wall -Wextra -pthread -Isrc4 -c src4/fault_benchmark.cpp -o bin/fault/fault_benchmark.o
+//   mpic++ -std=c++17 bin/fault/fault_benchmark.o bin/mpi/*.o bin/server/Server.o bin/index/*.o bin/query/*.o bin/dart/DART.o bin/benchmark/LatencyHistogram.o -o idioms_fault_bench
+
+using idioms::IndexRecord;
+using idioms::benchmark::LatencyHistogram;
+using idioms::mpi::MPIClient;
+using idioms::mpi::MPIServer;
+
+static const std::string DATA_DIR = "./fault_benchmark_data";
+
+// Distinct keys in the load; enough that the rotation outlives the
+// client result-cache TTL, so every query does server work
+static const size_t NUM_KEYS = 1000;
+
+// Pause between queries; bounds the load so the stray sends to the
+// dead rank stay few during the failure window
+static const int QUERY_GAP_MS = 2;
+
+// How long each steady phase runs
+static const int PHASE_MS = 2000;
+
+// Ping the victim this often during the failure phase, and confirm it
+// down after two consecutive pings miss their deadline
+static const int PROBE_INTERVAL_MS = 50;
+static const double PROBE_TIMEOUT_MS = 150.0;
+
+// Give up on detection after this long
+static const int DETECT_CAP_MS = 5000;
+
+// Latency and availability over one phase of the run
+struct PhaseStats
+{
+    LatencyHistogram hist;
+    uint64_t failures = 0;   // Queries that raised a server/transport error
+    uint64_t dataErrors = 0; // Queries whose result count was wrong
+};
+
+static std::string keyForIndex(size_t k)
+{
+    return "sensor/" + std::to_string(k) + "/reading";
+}
+
+// One exact-key read, recorded into the phase. Returns the latency in
+// nanoseconds (0 on failure).
+static uint64_t issueQuery(MPIClient &client, size_t &keyCursor,
+                           size_t expectedPerKey, PhaseStats &phase)
+{
+    std::string queryStr = keyForIndex(keyCursor++ % NUM_KEYS) + "=*";
+
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        std::vector<int> results = client.md_search(queryStr);
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        phase.hist.record(nanos);
+        if (results.size() != expectedPerKey)
+        {
+            phase.dataErrors++;
+        }
+        return nanos;
+    }
+    catch (const std::exception &e)
+    {
+        phase.failures++;
+        std::cerr << "Query failed: " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+// Issue queries back to back for durationMs
+static void runPhase(MPIClient &client, size_t &keyCursor, size_t expectedPerKey,
+                     int durationMs, PhaseStats &phase)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(durationMs);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        issueQuery(client, keyCursor, expectedPerKey, phase);
+        std::this_thread::sleep_for(std::chrono::milliseconds(QUERY_GAP_MS));
+    }
+}
+
+static double ms(uint64_t nanos)
+{
+    return nanos / 1e6;
+}
+
+static void printPhase(const std::string &name, const PhaseStats &phase)
+{
+    uint64_t total = phase.hist.count() + phase.failures;
+    double availability = total == 0
+                              ? 0.0
+                              : 100.0 * phase.hist.count() / static_cast<double>(total);
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+              << std::setw(8) << total << " queries"
+              << "  p50 " << std::setw(8) << std::fixed << std::setprecision(3)
+              << ms(phase.hist.valueAtPercentile(50.0)) << " ms"
+              << "  p99 " << std::setw(8) << ms(phase.hist.valueAtPercentile(99.0)) << " ms"
+              << "  max " << std::setw(8) << ms(phase.hist.max()) << " ms"
+              << "  avail " << std::setw(7) << std::setprecision(2) << availability << " %"
+              << "  wrong " << phase.dataErrors << std::endl;
+}
+
+static void runClient(int rank, int worldSize, size_t recordCount, int victimId)
+{
+    int numServers = worldSize - 1;
+    size_t expectedPerKey = recordCount / NUM_KEYS;
+
+    MPIClient client(rank, worldSize, true);
+
+    std::cout << "Fault-injection benchmark: " << recordCount << " records, "
+              << numServers << " servers, victim = server " << victimId
+              << std::endl;
+
+    std::vector<IndexRecord> records;
+    records.reserve(recordCount);
+    for (size_t i = 0; i < recordCount; i++)
+    {
+        records.emplace_back(keyForIndex(i % NUM_KEYS),
+                             "value-" + std::to_string(i), static_cast<int>(i));
+    }
+    client.create_md_index_batch(records);
+
+    size_t keyCursor = 0;
+    PhaseStats baseline, failure, rerouted, recovered;
+
+    // Phase 1: healthy cluster
+    runPhase(client, keyCursor, expectedPerKey, PHASE_MS, baseline);
+
+    // Phase 2: kill the victim and keep querying; the victim is pinged
+    // on an interval, and two consecutive missed deadlines confirm the
+    // failure — one miss only makes it a suspect, so a scheduling
+    // hiccup cannot fake a detection
+    std::cout << "Killing server " << victimId << "..." << std::endl;
+    auto killTime = std::chrono::steady_clock::now();
+    client.shutdownServer(victimId);
+
+    int missedProbes = 0;
+    double detectMs = -1.0;
+    auto detectCap = killTime + std::chrono::milliseconds(DETECT_CAP_MS);
+    auto nextProbe = killTime + std::chrono::milliseconds(PROBE_INTERVAL_MS);
+    while (std::chrono::steady_clock::now() < detectCap)
+    {
+        issueQuery(client, keyCursor, expectedPerKey, failure);
+
+        if (std::chrono::steady_clock::now() >= nextProbe)
+        {
+            missedProbes = client.pingServer(victimId, PROBE_TIMEOUT_MS)
+                               ? 0
+                               : missedProbes + 1;
+            nextProbe = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(PROBE_INTERVAL_MS);
+        }
+        if (missedProbes >= 2)
+        {
+            detectMs = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - killTime)
+                           .count();
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(QUERY_GAP_MS));
+    }
+
+    // Phase 3: publish the failure and measure how long routing takes to
+    // skip the dead rank cluster-wide
+    auto rerouteStart = std::chrono::steady_clock::now();
+    client.reportServerFailure(victimId);
+    double rerouteMs = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - rerouteStart)
+                           .count();
+
+    runPhase(client, keyCursor, expectedPerKey, PHASE_MS, rerouted);
+
+    // Phase 4: re-replicate the victim's vnodes to the survivors; the
+    // survivors' index growth over the transfer gives the data rate
+    uint64_t entriesBefore = 0, bytesBefore = 0;
+    for (int s = 0; s < numServers; s++)
+    {
+        if (s == victimId)
+        {
+            continue;
+        }
+        auto stats = client.getServerStats(s);
+        entriesBefore += stats.postingEntries;
+        bytesBefore += stats.indexMemoryBytes;
+    }
+
+    auto recoveryStart = std::chrono::steady_clock::now();
+    client.reReplicateFailedServer(victimId);
+    double recoveryMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - recoveryStart)
+                            .count();
+
+    uint64_t entriesAfter = 0, bytesAfter = 0;
+    for (int s = 0; s < numServers; s++)
+    {
+        if (s == victimId)
+        {
+            continue;
+        }
+        auto stats = client.getServerStats(s);
+        entriesAfter += stats.postingEntries;
+        bytesAfter += stats.indexMemoryBytes;
+    }
+
+    // Phase 5: healed cluster
+    runPhase(client, keyCursor, expectedPerKey, PHASE_MS, recovered);
+
+    std::cout << "\n=== Fault-injection results ===" << std::endl;
+    printPhase("baseline", baseline);
+    printPhase("failure", failure);
+    printPhase("rerouted", rerouted);
+    printPhase("recovered", recovered);
+
+    std::cout << std::fixed << std::setprecision(1);
+    if (detectMs >= 0.0)
+    {
+        std::cout << "  time-to-detect   " << detectMs << " ms ("
+                  << PROBE_INTERVAL_MS << " ms probe interval, "
+                  << PROBE_TIMEOUT_MS << " ms deadline)" << std::endl;
+    }
+    else
+    {
+        std::cout << "  time-to-detect   not confirmed within " << DETECT_CAP_MS
+                  << " ms" << std::endl;
+    }
+    std::cout << "  time-to-reroute  " << rerouteMs << " ms" << std::endl;
+
+    uint64_t entriesMoved = entriesAfter - entriesBefore;
+    uint64_t bytesMoved = bytesAfter - bytesBefore;
+    std::cout << "  recovery         " << recoveryMs << " ms, " << entriesMoved
+              << " entries re-replicated ("
+              << (recoveryMs > 0.0 ? entriesMoved / (recoveryMs / 1000.0) : 0.0)
+              << " entries/s, " << std::setprecision(2)
+              << (recoveryMs > 0.0 ? bytesMoved / (recoveryMs / 1000.0) / (1024.0 * 1024.0)
+                                   : 0.0)
+              << " MB/s of index)" << std::endl;
+
+    // The victim is already down; only the survivors need a shutdown
+    for (int s = 0; s < numServers; s++)
+    {
+        if (s != victimId)
+        {
+            client.shutdownServer(s);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int rank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    if (worldSize < 4)
+    {
+        if (rank == 0)
+        {
+            std::cerr << "The fault benchmark needs at least 4 ranks: one "
+                      << "client and three servers, so a killed server "
+                      << "leaves a replica and recovery targets" << std::endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    size_t recordCount = argc > 1 ? std::stoul(argv[1]) : 20000;
+    int victimId = argc > 2 ? std::stoi(argv[2]) : worldSize - 2;
+
+    if (rank == 0)
+    {
+        runClient(rank, worldSize, recordCount, victimId);
+    }
+    else
+    {
+        std::string dataDir = DATA_DIR + "_" + std::to_string(rank);
+        std::string cmd = "rm -rf " + dataDir;
+        system(cmd.c_str());
+        MPIServer server(rank, worldSize, dataDir, true);
+        server.run();
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,295 @@
+#ifndef IDIOMS_CHILD_TABLE_HPP
+#define IDIOMS_CHILD_TABLE_HPP
+
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace idioms
+{
+
+    /**
+     * Child tables for the trie nodes
+     *
+     * Child lookup is the innermost operation of every insert and search,
+     * so the layout is selected per deployment at compile time:
+     *
+     *   - SortedChildTable (the default): a small sorted vector, compact
+     *     for the typical fan-out of a few children.
+     *   - DirectChildTable (-DIDIOMS_TRIE_DENSE_CHILDREN): a
+     *     direct-indexed array over the deployment alphabet, making the
+     *     lookup a single array index, with a sorted-vector fallback for
+     *     characters outside the alphabet. Costs Alphabet::SIZE pointers
+     *     per node, which ingest-heavy deployments trade for the constant
+     *     factor.
+     *
+     * Both expose the same interface, including iteration in ascending
+     * edge-character order — the range walks prune subtrees based on that
+     * order, so the dense table merges its array slots with the fallback
+     * vector during iteration.
+     */
+
+    /**
+     * The deployment alphabet for the dense layout: [-./0-9_a-z]
+     *
+     * Slots are assigned in ascending character order so iterating the
+     * slot array visits children in the same order the sorted vector
+     * would.
+     */
+    struct DenseTrieAlphabet
+    {
+        static constexpr int SIZE = 40; // '-' '.' '/' + 10 digits + '_' + 26 letters
+
+        // Slot for a character, or -1 if outside the alphabet
+        static constexpr int slotOf(unsigned char c)
+        {
+            if (c >= '-' && c <= '/')
+            {
+                return c - '-';
+            }
+            if (c >= '0' && c <= '9')
+            {
+                return 3 + (c - '0');
+            }
+            if (c == '_')
+            {
+                return 13;
+            }
+            if (c >= 'a' && c <= 'z')
+            {
+                return 14 + (c - 'a');
+            }
+            return -1;
+        }
+
+        // The character owning a slot (inverse of slotOf)
+        static constexpr char charAt(int slot)
+        {
+            if (slot < 3)
+            {
+                return static_cast<char>('-' + slot);
+            }
+            if (slot < 13)
+            {
+                return static_cast<char>('0' + (slot - 3));
+            }
+            if (slot == 13)
+            {
+                return '_';
+            }
+            return static_cast<char>('a' + (slot - 14));
+        }
+    };
+
+    /**
+     * Sorted-vector child table (the historical layout)
+     */
+    template <typename Node>
+    class SortedChildTable
+    {
+    private:
+        std::vector<std::pair<char, Node *>> entries; // Sorted by edge character
+
+        // Position of the entry for c, or where it would be inserted
+        typename std::vector<std::pair<char, Node *>>::iterator lowerBound(char c)
+        {
+            return std::lower_bound(entries.begin(), entries.end(), c,
+                                    [](const std::pair<char, Node *> &entry, char ch)
+                                    { return entry.first < ch; });
+        }
+
+    public:
+        using const_iterator = typename std::vector<std::pair<char, Node *>>::const_iterator;
+
+        Node *find(char c) const
+        {
+            auto it = std::lower_bound(entries.begin(), entries.end(), c,
+                                       [](const std::pair<char, Node *> &entry, char ch)
+                                       { return entry.first < ch; });
+            return (it != entries.end() && it->first == c) ? it->second : nullptr;
+        }
+
+        void add(char c, Node *child)
+        {
+            entries.insert(lowerBound(c), {c, child});
+        }
+
+        void replace(char c, Node *child)
+        {
+            auto it = lowerBound(c);
+            if (it != entries.end() && it->first == c)
+            {
+                it->second = child;
+            }
+        }
+
+        bool empty() const { return entries.empty(); }
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+    };
+
+    /**
+     * Direct-indexed child table over a compile-time alphabet
+     */
+    template <typename Node, typename Alphabet = DenseTrieAlphabet>
+    class DirectChildTable
+    {
+    private:
+        std::array<Node *, Alphabet::SIZE> slots{}; // Indexed by Alphabet::slotOf
+        std::vector<std::pair<char, Node *>> rare;  // Sorted; characters outside the alphabet
+
+        // Position of the rare entry for c, or where it would be inserted
+        typename std::vector<std::pair<char, Node *>>::iterator rareLowerBound(char c)
+        {
+            return std::lower_bound(rare.begin(), rare.end(), c,
+                                    [](const std::pair<char, Node *> &entry, char ch)
+                                    { return entry.first < ch; });
+        }
+
+    public:
+        Node *find(char c) const
+        {
+            int slot = Alphabet::slotOf(static_cast<unsigned char>(c));
+            if (slot >= 0)
+            {
+                return slots[slot];
+            }
+            auto it = std::lower_bound(rare.begin(), rare.end(), c,
+                                       [](const std::pair<char, Node *> &entry, char ch)
+                                       { return entry.first < ch; });
+            return (it != rare.end() && it->first == c) ? it->second : nullptr;
+        }
+
+        void add(char c, Node *child)
+        {
+            int slot = Alphabet::slotOf(static_cast<unsigned char>(c));
+            if (slot >= 0)
+            {
+                slots[slot] = child;
+            }
+            else
+            {
+                rare.insert(rareLowerBound(c), {c, child});
+            }
+        }
+
+        void replace(char c, Node *child)
+        {
+            int slot = Alphabet::slotOf(static_cast<unsigned char>(c));
+            if (slot >= 0)
+            {
+                slots[slot] = child;
+            }
+            else
+            {
+                auto it = rareLowerBound(c);
+                if (it != rare.end() && it->first == c)
+                {
+                    it->second = child;
+                }
+            }
+        }
+
+        bool empty() const
+        {
+            if (!rare.empty())
+            {
+                return false;
+            }
+            for (Node *slot : slots)
+            {
+                if (slot != nullptr)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Iterates occupied slots merged with the rare vector in ascending
+         * edge-character order, yielding (character, child) pairs
+         */
+        class const_iterator
+        {
+        private:
+            const DirectChildTable *table;
+            int slot;        // Next occupied slot, or Alphabet::SIZE
+            size_t rareIdx;  // Next rare entry
+
+            // Advance slot to the next occupied one
+            void skipEmptySlots()
+            {
+                while (slot < Alphabet::SIZE && table->slots[slot] == nullptr)
+                {
+                    slot++;
+                }
+            }
+
+            // True if the next element comes from the slot array
+            bool slotIsNext() const
+            {
+                if (slot >= Alphabet::SIZE)
+                {
+                    return false;
+                }
+                if (rareIdx >= table->rare.size())
+                {
+                    return true;
+                }
+                return Alphabet::charAt(slot) < table->rare[rareIdx].first;
+            }
+
+        public:
+            const_iterator(const DirectChildTable *table, int slot, size_t rareIdx)
+                : table(table), slot(slot), rareIdx(rareIdx)
+            {
+                skipEmptySlots();
+            }
+
+            std::pair<char, Node *> operator*() const
+            {
+                if (slotIsNext())
+                {
+                    return {Alphabet::charAt(slot), table->slots[slot]};
+                }
+                return table->rare[rareIdx];
+            }
+
+            const_iterator &operator++()
+            {
+                if (slotIsNext())
+                {
+                    slot++;
+                    skipEmptySlots();
+                }
+                else
+                {
+                    rareIdx++;
+                }
+                return *this;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return slot != other.slot || rareIdx != other.rareIdx;
+            }
+        };
+
+        const_iterator begin() const { return const_iterator(this, 0, 0); }
+        const_iterator end() const { return const_iterator(this, Alphabet::SIZE, rare.size()); }
+    };
+
+// The layout used by KeyTrieNode and ValueTrieNode, chosen at build time
+#ifdef IDIOMS_TRIE_DENSE_CHILDREN
+    template <typename Node>
+    using TrieChildTable = DirectChildTable<Node>;
+#else
+    template <typename Node>
+    using TrieChildTable = SortedChildTable<Node>;
+#endif
+
+} // namespace idioms
+
+#endif // IDIOMS_CHILD_TABLE_HPP
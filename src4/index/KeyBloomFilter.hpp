@@ -0,0 +1,130 @@
+#ifndef IDIOMS_KEY_BLOOM_FILTER_HPP
+#define IDIOMS_KEY_BLOOM_FILTER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "../common/Hash.hpp"
+
+namespace idioms
+{
+
+    /**
+     * Fixed-size Bloom filter over indexed key strings
+     *
+     * Used by servers to answer "does this server possibly hold this key /
+     * key suffix?" without walking any trie, and shipped to clients as a
+     * compact digest so fan-out queries can skip servers that provably hold
+     * no match. A negative answer is always correct; a positive answer may
+     * be a false positive, in which case the normal trie lookup follows.
+     *
+     * The filter only grows: deletions leave bits set, so after heavy
+     * deletion it degrades to extra false positives, never to wrong
+     * negatives. Recovery rebuilds the filter from scratch.
+     *
+     * Header-only: add runs once per indexed key and mightContain guards
+     * every fan-out probe, so both inline into their call sites on the
+     * shared hash kernel (see common/Hash.hpp).
+     */
+    class KeyBloomFilter
+    {
+    private:
+        static const size_t FILTER_BITS = 1 << 16; // 8 KiB of bits
+        static const size_t NUM_HASHES = 4;
+
+        std::vector<uint64_t> words;
+
+        // 64-bit FNV-1a; split into two independent hashes for double hashing
+        static uint64_t hashString(std::string_view s)
+        {
+            return common::fnvHash64(s.data(), s.size());
+        }
+
+    public:
+        KeyBloomFilter()
+            : words(FILTER_BITS / 64, 0)
+        {
+        }
+
+        /**
+         * Record a string in the filter
+         *
+         * @param key String to record
+         */
+        void add(std::string_view key)
+        {
+            uint64_t hash = hashString(key);
+
+            // Double hashing: derive NUM_HASHES bit positions from two halves
+            // of one 64-bit hash. The odd step guarantees all positions differ.
+            uint64_t h1 = hash & 0xFFFFFFFFULL;
+            uint64_t h2 = (hash >> 32) | 1;
+
+            for (size_t i = 0; i < NUM_HASHES; i++)
+            {
+                size_t bit = (h1 + i * h2) % FILTER_BITS;
+                words[bit / 64] |= 1ULL << (bit % 64);
+            }
+        }
+
+        /**
+         * Check whether a string may have been recorded
+         *
+         * @param key String to probe
+         * @return False if the string was definitely never added; true if it
+         *         may have been (subject to false positives)
+         */
+        bool mightContain(std::string_view key) const
+        {
+            uint64_t hash = hashString(key);
+            uint64_t h1 = hash & 0xFFFFFFFFULL;
+            uint64_t h2 = (hash >> 32) | 1;
+
+            for (size_t i = 0; i < NUM_HASHES; i++)
+            {
+                size_t bit = (h1 + i * h2) % FILTER_BITS;
+                if ((words[bit / 64] & (1ULL << (bit % 64))) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Reset the filter to empty
+         */
+        void clear()
+        {
+            std::fill(words.begin(), words.end(), 0);
+        }
+
+        /**
+         * Get the filter's bit words as a compact digest for shipping
+         *
+         * @return The raw filter words
+         */
+        std::vector<uint64_t> getDigest() const
+        {
+            return words;
+        }
+
+        /**
+         * Replace the filter's contents with a previously fetched digest
+         *
+         * @param digest Words produced by getDigest on another filter
+         */
+        void loadDigest(const std::vector<uint64_t> &digest)
+        {
+            if (digest.size() == words.size())
+            {
+                words = digest;
+            }
+        }
+    };
+
+} // namespace idioms
+
+#endif // IDIOMS_KEY_BLOOM_FILTER_HPP
@@ -0,0 +1,21 @@
+#include "MemoryAccounting.hpp"
+
+namespace idioms
+{
+
+    MemoryAccounting::MemoryAccounting()
+    {
+        // Atomics in arrays do not zero-initialize on their own
+        for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++)
+        {
+            bytesBySubsystem[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    MemoryAccounting &MemoryAccounting::instance()
+    {
+        static MemoryAccounting instance;
+        return instance;
+    }
+
+} // namespace idioms
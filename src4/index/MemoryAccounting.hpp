@@ -0,0 +1,95 @@
+#ifndef IDIOMS_MEMORY_ACCOUNTING_HPP
+#define IDIOMS_MEMORY_ACCOUNTING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idioms
+{
+
+    // The major memory owners we attribute the footprint to
+    enum MemorySubsystem
+    {
+        MEM_TRIE_ARENA = 0,      // Node blocks of every KeyTrie/ValueTrie arena
+        MEM_SUFFIX_INDEX = 1,    // Interned text pools and suffix arrays
+        MEM_OBJECT_METADATA = 2, // objectMetadata key/value strings and pairs
+        MEM_MESSAGE_BUFFERS = 3, // Idle buffers held by the message pool
+        MEM_SUBSYSTEM_COUNT = 4
+    };
+
+    /**
+     * Process-wide per-subsystem memory counters
+     *
+     * The owners hook their allocation and release sites and keep one
+     * relaxed atomic per subsystem current, so an OOM can be attributed
+     * without a heap profiler attached. Counters cover the dominant
+     * allocations (arena blocks, interned text, metadata strings, pooled
+     * buffers), not every container's bookkeeping overhead.
+     *
+     * The registry is process-wide: under MPI each rank runs one server,
+     * so these are per-server numbers; the standalone demo runs every
+     * server in one process and each reports the shared totals.
+     */
+    class MemoryAccounting
+    {
+    private:
+        std::atomic<uint64_t> bytesBySubsystem[MEM_SUBSYSTEM_COUNT];
+
+        MemoryAccounting();
+
+    public:
+        // The process-wide registry
+        static MemoryAccounting &instance();
+
+        /**
+         * Charge bytes to a subsystem
+         *
+         * @param subsystem The owning subsystem
+         * @param bytes Bytes allocated
+         */
+        void add(MemorySubsystem subsystem, uint64_t bytes)
+        {
+            bytesBySubsystem[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        /**
+         * Release bytes from a subsystem
+         *
+         * @param subsystem The owning subsystem
+         * @param bytes Bytes freed
+         */
+        void sub(MemorySubsystem subsystem, uint64_t bytes)
+        {
+            bytesBySubsystem[subsystem].fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        /**
+         * Current footprint of a subsystem
+         *
+         * @param subsystem The subsystem to read
+         * @return Live bytes currently charged to it
+         */
+        uint64_t bytes(MemorySubsystem subsystem) const
+        {
+            return bytesBySubsystem[subsystem].load(std::memory_order_relaxed);
+        }
+    };
+
+    // Shorthand for the process-wide registry
+    inline MemoryAccounting &memoryAccounting()
+    {
+        return MemoryAccounting::instance();
+    }
+
+    // Heap bytes behind a string: zero while the small-string buffer
+    // holds it, capacity plus terminator once it spills
+    inline uint64_t stringHeapBytes(const std::string &str)
+    {
+        return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+    }
+
+} // namespace idioms
+
+#endif // IDIOMS_MEMORY_ACCOUNTING_HPP
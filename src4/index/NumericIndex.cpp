@@ -0,0 +1,65 @@
+#include "NumericIndex.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace idioms
+{
+
+    NumericIndex::NumericIndex() {}
+
+    void NumericIndex::ensureSorted(KeyEntries &keyEntries) const
+    {
+        if (!keyEntries.sorted)
+        {
+            std::sort(keyEntries.entries.begin(), keyEntries.entries.end());
+            keyEntries.sorted = true;
+        }
+    }
+
+    void NumericIndex::insert(const std::string &key, double value, int objectId)
+    {
+        KeyEntries &keyEntries = byKey[key];
+        keyEntries.entries.push_back({value, objectId});
+        keyEntries.sorted = false;
+    }
+
+    PostingList NumericIndex::queryRange(const std::string &key, double minValue, double maxValue) const
+    {
+        PostingList results;
+
+        auto it = byKey.find(key);
+        if (it == byKey.end())
+        {
+            return results;
+        }
+
+        KeyEntries &keyEntries = it->second;
+        ensureSorted(keyEntries);
+
+        // Binary search for the matching slice; objectId bounds make the
+        // pair comparisons cover the full value range at both ends
+        auto lower = std::lower_bound(keyEntries.entries.begin(), keyEntries.entries.end(),
+                                      std::make_pair(minValue, std::numeric_limits<int>::min()));
+        auto upper = std::upper_bound(lower, keyEntries.entries.end(),
+                                      std::make_pair(maxValue, std::numeric_limits<int>::max()));
+
+        for (auto entry = lower; entry != upper; ++entry)
+        {
+            results.add(entry->second);
+        }
+
+        return results;
+    }
+
+    bool NumericIndex::hasKey(const std::string &key) const
+    {
+        auto it = byKey.find(key);
+        return it != byKey.end() && !it->second.entries.empty();
+    }
+
+    void NumericIndex::clear()
+    {
+        byKey.clear();
+    }
+
+} // namespace idioms
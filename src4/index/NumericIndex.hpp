@@ -0,0 +1,78 @@
+#ifndef IDIOMS_NUMERIC_INDEX_HPP
+#define IDIOMS_NUMERIC_INDEX_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PostingList.hpp"
+
+namespace idioms
+{
+
+    /**
+     * Secondary index over numerically-valued metadata for range queries.
+     *
+     * Values that parse as numbers are recorded per key as (value, objectId)
+     * pairs in a sorted array, so a [min, max] range query is two binary
+     * searches plus a scan of the matching slice instead of a pass over every
+     * object's metadata with a string-to-double parse per comparison.
+     *
+     * Like the suffix index, sorting is deferred: inserts append and mark the
+     * key dirty, and the array is sorted on first query after a batch.
+     */
+    class NumericIndex
+    {
+    private:
+        struct KeyEntries
+        {
+            std::vector<std::pair<double, int>> entries; // (value, objectId)
+            bool sorted;
+
+            KeyEntries() : sorted(true) {}
+        };
+
+        // Mutable so lazy sorting can run under const queries
+        mutable std::unordered_map<std::string, KeyEntries> byKey;
+
+        // Sort a key's entries if inserts have been made since the last query
+        void ensureSorted(KeyEntries &keyEntries) const;
+
+    public:
+        NumericIndex();
+
+        /**
+         * Record a numeric value for a key
+         *
+         * @param key Metadata attribute key
+         * @param value Parsed numeric value
+         * @param objectId Object ID carrying this value
+         */
+        void insert(const std::string &key, double value, int objectId);
+
+        /**
+         * Find all objects whose value for a key lies in [minValue, maxValue]
+         *
+         * @param key Metadata attribute key
+         * @param minValue Lower bound (inclusive)
+         * @param maxValue Upper bound (inclusive)
+         * @return Posting list of matching object IDs
+         */
+        PostingList queryRange(const std::string &key, double minValue, double maxValue) const;
+
+        /**
+         * Check whether any numeric values are indexed for a key
+         *
+         * @param key Metadata attribute key
+         * @return True if the key has at least one numeric entry
+         */
+        bool hasKey(const std::string &key) const;
+
+        /**
+         * Remove all entries
+         */
+        void clear();
+    };
+
+} // namespace idioms
+
+#endif // IDIOMS_NUMERIC_INDEX_HPP
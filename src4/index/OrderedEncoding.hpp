@@ -0,0 +1,84 @@
+#ifndef IDIOMS_ORDERED_ENCODING_HPP
+#define IDIOMS_ORDERED_ENCODING_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace idioms
+{
+
+    // Prefix marking encoded numeric values in a ValueTrie. Metadata values
+    // never contain this byte, so encoded entries are invisible to ordinary
+    // exact/prefix/suffix/infix value queries.
+    const char ENCODED_VALUE_PREFIX = '\x02';
+
+    /**
+     * Encode a double as a fixed-width string whose lexicographic order
+     * matches numeric order
+     *
+     * The IEEE-754 bits are remapped (sign bit set for non-negatives, all
+     * bits flipped for negatives) so the full double range — negatives,
+     * zero, positives — sorts correctly, then rendered as 16 lowercase hex
+     * digits. Integers up to 2^53 and the day numbers produced by
+     * RangeQuery::dateToNumeric are covered exactly.
+     *
+     * @param value Numeric value to encode
+     * @return 16-character order-preserving encoding
+     */
+    inline std::string encodeOrderedDouble(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        if (bits & 0x8000000000000000ULL)
+        {
+            bits = ~bits; // Negative: flip everything
+        }
+        else
+        {
+            bits |= 0x8000000000000000ULL; // Non-negative: set the sign bit
+        }
+
+        static const char digits[] = "0123456789abcdef";
+        std::string encoded(16, '0');
+        for (int i = 15; i >= 0; i--)
+        {
+            encoded[i] = digits[bits & 0xF];
+            bits >>= 4;
+        }
+        return encoded;
+    }
+
+    /**
+     * Decode a string produced by encodeOrderedDouble
+     *
+     * @param encoded 16-character encoding
+     * @return The original double
+     */
+    inline double decodeOrderedDouble(const std::string &encoded)
+    {
+        uint64_t bits = 0;
+        for (char c : encoded)
+        {
+            bits <<= 4;
+            bits |= static_cast<uint64_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+        }
+
+        if (bits & 0x8000000000000000ULL)
+        {
+            bits &= ~0x8000000000000000ULL; // Non-negative: clear the sign bit
+        }
+        else
+        {
+            bits = ~bits; // Negative: flip everything back
+        }
+
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+} // namespace idioms
+
+#endif // IDIOMS_ORDERED_ENCODING_HPP
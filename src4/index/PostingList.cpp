@@ -0,0 +1,368 @@
+#include "PostingList.hpp"
+#include <algorithm>
+
+namespace idioms
+{
+
+    // Container implementation; the per-record add/contains leaves live
+    // in the header so they inline into the ingest path
+
+    void PostingList::Container::toBitmap()
+    {
+        bitmap.assign(BITMAP_WORDS, 0);
+        for (uint16_t low : array)
+        {
+            bitmap[low >> 6] |= 1ULL << (low & 63);
+        }
+        array.clear();
+        array.shrink_to_fit();
+        isBitmap = true;
+    }
+
+    void PostingList::Container::unionWith(const Container &other)
+    {
+        if (!isBitmap && !other.isBitmap)
+        {
+            // Array-array: linear merge
+            std::vector<uint16_t> merged;
+            merged.reserve(array.size() + other.array.size());
+            std::set_union(array.begin(), array.end(),
+                           other.array.begin(), other.array.end(),
+                           std::back_inserter(merged));
+            array = std::move(merged);
+            cardinality = array.size();
+
+            if (cardinality > ARRAY_LIMIT)
+            {
+                toBitmap();
+            }
+            return;
+        }
+
+        if (!isBitmap)
+        {
+            toBitmap();
+        }
+
+        if (other.isBitmap)
+        {
+            // Bitmap-bitmap: word-at-a-time OR
+            cardinality = 0;
+            for (size_t w = 0; w < BITMAP_WORDS; w++)
+            {
+                bitmap[w] |= other.bitmap[w];
+                cardinality += __builtin_popcountll(bitmap[w]);
+            }
+        }
+        else
+        {
+            for (uint16_t low : other.array)
+            {
+                add(low);
+            }
+        }
+    }
+
+    void PostingList::Container::intersectWith(const Container &other)
+    {
+        if (!isBitmap && !other.isBitmap)
+        {
+            // Array-array: linear intersection
+            std::vector<uint16_t> merged;
+            std::set_intersection(array.begin(), array.end(),
+                                  other.array.begin(), other.array.end(),
+                                  std::back_inserter(merged));
+            array = std::move(merged);
+            cardinality = array.size();
+            return;
+        }
+
+        if (isBitmap && other.isBitmap)
+        {
+            // Bitmap-bitmap: word-at-a-time AND
+            cardinality = 0;
+            for (size_t w = 0; w < BITMAP_WORDS; w++)
+            {
+                bitmap[w] &= other.bitmap[w];
+                cardinality += __builtin_popcountll(bitmap[w]);
+            }
+            return;
+        }
+
+        // Mixed: filter the array side through the bitmap side
+        const Container &arraySide = isBitmap ? other : *this;
+        const Container &bitmapSide = isBitmap ? *this : other;
+
+        std::vector<uint16_t> kept;
+        for (uint16_t low : arraySide.array)
+        {
+            if (bitmapSide.contains(low))
+            {
+                kept.push_back(low);
+            }
+        }
+
+        isBitmap = false;
+        bitmap.clear();
+        bitmap.shrink_to_fit();
+        array = std::move(kept);
+        cardinality = array.size();
+    }
+
+    void PostingList::Container::subtract(const Container &other)
+    {
+        if (isBitmap && other.isBitmap)
+        {
+            // Bitmap-bitmap: word-at-a-time AND NOT
+            cardinality = 0;
+            for (size_t w = 0; w < BITMAP_WORDS; w++)
+            {
+                bitmap[w] &= ~other.bitmap[w];
+                cardinality += __builtin_popcountll(bitmap[w]);
+            }
+            return;
+        }
+
+        if (isBitmap)
+        {
+            // Clear individual bits for the other side's array entries
+            for (uint16_t low : other.array)
+            {
+                uint64_t &word = bitmap[low >> 6];
+                uint64_t mask = 1ULL << (low & 63);
+                if (word & mask)
+                {
+                    word &= ~mask;
+                    cardinality--;
+                }
+            }
+            return;
+        }
+
+        // Array side: drop entries present in the other container
+        array.erase(std::remove_if(array.begin(), array.end(),
+                                   [&](uint16_t low)
+                                   { return other.contains(low); }),
+                    array.end());
+        cardinality = array.size();
+    }
+
+    void PostingList::Container::appendValues(uint32_t high, std::vector<int> &out) const
+    {
+        if (isBitmap)
+        {
+            for (size_t w = 0; w < BITMAP_WORDS; w++)
+            {
+                uint64_t word = bitmap[w];
+                while (word != 0)
+                {
+                    int bit = __builtin_ctzll(word);
+                    out.push_back(static_cast<int>((high << 16) | (w << 6) | bit));
+                    word &= word - 1;
+                }
+            }
+        }
+        else
+        {
+            for (uint16_t low : array)
+            {
+                out.push_back(static_cast<int>((high << 16) | low));
+            }
+        }
+    }
+
+    // PostingList implementation
+
+    void PostingList::unionWith(const PostingList &other)
+    {
+        for (const Container &otherContainer : other.containers)
+        {
+            Container *mine = findContainer(otherContainer.key);
+            if (mine != nullptr)
+            {
+                mine->unionWith(otherContainer);
+            }
+            else
+            {
+                // No matching container: copy the other side's wholesale
+                auto it = std::lower_bound(containers.begin(), containers.end(),
+                                           otherContainer.key,
+                                           [](const Container &c, uint16_t k)
+                                           { return c.key < k; });
+                containers.insert(it, otherContainer);
+            }
+        }
+    }
+
+    void PostingList::intersectWith(const PostingList &other)
+    {
+        std::vector<Container> kept;
+
+        for (Container &mine : containers)
+        {
+            const Container *theirs = other.findContainer(mine.key);
+            if (theirs == nullptr)
+            {
+                continue;
+            }
+
+            mine.intersectWith(*theirs);
+            if (mine.cardinality > 0)
+            {
+                kept.push_back(std::move(mine));
+            }
+        }
+
+        containers = std::move(kept);
+    }
+
+    void PostingList::subtract(const PostingList &other)
+    {
+        for (Container &mine : containers)
+        {
+            const Container *theirs = other.findContainer(mine.key);
+            if (theirs != nullptr)
+            {
+                mine.subtract(*theirs);
+            }
+        }
+
+        containers.erase(std::remove_if(containers.begin(), containers.end(),
+                                        [](const Container &c)
+                                        { return c.cardinality == 0; }),
+                         containers.end());
+    }
+
+    size_t PostingList::size() const
+    {
+        size_t total = 0;
+        for (const Container &container : containers)
+        {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    bool PostingList::empty() const
+    {
+        return containers.empty() || size() == 0;
+    }
+
+    std::vector<int> PostingList::toVector() const
+    {
+        std::vector<int> out;
+        out.reserve(size());
+        for (const Container &container : containers)
+        {
+            container.appendValues(container.key, out);
+        }
+        return out;
+    }
+
+    std::vector<int> PostingList::toVector(size_t maxResults) const
+    {
+        std::vector<int> out;
+
+        // Containers are sorted, so stopping after the container that
+        // crosses the cap still yields the smallest IDs
+        for (const Container &container : containers)
+        {
+            if (out.size() >= maxResults)
+            {
+                break;
+            }
+            container.appendValues(container.key, out);
+        }
+
+        if (out.size() > maxResults)
+        {
+            out.resize(maxResults);
+        }
+        return out;
+    }
+
+    std::vector<int> PostingList::slice(size_t offset, size_t maxResults) const
+    {
+        std::vector<int> out;
+        if (maxResults == 0)
+        {
+            return out;
+        }
+        out.reserve(maxResults);
+
+        std::vector<int> scratch;
+        for (const Container &container : containers)
+        {
+            if (out.size() >= maxResults)
+            {
+                break;
+            }
+
+            // Containers in front of the window skip by cardinality alone
+            if (offset >= container.cardinality)
+            {
+                offset -= container.cardinality;
+                continue;
+            }
+
+            scratch.clear();
+            container.appendValues(container.key, scratch);
+            for (size_t i = offset; i < scratch.size() && out.size() < maxResults; i++)
+            {
+                out.push_back(scratch[i]);
+            }
+            offset = 0;
+        }
+        return out;
+    }
+
+    void PostingList::forEachChunk(size_t chunkSize,
+                                   const std::function<void(const std::vector<int> &)> &onChunk) const
+    {
+        std::vector<int> chunk;
+        chunk.reserve(chunkSize);
+
+        auto emit = [&](int objectId)
+        {
+            chunk.push_back(objectId);
+            if (chunk.size() == chunkSize)
+            {
+                onChunk(chunk);
+                chunk.clear();
+            }
+        };
+
+        for (const Container &container : containers)
+        {
+            uint32_t high = container.key;
+
+            if (container.isBitmap)
+            {
+                for (size_t w = 0; w < BITMAP_WORDS; w++)
+                {
+                    uint64_t word = container.bitmap[w];
+                    while (word != 0)
+                    {
+                        int bit = __builtin_ctzll(word);
+                        emit(static_cast<int>((high << 16) | (w << 6) | bit));
+                        word &= word - 1;
+                    }
+                }
+            }
+            else
+            {
+                for (uint16_t low : container.array)
+                {
+                    emit(static_cast<int>((high << 16) | low));
+                }
+            }
+        }
+
+        // Flush the final partial chunk
+        if (!chunk.empty())
+        {
+            onChunk(chunk);
+        }
+    }
+
+} // namespace idioms
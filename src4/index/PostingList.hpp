@@ -0,0 +1,241 @@
+#ifndef IDIOMS_POSTING_LIST_HPP
+#define IDIOMS_POSTING_LIST_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace idioms
+{
+
+    /**
+     * Compressed posting list of object IDs (Roaring-style).
+     *
+     * Object IDs are partitioned by their high 16 bits into containers. Sparse
+     * containers store the low 16 bits in a sorted array; dense containers
+     * (more than ARRAY_LIMIT entries) switch to a 64Ki bitmap. Union and
+     * intersection work container-at-a-time — word-at-a-time for bitmaps —
+     * instead of hashing every element, and a container holding millions of
+     * IDs costs 8KB instead of ~32 bytes per entry.
+     */
+    class PostingList
+    {
+    private:
+        // Above this cardinality a container is converted from array to bitmap
+        static const size_t ARRAY_LIMIT = 4096;
+
+        // Number of 64-bit words in a bitmap container (covers 65536 IDs)
+        static const size_t BITMAP_WORDS = 1024;
+
+        struct Container
+        {
+            uint16_t key;   // High 16 bits of the IDs in this container
+            bool isBitmap;  // Storage kind
+            std::vector<uint16_t> array;  // Sorted low 16 bits (array kind)
+            std::vector<uint64_t> bitmap; // Bit per low value (bitmap kind)
+            size_t cardinality;
+
+            Container(uint16_t k) : key(k), isBitmap(false), cardinality(0) {}
+
+            // add and contains are the per-record leaves of ingest and
+            // membership checks, so they are defined here and inline at
+            // their call sites
+            void add(uint16_t low)
+            {
+                if (isBitmap)
+                {
+                    uint64_t &word = bitmap[low >> 6];
+                    uint64_t bit = 1ULL << (low & 63);
+                    if (!(word & bit))
+                    {
+                        word |= bit;
+                        cardinality++;
+                    }
+                    return;
+                }
+
+                auto it = std::lower_bound(array.begin(), array.end(), low);
+                if (it != array.end() && *it == low)
+                {
+                    return; // Already present
+                }
+                array.insert(it, low);
+                cardinality++;
+
+                if (cardinality > ARRAY_LIMIT)
+                {
+                    toBitmap();
+                }
+            }
+
+            bool contains(uint16_t low) const
+            {
+                if (isBitmap)
+                {
+                    return (bitmap[low >> 6] >> (low & 63)) & 1;
+                }
+                return std::binary_search(array.begin(), array.end(), low);
+            }
+
+            void toBitmap();
+            void unionWith(const Container &other);
+            void intersectWith(const Container &other);
+            void subtract(const Container &other);
+            void appendValues(uint32_t high, std::vector<int> &out) const;
+        };
+
+        std::vector<Container> containers; // Sorted by key
+
+        // Find the container for a key, or nullptr
+        Container *findContainer(uint16_t key)
+        {
+            auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                                       [](const Container &c, uint16_t k)
+                                       { return c.key < k; });
+            if (it != containers.end() && it->key == key)
+            {
+                return &(*it);
+            }
+            return nullptr;
+        }
+
+        const Container *findContainer(uint16_t key) const
+        {
+            auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                                       [](const Container &c, uint16_t k)
+                                       { return c.key < k; });
+            if (it != containers.end() && it->key == key)
+            {
+                return &(*it);
+            }
+            return nullptr;
+        }
+
+        // Find or create the container for a key
+        Container &getContainer(uint16_t key)
+        {
+            auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                                       [](const Container &c, uint16_t k)
+                                       { return c.key < k; });
+            if (it != containers.end() && it->key == key)
+            {
+                return *it;
+            }
+            return *containers.insert(it, Container(key));
+        }
+
+    public:
+        PostingList() {}
+
+        /**
+         * Add an object ID to the list
+         *
+         * @param objectId Object ID (non-negative)
+         */
+        void add(int objectId)
+        {
+            uint32_t id = static_cast<uint32_t>(objectId);
+            getContainer(static_cast<uint16_t>(id >> 16))
+                .add(static_cast<uint16_t>(id & 0xFFFF));
+        }
+
+        /**
+         * Check whether an object ID is present
+         *
+         * @param objectId Object ID to look up
+         * @return True if present
+         */
+        bool contains(int objectId) const
+        {
+            uint32_t id = static_cast<uint32_t>(objectId);
+            const Container *container = findContainer(static_cast<uint16_t>(id >> 16));
+            return container != nullptr &&
+                   container->contains(static_cast<uint16_t>(id & 0xFFFF));
+        }
+
+        /**
+         * Union another posting list into this one
+         *
+         * @param other Posting list to merge in
+         */
+        void unionWith(const PostingList &other);
+
+        /**
+         * Intersect this posting list with another, in place
+         *
+         * @param other Posting list to intersect with
+         */
+        void intersectWith(const PostingList &other);
+
+        /**
+         * Remove every ID present in another posting list, in place
+         *
+         * @param other Posting list of IDs to remove
+         */
+        void subtract(const PostingList &other);
+
+        /**
+         * Get the number of object IDs in the list
+         *
+         * @return Cardinality
+         */
+        size_t size() const;
+
+        /**
+         * Check whether the list is empty
+         *
+         * @return True if empty
+         */
+        bool empty() const;
+
+        /**
+         * Materialize the list as a sorted vector of object IDs
+         *
+         * @return Sorted object IDs
+         */
+        std::vector<int> toVector() const;
+
+        /**
+         * Materialize at most maxResults object IDs, in sorted order
+         *
+         * Traversal stops as soon as the cap is reached, so a LIMIT query
+         * over a huge list never walks (or allocates) the full set.
+         *
+         * @param maxResults Maximum number of IDs to return
+         * @return Up to maxResults smallest object IDs, sorted
+         */
+        std::vector<int> toVector(size_t maxResults) const;
+
+        /**
+         * Materialize a window of the list: up to maxResults IDs starting
+         * at the given position in sorted order
+         *
+         * Whole containers in front of the offset are skipped by their
+         * cardinality, so resuming deep into a large list never re-walks
+         * the part already consumed.
+         *
+         * @param offset Number of IDs to skip from the front
+         * @param maxResults Maximum number of IDs to return
+         * @return Up to maxResults IDs from position offset, sorted
+         */
+        std::vector<int> slice(size_t offset, size_t maxResults) const;
+
+        /**
+         * Visit the object IDs in sorted order in fixed-size chunks
+         *
+         * Each invocation of onChunk receives at most chunkSize IDs; the
+         * buffer is reused between invocations, so the whole list is never
+         * materialized at once.
+         *
+         * @param chunkSize Maximum number of IDs per chunk (must be > 0)
+         * @param onChunk Callback invoked for each chunk
+         */
+        void forEachChunk(size_t chunkSize,
+                          const std::function<void(const std::vector<int> &)> &onChunk) const;
+    };
+
+} // namespace idioms
+
+#endif // IDIOMS_POSTING_LIST_HPP
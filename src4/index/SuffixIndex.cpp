@@ -0,0 +1,234 @@
+#include "SuffixIndex.hpp"
+#include "MemoryAccounting.hpp"
+#include <algorithm>
+
+namespace idioms
+{
+
+    SuffixIndex::SuffixIndex() : dirty(false), indexedTextSize(0), accountedBytes(0) {}
+
+    SuffixIndex::~SuffixIndex()
+    {
+        memoryAccounting().sub(MEM_SUFFIX_INDEX, accountedBytes);
+    }
+
+    void SuffixIndex::refreshAccounting() const
+    {
+        // The text pool, start offsets and suffix array dominate; the
+        // dedup hash map's overhead is not charged
+        size_t current = text.capacity() +
+                         starts.capacity() * sizeof(size_t) +
+                         suffixArray.capacity() * sizeof(size_t);
+
+        if (current > accountedBytes)
+        {
+            memoryAccounting().add(MEM_SUFFIX_INDEX, current - accountedBytes);
+        }
+        else if (current < accountedBytes)
+        {
+            memoryAccounting().sub(MEM_SUFFIX_INDEX, accountedBytes - current);
+        }
+        accountedBytes = current;
+    }
+
+    size_t SuffixIndex::lengthOf(int id) const
+    {
+        size_t start = starts[id];
+        size_t end = static_cast<size_t>(id) + 1 < starts.size()
+                         ? starts[id + 1]
+                         : text.size();
+        return end - start - 1; // Exclude the separator
+    }
+
+    bool SuffixIndex::equalsString(int id, const std::string &str) const
+    {
+        return lengthOf(id) == str.length() &&
+               text.compare(starts[id], str.length(), str) == 0;
+    }
+
+    int SuffixIndex::addString(const std::string &str)
+    {
+        size_t hash = std::hash<std::string>{}(str);
+
+        auto it = idsByHash.find(hash);
+        if (it != idsByHash.end())
+        {
+            for (int id : it->second)
+            {
+                if (equalsString(id, str))
+                {
+                    return id; // Already interned
+                }
+            }
+        }
+
+        int id = static_cast<int>(starts.size());
+        idsByHash[hash].push_back(id);
+
+        starts.push_back(text.size());
+        text += str;
+        text += SEPARATOR;
+        refreshAccounting();
+
+        dirty = true;
+        return id;
+    }
+
+    bool SuffixIndex::suffixLess(size_t a, size_t b) const
+    {
+        // Separators compare below all metadata characters and terminate
+        // the comparison, so a position's ordering is decided entirely by
+        // its owning string and stays valid as the text grows. Positions
+        // whose bounded suffixes are equal tie-break by offset, which is
+        // immutable too.
+        size_t n = text.size();
+        while (a < n && b < n)
+        {
+            unsigned char ca = static_cast<unsigned char>(text[a]);
+            unsigned char cb = static_cast<unsigned char>(text[b]);
+            if (ca != cb)
+            {
+                return ca < cb;
+            }
+            if (text[a] == SEPARATOR)
+            {
+                return a < b;
+            }
+            a++;
+            b++;
+        }
+        return a < b; // Unreachable while the text ends with a separator
+    }
+
+    void SuffixIndex::buildSuffixArray() const
+    {
+        // Only the positions interned since the last build are unsorted:
+        // the bounded comparison keeps old orderings immutable as the text
+        // grows, so a batch of inserts costs a sort of its own positions
+        // plus one linear merge instead of re-sorting every suffix
+        std::vector<size_t> fresh;
+        fresh.reserve(text.size() - indexedTextSize);
+        for (size_t pos = indexedTextSize; pos < text.size(); pos++)
+        {
+            if (text[pos] != SEPARATOR)
+            {
+                fresh.push_back(pos);
+            }
+        }
+
+        auto less = [this](size_t a, size_t b)
+        { return suffixLess(a, b); };
+
+        std::sort(fresh.begin(), fresh.end(), less);
+
+        size_t boundary = suffixArray.size();
+        suffixArray.insert(suffixArray.end(), fresh.begin(), fresh.end());
+        std::inplace_merge(suffixArray.begin(),
+                           suffixArray.begin() + boundary,
+                           suffixArray.end(), less);
+
+        indexedTextSize = text.size();
+        refreshAccounting();
+        dirty = false;
+    }
+
+    int SuffixIndex::ownerOfPosition(size_t pos) const
+    {
+        // Find the last string start <= pos
+        auto it = std::upper_bound(starts.begin(), starts.end(), pos);
+        return static_cast<int>(it - starts.begin()) - 1;
+    }
+
+    std::pair<size_t, size_t> SuffixIndex::findRange(std::string_view pattern) const
+    {
+        if (dirty)
+        {
+            buildSuffixArray();
+        }
+
+        const std::string &t = text;
+
+        // Lower bound: first suffix >= pattern
+        auto lower = std::lower_bound(suffixArray.begin(), suffixArray.end(), pattern,
+                                      [&t](size_t pos, std::string_view p)
+                                      { return t.compare(pos, p.length(), p) < 0; });
+
+        // Upper bound: first suffix that does not start with pattern
+        auto upper = std::upper_bound(lower, suffixArray.end(), pattern,
+                                      [&t](std::string_view p, size_t pos)
+                                      { return t.compare(pos, p.length(), p) > 0; });
+
+        return {static_cast<size_t>(lower - suffixArray.begin()),
+                static_cast<size_t>(upper - suffixArray.begin())};
+    }
+
+    std::vector<int> SuffixIndex::findSubstring(std::string_view infix) const
+    {
+        std::vector<int> results;
+        if (infix.empty() || text.empty())
+        {
+            return results;
+        }
+
+        auto [lo, hi] = findRange(infix);
+
+        // Collect owning strings, deduplicated
+        std::vector<bool> seen(starts.size(), false);
+        for (size_t i = lo; i < hi; i++)
+        {
+            // A match that would span a separator cannot occur: the pattern
+            // contains no separator bytes, so the compare above fails first
+            int owner = ownerOfPosition(suffixArray[i]);
+            if (!seen[owner])
+            {
+                seen[owner] = true;
+                results.push_back(owner);
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<int> SuffixIndex::findSuffix(std::string_view suffix) const
+    {
+        std::vector<int> results;
+        if (suffix.empty() || text.empty())
+        {
+            return results;
+        }
+
+        auto [lo, hi] = findRange(suffix);
+
+        std::vector<bool> seen(starts.size(), false);
+        for (size_t i = lo; i < hi; i++)
+        {
+            size_t pos = suffixArray[i];
+
+            // Only keep matches that end exactly at the owning string's end
+            if (text[pos + suffix.length()] != SEPARATOR)
+            {
+                continue;
+            }
+
+            int owner = ownerOfPosition(pos);
+            if (!seen[owner])
+            {
+                seen[owner] = true;
+                results.push_back(owner);
+            }
+        }
+
+        return results;
+    }
+
+    std::string SuffixIndex::getString(int id) const
+    {
+        return text.substr(starts[id], lengthOf(id));
+    }
+
+    size_t SuffixIndex::size() const
+    {
+        return starts.size();
+    }
+
+} // namespace idioms
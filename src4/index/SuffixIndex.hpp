@@ -0,0 +1,119 @@
+#ifndef IDIOMS_SUFFIX_INDEX_HPP
+#define IDIOMS_SUFFIX_INDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+namespace idioms
+{
+
+    /**
+     * Linear-space substring index over a pool of interned strings.
+     *
+     * Strings are concatenated (separated by a sentinel byte) into one text
+     * buffer, and a generalized suffix array over that text answers suffix and
+     * infix lookups by binary search. Unlike inserting every suffix of every
+     * string into the trie, memory stays linear in the total text size.
+     *
+     * The suffix array is built lazily on first query after a batch of inserts,
+     * so ingest does not pay a rebuild per string — and it is maintained
+     * incrementally: only the positions interned since the last build are
+     * sorted, then merged into the existing array in one linear pass, so a
+     * trickle of inserts never re-sorts the whole text.
+     */
+    class SuffixIndex
+    {
+    private:
+        // Sentinel between interned strings; never appears in metadata
+        static const char SEPARATOR = '\x01';
+
+        // The text pool is the single owner of all interned characters;
+        // strings are referenced by (start, length) into it rather than
+        // stored again elsewhere.
+        std::string text;           // Concatenated interned strings
+        std::vector<size_t> starts; // Start offset of each string in text
+
+        // Dedup lookup by content hash; candidate IDs are verified against
+        // the pool, so colliding hashes cost only an extra compare
+        std::unordered_map<size_t, std::vector<int>> idsByHash;
+
+        // Length of an interned string (excluding the separator)
+        size_t lengthOf(int id) const;
+
+        // Whether the interned string with this ID equals str
+        bool equalsString(int id, const std::string &str) const;
+
+        mutable std::vector<size_t> suffixArray; // Positions sorted by suffix
+        mutable bool dirty;                      // Whether the array needs rebuilding
+        mutable size_t indexedTextSize;          // Text prefix already merged into suffixArray
+
+        // Bytes currently charged to MEM_SUFFIX_INDEX for this index
+        mutable size_t accountedBytes;
+
+        // Re-charge the memory accounting after text/starts/suffixArray grow
+        void refreshAccounting() const;
+
+        // Order two positions by their suffix, terminated at the first
+        // separator, so a position's ordering key never changes as later
+        // strings extend the text
+        bool suffixLess(size_t a, size_t b) const;
+
+        // Sort the suffixes of newly interned text and merge them into
+        // the array
+        void buildSuffixArray() const;
+
+        // Map a text position to the ID of the string containing it
+        int ownerOfPosition(size_t pos) const;
+
+        // Find the suffix-array range of positions whose suffix starts with pattern
+        std::pair<size_t, size_t> findRange(std::string_view pattern) const;
+
+    public:
+        SuffixIndex();
+        ~SuffixIndex();
+
+        /**
+         * Intern a string into the pool
+         *
+         * @param str String to add
+         * @return ID of the string (existing ID if already interned)
+         */
+        int addString(const std::string &str);
+
+        /**
+         * Find all strings containing the given substring
+         *
+         * @param infix Substring to search for
+         * @return IDs of matching strings
+         */
+        std::vector<int> findSubstring(std::string_view infix) const;
+
+        /**
+         * Find all strings ending with the given suffix
+         *
+         * @param suffix Suffix to search for
+         * @return IDs of matching strings
+         */
+        std::vector<int> findSuffix(std::string_view suffix) const;
+
+        /**
+         * Get an interned string by ID
+         *
+         * @param id String ID returned by addString
+         * @return Copy of the interned string, extracted from the pool
+         */
+        std::string getString(int id) const;
+
+        /**
+         * Get the number of interned strings
+         *
+         * @return String count
+         */
+        size_t size() const;
+    };
+
+} // namespace idioms
+
+#endif // IDIOMS_SUFFIX_INDEX_HPP
@@ -1,4 +1,8 @@
 #include "Trie.hpp"
+#include "../query/QueryGovernor.hpp"
+#include "../query/SubstringMatch.hpp"
+#include <algorithm>
+#include <deque>
 #include <iostream>
 
 namespace idioms
@@ -7,62 +11,145 @@ namespace idioms
     // KeyTrieNode implementation
     KeyTrieNode::KeyTrieNode() : isEndOfKey(false), valueTrie(nullptr) {}
 
+    KeyTrieNode *KeyTrieNode::findChild(char c) const
+    {
+        return children.find(c);
+    }
+
+    void KeyTrieNode::addChild(char c, KeyTrieNode *child)
+    {
+        children.add(c, child);
+    }
+
+    void KeyTrieNode::replaceChild(char c, KeyTrieNode *child)
+    {
+        children.replace(c, child);
+    }
+
     // ValueTrieNode implementation
     ValueTrieNode::ValueTrieNode() : isEndOfValue(false) {}
 
+    ValueTrieNode *ValueTrieNode::findChild(char c) const
+    {
+        return children.find(c);
+    }
+
+    void ValueTrieNode::addChild(char c, ValueTrieNode *child)
+    {
+        children.add(c, child);
+    }
+
+    void ValueTrieNode::replaceChild(char c, ValueTrieNode *child)
+    {
+        children.replace(c, child);
+    }
+
     // ValueTrie implementation
-    ValueTrie::ValueTrie(bool useSuffixMode)
-        : root(std::make_shared<ValueTrieNode>()), useSuffixTreeMode(useSuffixMode) {}
+    ValueTrie::ValueTrie(bool useSuffixMode, bool usePathCompressedMode)
+        : root(arena.allocate()), useSuffixTreeMode(useSuffixMode),
+          usePathCompression(usePathCompressedMode) {}
 
-    void ValueTrie::insertValue(const std::string &value, int objectId, const std::string &fullValue)
+    ValueTrieNode *ValueTrie::insertValueInternal(const std::string &value)
     {
-        std::shared_ptr<ValueTrieNode> current = root;
+        ValueTrieNode *current = root;
+        size_t i = 0;
 
-        for (char c : value)
+        while (i < value.length())
         {
-            if (current->children.find(c) == current->children.end())
+            ValueTrieNode *child = current->findChild(value[i]);
+
+            if (child == nullptr)
             {
-                current->children[c] = std::make_shared<ValueTrieNode>();
+                // No matching edge: create one covering the whole remaining
+                // string in path-compressed mode, or a single character otherwise
+                child = arena.allocate();
+                child->edge = usePathCompression ? value.substr(i) : value.substr(i, 1);
+                current->addChild(value[i], child);
+                current = child;
+                i += child->edge.length();
+                continue;
             }
-            current = current->children[c];
+
+            // Match as much of the child's edge as possible
+            size_t j = 0;
+            while (j < child->edge.length() && i + j < value.length() &&
+                   child->edge[j] == value[i + j])
+            {
+                j++;
+            }
+
+            if (j == child->edge.length())
+            {
+                // Whole edge matched: descend
+                current = child;
+                i += j;
+                continue;
+            }
+
+            // Partial match: split the edge at the divergence point
+            ValueTrieNode *mid = arena.allocate();
+            mid->edge = child->edge.substr(0, j);
+            child->edge = child->edge.substr(j);
+            mid->addChild(child->edge[0], child);
+            current->replaceChild(mid->edge[0], mid);
+            current = mid;
+            i += j;
         }
 
         current->isEndOfValue = true;
-        current->objectIds.insert(objectId);
+        return current;
+    }
 
-        // Store the full value for suffix and infix searches
-        if (!fullValue.empty())
-        {
-            current->fullValue = fullValue;
-        }
-        else
+    void ValueTrie::insertValue(const std::string &value, int objectId)
+    {
+        ValueTrieNode *node = insertValueInternal(value);
+        node->objectIds.add(objectId);
+    }
+
+    void ValueTrie::insertValueWithSuffixMode(const std::string &value, int objectId)
+    {
+        ValueTrieNode *node = insertValueInternal(value);
+        node->objectIds.add(objectId);
+
+        if (useSuffixTreeMode)
         {
-            current->fullValue = value;
+            // Register the value in the substring index instead of inserting
+            // every suffix into the trie; object IDs stay on the trie node
+            int stringId = suffixIndex.addString(value);
+            suffixStringNodes[stringId] = node;
         }
     }
 
-    void ValueTrie::insertValueWithSuffixes(const std::string &value, int objectId)
+    void ValueTrie::insertValue(const std::string &value, const std::vector<int> &objectIds)
     {
-        for (size_t i = 0; i < value.length(); i++)
+        ValueTrieNode *node = insertValueInternal(value);
+        for (int objectId : objectIds)
         {
-            std::string suffix = value.substr(i);
-            insertValue(suffix, objectId, value); // Pass the full value for suffix node
+            node->objectIds.add(objectId);
         }
     }
 
-    void ValueTrie::insertValueWithSuffixMode(const std::string &value, int objectId)
+    void ValueTrie::insertValueWithSuffixMode(const std::string &value, const std::vector<int> &objectIds)
     {
-        insertValue(value, objectId); // Insert the full value first
+        ValueTrieNode *node = insertValueInternal(value);
+        for (int objectId : objectIds)
+        {
+            node->objectIds.add(objectId);
+        }
 
         if (useSuffixTreeMode)
         {
-            insertValueWithSuffixes(value, objectId);
+            int stringId = suffixIndex.addString(value);
+            suffixStringNodes[stringId] = node;
         }
     }
 
-    void ValueTrie::searchByValuePrefix(std::shared_ptr<ValueTrieNode> node, const std::string &prefix,
-                                        size_t index, std::unordered_set<int> &results) const
+    void ValueTrie::searchByValuePrefix(const ValueTrieNode *node, size_t edgeOffset,
+                                        std::string_view prefix, size_t index,
+                                        PostingList &results) const
     {
+        query::checkBudget();
+
         if (index == prefix.length())
         {
             // If reached the end of prefix, collect all object IDs in this subtree
@@ -71,70 +158,44 @@ namespace idioms
         }
 
         char c = prefix[index];
-        if (c == '*')
-        {
-            // Wildcard: search all branches
-            for (const auto &pair : node->children)
-            {
-                searchByValuePrefix(pair.second, prefix, index + 1, results);
-            }
-        }
-        else
+
+        if (edgeOffset < node->edge.length())
         {
-            // Exact match
-            if (node->children.find(c) != node->children.end())
+            // Still inside this node's edge label: match the next edge character
+            if (c == '*' || c == node->edge[edgeOffset])
             {
-                searchByValuePrefix(node->children[c], prefix, index + 1, results);
+                searchByValuePrefix(node, edgeOffset + 1, prefix, index + 1, results);
             }
+            return;
         }
-    }
 
-    void ValueTrie::searchByValueInfix(std::shared_ptr<ValueTrieNode> node,
-                                       const std::string &infix, std::unordered_set<int> &results) const
-    {
-        // If this node has a full value and it contains the infix, add the object IDs
-        if (node->isEndOfValue && !node->fullValue.empty())
+        // At a node boundary: descend into matching children
+        if (c == '*')
         {
-            if (node->fullValue.find(infix) != std::string::npos)
+            // Wildcard: search all branches
+            for (const auto &pair : node->children)
             {
-                results.insert(node->objectIds.begin(), node->objectIds.end());
+                searchByValuePrefix(pair.second, 1, prefix, index + 1, results);
             }
         }
-
-        // Recursively search all child nodes
-        for (const auto &pair : node->children)
-        {
-            searchByValueInfix(pair.second, infix, results);
-        }
-    }
-
-    void ValueTrie::searchByValueSuffix(std::shared_ptr<ValueTrieNode> node,
-                                        const std::string &suffix, std::unordered_set<int> &results) const
-    {
-        // If this node has a full value and it ends with the suffix, add the object IDs
-        if (node->isEndOfValue && !node->fullValue.empty())
+        else
         {
-            if (node->fullValue.length() >= suffix.length() &&
-                node->fullValue.compare(node->fullValue.length() - suffix.length(),
-                                        suffix.length(), suffix) == 0)
+            ValueTrieNode *child = node->findChild(c);
+            if (child != nullptr)
             {
-                results.insert(node->objectIds.begin(), node->objectIds.end());
+                searchByValuePrefix(child, 1, prefix, index + 1, results);
             }
         }
-
-        // Recursively search all child nodes
-        for (const auto &pair : node->children)
-        {
-            searchByValueSuffix(pair.second, suffix, results);
-        }
     }
 
-    void ValueTrie::collectAllObjectIds(std::shared_ptr<ValueTrieNode> node,
-                                        std::unordered_set<int> &results) const
+    void ValueTrie::collectAllObjectIds(const ValueTrieNode *node,
+                                        PostingList &results) const
     {
+        query::checkBudget();
+
         if (node->isEndOfValue)
         {
-            results.insert(node->objectIds.begin(), node->objectIds.end());
+            results.unionWith(node->objectIds);
         }
 
         for (const auto &pair : node->children)
@@ -143,18 +204,28 @@ namespace idioms
         }
     }
 
-    std::unordered_set<int> ValueTrie::searchExactValue(const std::string &value) const
+    PostingList ValueTrie::searchExactValue(std::string_view value) const
     {
-        std::shared_ptr<ValueTrieNode> current = root;
-        std::unordered_set<int> results;
+        const ValueTrieNode *current = root;
+        PostingList results;
+        size_t i = 0;
 
-        for (char c : value)
+        while (i < value.length())
         {
-            if (current->children.find(c) == current->children.end())
+            const ValueTrieNode *child = current->findChild(value[i]);
+            if (child == nullptr)
             {
                 return results; // No match
             }
-            current = current->children[c];
+
+            // The whole edge label must match (values never end mid-edge)
+            if (value.compare(i, child->edge.length(), child->edge) != 0)
+            {
+                return results;
+            }
+
+            i += child->edge.length();
+            current = child;
         }
 
         if (current->isEndOfValue)
@@ -165,21 +236,29 @@ namespace idioms
         return results;
     }
 
-    std::unordered_set<int> ValueTrie::searchValuePrefix(const std::string &prefix) const
+    PostingList ValueTrie::searchValuePrefix(std::string_view prefix) const
     {
-        std::unordered_set<int> results;
-        searchByValuePrefix(root, prefix, 0, results);
+        PostingList results;
+        searchByValuePrefix(root, 0, prefix, 0, results);
         return results;
     }
 
-    std::unordered_set<int> ValueTrie::searchValueSuffix(const std::string &suffix) const
+    PostingList ValueTrie::searchValueSuffix(std::string_view suffix) const
     {
-        std::unordered_set<int> results;
+        PostingList results;
 
         if (useSuffixTreeMode)
         {
-            // With suffix-tree mode, we can utilize the suffix nodes directly
-            searchByValueSuffix(root, suffix, results);
+            // Look up values ending with the suffix in the substring index
+            for (int stringId : suffixIndex.findSuffix(suffix))
+            {
+                query::checkBudget();
+                auto it = suffixStringNodes.find(stringId);
+                if (it != suffixStringNodes.end())
+                {
+                    results.unionWith(it->second->objectIds);
+                }
+            }
         }
         else
         {
@@ -190,92 +269,217 @@ namespace idioms
         return results;
     }
 
-    std::unordered_set<int> ValueTrie::searchValueInfix(const std::string &infix) const
+    PostingList ValueTrie::searchValueInfix(std::string_view infix) const
     {
-        std::unordered_set<int> results;
+        PostingList results;
 
         if (useSuffixTreeMode)
         {
-            // With suffix-tree mode, we need to check if any stored full value contains the infix
-            searchByValueInfix(root, infix, results);
+            // Look up values containing the infix in the substring index
+            for (int stringId : suffixIndex.findSubstring(infix))
+            {
+                query::checkBudget();
+                auto it = suffixStringNodes.find(stringId);
+                if (it != suffixStringNodes.end())
+                {
+                    results.unionWith(it->second->objectIds);
+                }
+            }
         }
         else
         {
-            // Without suffix-tree mode, we need to check all values
-            std::cout << "Warning: Infix search without suffix-tree mode is inefficient" << std::endl;
+            // Without suffix-tree mode, rebuild each stored value along
+            // the walk and verify it with the substring kernel. Linear in
+            // the trie, but correct — this used to warn and return nothing.
+            std::string current;
+            collectValuesMatchingInfix(root, current, infix, results);
         }
 
         return results;
     }
 
-    std::unordered_set<int> ValueTrie::getAllObjectIds() const
+    void ValueTrie::collectValuesMatchingInfix(const ValueTrieNode *node, std::string &current,
+                                               std::string_view infix,
+                                               PostingList &results) const
     {
-        std::unordered_set<int> results;
-        collectAllObjectIds(root, results);
-        return results;
-    }
+        query::checkBudget();
 
-    // KeyTrie implementation
-    KeyTrie::KeyTrie(bool useSuffixMode)
-        : root(std::make_shared<KeyTrieNode>()), useSuffixTreeMode(useSuffixMode) {}
+        if (node->isEndOfValue && query::containsSubstring(current, infix))
+        {
+            results.unionWith(node->objectIds);
+        }
 
-    std::shared_ptr<ValueTrie> KeyTrie::insertKeyOnly(const std::string &key, const std::string &fullKey)
+        for (const auto &pair : node->children)
+        {
+            const ValueTrieNode *child = pair.second;
+            current.append(child->edge);
+            collectValuesMatchingInfix(child, current, infix, results);
+            current.resize(current.size() - child->edge.size());
+        }
+    }
+
+    void ValueTrie::searchByValueRange(const ValueTrieNode *node, const std::string &current,
+                                       const std::string &low, const std::string &high,
+                                       PostingList &results) const
     {
-        std::shared_ptr<KeyTrieNode> current = root;
+        query::checkBudget();
 
-        for (char c : key)
+        // Every value below this node extends `current`, so the subtree can
+        // be pruned whenever `current` already decides the comparison:
+        // above the high bound, or below the low bound without being one of
+        // its prefixes.
+        if (current.compare(high) > 0)
         {
-            if (current->children.find(c) == current->children.end())
-            {
-                current->children[c] = std::make_shared<KeyTrieNode>();
-            }
-            current = current->children[c];
+            return;
+        }
+        if (current.compare(low) < 0 && low.compare(0, current.length(), current) != 0)
+        {
+            return;
         }
 
-        current->isEndOfKey = true;
+        if (node->isEndOfValue && current.compare(low) >= 0)
+        {
+            results.unionWith(node->objectIds);
+        }
 
-        if (!current->valueTrie)
+        for (const auto &childPair : node->children)
         {
-            current->valueTrie = std::make_shared<ValueTrie>(useSuffixTreeMode);
+            const ValueTrieNode *child = childPair.second;
+            searchByValueRange(child, current + child->edge, low, high, results);
         }
+    }
 
-        // Store the full key for suffix and infix searches
-        if (!fullKey.empty())
+    PostingList ValueTrie::searchValueRange(const std::string &low, const std::string &high) const
+    {
+        PostingList results;
+        if (low.compare(high) <= 0)
         {
-            current->fullKey = fullKey;
+            searchByValueRange(root, "", low, high, results);
         }
-        else
+        return results;
+    }
+
+    PostingList ValueTrie::getAllObjectIds() const
+    {
+        PostingList results;
+        collectAllObjectIds(root, results);
+        return results;
+    }
+
+    size_t ValueTrie::nodeCount() const
+    {
+        return arena.size();
+    }
+
+    void ValueTrie::collectPostingStatsFrom(const ValueTrieNode *node, uint64_t &lists,
+                                            uint64_t &entries, uint64_t &maxEntries) const
+    {
+        size_t postings = node->objectIds.size();
+        if (postings > 0)
         {
-            current->fullKey = key;
+            lists++;
+            entries += postings;
+            if (postings > maxEntries)
+            {
+                maxEntries = postings;
+            }
         }
 
-        return current->valueTrie;
+        for (const auto &child : node->children)
+        {
+            collectPostingStatsFrom(child.second, lists, entries, maxEntries);
+        }
     }
 
-    void KeyTrie::insertKeyWithSuffixes(const std::string &key)
+    void ValueTrie::collectPostingStats(uint64_t &lists, uint64_t &entries,
+                                        uint64_t &maxEntries) const
     {
-        for (size_t i = 0; i < key.length(); i++)
+        collectPostingStatsFrom(root, lists, entries, maxEntries);
+    }
+
+    // KeyTrie implementation
+    KeyTrie::KeyTrie(bool useSuffixMode, bool usePathCompressedMode)
+        : root(arena.allocate()), useSuffixTreeMode(useSuffixMode),
+          usePathCompression(usePathCompressedMode) {}
+
+    std::shared_ptr<ValueTrie> KeyTrie::insertKeyOnly(const std::string &key)
+    {
+        KeyTrieNode *current = root;
+        size_t i = 0;
+
+        while (i < key.length())
+        {
+            KeyTrieNode *child = current->findChild(key[i]);
+
+            if (child == nullptr)
+            {
+                // No matching edge: create one covering the whole remaining
+                // string in path-compressed mode, or a single character otherwise
+                child = arena.allocate();
+                child->edge = usePathCompression ? key.substr(i) : key.substr(i, 1);
+                current->addChild(key[i], child);
+                current = child;
+                i += child->edge.length();
+                continue;
+            }
+
+            // Match as much of the child's edge as possible
+            size_t j = 0;
+            while (j < child->edge.length() && i + j < key.length() &&
+                   child->edge[j] == key[i + j])
+            {
+                j++;
+            }
+
+            if (j == child->edge.length())
+            {
+                // Whole edge matched: descend
+                current = child;
+                i += j;
+                continue;
+            }
+
+            // Partial match: split the edge at the divergence point
+            KeyTrieNode *mid = arena.allocate();
+            mid->edge = child->edge.substr(0, j);
+            child->edge = child->edge.substr(j);
+            mid->addChild(child->edge[0], child);
+            current->replaceChild(mid->edge[0], mid);
+            current = mid;
+            i += j;
+        }
+
+        current->isEndOfKey = true;
+
+        if (!current->valueTrie)
         {
-            insertKeyOnly(key.substr(i), key); // Pass the full key for suffix nodes
+            current->valueTrie = std::make_shared<ValueTrie>(useSuffixTreeMode, usePathCompression);
         }
+
+        return current->valueTrie;
     }
 
     std::shared_ptr<ValueTrie> KeyTrie::insertKeyWithSuffixMode(const std::string &key)
     {
-        std::shared_ptr<ValueTrie> mainValueTrie = insertKeyOnly(key, key);
+        std::shared_ptr<ValueTrie> mainValueTrie = insertKeyOnly(key);
 
         if (useSuffixTreeMode)
         {
-            // Insert all suffixes
-            insertKeyWithSuffixes(key);
+            // Register the key in the substring index instead of inserting
+            // every suffix into the trie
+            int stringId = suffixIndex.addString(key);
+            suffixStringTries[stringId] = mainValueTrie;
         }
 
         return mainValueTrie;
     }
 
-    void KeyTrie::searchByKeyPrefix(std::shared_ptr<KeyTrieNode> node, const std::string &prefix,
-                                    size_t index, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const
+    void KeyTrie::searchByKeyPrefix(const KeyTrieNode *node, size_t edgeOffset,
+                                    std::string_view prefix, size_t index,
+                                    std::vector<std::shared_ptr<ValueTrie>> &valueTries) const
     {
+        query::checkBudget();
+
         if (index == prefix.length())
         {
             // If we've reached the end of the prefix, collect this node and all descendants
@@ -284,67 +488,41 @@ namespace idioms
         }
 
         char c = prefix[index];
-        if (c == '*')
-        {
-            // Wildcard: search all branches
-            for (const auto &pair : node->children)
-            {
-                searchByKeyPrefix(pair.second, prefix, index + 1, valueTries);
-            }
-        }
-        else
+
+        if (edgeOffset < node->edge.length())
         {
-            // Exact character match
-            if (node->children.find(c) != node->children.end())
+            // Still inside this node's edge label: match the next edge character
+            if (c == '*' || c == node->edge[edgeOffset])
             {
-                searchByKeyPrefix(node->children[c], prefix, index + 1, valueTries);
+                searchByKeyPrefix(node, edgeOffset + 1, prefix, index + 1, valueTries);
             }
+            return;
         }
-    }
 
-    void KeyTrie::searchByKeyInfix(std::shared_ptr<KeyTrieNode> node,
-                                   const std::string &infix, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const
-    {
-        // If this node has a full key and it contains the infix, add its value trie
-        if (node->isEndOfKey && node->valueTrie && !node->fullKey.empty())
+        // At a node boundary: descend into matching children
+        if (c == '*')
         {
-            if (node->fullKey.find(infix) != std::string::npos)
+            // Wildcard: search all branches
+            for (const auto &pair : node->children)
             {
-                valueTries.push_back(node->valueTrie);
+                searchByKeyPrefix(pair.second, 1, prefix, index + 1, valueTries);
             }
         }
-
-        // Recursively search all child nodes
-        for (const auto &pair : node->children)
-        {
-            searchByKeyInfix(pair.second, infix, valueTries);
-        }
-    }
-
-    void KeyTrie::searchByKeySuffix(std::shared_ptr<KeyTrieNode> node,
-                                    const std::string &suffix, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const
-    {
-        // If this node has a full key and it ends with the suffix, add its value trie
-        if (node->isEndOfKey && node->valueTrie && !node->fullKey.empty())
+        else
         {
-            if (node->fullKey.length() >= suffix.length() &&
-                node->fullKey.compare(node->fullKey.length() - suffix.length(),
-                                      suffix.length(), suffix) == 0)
+            KeyTrieNode *child = node->findChild(c);
+            if (child != nullptr)
             {
-                valueTries.push_back(node->valueTrie);
+                searchByKeyPrefix(child, 1, prefix, index + 1, valueTries);
             }
         }
-
-        // Recursively search all child nodes
-        for (const auto &pair : node->children)
-        {
-            searchByKeySuffix(pair.second, suffix, valueTries);
-        }
     }
 
-    void KeyTrie::collectAllValueTries(std::shared_ptr<KeyTrieNode> node,
+    void KeyTrie::collectAllValueTries(const KeyTrieNode *node,
                                        std::vector<std::shared_ptr<ValueTrie>> &valueTries) const
     {
+        query::checkBudget();
+
         if (node->isEndOfKey && node->valueTrie)
         {
             valueTries.push_back(node->valueTrie);
@@ -356,17 +534,27 @@ namespace idioms
         }
     }
 
-    std::shared_ptr<ValueTrie> KeyTrie::searchExactKey(const std::string &key) const
+    std::shared_ptr<ValueTrie> KeyTrie::searchExactKey(std::string_view key) const
     {
-        std::shared_ptr<KeyTrieNode> current = root;
+        const KeyTrieNode *current = root;
+        size_t i = 0;
 
-        for (char c : key)
+        while (i < key.length())
         {
-            if (current->children.find(c) == current->children.end())
+            const KeyTrieNode *child = current->findChild(key[i]);
+            if (child == nullptr)
             {
                 return nullptr; // No match
             }
-            current = current->children[c];
+
+            // The whole edge label must match (keys never end mid-edge)
+            if (key.compare(i, child->edge.length(), child->edge) != 0)
+            {
+                return nullptr;
+            }
+
+            i += child->edge.length();
+            current = child;
         }
 
         if (current->isEndOfKey)
@@ -377,21 +565,29 @@ namespace idioms
         return nullptr;
     }
 
-    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeyPrefix(const std::string &prefix) const
+    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeyPrefix(std::string_view prefix) const
     {
         std::vector<std::shared_ptr<ValueTrie>> results;
-        searchByKeyPrefix(root, prefix, 0, results);
+        searchByKeyPrefix(root, 0, prefix, 0, results);
         return results;
     }
 
-    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeySuffix(const std::string &suffix) const
+    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeySuffix(std::string_view suffix) const
     {
         std::vector<std::shared_ptr<ValueTrie>> results;
 
         if (useSuffixTreeMode)
         {
-            // With suffix-tree mode, we can search through indexed suffixes
-            searchByKeySuffix(root, suffix, results);
+            // Look up keys ending with the suffix in the substring index
+            for (int stringId : suffixIndex.findSuffix(suffix))
+            {
+                query::checkBudget();
+                auto it = suffixStringTries.find(stringId);
+                if (it != suffixStringTries.end())
+                {
+                    results.push_back(it->second);
+                }
+            }
         }
         else
         {
@@ -402,14 +598,22 @@ namespace idioms
         return results;
     }
 
-    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeyInfix(const std::string &infix) const
+    std::vector<std::shared_ptr<ValueTrie>> KeyTrie::searchKeyInfix(std::string_view infix) const
     {
         std::vector<std::shared_ptr<ValueTrie>> results;
 
         if (useSuffixTreeMode)
         {
-            // With suffix-tree mode, we search for the infix in all stored keys
-            searchByKeyInfix(root, infix, results);
+            // Look up keys containing the infix in the substring index
+            for (int stringId : suffixIndex.findSubstring(infix))
+            {
+                query::checkBudget();
+                auto it = suffixStringTries.find(stringId);
+                if (it != suffixStringTries.end())
+                {
+                    results.push_back(it->second);
+                }
+            }
         }
         else
         {
@@ -427,4 +631,97 @@ namespace idioms
         return results;
     }
 
-} // namespace idioms
\ No newline at end of file
+    size_t KeyTrie::nodeCount() const
+    {
+        return arena.size();
+    }
+
+    size_t KeyTrie::subtreeKeyCount(const KeyTrieNode *node,
+                                    std::unordered_map<const KeyTrieNode *, size_t> &weights) const
+    {
+        size_t count = node->isEndOfKey ? 1 : 0;
+        for (const auto &pair : node->children)
+        {
+            count += subtreeKeyCount(pair.second, weights);
+        }
+        weights[node] = count;
+        return count;
+    }
+
+    void KeyTrie::freeze()
+    {
+        // Weigh each subtree by the keys it stores: the trie carries no
+        // per-node query counters, so keys beneath a child stand in for
+        // the queries that will descend through it
+        std::unordered_map<const KeyTrieNode *, size_t> weights;
+        weights.reserve(arena.size());
+        subtreeKeyCount(root, weights);
+
+        // Clone the nodes into a fresh arena in BFS order, heaviest
+        // sibling first. Only arena placement follows the weights; each
+        // child table keeps its edge-character order, so lookups and
+        // range walks behave exactly as before.
+        NodeArena<KeyTrieNode> frozen;
+        KeyTrieNode *newRoot = frozen.allocate();
+
+        std::deque<std::pair<const KeyTrieNode *, KeyTrieNode *>> queue;
+        queue.push_back({root, newRoot});
+
+        while (!queue.empty())
+        {
+            const KeyTrieNode *oldNode = queue.front().first;
+            KeyTrieNode *newNode = queue.front().second;
+            queue.pop_front();
+
+            newNode->edge = oldNode->edge;
+            newNode->isEndOfKey = oldNode->isEndOfKey;
+            newNode->valueTrie = oldNode->valueTrie;
+
+            std::vector<std::pair<char, const KeyTrieNode *>> children;
+            for (const auto &pair : oldNode->children)
+            {
+                children.emplace_back(pair.first, pair.second);
+            }
+            std::stable_sort(children.begin(), children.end(),
+                             [&weights](const std::pair<char, const KeyTrieNode *> &a,
+                                        const std::pair<char, const KeyTrieNode *> &b)
+                             { return weights[a.second] > weights[b.second]; });
+
+            for (const auto &pair : children)
+            {
+                KeyTrieNode *newChild = frozen.allocate();
+                newNode->addChild(pair.first, newChild);
+                queue.push_back({pair.second, newChild});
+            }
+        }
+
+        root = newRoot;
+        arena.swap(frozen);
+        // The insertion-ordered nodes die with the swapped-out arena here
+    }
+
+    void KeyTrie::collectKeyTriesFrom(const KeyTrieNode *node, std::string &prefix,
+                                      std::vector<std::pair<std::string, std::shared_ptr<ValueTrie>>> &out) const
+    {
+        prefix += node->edge;
+
+        if (node->isEndOfKey && node->valueTrie)
+        {
+            out.emplace_back(prefix, node->valueTrie);
+        }
+
+        for (const auto &child : node->children)
+        {
+            collectKeyTriesFrom(child.second, prefix, out);
+        }
+
+        prefix.resize(prefix.size() - node->edge.size());
+    }
+
+    void KeyTrie::collectKeyTries(std::vector<std::pair<std::string, std::shared_ptr<ValueTrie>>> &out) const
+    {
+        std::string prefix;
+        collectKeyTriesFrom(root, prefix, out);
+    }
+
+} // namespace idioms
@@ -2,10 +2,16 @@
 #define IDIOMS_TRIE_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
+#include <utility>
+#include "TrieArena.hpp"
+#include "SuffixIndex.hpp"
+#include "PostingList.hpp"
+#include "ChildTable.hpp"
 
 namespace idioms
 {
@@ -15,16 +21,34 @@ namespace idioms
 
     /**
      * Node for the first-layer trie that stores metadata keys
+     *
+     * Children live in a TrieChildTable (see ChildTable.hpp): a small sorted
+     * vector by default, or a direct-indexed array over the deployment
+     * alphabet when built with -DIDIOMS_TRIE_DENSE_CHILDREN. The nodes
+     * themselves are arena-allocated by the owning trie.
+     *
+     * Each node carries the substring labelling the edge leading into it. In
+     * path-compressed mode an edge holds a whole run of single-child characters
+     * ("experiment/run/..."); in plain mode every edge is a single character.
      */
     class KeyTrieNode
     {
     public:
-        std::unordered_map<char, std::shared_ptr<KeyTrieNode>> children;
+        TrieChildTable<KeyTrieNode> children; // Iterates in edge-character order
+        std::string edge; // Label of the edge leading into this node (empty for root)
         bool isEndOfKey;
         std::shared_ptr<ValueTrie> valueTrie; // Points to the second-layer trie for this key
-        std::string fullKey;                  // Store the full key for this node (for suffix/infix searches)
 
         KeyTrieNode();
+
+        // Find a child whose edge starts with the given character (nullptr if absent)
+        KeyTrieNode *findChild(char c) const;
+
+        // Insert a child, keeping the vector sorted by first edge character
+        void addChild(char c, KeyTrieNode *child);
+
+        // Replace the child registered under the given character (used for edge splits)
+        void replaceChild(char c, KeyTrieNode *child);
     };
 
     /**
@@ -33,47 +57,109 @@ namespace idioms
     class ValueTrieNode
     {
     public:
-        std::unordered_map<char, std::shared_ptr<ValueTrieNode>> children;
+        TrieChildTable<ValueTrieNode> children; // Iterates in edge-character order
+        std::string edge; // Label of the edge leading into this node (empty for root)
         bool isEndOfValue;
-        std::unordered_set<int> objectIds; // Objects with this key-value pair
-        std::string fullValue;             // Store the full value for this node (for suffix/infix searches)
+        PostingList objectIds; // Objects with this key-value pair
 
         ValueTrieNode();
+
+        // Find a child whose edge starts with the given character (nullptr if absent)
+        ValueTrieNode *findChild(char c) const;
+
+        // Insert a child, keeping the vector sorted by first edge character
+        void addChild(char c, ValueTrieNode *child);
+
+        // Replace the child registered under the given character (used for edge splits)
+        void replaceChild(char c, ValueTrieNode *child);
     };
 
     /**
      * Second-layer trie for storing metadata values for a specific key
+     *
+     * In suffix-tree mode, suffix and infix lookups are served by a linear-space
+     * SuffixIndex over the interned values instead of inserting every suffix of
+     * every value into the trie.
      */
     class ValueTrie
     {
     private:
-        std::shared_ptr<ValueTrieNode> root;
+        NodeArena<ValueTrieNode> arena; // Owns all nodes in this trie
+        ValueTrieNode *root;
         bool useSuffixTreeMode;
+        bool usePathCompression;
+
+        // Substring index over values for suffix/infix queries (suffix mode only)
+        SuffixIndex suffixIndex;
+
+        // Map from interned value ID to the trie node holding its object IDs
+        std::unordered_map<int, ValueTrieNode *> suffixStringNodes;
 
         // Helper functions
-        void insertValueWithSuffixes(const std::string &value, int objectId);
-        void searchByValuePrefix(std::shared_ptr<ValueTrieNode> node, const std::string &prefix,
-                                 size_t index, std::unordered_set<int> &results) const;
-        void searchByValueInfix(std::shared_ptr<ValueTrieNode> node,
-                                const std::string &infix, std::unordered_set<int> &results) const;
-        void searchByValueSuffix(std::shared_ptr<ValueTrieNode> node,
-                                 const std::string &suffix, std::unordered_set<int> &results) const;
-        void collectAllObjectIds(std::shared_ptr<ValueTrieNode> node,
-                                 std::unordered_set<int> &results) const;
+        ValueTrieNode *insertValueInternal(const std::string &value);
+        void searchByValuePrefix(const ValueTrieNode *node, size_t edgeOffset,
+                                 std::string_view prefix, size_t index,
+                                 PostingList &results) const;
+        void searchByValueRange(const ValueTrieNode *node, const std::string &current,
+                                const std::string &low, const std::string &high,
+                                PostingList &results) const;
+        void collectValuesMatchingInfix(const ValueTrieNode *node, std::string &current,
+                                        std::string_view infix,
+                                        PostingList &results) const;
+        void collectAllObjectIds(const ValueTrieNode *node,
+                                 PostingList &results) const;
+        void collectPostingStatsFrom(const ValueTrieNode *node, uint64_t &lists,
+                                     uint64_t &entries, uint64_t &maxEntries) const;
 
     public:
-        ValueTrie(bool useSuffixMode = false);
+        ValueTrie(bool useSuffixMode = false, bool usePathCompressedMode = false);
 
         // Index operations
-        void insertValue(const std::string &value, int objectId, const std::string &fullValue = "");
+        void insertValue(const std::string &value, int objectId);
         void insertValueWithSuffixMode(const std::string &value, int objectId);
 
-        // Query operations
-        std::unordered_set<int> searchExactValue(const std::string &value) const;
-        std::unordered_set<int> searchValuePrefix(const std::string &prefix) const;
-        std::unordered_set<int> searchValueSuffix(const std::string &suffix) const;
-        std::unordered_set<int> searchValueInfix(const std::string &infix) const;
-        std::unordered_set<int> getAllObjectIds() const;
+        // Batch variants: one trie descent for all objects sharing a value
+        void insertValue(const std::string &value, const std::vector<int> &objectIds);
+        void insertValueWithSuffixMode(const std::string &value, const std::vector<int> &objectIds);
+
+        // Query operations. Patterns are taken as string_view so callers
+        // can pass slices of the query string without allocating substrings.
+        PostingList searchExactValue(std::string_view value) const;
+        PostingList searchValuePrefix(std::string_view prefix) const;
+        PostingList searchValueSuffix(std::string_view suffix) const;
+        PostingList searchValueInfix(std::string_view infix) const;
+
+        /**
+         * Find all objects whose stored value lies in [low, high]
+         * lexicographically, walking only the subtrees between the bounds
+         *
+         * With order-preserving encoded values (see OrderedEncoding.hpp) this
+         * answers numeric range queries as a bounded trie walk.
+         *
+         * @param low Lower bound (inclusive)
+         * @param high Upper bound (inclusive)
+         * @return Posting list of matching object IDs
+         */
+        PostingList searchValueRange(const std::string &low, const std::string &high) const;
+
+        PostingList getAllObjectIds() const;
+
+        /**
+         * Number of nodes allocated in this trie
+         *
+         * @return Node count (an arena counter read, no walk)
+         */
+        size_t nodeCount() const;
+
+        /**
+         * Accumulate posting-list statistics over this trie
+         *
+         * @param lists Incremented by the number of non-empty posting lists
+         * @param entries Incremented by the total posting entries
+         * @param maxEntries Raised to the largest single posting list seen
+         */
+        void collectPostingStats(uint64_t &lists, uint64_t &entries,
+                                 uint64_t &maxEntries) const;
     };
 
     /**
@@ -82,35 +168,84 @@ namespace idioms
     class KeyTrie
     {
     private:
-        std::shared_ptr<KeyTrieNode> root;
+        NodeArena<KeyTrieNode> arena; // Owns all nodes in this trie
+        KeyTrieNode *root;
         bool useSuffixTreeMode;
+        bool usePathCompression;
+
+        // Substring index over keys for suffix/infix queries (suffix mode only)
+        SuffixIndex suffixIndex;
+
+        // Map from interned key ID to the value trie for that key
+        std::unordered_map<int, std::shared_ptr<ValueTrie>> suffixStringTries;
 
         // Helper functions
-        void insertKeyWithSuffixes(const std::string &key);
-        void searchByKeyPrefix(std::shared_ptr<KeyTrieNode> node, const std::string &prefix,
-                               size_t index, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const;
-        void searchByKeyInfix(std::shared_ptr<KeyTrieNode> node,
-                              const std::string &infix, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const;
-        void searchByKeySuffix(std::shared_ptr<KeyTrieNode> node,
-                               const std::string &suffix, std::vector<std::shared_ptr<ValueTrie>> &valueTries) const;
-        void collectAllValueTries(std::shared_ptr<KeyTrieNode> node,
+        void searchByKeyPrefix(const KeyTrieNode *node, size_t edgeOffset,
+                               std::string_view prefix, size_t index,
+                               std::vector<std::shared_ptr<ValueTrie>> &valueTries) const;
+
+        // Weigh each subtree by the keys stored beneath it, for the
+        // freeze pass's placement order
+        size_t subtreeKeyCount(const KeyTrieNode *node,
+                               std::unordered_map<const KeyTrieNode *, size_t> &weights) const;
+        void collectAllValueTries(const KeyTrieNode *node,
                                   std::vector<std::shared_ptr<ValueTrie>> &valueTries) const;
+        void collectKeyTriesFrom(const KeyTrieNode *node, std::string &prefix,
+                                 std::vector<std::pair<std::string, std::shared_ptr<ValueTrie>>> &out) const;
 
     public:
-        KeyTrie(bool useSuffixMode = false);
+        /**
+         * Constructor
+         *
+         * @param useSuffixMode Whether to index suffixes for infix/suffix queries
+         * @param usePathCompressedMode Whether to collapse single-child chains
+         *        into multi-character edges (radix-tree layout)
+         */
+        KeyTrie(bool useSuffixMode = false, bool usePathCompressedMode = false);
 
         // Index operations
-        std::shared_ptr<ValueTrie> insertKeyOnly(const std::string &key, const std::string &fullKey = "");
+        std::shared_ptr<ValueTrie> insertKeyOnly(const std::string &key);
         std::shared_ptr<ValueTrie> insertKeyWithSuffixMode(const std::string &key);
 
-        // Query operations
-        std::shared_ptr<ValueTrie> searchExactKey(const std::string &key) const;
-        std::vector<std::shared_ptr<ValueTrie>> searchKeyPrefix(const std::string &prefix) const;
-        std::vector<std::shared_ptr<ValueTrie>> searchKeySuffix(const std::string &suffix) const;
-        std::vector<std::shared_ptr<ValueTrie>> searchKeyInfix(const std::string &infix) const;
+        // Query operations. Patterns are taken as string_view so callers
+        // can pass slices of the query string without allocating substrings.
+        std::shared_ptr<ValueTrie> searchExactKey(std::string_view key) const;
+        std::vector<std::shared_ptr<ValueTrie>> searchKeyPrefix(std::string_view prefix) const;
+        std::vector<std::shared_ptr<ValueTrie>> searchKeySuffix(std::string_view suffix) const;
+        std::vector<std::shared_ptr<ValueTrie>> searchKeyInfix(std::string_view infix) const;
         std::vector<std::shared_ptr<ValueTrie>> getAllValueTries() const;
+
+        /**
+         * Number of nodes allocated in this trie
+         *
+         * @return Node count (an arena counter read, no walk)
+         */
+        size_t nodeCount() const;
+
+        /**
+         * Visit every stored key together with its value trie
+         *
+         * Reconstructs each key from the edges on its path, so the
+         * memory report can name keys instead of pointing at nodes.
+         *
+         * @param out Appended with (key, value trie) pairs in trie order
+         */
+        void collectKeyTries(std::vector<std::pair<std::string, std::shared_ptr<ValueTrie>>> &out) const;
+
+        /**
+         * Rewrite the nodes into traversal order
+         *
+         * Incremental insertion scatters a path's nodes across the arena
+         * in insertion order; freezing clones them into a fresh arena in
+         * breadth-first order, heaviest subtree first, so a prefix
+         * descent through popular keys reads nearly adjacent memory.
+         * Intended after a bulk load or when building a read-only
+         * snapshot, while no other thread touches the trie; lookups and
+         * later inserts work unchanged on the frozen layout.
+         */
+        void freeze();
     };
 
 } // namespace idioms
 
-#endif // IDIOMS_TRIE_HPP
\ No newline at end of file
+#endif // IDIOMS_TRIE_HPP
@@ -5,6 +5,7 @@
 #include <memory>
 #include <algorithm>
 #include "client/Client.hpp"
+#include "numa/NumaPolicy.hpp"
 
 // Global metadata tracking (for display purposes only)
 std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> objectMetadata;
@@ -194,7 +195,18 @@ int main()
     system(cmd.c_str());
 
     // Create a client with 4 servers and suffix-tree mode enabled
-    idioms::DistributedIdiomsClient client(4, dataDir, true);
+    const int numServers = 4;
+    idioms::DistributedIdiomsClient client(numServers, dataDir, true);
+
+    // NUMA placement: spread the servers evenly across the machine's
+    // nodes in contiguous blocks. This is the deployment knob — swap in
+    // an explicit per-server vector to pack servers differently.
+    std::vector<int> serverNodes(numServers);
+    for (int i = 0; i < numServers; i++)
+    {
+        serverNodes[i] = i * idioms::numa::nodeCount() / numServers;
+    }
+    client.setNumaPolicy(serverNodes);
 
     std::cout << "=== IDIOMS with DART Distributed System ===" << std::endl;
     std::cout << "\n=== Initializing IDIOMS with example metadata ===" << std::endl;
@@ -0,0 +1,502 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "index/Trie.hpp"
+#include "index/PostingList.hpp"
+#include "dart/DART.hpp"
+#include "mpi/MPICommon.hpp"
+
+// Microbenchmarks for the primitives the end-to-end benchmarks sit on:
+// trie operations, posting-list algebra, DART hashing/routing and the
+// MPI wire codec. Each line reports per-op latency and throughput with
+// a fixed seed, so output from two commits can be diffed directly.
+//
+// With --perf the hot kernels run under Linux perf-event counters
+// (cycles, instructions, LLC misses, branch misses) instead of the
+// wall clock, so a node-layout change can be judged by what it does to
+// misses per operation rather than by timing noise.
+//
+// Build (from the repository root):
+//   mpic++ -std=c++17 -Wall -Wextra -pthread -I. -c src4/microbenchmark.cpp -o bin/microbenchmark.o
+//   mpic++ -std=c++17 bin/microbenchmark.o bin/index/*.o bin/dart/DART.o -o idioms_microbench
+
+// Fixed seed: identical inputs on every run and every commit
+static const unsigned RNG_SEED = 42;
+
+// Print one result line in a fixed-width, diff-friendly layout
+static void report(const std::string &name, size_t iterations, double totalNs)
+{
+    double nsPerOp = totalNs / static_cast<double>(iterations);
+    double mopsPerSec = 1000.0 / nsPerOp;
+
+    std::cout << std::left << std::setw(52) << name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << nsPerOp << " ns/op"
+              << std::setw(12) << std::setprecision(2) << mopsPerSec
+              << " Mops/s" << std::endl;
+}
+
+// Time a callable that performs `iterations` operations internally
+template <typename Func>
+static void benchmark(const std::string &name, size_t iterations, Func func)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    report(name, iterations, elapsed.count());
+}
+
+// Generate `count` random values with lengths uniform in [minLen, maxLen]
+static std::vector<std::string> makeValues(size_t count, size_t minLen, size_t maxLen,
+                                           std::mt19937 &gen)
+{
+    static const std::string alphabet =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.";
+    std::uniform_int_distribution<size_t> lenDist(minLen, maxLen);
+    std::uniform_int_distribution<size_t> charDist(0, alphabet.length() - 1);
+
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string value(lenDist(gen), ' ');
+        for (char &c : value)
+        {
+            c = alphabet[charDist(gen)];
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+// Sink for lookup results so the calls cannot be optimized away
+static volatile size_t resultSink = 0;
+
+// One hardware counter reading for a measured region
+struct PerfSample
+{
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t llcMisses = 0;
+    uint64_t branchMisses = 0;
+};
+
+// Group of hardware perf-event counters: cycles leads, the rest follow
+// it so all four start, stop and read together
+class PerfCounters
+{
+private:
+    static const int EVENT_COUNT = 4;
+    int fds[EVENT_COUNT];
+
+    static int openEvent(uint32_t type, uint64_t config, int groupFd)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = groupFd == -1 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        return static_cast<int>(
+            syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+
+public:
+    PerfCounters()
+    {
+        fds[0] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        fds[1] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fds[0]);
+        fds[2] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, fds[0]);
+        fds[3] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fds[0]);
+    }
+
+    ~PerfCounters()
+    {
+        for (int fd : fds)
+        {
+            if (fd != -1)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    // Whether every counter in the group opened (fails without
+    // CAP_PERFMON or with perf_event_paranoid locked down)
+    bool available() const
+    {
+        for (int fd : fds)
+        {
+            if (fd == -1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void start()
+    {
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    PerfSample stop()
+    {
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // PERF_FORMAT_GROUP: a count of values, then one per event in
+        // the order they joined the group
+        struct
+        {
+            uint64_t nr;
+            uint64_t values[EVENT_COUNT];
+        } data;
+
+        PerfSample sample;
+        if (read(fds[0], &data, sizeof(data)) == sizeof(data) &&
+            data.nr == EVENT_COUNT)
+        {
+            sample.cycles = data.values[0];
+            sample.instructions = data.values[1];
+            sample.llcMisses = data.values[2];
+            sample.branchMisses = data.values[3];
+        }
+        return sample;
+    }
+};
+
+// Print one perf result line: per-op counter rates plus IPC
+static void reportPerf(const std::string &name, size_t iterations,
+                       const PerfSample &sample)
+{
+    double ops = static_cast<double>(iterations);
+    double ipc = sample.cycles > 0
+                     ? static_cast<double>(sample.instructions) / sample.cycles
+                     : 0.0;
+
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(0)
+              << (sample.cycles / ops) << " cyc/op"
+              << std::setw(10) << (sample.instructions / ops) << " ins/op"
+              << std::setw(7) << std::setprecision(2) << ipc << " IPC"
+              << std::setw(9) << std::setprecision(2)
+              << (sample.llcMisses / ops) << " LLCm/op"
+              << std::setw(9) << (sample.branchMisses / ops) << " brm/op"
+              << std::endl;
+}
+
+// Run a callable under the counter group and report per-op rates
+template <typename Func>
+static void perfBenchmark(PerfCounters &counters, const std::string &name,
+                          size_t iterations, Func func)
+{
+    counters.start();
+    func();
+    reportPerf(name, iterations, counters.stop());
+}
+
+static void benchmarkTrie(size_t size, size_t minLen, size_t maxLen,
+                          const std::string &lengthLabel)
+{
+    std::mt19937 gen(RNG_SEED);
+    std::vector<std::string> values = makeValues(size, minLen, maxLen, gen);
+    std::string tag = "/" + std::to_string(size) + "/" + lengthLabel;
+
+    // Insert into a fresh trie, one op per value
+    {
+        idioms::ValueTrie trie;
+        benchmark("Trie/insert" + tag, size, [&]()
+                  {
+            for (size_t i = 0; i < size; i++)
+            {
+                trie.insertValue(values[i], static_cast<int>(i));
+            } });
+    }
+
+    // Lookups against a pre-built trie; exact and prefix probes reuse
+    // the inserted values, so every probe hits
+    idioms::ValueTrie trie;
+    for (size_t i = 0; i < size; i++)
+    {
+        trie.insertValue(values[i], static_cast<int>(i));
+    }
+
+    size_t lookups = std::min<size_t>(size, 10000);
+
+    benchmark("Trie/exact" + tag, lookups, [&]()
+              {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            resultSink += trie.searchExactValue(values[i]).size();
+        } });
+
+    benchmark("Trie/prefix" + tag, lookups, [&]()
+              {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            resultSink += trie.searchValuePrefix(values[i].substr(0, 3)).size();
+        } });
+
+    // Suffix and infix probes run against a suffix-mode trie, the mode
+    // those queries are answered from
+    idioms::ValueTrie suffixTrie(true);
+    for (size_t i = 0; i < size; i++)
+    {
+        suffixTrie.insertValueWithSuffixMode(values[i], static_cast<int>(i));
+    }
+
+    benchmark("Trie/suffix" + tag, lookups, [&]()
+              {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            const std::string &v = values[i];
+            resultSink += suffixTrie.searchValueSuffix(v.substr(v.length() - 3)).size();
+        } });
+
+    benchmark("Trie/infix" + tag, lookups, [&]()
+              {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            const std::string &v = values[i];
+            resultSink += suffixTrie.searchValueInfix(v.substr(v.length() / 2, 3)).size();
+        } });
+}
+
+static void benchmarkPostingLists(size_t size)
+{
+    std::mt19937 gen(RNG_SEED);
+
+    // Two lists with ~50% overlap over a domain twice the list size,
+    // which exercises both the dense and sparse container paths
+    std::uniform_int_distribution<int> idDist(0, static_cast<int>(size) * 2);
+    idioms::PostingList left, right;
+    for (size_t i = 0; i < size; i++)
+    {
+        left.add(idDist(gen));
+        right.add(idDist(gen));
+    }
+
+    std::string tag = "/" + std::to_string(size);
+    size_t rounds = std::max<size_t>(1, 1000000 / size);
+
+    benchmark("PostingList/union" + tag, rounds * size, [&]()
+              {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            idioms::PostingList result = left;
+            result.unionWith(right);
+            resultSink += result.size();
+        } });
+
+    benchmark("PostingList/intersect" + tag, rounds * size, [&]()
+              {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            idioms::PostingList result = left;
+            result.intersectWith(right);
+            resultSink += result.size();
+        } });
+}
+
+static void benchmarkRouting()
+{
+    std::mt19937 gen(RNG_SEED);
+    std::vector<std::string> keys = makeValues(10000, 4, 32, gen);
+    idioms::DARTRouter router(8);
+
+    benchmark("DART/getVirtualNodeId/10000", keys.size(), [&]()
+              {
+        for (const std::string &key : keys)
+        {
+            resultSink += router.getVirtualNodeId(key);
+        } });
+
+    benchmark("DART/getServersForKey/10000", keys.size(), [&]()
+              {
+        for (const std::string &key : keys)
+        {
+            resultSink += router.getServersForKey(key).size();
+        } });
+}
+
+static void benchmarkWireCodec()
+{
+    using namespace idioms::mpi;
+
+    std::mt19937 gen(RNG_SEED);
+    size_t rounds = 100000;
+
+    // Query messages: small, string-dominated payload
+    QueryMessage query("StageX=30*", 7, 12345);
+    benchmark("Wire/QueryMessage/roundtrip", rounds, [&]()
+              {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            auto buffer = query.serialize();
+            QueryMessage decoded = QueryMessage::deserialize(buffer);
+            resultSink += decoded.queryStr.length();
+            messageBufferPool().release(std::move(buffer));
+        } });
+
+    // Responses: ID-list dominated, exercising the delta-varint codec
+    std::uniform_int_distribution<int> idDist(0, 1000000);
+    std::vector<int> ids(1000);
+    for (int &id : ids)
+    {
+        id = idDist(gen);
+    }
+    ResponseMessage response(ids);
+
+    rounds = 10000;
+    benchmark("Wire/ResponseMessage/1000ids/roundtrip", rounds, [&]()
+              {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            auto buffer = response.serialize();
+            ResponseMessage decoded = ResponseMessage::deserialize(buffer);
+            resultSink += decoded.results.size();
+            messageBufferPool().release(std::move(buffer));
+        } });
+
+    CreateIndexMessage create("microscope", "LS-2000-B", 42);
+    rounds = 100000;
+    benchmark("Wire/CreateIndexMessage/roundtrip", rounds, [&]()
+              {
+        for (size_t r = 0; r < rounds; r++)
+        {
+            auto buffer = create.serialize();
+            CreateIndexMessage decoded = CreateIndexMessage::deserialize(buffer);
+            resultSink += decoded.key.length();
+            messageBufferPool().release(std::move(buffer));
+        } });
+}
+
+// Counter runs over the index hot kernels, per value-length class: the
+// trie descent (searchByValuePrefix), the substring probe
+// (searchValueInfix), the full subtree walk (collectAllObjectIds) and
+// the routing hash (ConsistentHash::getServer)
+static void benchmarkPerfKernels(PerfCounters &counters, size_t size,
+                                 size_t minLen, size_t maxLen,
+                                 const std::string &lengthLabel)
+{
+    std::mt19937 gen(RNG_SEED);
+    std::vector<std::string> values = makeValues(size, minLen, maxLen, gen);
+    std::string tag = "/" + std::to_string(size) + "/" + lengthLabel;
+
+    idioms::ValueTrie suffixTrie(true);
+    for (size_t i = 0; i < size; i++)
+    {
+        suffixTrie.insertValueWithSuffixMode(values[i], static_cast<int>(i));
+    }
+
+    size_t lookups = std::min<size_t>(size, 10000);
+
+    perfBenchmark(counters, "Perf/prefix" + tag, lookups, [&]()
+                  {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            resultSink += suffixTrie.searchValuePrefix(values[i].substr(0, 3)).size();
+        } });
+
+    perfBenchmark(counters, "Perf/infix" + tag, lookups, [&]()
+                  {
+        for (size_t i = 0; i < lookups; i++)
+        {
+            const std::string &v = values[i];
+            resultSink += suffixTrie.searchValueInfix(v.substr(v.length() / 2, 3)).size();
+        } });
+
+    // One walk covers every node, so per-op rates are per full scan
+    size_t walks = 100;
+    perfBenchmark(counters, "Perf/collectAll" + tag, walks, [&]()
+                  {
+        for (size_t i = 0; i < walks; i++)
+        {
+            resultSink += suffixTrie.getAllObjectIds().size();
+        } });
+
+    idioms::ConsistentHash hash(8);
+    perfBenchmark(counters, "Perf/getServer" + tag, size, [&]()
+                  {
+        for (const std::string &value : values)
+        {
+            resultSink += hash.getServer(value);
+        } });
+}
+
+static int runPerfMode()
+{
+    PerfCounters counters;
+    if (!counters.available())
+    {
+        std::cerr << "perf counters unavailable: perf_event_open failed "
+                  << "(check kernel.perf_event_paranoid or CAP_PERFMON)"
+                  << std::endl;
+        return 1;
+    }
+
+    std::cout << "===== IDIOMS Microbenchmarks (perf counters) ====="
+              << std::endl;
+    std::cout << "Seed: " << RNG_SEED << std::endl;
+    std::cout << std::endl;
+
+    for (size_t size : {10000, 100000})
+    {
+        benchmarkPerfKernels(counters, size, 4, 12, "short");
+        benchmarkPerfKernels(counters, size, 24, 64, "long");
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--perf")
+    {
+        return runPerfMode();
+    }
+
+    std::cout << "===== IDIOMS Microbenchmarks =====" << std::endl;
+    std::cout << "Seed: " << RNG_SEED << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "--- ValueTrie ---" << std::endl;
+    for (size_t size : {1000, 10000, 100000})
+    {
+        benchmarkTrie(size, 4, 12, "short");
+        benchmarkTrie(size, 24, 64, "long");
+    }
+    std::cout << std::endl;
+
+    std::cout << "--- PostingList ---" << std::endl;
+    for (size_t size : {1000, 100000})
+    {
+        benchmarkPostingLists(size);
+    }
+    std::cout << std::endl;
+
+    std::cout << "--- DART routing ---" << std::endl;
+    benchmarkRouting();
+    std::cout << std::endl;
+
+    std::cout << "--- Wire codec ---" << std::endl;
+    benchmarkWireCodec();
+
+    return 0;
+}
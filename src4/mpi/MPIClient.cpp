@@ -1,8 +1,38 @@
 #include "MPIClient.hpp"
+#include "../query/ResultSet.hpp"
+#include "../query/MultiConditionQuery.hpp"
+#include "../trace/Tracer.hpp"
 #include <iostream>
 #include <stdexcept>
-#include <unordered_set>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+    // Nanoseconds since a steady-clock mark, for histogram recording
+    uint64_t elapsedNs(const std::chrono::steady_clock::time_point &start)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+    }
+
+    // Steady-clock mark as nanoseconds since epoch, matching the span
+    // timestamps the tracer's now() produces
+    uint64_t spanNs(const std::chrono::steady_clock::time_point &mark)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                mark.time_since_epoch())
+                .count());
+    }
+
+} // namespace
 
 namespace idioms
 {
@@ -20,233 +50,2134 @@ namespace idioms
             // Create the DART router
             router = std::make_shared<DARTRouter>(numServers);
 
+            // No latency observed yet; estimates seed on first response
+            serverLatency.resize(numServers);
+
             std::cout << "MPI Client initialized with " << numServers << " servers" << std::endl;
         }
 
         MPIClient::~MPIClient()
         {
-            // Clean up resources if needed
+            // Ship anything still sitting in the ingest batch and drain
+            // the async window
+            flushPendingIndexRecords();
+            waitForAsyncOperations();
         }
 
-        void MPIClient::create_md_index(const std::string &key, const std::string &value, int objectId)
+        void MPIClient::enableSharedMemoryTransport()
         {
-            // Determine which servers should store this index record
-            std::vector<int> serverIds = router->getServersForKey(key);
-
-            std::cout << "Distributing index for key '" << key << "' to servers: ";
-            for (size_t i = 0; i < serverIds.size(); i++)
-            {
-                if (i > 0)
-                    std::cout << ", ";
-                std::cout << serverIds[i];
+            shm = std::make_unique<ShmTransport>();
+        }
 
-                // MPI ranks start at 0, but rank 0 is reserved for client
-                // So server with ID 0 is at MPI rank 1, server with ID 1 is at MPI rank 2, etc.
-                int serverRank = serverIds[i] + 1;
+        void MPIClient::setAsyncWindowSize(int window)
+        {
+            asyncWindow = window > 0 ? window : 1;
+        }
 
-                // Create and send the message
-                CreateIndexMessage msg(key, value, objectId);
-                sendMessage(msg, serverRank, INDEX_TAG);
+        void MPIClient::setQueryPriority(QueryPriority priority)
+        {
+            queryPriority = priority;
+        }
 
-                // Wait for response
-                auto response = receiveResponse(serverRank, RESULT_TAG);
+        ResponseMessage MPIClient::queryWithBusyRetry(QueryMessage msg, int serverRank)
+        {
+            for (int attempt = 0;; attempt++)
+            {
+                sendMessage(msg, serverRank, QUERY_TAG);
+                auto response = receiveResponse(serverRank, RESULT_TAG, msg.requestId);
 
-                if (!response.success)
+                if (!response.busy || attempt >= BUSY_RETRY_LIMIT)
                 {
-                    std::cerr << "Failed to create index on server " << serverIds[i] << std::endl;
+                    if (response.busy)
+                    {
+                        std::cerr << "Server " << (serverRank - 1)
+                                  << " still busy after " << attempt
+                                  << " retries; giving up on this request" << std::endl;
+                    }
+                    return response;
                 }
+
+                // Back off for the server's hint, then resend under a
+                // fresh request ID so a late answer to the rejected send
+                // cannot be mistaken for the retry's
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(response.retryAfterMs));
+                msg.requestId = nextRequestId++;
             }
-            std::cout << std::endl;
         }
 
-        void MPIClient::delete_md_index(const std::string &key, const std::string &value, int objectId)
+        void MPIClient::postAsyncOp(const Message &msg, int serverId, int sendTag,
+                                    int recvTag, int recvBufferBytes,
+                                    std::shared_ptr<std::promise<bool>> ackPromise)
         {
-            // Determine which servers should have this index record
-            std::vector<int> serverIds = router->getServersForKey(key);
+            AsyncOp op;
+            op.serverId = serverId;
+            op.ackPromise = std::move(ackPromise);
+            op.sendBuffer = msg.serialize();
+            op.recvBuffer = messageBufferPool().acquire(recvBufferBytes);
+            op.recvBuffer.resize(recvBufferBytes);
 
-            std::cout << "Deleting index for key '" << key << "' from servers: ";
-            for (size_t i = 0; i < serverIds.size(); i++)
-            {
-                if (i > 0)
-                    std::cout << ", ";
-                std::cout << serverIds[i];
+            // MPI ranks start at 0, but rank 0 is reserved for client
+            int serverRank = serverId + 1;
 
-                // MPI ranks start at 0, but rank 0 is reserved for client
-                int serverRank = serverIds[i] + 1;
+            MPI_Isend(op.sendBuffer.data(), op.sendBuffer.size(), MPI_CHAR,
+                      serverRank, sendTag, MPI_COMM_WORLD, &op.sendRequest);
+            MPI_Irecv(op.recvBuffer.data(), recvBufferBytes, MPI_CHAR,
+                      serverRank, recvTag, MPI_COMM_WORLD, &op.recvRequest);
 
-                // Create and send the message
-                DeleteIndexMessage msg(key, value, objectId);
-                sendMessage(msg, serverRank, INDEX_TAG);
+            inflightOps.push_back(std::move(op));
+        }
 
-                // Wait for response
-                auto response = receiveResponse(serverRank, RESULT_TAG);
+        void MPIClient::reapAsyncCompletions(bool waitAll)
+        {
+            while (!inflightOps.empty() &&
+                   (waitAll || inflightOps.size() >= static_cast<size_t>(asyncWindow)))
+            {
+                std::vector<MPI_Request> recvRequests;
+                recvRequests.reserve(inflightOps.size());
+                for (const auto &op : inflightOps)
+                {
+                    recvRequests.push_back(op.recvRequest);
+                }
 
-                if (!response.success)
+                int completed = 0;
+                std::vector<int> indices(inflightOps.size());
+                std::vector<MPI_Status> statuses(inflightOps.size());
+                MPI_Waitsome(recvRequests.size(), recvRequests.data(), &completed,
+                             indices.data(), statuses.data());
+
+                if (completed == MPI_UNDEFINED)
                 {
-                    std::cerr << "Failed to delete index on server " << serverIds[i] << std::endl;
+                    // No reapable requests remain; resolve any futures so
+                    // their holders do not wait on a broken promise
+                    for (AsyncOp &op : inflightOps)
+                    {
+                        if (op.ackPromise)
+                        {
+                            op.ackPromise->set_value(false);
+                        }
+                    }
+                    inflightOps.clear();
+                    break;
+                }
+
+                for (int i = 0; i < completed; i++)
+                {
+                    AsyncOp &op = inflightOps[indices[i]];
+
+                    // The ack arrived, so the matching send is long done
+                    MPI_Wait(&op.sendRequest, MPI_STATUS_IGNORE);
+                    op.recvRequest = MPI_REQUEST_NULL;
+
+                    int msgSize = 0;
+                    MPI_Get_count(&statuses[i], MPI_CHAR, &msgSize);
+                    op.recvBuffer.resize(msgSize);
+
+                    // A descriptor means the real ack is in shared memory
+                    if (shm && Message::getType(op.recvBuffer) == SHM_PAYLOAD)
+                    {
+                        auto descriptor = ShmPayloadMessage::deserialize(op.recvBuffer);
+                        op.recvBuffer = shm->fetchPayload(op.serverId + 1, descriptor.slot);
+                    }
+
+                    bool accepted = true;
+                    if (Message::getType(op.recvBuffer) == ERROR_RESPONSE)
+                    {
+                        auto errorMsg = ErrorResponseMessage::deserialize(op.recvBuffer);
+                        std::cerr << "Async operation failed on server " << op.serverId
+                                  << ": " << errorMsg.errorMessage << std::endl;
+                        accepted = false;
+                    }
+                    else if (!ResponseMessage::deserialize(op.recvBuffer).success)
+                    {
+                        std::cerr << "Async operation failed on server "
+                                  << op.serverId << std::endl;
+                        accepted = false;
+                    }
+
+                    // Resolve the operation's future, if one was requested
+                    if (op.ackPromise)
+                    {
+                        op.ackPromise->set_value(accepted);
+                    }
+
+                    // Recycle both buffers for later operations
+                    messageBufferPool().release(std::move(op.sendBuffer));
+                    messageBufferPool().release(std::move(op.recvBuffer));
                 }
+
+                // Drop the completed operations
+                inflightOps.erase(
+                    std::remove_if(inflightOps.begin(), inflightOps.end(),
+                                   [](const AsyncOp &op)
+                                   { return op.recvRequest == MPI_REQUEST_NULL; }),
+                    inflightOps.end());
             }
-            std::cout << std::endl;
         }
 
-        std::vector<int> MPIClient::findServersForQuery(const std::string &queryStr) const
+        void MPIClient::create_md_index_async(const std::string &key, const std::string &value, int objectId)
         {
-            // Determine which servers should receive this query
-            std::vector<int> destinationServerIds = router->getDestinationServers(queryStr);
+            // Our own write must be visible to our own next read
+            invalidateResultCache(key);
 
-            std::cout << "Query: \"" << queryStr << "\" routed to servers: ";
-            for (size_t i = 0; i < destinationServerIds.size(); i++)
+            CreateIndexMessage msg(key, value, objectId);
+
+            // One posted write per record: the primary streams the record
+            // to its replicas off the client's path
+            std::vector<int> serverIds = router->getServersForKey(key);
+            if (serverIds.empty())
             {
-                if (i > 0)
-                    std::cout << ", ";
-                std::cout << destinationServerIds[i];
+                std::cerr << "No server available for key '" << key << "'" << std::endl;
+                return;
             }
-            std::cout << std::endl;
 
-            return destinationServerIds;
+            // Block only when the window is already full
+            reapAsyncCompletions(false);
+            postAsyncOp(msg, serverIds[0], INDEX_TAG, RESULT_TAG, ASYNC_ACK_BUFFER_BYTES);
         }
 
-        std::vector<int> MPIClient::md_search(const std::string &queryStr)
+        std::future<bool> MPIClient::create_md_index_future(const std::string &key, const std::string &value, int objectId)
         {
-            // Find which servers should receive this query
-            std::vector<int> serverIds = findServersForQuery(queryStr);
+            // Our own write must be visible to our own next read
+            invalidateResultCache(key);
 
-            // Send query to selected servers and collect results
-            std::unordered_set<int> resultSet;
-            std::vector<int> handlingServers;
+            CreateIndexMessage msg(key, value, objectId);
 
-            std::cout << "Servers that can handle the query: ";
-            bool first = true;
+            auto ackPromise = std::make_shared<std::promise<bool>>();
+            std::future<bool> future = ackPromise->get_future();
+
+            std::vector<int> serverIds = router->getServersForKey(key);
+            if (serverIds.empty())
+            {
+                std::cerr << "No server available for key '" << key << "'" << std::endl;
+                ackPromise->set_value(false);
+                return future;
+            }
+
+            // Block only when the window is already full
+            reapAsyncCompletions(false);
+            postAsyncOp(msg, serverIds[0], INDEX_TAG, RESULT_TAG,
+                        ASYNC_ACK_BUFFER_BYTES, std::move(ackPromise));
+            return future;
+        }
+
+        void MPIClient::waitForAsyncOperations()
+        {
+            reapAsyncCompletions(true);
+        }
+
+        std::vector<int> MPIClient::md_search_parallel(const std::string &queryStr)
+        {
+            // Route on the bare condition, as in md_search
+            std::string condition;
+            size_t limit = query::parseLimitModifier(queryStr, condition);
+
+            std::vector<int> serverIds = findServersForQuery(condition);
+
+            // Issue the whole fan-out as nonblocking sends so every server
+            // starts working on the query at the same time
+            QueryMessage msg(queryStr, router->getRoutingEpoch(), nextRequestId++,
+                                 queryPriority);
+
+            std::vector<AsyncOp> queryOps;
+            queryOps.reserve(serverIds.size());
 
             for (int serverId : serverIds)
             {
+                AsyncOp op;
+                op.serverId = serverId;
+                op.sendBuffer = msg.serialize();
+                op.recvBuffer = messageBufferPool().acquire(ASYNC_RESULT_BUFFER_BYTES);
+                op.recvBuffer.resize(ASYNC_RESULT_BUFFER_BYTES);
+
                 // MPI ranks start at 0, but rank 0 is reserved for client
                 int serverRank = serverId + 1;
 
-                // Create and send the message
-                QueryMessage msg(queryStr);
-                sendMessage(msg, serverRank, QUERY_TAG);
+                MPI_Isend(op.sendBuffer.data(), op.sendBuffer.size(), MPI_CHAR,
+                          serverRank, QUERY_TAG, MPI_COMM_WORLD, &op.sendRequest);
+                MPI_Irecv(op.recvBuffer.data(), ASYNC_RESULT_BUFFER_BYTES, MPI_CHAR,
+                          serverRank, RESULT_TAG, MPI_COMM_WORLD, &op.recvRequest);
 
-                // Wait for response
-                auto response = receiveResponse(serverRank, RESULT_TAG);
+                queryOps.push_back(std::move(op));
+            }
 
-                // If we got results, this server could handle the query
-                if (!response.results.empty())
+            // Merge responses in completion order so a slow server only
+            // delays its own contribution
+            query::ResultSet resultSet;
+
+            std::vector<MPI_Request> recvRequests;
+            recvRequests.reserve(queryOps.size());
+            for (const auto &op : queryOps)
+            {
+                recvRequests.push_back(op.recvRequest);
+            }
+
+            size_t remaining = queryOps.size();
+            std::vector<int> indices(queryOps.size());
+            std::vector<MPI_Status> statuses(queryOps.size());
+
+            while (remaining > 0)
+            {
+                int completed = 0;
+                MPI_Waitsome(recvRequests.size(), recvRequests.data(), &completed,
+                             indices.data(), statuses.data());
+
+                if (completed == MPI_UNDEFINED)
                 {
-                    if (!first)
-                        std::cout << ", ";
-                    std::cout << serverId;
-                    first = false;
-                    handlingServers.push_back(serverId);
+                    break;
+                }
 
-                    // Merge results
-                    resultSet.insert(response.results.begin(), response.results.end());
+                for (int i = 0; i < completed; i++)
+                {
+                    AsyncOp &op = queryOps[indices[i]];
+                    MPI_Wait(&op.sendRequest, MPI_STATUS_IGNORE);
+
+                    int msgSize = 0;
+                    MPI_Get_count(&statuses[i], MPI_CHAR, &msgSize);
+                    op.recvBuffer.resize(msgSize);
+
+                    // A descriptor means the real message is in shared memory
+                    if (shm && Message::getType(op.recvBuffer) == SHM_PAYLOAD)
+                    {
+                        auto descriptor = ShmPayloadMessage::deserialize(op.recvBuffer);
+                        op.recvBuffer = shm->fetchPayload(op.serverId + 1, descriptor.slot);
+                    }
+
+                    if (Message::getType(op.recvBuffer) == ERROR_RESPONSE)
+                    {
+                        auto errorMsg = ErrorResponseMessage::deserialize(op.recvBuffer);
+                        throw std::runtime_error("Server error: " + errorMsg.errorMessage);
+                    }
+
+                    auto response = ResponseMessage::deserialize(op.recvBuffer);
+                    if (!response.results.empty())
+                    {
+                        resultSet.unionWith(query::ResultSet(std::move(response.results)));
+                    }
+
+                    // Recycle both buffers for later operations
+                    messageBufferPool().release(std::move(op.sendBuffer));
+                    messageBufferPool().release(std::move(op.recvBuffer));
                 }
+
+                remaining -= completed;
             }
 
-            if (first)
-                std::cout << "None";
-            std::cout << std::endl;
+            std::vector<int> results = resultSet.takeVector();
 
-            // Convert set to vector for return
-            std::vector<int> results(resultSet.begin(), resultSet.end());
-            std::sort(results.begin(), results.end()); // Sort for deterministic output
+            // Each server already capped its own results; cap the merged set too
+            if (limit > 0 && results.size() > limit)
+            {
+                results.resize(limit);
+            }
             return results;
         }
 
-        void MPIClient::checkpointAllIndices()
+        void MPIClient::enableBatchedIngest(size_t maxRecords, int maxDelayMs)
         {
-            std::cout << "Checkpointing indices to disk..." << std::endl;
+            batchingEnabled = true;
+            batchMaxRecords = maxRecords;
+            batchMaxDelay = std::chrono::milliseconds(maxDelayMs);
+            pendingRecords.reserve(maxRecords);
 
-            // Send checkpoint command to all servers
-            AdminMessage msg(CHECKPOINT);
+            std::cout << "Batched ingest enabled (flush at " << maxRecords
+                      << " records or " << maxDelayMs << "ms)" << std::endl;
+        }
 
-            for (int i = 1; i < worldSize; i++)
-            { // Skip rank 0 (client)
-                sendMessage(msg, i, ADMIN_TAG);
+        void MPIClient::disableBatchedIngest()
+        {
+            flushPendingIndexRecords();
+            batchingEnabled = false;
+        }
 
-                // Wait for response
-                auto response = receiveResponse(i, ADMIN_TAG);
+        void MPIClient::flushPendingIndexRecords()
+        {
+            if (pendingRecords.empty())
+            {
+                return;
+            }
 
-                if (!response.success)
+            std::vector<IndexRecord> batch;
+            batch.swap(pendingRecords);
+            create_md_index_batch(batch);
+        }
+
+        void MPIClient::create_md_index(const std::string &key, const std::string &value, int objectId)
+        {
+            auto opStart = std::chrono::steady_clock::now();
+
+            // Our own write must be visible to our own next read
+            invalidateResultCache(key);
+
+            if (batchingEnabled)
+            {
+                // Accumulate; one BATCH_CREATE_INDEX per server at flush
+                // time replaces a routed round-trip per record
+                if (pendingRecords.empty())
                 {
-                    std::cerr << "Failed to checkpoint index on server " << (i - 1) << std::endl;
+                    firstPendingAt = std::chrono::steady_clock::now();
                 }
+                pendingRecords.emplace_back(key, value, objectId);
+
+                bool full = pendingRecords.size() >= batchMaxRecords;
+                bool stale = std::chrono::steady_clock::now() - firstPendingAt >= batchMaxDelay;
+                if (full || stale)
+                {
+                    flushPendingIndexRecords();
+                }
+                return;
             }
 
-            std::cout << "Checkpoint complete." << std::endl;
+            // Determine which servers hold this key; the write goes to the
+            // primary only, which streams it to the replicas asynchronously
+            std::vector<int> serverIds = router->getServersForKey(key);
+            if (serverIds.empty())
+            {
+                std::cerr << "No server available for key '" << key << "'" << std::endl;
+                return;
+            }
+
+            int primary = serverIds[0];
+            std::cout << "Writing index for key '" << key << "' to primary server "
+                      << primary << " (" << (serverIds.size() - 1)
+                      << " streamed replicas)" << std::endl;
+
+            // MPI ranks start at 0, but rank 0 is reserved for client
+            // So server with ID 0 is at MPI rank 1, server with ID 1 is at MPI rank 2, etc.
+            int serverRank = primary + 1;
+
+            // Create and send the message
+            CreateIndexMessage msg(key, value, objectId);
+            sendMessage(msg, serverRank, INDEX_TAG);
+
+            // Wait for response; the replicas catch up within the stream's
+            // flush interval rather than on the client's critical path
+            auto response = receiveResponse(serverRank, RESULT_TAG);
+
+            if (!response.success)
+            {
+                std::cerr << "Failed to create index on server " << primary << std::endl;
+            }
+
+            writeLatencyHist.record(elapsedNs(opStart));
         }
 
-        void MPIClient::recoverAllIndices()
+        void MPIClient::create_md_index_batch(const std::vector<IndexRecord> &records)
         {
-            std::cout << "Recovering indices from disk..." << std::endl;
+            int numServers = worldSize - 1;
 
-            // Send recover command to all servers
-            AdminMessage msg(RECOVER);
+            // Partition the batch by destination server; a record goes to
+            // every server responsible for its key, same as create_md_index
+            std::vector<BatchCreateIndexMessage> perServer(numServers);
 
-            for (int i = 1; i < worldSize; i++)
-            { // Skip rank 0 (client)
-                sendMessage(msg, i, ADMIN_TAG);
+            for (const auto &record : records)
+            {
+                invalidateResultCache(record.key);
+
+                // The key's primary alone receives the record; its
+                // replication stream carries it to the replicas
+                std::vector<int> serverIds = router->getServersForKey(record.key);
+                if (!serverIds.empty())
+                {
+                    perServer[serverIds[0]].addRecord(record.key, record.value, record.objectId);
+                }
+            }
+
+            std::cout << "Bulk loading " << records.size() << " index records..." << std::endl;
+
+            for (int serverId = 0; serverId < numServers; serverId++)
+            {
+                if (perServer[serverId].recordCount() == 0)
+                {
+                    continue;
+                }
+
+                std::cout << "  Server " << serverId << ": "
+                          << perServer[serverId].recordCount() << " records" << std::endl;
+
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverId + 1;
+
+                // Send the whole batch as one message
+                sendMessage(perServer[serverId], serverRank, INDEX_TAG);
 
                 // Wait for response
-                auto response = receiveResponse(i, ADMIN_TAG);
+                auto response = receiveResponse(serverRank, RESULT_TAG);
 
                 if (!response.success)
                 {
-                    std::cerr << "Failed to recover index on server " << (i - 1) << std::endl;
+                    std::cerr << "Failed to bulk load index on server " << serverId << std::endl;
                 }
             }
-
-            std::cout << "Recovery complete." << std::endl;
         }
 
-        void MPIClient::shutdownAllServers()
+        void MPIClient::delete_md_index(const std::string &key, const std::string &value, int objectId)
         {
-            std::cout << "Shutting down all servers..." << std::endl;
+            // Our own delete must be visible to our own next read
+            invalidateResultCache(key);
 
-            // Send shutdown command to all servers
-            AdminMessage msg(SHUTDOWN);
+            // Determine which servers should have this index record
+            std::vector<int> serverIds = router->getServersForKey(key);
 
-            for (int i = 1; i < worldSize; i++)
-            { // Skip rank 0 (client)
-                sendMessage(msg, i, ADMIN_TAG);
+            std::cout << "Deleting index for key '" << key << "' from servers: ";
+            for (size_t i = 0; i < serverIds.size(); i++)
+            {
+                if (i > 0)
+                    std::cout << ", ";
+                std::cout << serverIds[i];
 
-                // No need to wait for response
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverIds[i] + 1;
+
+                // Create and send the message
+                DeleteIndexMessage msg(key, value, objectId);
+                sendMessage(msg, serverRank, INDEX_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(serverRank, RESULT_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to delete index on server " << serverIds[i] << std::endl;
+                }
             }
+            std::cout << std::endl;
         }
 
-        void MPIClient::sendMessage(const Message &msg, int destRank, int tag)
+        void MPIClient::delete_md_index_batch(const std::vector<IndexRecord> &records)
         {
-            // Serialize the message
-            auto buffer = msg.serialize();
+            int numServers = worldSize - 1;
 
-            // Send the message
-            MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank, tag, MPI_COMM_WORLD);
-        }
+            // Partition the batch by destination server; unlike creates, a
+            // record goes to every server holding its key, since deletes
+            // are not carried by the replication stream
+            std::vector<BatchDeleteIndexMessage> perServer(numServers);
 
-        ResponseMessage MPIClient::receiveResponse(int sourceRank, int tag)
-        {
-            MPI_Status status;
-            int msgSize;
+            for (const auto &record : records)
+            {
+                invalidateResultCache(record.key);
 
-            // Probe for the message size
-            MPI_Probe(sourceRank, tag, MPI_COMM_WORLD, &status);
-            MPI_Get_count(&status, MPI_CHAR, &msgSize);
+                for (int serverId : router->getServersForKey(record.key))
+                {
+                    perServer[serverId].addRecord(record.key, record.value, record.objectId);
+                }
+            }
 
-            // Receive the message
-            std::vector<char> buffer(msgSize);
-            MPI_Recv(buffer.data(), msgSize, MPI_CHAR, sourceRank, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            std::cout << "Bulk deleting " << records.size() << " index records..." << std::endl;
 
-            // Check if it's an error response
-            MessageType type = Message::getType(buffer);
-            if (type == ERROR_RESPONSE)
+            for (int serverId = 0; serverId < numServers; serverId++)
             {
-                auto errorMsg = ErrorResponseMessage::deserialize(buffer);
-                throw std::runtime_error("Server error: " + errorMsg.errorMessage);
-            }
+                if (perServer[serverId].recordCount() == 0)
+                {
+                    continue;
+                }
+
+                std::cout << "  Server " << serverId << ": "
+                          << perServer[serverId].recordCount() << " records" << std::endl;
+
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverId + 1;
+
+                // Send the whole batch as one message
+                sendMessage(perServer[serverId], serverRank, INDEX_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(serverRank, RESULT_TAG);
 
-            // Deserialize and return the response
-            return ResponseMessage::deserialize(buffer);
+                if (!response.success)
+                {
+                    std::cerr << "Failed to bulk delete index on server " << serverId << std::endl;
+                }
+            }
+        }
+
+        size_t MPIClient::delete_md_by_query(const std::string &queryStr)
+        {
+            // The servers remove whatever metadata the victims carry, which
+            // can touch keys the query never names; no cached answer is
+            // safely narrower than "everything"
+            resultCache.clear();
+            resultCacheLru.clear();
+
+            std::vector<int> serverIds = findServersForQuery(queryStr);
+
+            std::cout << "Deleting by query '" << queryStr << "' on servers: ";
+            size_t deleted = 0;
+            for (size_t i = 0; i < serverIds.size(); i++)
+            {
+                if (i > 0)
+                    std::cout << ", ";
+                std::cout << serverIds[i];
+
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverIds[i] + 1;
+
+                DeleteByQueryMessage msg(queryStr);
+                sendMessage(msg, serverRank, INDEX_TAG);
+
+                // The victim count comes back COUNT-query style
+                auto response = receiveResponse(serverRank, RESULT_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to delete by query on server " << serverIds[i] << std::endl;
+                }
+                else if (!response.results.empty())
+                {
+                    deleted += static_cast<size_t>(response.results[0]);
+                }
+            }
+            std::cout << std::endl;
+
+            return deleted;
+        }
+
+        std::vector<int> MPIClient::destinationServersCached(const std::string &queryStr) const
+        {
+            // A cached decision stays valid until vnode ownership moves;
+            // the epoch check catches rebalances and membership changes
+            uint64_t epoch = router->getRoutingEpoch();
+
+            auto it = routingCache.find(queryStr);
+            if (it != routingCache.end() && it->second.epoch == epoch)
+            {
+                return it->second.servers;
+            }
+
+            if (routingCache.size() >= ROUTING_CACHE_CAPACITY)
+            {
+                routingCache.clear();
+            }
+
+            std::vector<int> servers = router->getDestinationServers(queryStr);
+            routingCache[queryStr] = {epoch, servers};
+            return servers;
+        }
+
+        bool MPIClient::lookupResultCache(const std::string &queryStr, std::vector<int> &results)
+        {
+            auto it = resultCache.find(queryStr);
+            if (it == resultCache.end())
+            {
+                return false;
+            }
+
+            double ageMs = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - it->second.storedAt)
+                               .count();
+            if (ageMs > RESULT_CACHE_TTL_MS)
+            {
+                // Expired entries are evicted lazily, by the lookup that
+                // notices
+                resultCacheLru.erase(it->second.lruPosition);
+                resultCache.erase(it);
+                return false;
+            }
+
+            resultCacheLru.splice(resultCacheLru.begin(), resultCacheLru,
+                                  it->second.lruPosition);
+            results = it->second.results;
+            return true;
+        }
+
+        void MPIClient::storeResultCache(const std::string &queryStr,
+                                         const std::vector<int> &results)
+        {
+            auto it = resultCache.find(queryStr);
+            if (it != resultCache.end())
+            {
+                it->second.storedAt = std::chrono::steady_clock::now();
+                it->second.results = results;
+                resultCacheLru.splice(resultCacheLru.begin(), resultCacheLru,
+                                      it->second.lruPosition);
+                return;
+            }
+
+            if (resultCache.size() >= RESULT_CACHE_CAPACITY)
+            {
+                resultCache.erase(resultCacheLru.back());
+                resultCacheLru.pop_back();
+            }
+
+            resultCacheLru.push_front(queryStr);
+            resultCache[queryStr] = {std::chrono::steady_clock::now(), results,
+                                     resultCacheLru.begin()};
+        }
+
+        void MPIClient::invalidateResultCache(const std::string &key)
+        {
+            // A write this client issues must be visible to its own next
+            // read: drop any cached answer whose condition could cover the
+            // written key — queries naming the key, and conservatively any
+            // query with a wildcard in it. Writes by other clients are only
+            // seen once the TTL lapses.
+            for (auto it = resultCache.begin(); it != resultCache.end();)
+            {
+                if (it->first.find(key) != std::string::npos ||
+                    it->first.find('*') != std::string::npos)
+                {
+                    resultCacheLru.erase(it->second.lruPosition);
+                    it = resultCache.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        std::vector<int> MPIClient::findServersForQuery(const std::string &queryStr) const
+        {
+            // Determine which servers should receive this query
+            std::vector<int> destinationServerIds = destinationServersCached(queryStr);
+
+            std::cout << "Query: \"" << queryStr << "\" routed to servers: ";
+            for (size_t i = 0; i < destinationServerIds.size(); i++)
+            {
+                if (i > 0)
+                    std::cout << ", ";
+                std::cout << destinationServerIds[i];
+            }
+            std::cout << std::endl;
+
+            return destinationServerIds;
+        }
+
+        int MPIClient::pickReplica(const std::vector<int> &serverIds) const
+        {
+            // Round-robin across the candidates. For now all servers are
+            // assumed healthy; FaultManager status can narrow the set once
+            // the fault path is wired into query routing.
+            return serverIds[replicaCursor++ % serverIds.size()];
+        }
+
+        std::vector<int> MPIClient::md_search(const std::string &queryStr)
+        {
+            auto opStart = std::chrono::steady_clock::now();
+
+            // Interactive clients repeat the same lookups in tight loops;
+            // while a cached answer is fresh it never leaves the client
+            std::vector<int> cached;
+            if (lookupResultCache(queryStr, cached))
+            {
+                std::cout << "Query: \"" << queryStr
+                          << "\" answered from client result cache" << std::endl;
+                searchLatencyHist.record(elapsedNs(opStart));
+                return cached;
+            }
+
+            std::vector<int> results = executeSearch(queryStr);
+            storeResultCache(queryStr, results);
+            searchLatencyHist.record(elapsedNs(opStart));
+            return results;
+        }
+
+        void MPIClient::cancel_md_query(uint64_t requestId)
+        {
+            std::cout << "Cancelling query request " << requestId
+                      << " on all servers" << std::endl;
+
+            // The client does not track which server a request landed
+            // on; the cancel is one small message and servers ignore IDs
+            // they are not running, so every server gets one
+            CancelQueryMessage msg(requestId);
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, QUERY_TAG);
+            }
+        }
+
+        std::vector<uint64_t> MPIClient::inFlightQueries() const
+        {
+            std::lock_guard<std::mutex> lock(inflightMutex);
+            return std::vector<uint64_t>(inflightQueries.begin(),
+                                         inflightQueries.end());
+        }
+
+        std::vector<int> MPIClient::executeSearch(const std::string &queryStr)
+        {
+            if (query::isCountDistinctQuery(queryStr))
+            {
+                // COUNT(DISTINCT key) computes one integer on one replica
+                // of the key; only that integer crosses the wire
+                std::vector<int> distinctServerIds =
+                    router->getServersForKey(query::countDistinctKey(queryStr));
+                if (distinctServerIds.empty())
+                {
+                    return {0};
+                }
+
+                int serverRank = pickReplica(distinctServerIds) + 1;
+                QueryMessage msg(queryStr, router->getRoutingEpoch(), nextRequestId++,
+                                 queryPriority);
+                auto response = queryWithBusyRetry(msg, serverRank);
+                return response.results.empty() ? std::vector<int>{0} : response.results;
+            }
+
+            if (query::isCountQuery(queryStr))
+            {
+                std::string condition = query::countQueryCondition(queryStr);
+
+                size_t pos = condition.find('=');
+                std::string keyPart = pos != std::string::npos ? condition.substr(0, pos) : condition;
+                bool exactKey = !keyPart.empty() && keyPart != "*" &&
+                                keyPart.front() != '*' && keyPart.back() != '*';
+
+                if (exactKey)
+                {
+                    // Every replica of an exact key holds the same postings,
+                    // so one server's count answers for the cluster and only
+                    // a single integer crosses the wire
+                    std::vector<int> countServerIds = findServersForQuery(condition);
+                    if (countServerIds.empty())
+                    {
+                        return {0};
+                    }
+
+                    int serverRank = pickReplica(countServerIds) + 1;
+                    QueryMessage msg(queryStr, router->getRoutingEpoch(), nextRequestId++,
+                                     queryPriority);
+                    auto response = queryWithBusyRetry(msg, serverRank);
+                    return response.results.empty() ? std::vector<int>{0} : response.results;
+                }
+
+                // For now, wildcard-key counts still union the IDs client-side:
+                // per-server counts overlap through replication and cannot be
+                // summed without double counting
+                return {static_cast<int>(md_search(condition).size())};
+            }
+
+            // Route on the bare condition; the full query string (including
+            // any LIMIT modifier) is what each server executes
+            std::string condition;
+            size_t limit = query::parseLimitModifier(queryStr, condition);
+
+            // Find which servers should receive this query; routing is
+            // timed separately so the phase report can attribute the tail
+            auto routingStart = std::chrono::steady_clock::now();
+            std::vector<int> serverIds = findServersForQuery(condition);
+            auto routingEnd = std::chrono::steady_clock::now();
+            phaseRoutingHist.record(elapsedNs(routingStart));
+
+            // Compound conditions route on every condition's key, not just
+            // the first one: a pure conjunction goes to one replica holding
+            // all of its keys so the server-side semi-join can run locally,
+            // anything else fans out to every condition's servers
+            if (condition.find(" AND ") != std::string::npos ||
+                condition.find(" OR ") != std::string::npos)
+            {
+                // Repeated query shapes reuse the cached parse for routing
+                std::shared_ptr<const query::MultiConditionQuery> multiQuery =
+                    query::parsedQuery(condition);
+
+                std::vector<std::vector<int>> conditionServers;
+                for (const query::QueryCondition &cond : multiQuery->getConditions())
+                {
+                    conditionServers.push_back(
+                        destinationServersCached(cond.key + "=" + cond.value));
+                }
+
+                bool pureAnd = true;
+                for (query::LogicalOperator op : multiQuery->getOperators())
+                {
+                    if (op != query::AND)
+                    {
+                        pureAnd = false;
+                        break;
+                    }
+                }
+
+                serverIds.clear();
+                if (pureAnd)
+                {
+                    for (int serverId : conditionServers[0])
+                    {
+                        bool onAll = true;
+                        for (size_t i = 1; i < conditionServers.size() && onAll; i++)
+                        {
+                            onAll = std::find(conditionServers[i].begin(),
+                                              conditionServers[i].end(),
+                                              serverId) != conditionServers[i].end();
+                        }
+                        if (onAll)
+                        {
+                            serverIds.push_back(serverId);
+                        }
+                    }
+                }
+
+                if (pureAnd && !serverIds.empty())
+                {
+                    int chosen = pickReplica(serverIds);
+                    std::cout << "Compound query served by server " << chosen << std::endl;
+                    serverIds.assign(1, chosen);
+                }
+                else
+                {
+                    // OR queries, or a conjunction whose keys share no
+                    // replica: union every condition's servers. For now a
+                    // conjunction split this way can under-report when no
+                    // queried server holds all of its keys.
+                    for (const std::vector<int> &ids : conditionServers)
+                    {
+                        for (int serverId : ids)
+                        {
+                            if (std::find(serverIds.begin(), serverIds.end(),
+                                          serverId) == serverIds.end())
+                            {
+                                serverIds.push_back(serverId);
+                            }
+                        }
+                    }
+                    std::sort(serverIds.begin(), serverIds.end());
+                }
+
+                query::ResultSet compoundResults;
+                for (int serverId : serverIds)
+                {
+                    int serverRank = serverId + 1;
+                    QueryMessage msg(queryStr, router->getRoutingEpoch(), nextRequestId++,
+                                     queryPriority);
+                    auto response = queryWithBusyRetry(msg, serverRank);
+                    compoundResults.unionWith(
+                        query::ResultSet(std::move(response.results)));
+                }
+
+                std::vector<int> merged = compoundResults.takeVector();
+                if (limit > 0 && merged.size() > limit)
+                {
+                    merged.resize(limit);
+                }
+                return merged;
+            }
+
+            // Exact-key conditions are fully replicated, so one replica
+            // holds the complete answer; rotate reads across them so the
+            // replicas actually absorb read traffic
+            size_t eqPos = condition.find('=');
+            std::string keyPart = eqPos != std::string::npos ? condition.substr(0, eqPos) : condition;
+            bool exactKey = !keyPart.empty() && keyPart != "*" &&
+                            keyPart.front() != '*' && keyPart.back() != '*';
+
+            if (exactKey && serverIds.size() > 1)
+            {
+                // One replica holds the complete answer; hedge the read so
+                // a single slow rank cannot set this query's latency
+                auto response = hedgedQuery(queryStr, serverIds);
+
+                std::vector<int> results = std::move(response.results);
+                if (limit > 0 && results.size() > limit)
+                {
+                    results.resize(limit);
+                }
+                return results;
+            }
+
+            // Wide fan-outs (wildcard queries can hit every server) go
+            // through the aggregation tree: intermediate servers merge and
+            // deduplicate, and the client receives a single response
+            if (serverIds.size() > TREE_FANOUT_THRESHOLD)
+            {
+                return treeQueryFanout(queryStr, serverIds, limit);
+            }
+
+            // Send query to selected servers and merge their sorted
+            // results, accumulating per-phase time across the fan-out
+            query::ResultSet resultSet;
+            std::vector<int> handlingServers;
+            uint64_t sendNs = 0, waitNs = 0, mergeNs = 0;
+            uint64_t firstRequestId = 0;
+
+            std::cout << "Servers that can handle the query: ";
+            bool first = true;
+
+            for (int serverId : serverIds)
+            {
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverId + 1;
+
+                // Create and send the message
+                uint64_t requestId = nextRequestId++;
+                if (firstRequestId == 0)
+                {
+                    firstRequestId = requestId;
+                }
+                bool traced = trace::tracer().sampled(requestId);
+
+                QueryMessage msg(queryStr, router->getRoutingEpoch(), requestId,
+                             queryPriority);
+                auto sendStart = std::chrono::steady_clock::now();
+                sendMessage(msg, serverRank, QUERY_TAG);
+                if (traced)
+                {
+                    trace::tracer().record(requestId, "client.send",
+                                           spanNs(sendStart),
+                                           trace::Tracer::now());
+                }
+                sendNs += elapsedNs(sendStart);
+
+                // Wait for response, feeding the latency estimate that
+                // sets this server's hedge delay
+                auto sentAt = std::chrono::steady_clock::now();
+                auto response = receiveResponse(serverRank, RESULT_TAG, requestId);
+                if (traced)
+                {
+                    trace::tracer().record(requestId, "client.wait",
+                                           spanNs(sentAt),
+                                           trace::Tracer::now());
+                }
+                waitNs += elapsedNs(sentAt);
+                recordServerLatency(serverId,
+                                    std::chrono::duration<double, std::milli>(
+                                        std::chrono::steady_clock::now() - sentAt)
+                                        .count());
+
+                // Busy rejection: honor the hint and retry; the retries
+                // run outside the phase timings so the send/wait split
+                // keeps describing the transport, not the backoff
+                if (response.busy)
+                {
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds(response.retryAfterMs));
+                    QueryMessage retryMsg(queryStr, router->getRoutingEpoch(),
+                                          nextRequestId++, queryPriority);
+                    response = queryWithBusyRetry(retryMsg, serverRank);
+                }
+
+                // If we got results, this server could handle the query
+                if (!response.results.empty())
+                {
+                    if (!first)
+                        std::cout << ", ";
+                    std::cout << serverId;
+                    first = false;
+                    handlingServers.push_back(serverId);
+
+                    // Merge results
+                    auto mergeStart = std::chrono::steady_clock::now();
+                    resultSet.unionWith(query::ResultSet(std::move(response.results)));
+                    mergeNs += elapsedNs(mergeStart);
+                }
+            }
+
+            if (first)
+                std::cout << "None";
+            std::cout << std::endl;
+
+            auto mergeStart = std::chrono::steady_clock::now();
+            std::vector<int> results = resultSet.takeVector();
+            mergeNs += elapsedNs(mergeStart);
+
+            // One sample per query for each phase: the MPI wait includes
+            // server execute, which cannot be split off without carrying
+            // timestamps in the wire header
+            phaseSendHist.record(sendNs);
+            phaseWaitHist.record(waitNs);
+            phaseMergeHist.record(mergeNs);
+
+            // Query-level spans join the per-server ones on the first
+            // request ID; merge time is accumulated across the fan-out,
+            // so its span is synthesized backwards from the end mark
+            if (firstRequestId != 0 && trace::tracer().sampled(firstRequestId))
+            {
+                trace::tracer().record(firstRequestId, "client.route",
+                                       spanNs(routingStart), spanNs(routingEnd));
+                uint64_t mergeEnd = trace::Tracer::now();
+                trace::tracer().record(firstRequestId, "client.merge",
+                                       mergeEnd - mergeNs, mergeEnd);
+            }
+
+            // Each server already capped its own results; cap the merged set too
+            if (limit > 0 && results.size() > limit)
+            {
+                results.resize(limit);
+            }
+            return results;
+        }
+
+        std::vector<int> MPIClient::md_search_streaming(const std::string &queryStr,
+                                                        size_t chunkSize)
+        {
+            // Route on the bare condition, as in md_search
+            std::string condition;
+            size_t limit = query::parseLimitModifier(queryStr, condition);
+
+            std::vector<int> serverIds = findServersForQuery(condition);
+
+            // Kick off every server's stream, then merge chunks as they
+            // arrive from any of them
+            StreamQueryMessage msg(queryStr, router->getRoutingEpoch(), chunkSize);
+            for (int serverId : serverIds)
+            {
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                sendMessage(msg, serverId + 1, QUERY_TAG);
+            }
+
+            query::ResultSet resultSet;
+            size_t openStreams = serverIds.size();
+
+            while (openStreams > 0)
+            {
+                MPI_Status status;
+                int msgSize;
+
+                MPI_Probe(MPI_ANY_SOURCE, RESULT_TAG, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+                auto buffer = messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, status.MPI_SOURCE,
+                         RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                if (Message::getType(buffer) == ERROR_RESPONSE)
+                {
+                    auto errorMsg = ErrorResponseMessage::deserialize(buffer);
+                    throw std::runtime_error("Server error: " + errorMsg.errorMessage);
+                }
+
+                auto chunk = ResponseChunkMessage::deserialize(buffer);
+                messageBufferPool().release(std::move(buffer));
+
+                // Incremental merge: each chunk is sorted, so the union
+                // stays a cheap merge of sorted runs
+                if (!chunk.results.empty())
+                {
+                    resultSet.unionWith(query::ResultSet(std::move(chunk.results)));
+                }
+
+                if (chunk.last)
+                {
+                    openStreams--;
+                }
+            }
+
+            std::vector<int> results = resultSet.takeVector();
+
+            // Each server already capped its own results; cap the merged set too
+            if (limit > 0 && results.size() > limit)
+            {
+                results.resize(limit);
+            }
+            return results;
+        }
+
+        std::vector<int> MPIClient::md_search_page(const std::string &queryStr,
+                                                   size_t pageSize, bool &done)
+        {
+            auto it = pagedSearches.find(queryStr);
+            if (it == pagedSearches.end())
+            {
+                PagedSearchState state;
+                state.serverIds = findServersForQuery(queryStr);
+                it = pagedSearches.emplace(queryStr, std::move(state)).first;
+            }
+
+            PagedSearchState &state = it->second;
+            std::vector<int> page;
+
+            // Drain servers in order; a page emptied entirely by the
+            // replica dedupe rolls straight into the next server
+            while (page.empty() && state.serverIndex < state.serverIds.size())
+            {
+                int serverRank = state.serverIds[state.serverIndex] + 1;
+                PagedQueryMessage msg(queryStr, router->getRoutingEpoch(),
+                                      state.serverCursor,
+                                      static_cast<uint32_t>(pageSize),
+                                      nextRequestId++);
+                sendMessage(msg, serverRank, QUERY_TAG);
+
+                MPI_Status status;
+                int msgSize;
+                MPI_Probe(serverRank, RESULT_TAG, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+                auto buffer = messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, serverRank, RESULT_TAG,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                if (Message::getType(buffer) != PAGED_RESPONSE)
+                {
+                    // Error response (e.g. stale epoch): give up on this
+                    // server rather than loop on it
+                    messageBufferPool().release(std::move(buffer));
+                    state.serverIndex++;
+                    state.serverCursor = 0;
+                    continue;
+                }
+
+                auto reply = PagedResponseMessage::deserialize(buffer);
+                messageBufferPool().release(std::move(buffer));
+
+                state.serverCursor = reply.cursor;
+                if (reply.exhausted)
+                {
+                    state.serverIndex++;
+                    state.serverCursor = 0;
+                }
+
+                for (int objectId : reply.results)
+                {
+                    if (state.seen.insert(objectId).second)
+                    {
+                        page.push_back(objectId);
+                    }
+                }
+            }
+
+            done = page.empty() && state.serverIndex >= state.serverIds.size();
+            if (done)
+            {
+                pagedSearches.erase(it);
+            }
+            return page;
+        }
+
+        std::vector<int> MPIClient::treeQueryFanout(const std::string &queryStr,
+                                                    const std::vector<int> &serverIds,
+                                                    size_t limit)
+        {
+            // Lay the destination servers out as a binary heap: node i's
+            // children are 2i+1 and 2i+2, the root's parent is the client
+            size_t n = serverIds.size();
+
+            std::cout << "Query fan-out to " << n
+                      << " servers via aggregation tree rooted at server "
+                      << serverIds[0] << std::endl;
+
+            uint64_t epoch = router->getRoutingEpoch();
+
+            for (size_t i = 0; i < n; i++)
+            {
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                int serverRank = serverIds[i] + 1;
+                int parentRank = i == 0 ? 0 : serverIds[(i - 1) / 2] + 1;
+
+                std::vector<int> childRanks;
+                if (2 * i + 1 < n)
+                {
+                    childRanks.push_back(serverIds[2 * i + 1] + 1);
+                }
+                if (2 * i + 2 < n)
+                {
+                    childRanks.push_back(serverIds[2 * i + 2] + 1);
+                }
+
+                TreeQueryMessage msg(queryStr, epoch, parentRank, childRanks);
+                sendMessage(msg, serverRank, QUERY_TAG);
+            }
+
+            // The root delivers the fully merged, deduplicated result set
+            int rootRank = serverIds[0] + 1;
+            auto response = receiveResponse(rootRank, RESULT_TAG);
+
+            std::vector<int> results = std::move(response.results);
+
+            // Each server already capped its own results; cap the merged set too
+            if (limit > 0 && results.size() > limit)
+            {
+                results.resize(limit);
+            }
+            return results;
+        }
+
+        void MPIClient::checkpointAllIndices()
+        {
+            std::cout << "Checkpointing indices to disk..." << std::endl;
+
+            // Send checkpoint command to all servers
+            AdminMessage msg(CHECKPOINT);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to checkpoint index on server " << (i - 1) << std::endl;
+                }
+            }
+
+            std::cout << "Checkpoint complete." << std::endl;
+        }
+
+        void MPIClient::checkpointAllIndicesAsync()
+        {
+            std::cout << "Starting asynchronous checkpoint on all servers..." << std::endl;
+
+            // Send async checkpoint command to all servers; each one returns
+            // as soon as its state is frozen and writes to disk in the
+            // background
+            AdminMessage msg(CHECKPOINT_ASYNC);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to start async checkpoint on server " << (i - 1) << std::endl;
+                }
+            }
+        }
+
+        bool MPIClient::allCheckpointsComplete()
+        {
+            // Poll every server's checkpoint status; a server reports
+            // success only once its background writer has finished cleanly
+            AdminMessage msg(CHECKPOINT_STATUS);
+            bool allComplete = true;
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    allComplete = false;
+                }
+            }
+
+            return allComplete;
+        }
+
+        bool MPIClient::checkpointAllIndicesCoordinated()
+        {
+            // Stamp a single epoch for the whole set so every server's
+            // manifest names the same checkpoint
+            uint64_t checkpointEpoch = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count());
+
+            std::cout << "Coordinated checkpoint epoch " << checkpointEpoch
+                      << " starting..." << std::endl;
+
+            // Phase 1: broadcast the prepare to every server before
+            // collecting any acknowledgement, so all image writes overlap
+            CoordinatedCheckpointMessage prepare(
+                checkpointEpoch, CoordinatedCheckpointMessage::PHASE_PREPARE);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(prepare, i, ADMIN_TAG);
+            }
+
+            bool allPrepared = true;
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to prepare coordinated checkpoint on server "
+                              << (i - 1) << std::endl;
+                    allPrepared = false;
+                }
+            }
+
+            if (!allPrepared)
+            {
+                // Leave the manifests pending: recovery will report the
+                // incomplete set instead of claiming a consistent one
+                std::cerr << "Coordinated checkpoint epoch " << checkpointEpoch
+                          << " aborted before commit" << std::endl;
+                return false;
+            }
+
+            // Phase 2: every image is on disk, promote the manifests
+            CoordinatedCheckpointMessage commit(
+                checkpointEpoch, CoordinatedCheckpointMessage::PHASE_COMMIT);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(commit, i, ADMIN_TAG);
+            }
+
+            bool allCommitted = true;
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to commit coordinated checkpoint on server "
+                              << (i - 1) << std::endl;
+                    allCommitted = false;
+                }
+            }
+
+            if (allCommitted)
+            {
+                std::cout << "Coordinated checkpoint epoch " << checkpointEpoch
+                          << " committed on all servers." << std::endl;
+            }
+
+            return allCommitted;
+        }
+
+        void MPIClient::publishEpochUpdate()
+        {
+            EpochUpdateMessage msg(router->getRoutingEpoch(), router->getDownServers());
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                if (router->isServerDown(i - 1))
+                {
+                    continue;
+                }
+
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to publish epoch update to server " << (i - 1) << std::endl;
+                }
+            }
+        }
+
+        void MPIClient::reportServerFailure(int serverId)
+        {
+            if (router->isServerDown(serverId))
+            {
+                return; // Already known down; nothing new to publish
+            }
+
+            std::cout << "Reporting server " << serverId << " as failed" << std::endl;
+
+            // Marking the server down bumps the epoch; routing skips it from
+            // now on, so reads land on replicas without waiting for timeouts
+            router->markServerDown(serverId);
+            publishEpochUpdate();
+        }
+
+        void MPIClient::reReplicateFailedServer(int serverId)
+        {
+            if (!router->isServerDown(serverId))
+            {
+                // Re-replication only makes sense for a confirmed-down server
+                reportServerFailure(serverId);
+            }
+
+            // Hand the failed server's vnodes to surviving owners; the
+            // epoch bump travels with the down-server set so cached routing
+            // goes stale everywhere
+            std::vector<VnodeMigration> migrations = router->reassignServerVnodes(serverId);
+            publishEpochUpdate();
+
+            if (migrations.empty())
+            {
+                return;
+            }
+
+            // Every survivor may hold replica copies of any orphaned vnode,
+            // so each one gets the full (vnode -> new owner) plan, minus the
+            // vnodes it now owns itself; the sources then export and stream
+            // their shards concurrently
+            std::vector<int> sources;
+            int numServers = worldSize - 1;
+            for (int sourceId = 0; sourceId < numServers; sourceId++)
+            {
+                if (sourceId == serverId || router->isServerDown(sourceId))
+                {
+                    continue;
+                }
+
+                ReplicateVnodesMessage msg;
+                for (const VnodeMigration &migration : migrations)
+                {
+                    if (migration.toServer != sourceId)
+                    {
+                        msg.addVnode(migration.vnodeId, migration.toServer);
+                    }
+                }
+
+                if (msg.vnodeCount() == 0)
+                {
+                    continue;
+                }
+
+                std::cout << "Re-replicating " << msg.vnodeCount()
+                          << " vnodes from server " << sourceId << std::endl;
+
+                // Send to every source before collecting any ack, so the
+                // exports and shard streams overlap across servers
+                sendMessage(msg, sourceId + 1, FAULT_TAG);
+                sources.push_back(sourceId);
+            }
+
+            for (int sourceId : sources)
+            {
+                auto response = receiveResponse(sourceId + 1, RESULT_TAG);
+                if (!response.success)
+                {
+                    std::cerr << "Re-replication from server " << sourceId
+                              << " failed" << std::endl;
+                }
+            }
+
+            std::cout << "Re-replication of server " << serverId
+                      << "'s vnodes complete" << std::endl;
+        }
+
+        bool MPIClient::bootstrapServerFromSnapshot(int sourceServerId, int targetServerId,
+                                                    const std::vector<uint32_t> &vnodeIds)
+        {
+            std::cout << "Bootstrapping server " << targetServerId << " from server "
+                      << sourceServerId << " (" << vnodeIds.size() << " vnodes)"
+                      << std::endl;
+
+            // The source streams chunks straight to the target; this call
+            // only waits for the source's "image on the wire" ack, the
+            // delta catch-up then runs between the servers themselves
+            SnapshotRequestMessage msg(targetServerId, vnodeIds);
+            sendMessage(msg, sourceServerId + 1, FAULT_TAG);
+
+            auto response = receiveResponse(sourceServerId + 1, RESULT_TAG);
+            if (!response.success)
+            {
+                std::cerr << "Snapshot transfer from server " << sourceServerId
+                          << " failed" << std::endl;
+            }
+            return response.success;
+        }
+
+        void MPIClient::reportServerRecovery(int serverId)
+        {
+            if (!router->isServerDown(serverId))
+            {
+                return;
+            }
+
+            std::cout << "Reporting server " << serverId << " as recovered" << std::endl;
+
+            router->markServerUp(serverId);
+            publishEpochUpdate();
+
+            // Trigger delta catch-up: the rejoining server asks its peers
+            // for only the records streamed past its last applied
+            // sequence, so a brief partition costs seconds, not a resync
+            AdminMessage catchUp(CATCH_UP);
+            sendMessage(catchUp, serverId + 1, ADMIN_TAG);
+
+            auto response = receiveResponse(serverId + 1, ADMIN_TAG);
+            if (response.success)
+            {
+                std::cout << "Server " << serverId << " requested catch-up deltas"
+                          << std::endl;
+            }
+        }
+
+        void MPIClient::printLatencyReport() const
+        {
+            std::cout << "===== Client Latency Report =====" << std::endl;
+            searchLatencyHist.printSummary("search");
+            writeLatencyHist.printSummary("write");
+
+            if (searchLatencyHist.count() > 0)
+            {
+                searchLatencyHist.printSpectrum("search");
+            }
+
+            std::cout << "--- Search phases (MPI wait includes server execute) ---"
+                      << std::endl;
+            phaseRoutingHist.printSummary("routing");
+            phaseSendHist.printSummary("serialize+send");
+            phaseWaitHist.printSummary("MPI wait");
+            phaseMergeHist.printSummary("merge");
+        }
+
+        ServerStats MPIClient::getServerStats(int serverId)
+        {
+            int serverRank = serverId + 1;
+            AdminMessage msg(STATS);
+            sendMessage(msg, serverRank, ADMIN_TAG);
+
+            MPI_Status status;
+            int msgSize;
+            MPI_Probe(serverRank, ADMIN_TAG, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+            auto buffer = messageBufferPool().acquire(msgSize);
+            buffer.resize(msgSize);
+            MPI_Recv(buffer.data(), msgSize, MPI_CHAR, serverRank, ADMIN_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            auto reply = ServerStatsMessage::deserialize(buffer);
+            messageBufferPool().release(std::move(buffer));
+
+            return reply.stats;
+        }
+
+        KeyStatistics MPIClient::md_key_stats(const std::string &key)
+        {
+            std::vector<int> serverIds = router->getServersForKey(key);
+            if (serverIds.empty())
+            {
+                return {};
+            }
+
+            int serverRank = serverIds[0] + 1;
+            KeyStatsRequestMessage msg(key);
+            sendMessage(msg, serverRank, ADMIN_TAG);
+
+            MPI_Status status;
+            int msgSize;
+            MPI_Probe(serverRank, ADMIN_TAG, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+            auto buffer = messageBufferPool().acquire(msgSize);
+            buffer.resize(msgSize);
+            MPI_Recv(buffer.data(), msgSize, MPI_CHAR, serverRank, ADMIN_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            auto reply = KeyStatsResponseMessage::deserialize(buffer);
+            messageBufferPool().release(std::move(buffer));
+
+            KeyStatistics stats;
+            stats.records = reply.records;
+            stats.distinctValues = reply.distinctValues;
+            stats.sampleValues = std::move(reply.sampleValues);
+            return stats;
+        }
+
+        void MPIClient::printClusterStats()
+        {
+            // Mean in microseconds, guarding the empty case
+            auto meanUs = [](uint64_t totalNs, uint64_t count) -> double
+            {
+                return count == 0 ? 0.0 : (double)totalNs / count / 1000.0;
+            };
+
+            std::cout << "===== Cluster Statistics =====" << std::endl;
+
+            for (int serverId = 0; serverId < worldSize - 1; serverId++)
+            {
+                if (router->isServerDown(serverId))
+                {
+                    std::cout << "Server " << serverId << ": down" << std::endl;
+                    continue;
+                }
+
+                ServerStats s = getServerStats(serverId);
+
+                std::cout << "Server " << serverId << ":" << std::endl;
+                std::cout << "  queries: exact " << s.exactQueries
+                          << " (" << meanUs(s.exactLatencyNs, s.exactQueries)
+                          << " us), prefix " << s.prefixQueries
+                          << " (" << meanUs(s.prefixLatencyNs, s.prefixQueries)
+                          << " us), suffix " << s.suffixQueries
+                          << " (" << meanUs(s.suffixLatencyNs, s.suffixQueries)
+                          << " us), infix " << s.infixQueries
+                          << " (" << meanUs(s.infixLatencyNs, s.infixQueries)
+                          << " us), wildcard " << s.wildcardQueries
+                          << " (" << meanUs(s.wildcardLatencyNs, s.wildcardQueries)
+                          << " us)" << std::endl;
+                std::cout << "  index: " << s.keyTrieNodes << " key nodes, "
+                          << s.valueTrieNodes << " value nodes, ~"
+                          << (s.indexMemoryBytes / 1024) << " KB" << std::endl;
+                std::cout << "  postings: " << s.postingLists << " lists, "
+                          << s.postingEntries << " entries, largest "
+                          << s.maxPostingEntries << std::endl;
+                std::cout << "  memory: arena " << (s.trieArenaBytes / 1024)
+                          << " KB, suffix index " << (s.suffixIndexBytes / 1024)
+                          << " KB, metadata " << (s.metadataBytes / 1024)
+                          << " KB, pooled buffers " << (s.messageBufferBytes / 1024)
+                          << " KB" << std::endl;
+                std::cout << "  lock wait: " << (s.lockWaitNs / 1000000)
+                          << " ms total" << std::endl;
+                std::cout << "  checkpoints: " << s.checkpointCount
+                          << " (last " << s.lastCheckpointMs << " ms, total "
+                          << s.totalCheckpointMs << " ms)" << std::endl;
+            }
+        }
+
+        void MPIClient::recoverAllIndices()
+        {
+            std::cout << "Recovering indices from disk..." << std::endl;
+
+            // Send recover command to all servers
+            AdminMessage msg(RECOVER);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // Wait for response
+                auto response = receiveResponse(i, ADMIN_TAG);
+
+                if (!response.success)
+                {
+                    std::cerr << "Failed to recover index on server " << (i - 1) << std::endl;
+                }
+            }
+
+            std::cout << "Recovery complete." << std::endl;
+        }
+
+        void MPIClient::shutdownAllServers()
+        {
+            std::cout << "Shutting down all servers..." << std::endl;
+
+            // Send shutdown command to all servers
+            AdminMessage msg(SHUTDOWN);
+
+            for (int i = 1; i < worldSize; i++)
+            { // Skip rank 0 (client)
+                sendMessage(msg, i, ADMIN_TAG);
+
+                // No need to wait for response
+            }
+
+            // Each server dumps its spans on the way down; do the same here
+            if (trace::tracer().enabled())
+            {
+                trace::tracer().dump("trace_rank" + std::to_string(rank) + ".log");
+            }
+        }
+
+        void MPIClient::shutdownServer(int serverId)
+        {
+            std::cout << "Shutting down server " << serverId << std::endl;
+
+            // Fire and forget, like shutdownAllServers: a stopping (or
+            // crashed) server may never answer
+            AdminMessage msg(SHUTDOWN);
+            sendMessage(msg, serverId + 1, ADMIN_TAG);
+        }
+
+        bool MPIClient::pingServer(int serverId, double timeoutMs)
+        {
+            // A checkpoint-status request is the cheapest admin round
+            // trip: handled inline on the dispatch thread, so the answer
+            // measures liveness rather than worker-pool depth
+            AdminMessage msg(CHECKPOINT_STATUS);
+            sendMessage(msg, serverId + 1, ADMIN_TAG);
+
+            auto deadline = std::chrono::steady_clock::now() +
+                            std::chrono::duration<double, std::milli>(timeoutMs);
+            while (std::chrono::steady_clock::now() < deadline)
+            {
+                int pending = 0;
+                MPI_Iprobe(serverId + 1, ADMIN_TAG, MPI_COMM_WORLD, &pending,
+                           MPI_STATUS_IGNORE);
+                if (pending)
+                {
+                    receiveResponse(serverId + 1, ADMIN_TAG);
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            return false;
+        }
+
+        int MPIClient::md_subscribe(const std::string &queryStr, std::vector<int> &initialResults)
+        {
+            initialResults.clear();
+
+            // Route like a one-shot read: a pure conjunction registers on
+            // one replica holding every condition's key so the server-side
+            // semi-join can keep the membership current locally
+            std::vector<int> serverIds;
+            if (queryStr.find(" AND ") != std::string::npos ||
+                queryStr.find(" OR ") != std::string::npos)
+            {
+                std::shared_ptr<const query::MultiConditionQuery> multiQuery =
+                    query::parsedQuery(queryStr);
+
+                bool pureAnd = true;
+                for (query::LogicalOperator op : multiQuery->getOperators())
+                {
+                    if (op != query::AND)
+                    {
+                        pureAnd = false;
+                        break;
+                    }
+                }
+
+                for (const query::QueryCondition &cond : multiQuery->getConditions())
+                {
+                    std::vector<int> condServers =
+                        destinationServersCached(cond.key + "=" + cond.value);
+
+                    if (serverIds.empty())
+                    {
+                        serverIds = condServers;
+                    }
+                    else if (pureAnd)
+                    {
+                        std::vector<int> kept;
+                        for (int serverId : serverIds)
+                        {
+                            if (std::find(condServers.begin(), condServers.end(),
+                                          serverId) != condServers.end())
+                            {
+                                kept.push_back(serverId);
+                            }
+                        }
+                        serverIds.swap(kept);
+                    }
+                }
+
+                // For now an OR subscription lives on the first condition's
+                // replica and misses matches held only elsewhere, the same
+                // caveat as split compound reads
+            }
+            else
+            {
+                serverIds = findServersForQuery(queryStr);
+            }
+
+            if (serverIds.empty())
+            {
+                return -1;
+            }
+
+            int serverRank = pickReplica(serverIds) + 1;
+            SubscribeQueryMessage msg(queryStr, nextRequestId++);
+            sendMessage(msg, serverRank, QUERY_TAG);
+
+            // The registration reply is itself a notification, with added
+            // carrying the initial matches
+            MPI_Status status;
+            int msgSize;
+            MPI_Probe(serverRank, RESULT_TAG, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+            auto buffer = messageBufferPool().acquire(msgSize);
+            buffer.resize(msgSize);
+            MPI_Recv(buffer.data(), msgSize, MPI_CHAR, serverRank, RESULT_TAG,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            if (shm && Message::getType(buffer) == SHM_PAYLOAD)
+            {
+                auto descriptor = ShmPayloadMessage::deserialize(buffer);
+                messageBufferPool().release(std::move(buffer));
+                buffer = shm->fetchPayload(serverRank, descriptor.slot);
+            }
+
+            auto reply = QueryNotifyMessage::deserialize(buffer);
+            messageBufferPool().release(std::move(buffer));
+
+            initialResults = std::move(reply.added);
+
+            std::cout << "Subscribed to \"" << queryStr << "\" on server "
+                      << (serverRank - 1) << " as subscription "
+                      << reply.subscriptionId << std::endl;
+
+            return reply.subscriptionId;
+        }
+
+        std::vector<QueryNotifyMessage> MPIClient::md_poll_notifications()
+        {
+            std::vector<QueryNotifyMessage> notifications;
+
+            // Drain whatever the servers have pushed; never block
+            while (true)
+            {
+                int pending = 0;
+                MPI_Status status;
+                MPI_Iprobe(MPI_ANY_SOURCE, NOTIFY_TAG, MPI_COMM_WORLD, &pending, &status);
+                if (!pending)
+                {
+                    break;
+                }
+
+                int msgSize;
+                MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+                auto buffer = messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, status.MPI_SOURCE,
+                         NOTIFY_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                notifications.push_back(QueryNotifyMessage::deserialize(buffer));
+                messageBufferPool().release(std::move(buffer));
+            }
+
+            return notifications;
+        }
+
+        void MPIClient::recordServerLatency(int serverId, double elapsedMs)
+        {
+            std::lock_guard<std::mutex> lock(latencyMutex);
+            ServerLatency &stats = serverLatency[serverId];
+
+            if (!stats.seeded)
+            {
+                stats.ewmaMs = elapsedMs;
+                stats.ewmaDevMs = elapsedMs / 2.0;
+                stats.seeded = true;
+                return;
+            }
+
+            double deviation = std::fabs(elapsedMs - stats.ewmaMs);
+            stats.ewmaMs += LATENCY_EWMA_ALPHA * (elapsedMs - stats.ewmaMs);
+            stats.ewmaDevMs += LATENCY_EWMA_ALPHA * (deviation - stats.ewmaDevMs);
+        }
+
+        double MPIClient::hedgeDelayMs(int serverId) const
+        {
+            std::lock_guard<std::mutex> lock(latencyMutex);
+            const ServerLatency &stats = serverLatency[serverId];
+
+            if (!stats.seeded)
+            {
+                return DEFAULT_HEDGE_DELAY_MS;
+            }
+
+            // Mean plus four deviations sits near the tail of the observed
+            // distribution without keeping a histogram
+            return std::max(MIN_HEDGE_DELAY_MS, stats.ewmaMs + 4.0 * stats.ewmaDevMs);
+        }
+
+        ResponseMessage MPIClient::hedgedQuery(const std::string &queryStr,
+                                               const std::vector<int> &replicaIds)
+        {
+            // Both sends carry the same request ID: whichever replica
+            // answers first wins, and the loser's late echo is discarded
+            // by the next filtered receive from that rank
+            uint64_t requestId = nextRequestId++;
+            QueryMessage msg(queryStr, router->getRoutingEpoch(), requestId,
+                             queryPriority);
+
+            int primary = pickReplica(replicaIds);
+            double delayMs = hedgeDelayMs(primary);
+
+            std::cout << "Read served by replica on server " << primary
+                      << " (hedge after " << delayMs << " ms)" << std::endl;
+
+            // Replicas queried so far and when each was asked
+            std::vector<std::pair<int, std::chrono::steady_clock::time_point>> queried;
+
+            sendMessage(msg, primary + 1, QUERY_TAG);
+            queried.push_back({primary, std::chrono::steady_clock::now()});
+
+            while (true)
+            {
+                // Take the first arrived response from any queried replica
+                for (const auto &[serverId, sentAt] : queried)
+                {
+                    int pending = 0;
+                    MPI_Status status;
+                    MPI_Iprobe(serverId + 1, RESULT_TAG, MPI_COMM_WORLD, &pending, &status);
+                    if (!pending)
+                    {
+                        continue;
+                    }
+
+                    auto response = receiveResponse(serverId + 1, RESULT_TAG, requestId);
+                    recordServerLatency(serverId,
+                                        std::chrono::duration<double, std::milli>(
+                                            std::chrono::steady_clock::now() - sentAt)
+                                            .count());
+
+                    // A busy replica declines the race; stop hedging and
+                    // retry the primary with the server's backoff hint
+                    if (response.busy)
+                    {
+                        std::this_thread::sleep_for(
+                            std::chrono::milliseconds(response.retryAfterMs));
+                        QueryMessage retryMsg(queryStr, router->getRoutingEpoch(),
+                                              nextRequestId++, queryPriority);
+                        return queryWithBusyRetry(retryMsg, primary + 1);
+                    }
+                    return response;
+                }
+
+                // Past the primary's hedge delay with no answer: ask one
+                // more replica and race the two
+                double waitedMs = std::chrono::duration<double, std::milli>(
+                                      std::chrono::steady_clock::now() - queried[0].second)
+                                      .count();
+                if (waitedMs > delayMs && queried.size() == 1)
+                {
+                    for (int serverId : replicaIds)
+                    {
+                        bool alreadyQueried = false;
+                        for (const auto &[queriedId, sentAt] : queried)
+                        {
+                            if (queriedId == serverId)
+                            {
+                                alreadyQueried = true;
+                                break;
+                            }
+                        }
+                        if (alreadyQueried)
+                        {
+                            continue;
+                        }
+
+                        std::cout << "Hedging read to server " << serverId
+                                  << " after " << waitedMs << " ms" << std::endl;
+                        sendMessage(msg, serverId + 1, QUERY_TAG);
+                        queried.push_back({serverId, std::chrono::steady_clock::now()});
+                        break;
+                    }
+                }
+
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+
+        void MPIClient::sendMessage(const Message &msg, int destRank, int tag)
+        {
+            // Serialize the message
+            auto buffer = msg.serialize();
+
+            // Co-located servers get the payload through shared memory;
+            // only a slot descriptor crosses the MPI transport
+            if (shm && shm->isLocal(destRank) &&
+                buffer.size() <= ShmTransport::maxPayloadBytes())
+            {
+                ShmPayloadMessage descriptor(shm->stagePayload(buffer));
+                auto descBuffer = descriptor.serialize();
+                MPI_Send(descBuffer.data(), descBuffer.size(), MPI_CHAR,
+                         destRank, tag, MPI_COMM_WORLD);
+                messageBufferPool().release(std::move(descBuffer));
+                messageBufferPool().release(std::move(buffer));
+                return;
+            }
+
+            // Servers receive through a ring of pre-posted slots; a message
+            // too big for a slot goes out as a notice plus OVERSIZE_TAG
+            // payload, sent under one lock so pairs from concurrent client
+            // instances in this process cannot interleave
+            if (buffer.size() > CHANNEL_SLOT_BYTES)
+            {
+                static std::mutex oversizeSendMutex;
+
+                LargePayloadMessage notice(buffer.size());
+                auto noticeBuffer = notice.serialize();
+
+                {
+                    std::lock_guard<std::mutex> lock(oversizeSendMutex);
+                    MPI_Send(noticeBuffer.data(), noticeBuffer.size(), MPI_CHAR,
+                             destRank, tag, MPI_COMM_WORLD);
+                    MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank,
+                             OVERSIZE_TAG, MPI_COMM_WORLD);
+                }
+
+                messageBufferPool().release(std::move(noticeBuffer));
+                messageBufferPool().release(std::move(buffer));
+                return;
+            }
+
+            // Send the message and recycle the buffer
+            MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank, tag, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
+        }
+
+        ResponseMessage MPIClient::receiveResponse(int sourceRank, int tag,
+                                                   uint64_t expectedRequestId)
+        {
+            // While this wait blocks, the request is in flight and a
+            // watchdog thread can cancel it by name; the guard keeps the
+            // registry honest on every exit, including the error throw
+            struct InflightGuard
+            {
+                MPIClient &client;
+                uint64_t id;
+
+                InflightGuard(MPIClient &c, uint64_t requestId)
+                    : client(c), id(requestId)
+                {
+                    if (id != 0)
+                    {
+                        std::lock_guard<std::mutex> lock(client.inflightMutex);
+                        client.inflightQueries.insert(id);
+                    }
+                }
+
+                ~InflightGuard()
+                {
+                    if (id != 0)
+                    {
+                        std::lock_guard<std::mutex> lock(client.inflightMutex);
+                        client.inflightQueries.erase(id);
+                    }
+                }
+            } inflightGuard(*this, expectedRequestId);
+
+            while (true)
+            {
+                MPI_Status status;
+                int msgSize;
+
+                // Probe for the message size
+                MPI_Probe(sourceRank, tag, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_CHAR, &msgSize);
+
+                // Receive the message into a pooled buffer
+                auto buffer = messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, sourceRank, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                // A descriptor means the real message is in shared memory
+                if (shm && Message::getType(buffer) == SHM_PAYLOAD)
+                {
+                    auto descriptor = ShmPayloadMessage::deserialize(buffer);
+                    messageBufferPool().release(std::move(buffer));
+                    buffer = shm->fetchPayload(sourceRank, descriptor.slot);
+                }
+
+                // Check if it's an error response
+                MessageType type = Message::getType(buffer);
+                if (type == ERROR_RESPONSE)
+                {
+                    auto errorMsg = ErrorResponseMessage::deserialize(buffer);
+                    throw std::runtime_error("Server error: " + errorMsg.errorMessage);
+                }
+
+                // Admission-control rejection: surface it as an empty
+                // response flagged busy so callers can honor the hint
+                if (type == BUSY_RESPONSE)
+                {
+                    auto busyMsg = BusyResponseMessage::deserialize(buffer);
+                    messageBufferPool().release(std::move(buffer));
+
+                    if (expectedRequestId != 0 && busyMsg.requestId != 0 &&
+                        busyMsg.requestId != expectedRequestId)
+                    {
+                        continue; // A late hedge's rejection; drop it
+                    }
+
+                    ResponseMessage rejected;
+                    rejected.success = false;
+                    rejected.busy = true;
+                    rejected.retryAfterMs = busyMsg.retryAfterMs;
+                    rejected.requestId = busyMsg.requestId;
+                    return rejected;
+                }
+
+                // Deserialize the response, then recycle the buffer
+                auto response = ResponseMessage::deserialize(buffer);
+                messageBufferPool().release(std::move(buffer));
+
+                // A mismatched echo is the late answer of a hedged read
+                // that another replica already won; drop it and wait on
+                if (expectedRequestId != 0 && response.requestId != 0 &&
+                    response.requestId != expectedRequestId)
+                {
+                    continue;
+                }
+
+                return response;
+            }
         }
 
     } // namespace mpi
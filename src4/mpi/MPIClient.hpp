@@ -4,9 +4,18 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
 #include <mpi.h>
+#include "../benchmark/LatencyHistogram.hpp"
 #include "../dart/DART.hpp"
+#include "../server/Server.hpp"
 #include "MPICommon.hpp"
+#include "ShmTransport.hpp"
 
 namespace idioms
 {
@@ -25,15 +34,224 @@ namespace idioms
             bool useSuffixTreeMode;             // Whether to use suffix tree mode
             std::shared_ptr<DARTRouter> router; // DART router for query routing
 
+            // Shared-memory fast path for co-located servers (optional)
+            std::unique_ptr<ShmTransport> shm;
+
             // Send a message to a server
             void sendMessage(const Message &msg, int destRank, int tag);
 
-            // Receive a response from a server
-            ResponseMessage receiveResponse(int sourceRank, int tag);
+            // Receive a response from a server. A nonzero
+            // expectedRequestId discards responses carrying a different
+            // echo — the late answers of hedged reads that already won.
+            ResponseMessage receiveResponse(int sourceRank, int tag,
+                                            uint64_t expectedRequestId = 0);
 
             // Find servers that can handle a query
             std::vector<int> findServersForQuery(const std::string &queryStr) const;
 
+            /**
+             * One cached routing decision, valid while the routing epoch
+             * it was computed under is still current
+             */
+            struct RoutingCacheEntry
+            {
+                uint64_t epoch;
+                std::vector<int> servers;
+            };
+
+            // Distinct query shapes a client keeps routing decisions for;
+            // the cache is simply cleared when it fills
+            static const size_t ROUTING_CACHE_CAPACITY = 1024;
+
+            // Routing cache keyed by the bare condition. Interactive
+            // clients repeat the same lookups in tight loops; the DART
+            // hash walk runs once per shape per epoch instead of per call.
+            mutable std::unordered_map<std::string, RoutingCacheEntry> routingCache;
+
+            // Destination servers for a condition, served from the routing
+            // cache when the epoch still matches
+            std::vector<int> destinationServersCached(const std::string &queryStr) const;
+
+            // Result cache bounds: entries older than the TTL are misses,
+            // and the least recently used entry is evicted at capacity
+            static constexpr double RESULT_CACHE_TTL_MS = 2000.0;
+            static const size_t RESULT_CACHE_CAPACITY = 256;
+
+            /**
+             * One cached query answer with its fill time and recency slot
+             */
+            struct ResultCacheEntry
+            {
+                std::chrono::steady_clock::time_point storedAt;
+                std::vector<int> results;
+                std::list<std::string>::iterator lruPosition;
+            };
+
+            // TTL'd LRU of full query answers, keyed by query string.
+            // Writes issued by this client invalidate covering entries;
+            // other clients' writes are only seen after the TTL.
+            mutable std::unordered_map<std::string, ResultCacheEntry> resultCache;
+            mutable std::list<std::string> resultCacheLru; // Most recent at front
+
+            // Look up a query in the result cache; true on a fresh hit
+            bool lookupResultCache(const std::string &queryStr, std::vector<int> &results);
+
+            // Store a query answer in the result cache
+            void storeResultCache(const std::string &queryStr, const std::vector<int> &results);
+
+            // Drop cached answers a write to this key could change
+            void invalidateResultCache(const std::string &key);
+
+            // md_search body behind the result cache
+            std::vector<int> executeSearch(const std::string &queryStr);
+
+            // One in-progress paged search: the servers left to drain, the
+            // cursor into the current one, and the IDs already returned so
+            // replica copies answered by several servers dedupe
+            struct PagedSearchState
+            {
+                std::vector<int> serverIds;
+                size_t serverIndex = 0;
+                uint64_t serverCursor = 0;
+                std::unordered_set<int> seen;
+            };
+            std::unordered_map<std::string, PagedSearchState> pagedSearches;
+
+            // Rotates exact-key reads across replicas so replication buys
+            // read throughput instead of only durability
+            mutable uint64_t replicaCursor = 0;
+
+            // Pick one replica from a candidate set, round-robin
+            int pickReplica(const std::vector<int> &serverIds) const;
+
+            // Monotonic ID stamped on queries and echoed by the server,
+            // so responses finished out of order by its worker pool can
+            // be matched to their requests
+            uint64_t nextRequestId = 1;
+
+            // Request IDs this client is currently blocked waiting on,
+            // registered by receiveResponse, so a watchdog thread can
+            // name a stuck query in a cancel
+            mutable std::mutex inflightMutex;
+            std::unordered_set<uint64_t> inflightQueries;
+
+            // Priority class stamped on outgoing queries (see
+            // QueryPriority); batch consumers set it via setQueryPriority
+            uint8_t queryPriority = PRIORITY_INTERACTIVE;
+
+            // How many times a busy-rejected query is resent before the
+            // client gives up and returns what it has
+            static const int BUSY_RETRY_LIMIT = 3;
+
+            // Send a query and wait for its response, honoring busy
+            // rejections: back off for the server's hint and resend under
+            // a fresh request ID, up to BUSY_RETRY_LIMIT times
+            ResponseMessage queryWithBusyRetry(QueryMessage msg, int serverRank);
+
+            /**
+             * Per-server response-time estimate, updated on every matched
+             * response: an EWMA of the latency and of its deviation, the
+             * same smoothing a TCP RTO uses
+             */
+            struct ServerLatency
+            {
+                double ewmaMs = 0.0;
+                double ewmaDevMs = 0.0;
+                bool seeded = false;
+            };
+
+            // Smoothing factor for the latency estimates
+            static constexpr double LATENCY_EWMA_ALPHA = 0.2;
+
+            // Hedge delay before any latency has been observed, and the
+            // floor under the adaptive delay
+            static constexpr double DEFAULT_HEDGE_DELAY_MS = 5.0;
+            static constexpr double MIN_HEDGE_DELAY_MS = 0.5;
+
+            mutable std::mutex latencyMutex;
+            mutable std::vector<ServerLatency> serverLatency;
+
+            // Record one observed response time for a server
+            void recordServerLatency(int serverId, double elapsedMs);
+
+            // Delay before hedging a read to another replica: roughly the
+            // tail of the server's observed response-time distribution
+            double hedgeDelayMs(int serverId) const;
+
+            // Send a query to one replica and, if it is slower than its
+            // hedge delay, to a second; the first response wins
+            ResponseMessage hedgedQuery(const std::string &queryStr,
+                                        const std::vector<int> &replicaIds);
+
+            // Push the current epoch and down-server set to every server
+            // that is still up
+            void publishEpochUpdate();
+
+            // One nonblocking operation in flight: the send and the matching
+            // receive, plus the buffers MPI is still reading/writing
+            struct AsyncOp
+            {
+                std::vector<char> sendBuffer;
+                std::vector<char> recvBuffer;
+                MPI_Request sendRequest;
+                MPI_Request recvRequest;
+                int serverId;
+
+                // Fulfilled with the ack's verdict when the operation is
+                // reaped; null for fire-and-forget operations
+                std::shared_ptr<std::promise<bool>> ackPromise;
+            };
+
+            // Acks are tiny; query results can be large
+            static constexpr int ASYNC_ACK_BUFFER_BYTES = 4096;
+            static constexpr int ASYNC_RESULT_BUFFER_BYTES = 1 << 20;
+
+            // Fan-outs wider than this use the aggregation tree, where
+            // intermediate servers merge results instead of the client
+            // receiving one response per server
+            static constexpr size_t TREE_FANOUT_THRESHOLD = 4;
+
+            // Run a query through a binary aggregation tree over the
+            // destination servers; the client receives one merged response
+            // from the root
+            std::vector<int> treeQueryFanout(const std::string &queryStr,
+                                             const std::vector<int> &serverIds,
+                                             size_t limit);
+
+            // In-flight async index operations, capped at asyncWindow
+            std::vector<AsyncOp> inflightOps;
+            int asyncWindow = 32;
+
+            // Post a nonblocking send plus the matching ack receive; the
+            // optional promise is fulfilled when the ack is reaped
+            void postAsyncOp(const Message &msg, int serverId, int sendTag,
+                             int recvTag, int recvBufferBytes,
+                             std::shared_ptr<std::promise<bool>> ackPromise = nullptr);
+
+            // Reap completed async operations with MPI_Waitsome; drains the
+            // whole window when waitAll is set, otherwise just enough to
+            // stay under the window limit
+            void reapAsyncCompletions(bool waitAll);
+
+            // HDR latency histograms per operation type, plus a client-side
+            // phase breakdown of the search path (routing, send, MPI wait,
+            // merge) for attributing where tail latency comes from
+            mutable benchmark::LatencyHistogram searchLatencyHist;
+            mutable benchmark::LatencyHistogram writeLatencyHist;
+            mutable benchmark::LatencyHistogram phaseRoutingHist;
+            mutable benchmark::LatencyHistogram phaseSendHist;
+            mutable benchmark::LatencyHistogram phaseWaitHist;
+            mutable benchmark::LatencyHistogram phaseMergeHist;
+
+            // Batched ingest state: create_md_index calls accumulate here
+            // and are shipped as per-server BATCH_CREATE_INDEX messages
+            // when the batch is full or has been sitting too long
+            bool batchingEnabled = false;
+            size_t batchMaxRecords = 0;
+            std::chrono::milliseconds batchMaxDelay{0};
+            std::vector<IndexRecord> pendingRecords;
+            std::chrono::steady_clock::time_point firstPendingAt;
+
         public:
             /**
              * Constructor
@@ -58,6 +276,159 @@ namespace idioms
              */
             void create_md_index(const std::string &key, const std::string &value, int objectId);
 
+            /**
+             * Bulk-load a batch of metadata index records
+             *
+             * Records are partitioned by destination server and each server
+             * receives its share as a single BATCH_CREATE_INDEX message,
+             * loaded through the server's bulk loader.
+             *
+             * @param records Index records to load
+             */
+            void create_md_index_batch(const std::vector<IndexRecord> &records);
+
+            /**
+             * Enable the shared-memory fast path for co-located servers
+             *
+             * COLLECTIVE over MPI_COMM_WORLD: every rank must call its
+             * enableSharedMemoryTransport at the same point (the servers
+             * have a matching method). Once enabled, messages to same-node
+             * ranks put the payload in shared memory and send only a slot
+             * descriptor through MPI; remote ranks are unaffected.
+             */
+            void enableSharedMemoryTransport();
+
+            /**
+             * Set how many asynchronous operations may be in flight before
+             * create_md_index_async blocks to reap completions
+             *
+             * @param window Maximum number of outstanding requests
+             */
+            void setAsyncWindowSize(int window);
+
+            /**
+             * Declare this client's query priority class
+             *
+             * Batch consumers (analytics, bulk exports) should declare
+             * PRIORITY_BATCH so the servers schedule their queries behind
+             * interactive traffic; under load a batch query may be
+             * rejected with a retry hint, which the client honors
+             * transparently up to a retry limit.
+             *
+             * @param priority Priority class for subsequent queries
+             */
+            void setQueryPriority(QueryPriority priority);
+
+            /**
+             * Create a metadata index record without waiting for the
+             * acknowledgment
+             *
+             * The sends use MPI_Isend with the acknowledgment received via
+             * MPI_Irecv, so up to the window size of requests overlap and a
+             * slow server no longer stalls the requests behind it. Failed
+             * acknowledgments are reported to stderr as they complete.
+             *
+             * @param key Metadata attribute key
+             * @param value Metadata attribute value
+             * @param objectId Object ID to associate with this metadata
+             */
+            void create_md_index_async(const std::string &key, const std::string &value, int objectId);
+
+            /**
+             * Create a metadata index record and receive its acknowledgment
+             * as a future
+             *
+             * Rides the same nonblocking window as create_md_index_async, so
+             * one thread can hold hundreds of outstanding writes and check
+             * each one's fate instead of scraping stderr. Acknowledgments
+             * are reaped as later operations are issued; call
+             * waitForAsyncOperations to force every pending future to
+             * resolve. The value is whether the server accepted the write.
+             *
+             * @param key Metadata attribute key
+             * @param value Metadata attribute value
+             * @param objectId Object ID to associate with this metadata
+             * @return Future resolving to the acknowledgment's verdict
+             */
+            std::future<bool> create_md_index_future(const std::string &key, const std::string &value, int objectId);
+
+            /**
+             * Block until every outstanding asynchronous operation has been
+             * acknowledged
+             */
+            void waitForAsyncOperations();
+
+            /**
+             * Perform a metadata search with the per-server fan-out issued
+             * as nonblocking sends, merging responses as they complete
+             * instead of draining servers one at a time
+             *
+             * @param queryStr Query string in the format "key=value" with optional wildcards (*)
+             * @return Vector of matching object IDs
+             */
+            std::vector<int> md_search_parallel(const std::string &queryStr);
+
+            /**
+             * Perform a metadata search with responses streamed back in
+             * fixed-size chunks
+             *
+             * Each server delivers its results as bounded RESPONSE_CHUNK
+             * messages rather than one contiguous buffer, and the client
+             * merges chunks as they arrive, so neither side ever holds a
+             * giant result in a single allocation and aggregation overlaps
+             * with server-side traversal.
+             *
+             * @param queryStr Query string in the format "key=value" with optional wildcards (*)
+             * @param chunkSize Maximum number of object IDs per chunk
+             * @return Vector of matching object IDs
+             */
+            std::vector<int> md_search_streaming(const std::string &queryStr,
+                                                 size_t chunkSize = 65536);
+
+            /**
+             * Fetch the next page of a large query, resumable across calls
+             *
+             * The first call for a query opens a paged cursor on each
+             * relevant server; every call drains the next page from the
+             * current server and moves on once it is exhausted, so the
+             * query is evaluated once per server however many pages the
+             * consumer pulls. Objects answered by several replicas are
+             * deduplicated client-side. Once done is set the paged state
+             * is discarded and a later call starts the query over.
+             *
+             * @param queryStr Query string in the format "key=value" with optional wildcards (*)
+             * @param pageSize Maximum number of object IDs per page
+             * @param done Set to true once the result set is exhausted
+             * @return The next page of object IDs (empty once done)
+             */
+            std::vector<int> md_search_page(const std::string &queryStr, size_t pageSize,
+                                            bool &done);
+
+            /**
+             * Enable client-side ingest batching
+             *
+             * While enabled, create_md_index calls accumulate locally and
+             * are flushed through create_md_index_batch once maxRecords
+             * have gathered or the oldest pending record is maxDelayMs old,
+             * whichever comes first. One acknowledgment per server batch
+             * replaces one per record.
+             *
+             * @param maxRecords Flush when this many records are pending
+             * @param maxDelayMs Flush when the oldest pending record has
+             *                   waited this long (checked on each add)
+             */
+            void enableBatchedIngest(size_t maxRecords, int maxDelayMs);
+
+            /**
+             * Flush any pending ingest records and disable batching
+             */
+            void disableBatchedIngest();
+
+            /**
+             * Flush pending ingest records immediately
+             */
+            void flushPendingIndexRecords();
+
             /**
              * Delete a metadata index record
              *
@@ -67,6 +438,31 @@ namespace idioms
              */
             void delete_md_index(const std::string &key, const std::string &value, int objectId);
 
+            /**
+             * Delete a batch of metadata index records
+             *
+             * Records are partitioned by destination server and each server
+             * receives its share as a single BATCH_DELETE_INDEX message,
+             * removed through the server's batched tombstone path. Unlike
+             * creates, a record goes to every server holding its key, since
+             * deletes are not carried by the replication stream.
+             *
+             * @param records Index records to delete
+             */
+            void delete_md_index_batch(const std::vector<IndexRecord> &records);
+
+            /**
+             * Delete every object matching a query
+             *
+             * Each server holding the query's keys evaluates it locally and
+             * removes all metadata of the matching objects in one pass.
+             *
+             * @param queryStr Query condition selecting the objects to delete
+             * @return Total objects deleted, summed over servers (an object
+             *         replicated on several servers is counted on each)
+             */
+            size_t delete_md_by_query(const std::string &queryStr);
+
             /**
              * Perform a metadata search
              *
@@ -75,11 +471,207 @@ namespace idioms
              */
             std::vector<int> md_search(const std::string &queryStr);
 
+            /**
+             * Cancel an in-flight query by its request ID
+             *
+             * Fire-and-forget: every server gets the cancel, since the
+             * client does not track which one a request landed on, and
+             * servers ignore IDs they are not running. The cancelled
+             * query's waiting call surfaces the server's error response
+             * as an exception. Safe to call from a watchdog thread while
+             * another thread is blocked in md_search.
+             *
+             * @param requestId A request ID from inFlightQueries()
+             */
+            void cancel_md_query(uint64_t requestId);
+
+            /**
+             * Request IDs of responses this client is currently waiting on
+             *
+             * A query that has been stuck too long shows up here; feed
+             * its ID to cancel_md_query to free the server core it is
+             * pinning.
+             *
+             * @return Snapshot of the in-flight request IDs
+             */
+            std::vector<uint64_t> inFlightQueries() const;
+
+            /**
+             * Register a standing query on the server holding its keys
+             *
+             * The server evaluates the query once, then pushes membership
+             * deltas on NOTIFY_TAG as inserts and deletes change the
+             * answer, so a poller's recurring full evaluation becomes
+             * O(changes) drained via md_poll_notifications.
+             *
+             * @param queryStr Conditions joined with " AND " / " OR "
+             * @param initialResults Receives the objects matching at registration
+             * @return Subscription ID, or -1 if no server handles the query
+             */
+            int md_subscribe(const std::string &queryStr, std::vector<int> &initialResults);
+
+            /**
+             * Drain standing-query notifications pushed by the servers
+             *
+             * Non-blocking: returns whatever deltas have arrived since the
+             * last call, possibly none.
+             *
+             * @return Pending notifications, one per subscription delta
+             */
+            std::vector<QueryNotifyMessage> md_poll_notifications();
+
             /**
              * Checkpoint all server indices to disk
              */
             void checkpointAllIndices();
 
+            /**
+             * Start an asynchronous checkpoint on all servers and return
+             * immediately; the serialization and disk write happen in a
+             * background thread on each server
+             */
+            void checkpointAllIndicesAsync();
+
+            /**
+             * Check whether every server has finished its asynchronous
+             * checkpoint successfully
+             *
+             * @return True if no checkpoint is still in progress and the
+             *         last one on every server wrote cleanly
+             */
+            bool allCheckpointsComplete();
+
+            /**
+             * Coordinated cluster-wide checkpoint: stamp a single epoch,
+             * broadcast a prepare to every server before collecting any
+             * acknowledgement (so the image writes overlap instead of
+             * serializing), then commit the manifest on all servers once
+             * every prepare succeeded. On failure the pending manifests
+             * are left uncommitted and recovery reports the incomplete set.
+             *
+             * @return True if every server prepared and committed the epoch
+             */
+            bool checkpointAllIndicesCoordinated();
+
+            /**
+             * Mark a server as down, bump the routing epoch and publish the
+             * new membership view to every reachable server. Subsequent
+             * queries reroute to replicas immediately instead of timing out
+             * against the dead rank.
+             *
+             * @param serverId DART server ID (MPI rank - 1) that failed
+             */
+            void reportServerFailure(int serverId);
+
+            /**
+             * Shut down one server without waiting for it
+             *
+             * Fault-injection harnesses use this to simulate a crash:
+             * the rank stops serving but stays in the MPI job.
+             *
+             * @param serverId DART server ID (MPI rank - 1) to stop
+             */
+            void shutdownServer(int serverId);
+
+            /**
+             * Probe one server for liveness
+             *
+             * Sends a cheap admin request and waits up to timeoutMs for
+             * any reply; a dead or wedged dispatch thread answers
+             * nothing. A reply arriving after the deadline stays queued
+             * and is drained by the next admin receive from that rank,
+             * so probe live servers with generous timeouts.
+             *
+             * @param serverId DART server ID (MPI rank - 1) to probe
+             * @param timeoutMs How long to wait for a reply
+             * @return True if the server answered within the deadline
+             */
+            bool pingServer(int serverId, double timeoutMs);
+
+            /**
+             * Re-replicate a confirmed-down server's index, virtual node
+             * by virtual node
+             *
+             * Each of the failed server's vnodes is reassigned to a
+             * surviving owner, and every surviving server streams its
+             * replica copies of those vnodes straight to the new owners —
+             * many vnodes in parallel across different sources — instead
+             * of one server sequentially rebuilding the whole failed
+             * index.
+             *
+             * @param serverId DART server ID (MPI rank - 1) that failed
+             */
+            void reReplicateFailedServer(int serverId);
+
+            /**
+             * Bootstrap a joining server from an existing server's
+             * snapshot image
+             *
+             * The source encodes a binary snapshot of the given vnodes and
+             * streams it to the target in large chunks; the target loads
+             * the reassembled image in one bulk pass and then pulls the
+             * replication delta from its peers, so adding capacity never
+             * replays ingest.
+             *
+             * @param sourceServerId DART server ID holding the records
+             * @param targetServerId DART server ID being bootstrapped
+             * @param vnodeIds Virtual nodes to transfer
+             * @return True if the source acknowledged the transfer
+             */
+            bool bootstrapServerFromSnapshot(int sourceServerId, int targetServerId,
+                                             const std::vector<uint32_t> &vnodeIds);
+
+            /**
+             * Mark a recovered server as up again and publish the new
+             * membership view to every reachable server
+             *
+             * @param serverId DART server ID (MPI rank - 1) that recovered
+             */
+            void reportServerRecovery(int serverId);
+
+            /**
+             * Fetch one server's statistics snapshot
+             *
+             * @param serverId DART server ID (MPI rank - 1)
+             * @return The server's statistics
+             */
+            ServerStats getServerStats(int serverId);
+
+            /**
+             * Fetch one key's statistics from the server owning it
+             *
+             * Record and distinct-value counts plus a sampled value
+             * histogram, maintained incrementally server-side, so an
+             * application can estimate a query's fan-out cost before
+             * paying for an expensive wildcard.
+             *
+             * @param key Metadata attribute key
+             * @return Counts and sampled values; zeroed when no server
+             *         owns the key or the key is unknown
+             */
+            KeyStatistics md_key_stats(const std::string &key);
+
+            /**
+             * Fetch and print every live server's statistics
+             *
+             * One block per server: query counts and mean latency by
+             * shape, index shape and memory estimate, lock wait and
+             * checkpoint timings — enough to see which server is hot
+             * without guessing.
+             */
+            void printClusterStats();
+
+            /**
+             * Print the client's latency report
+             *
+             * Per-operation HDR summaries (p50/p90/p99/p99.9/max), the
+             * percentile spectrum for searches, and the per-phase
+             * breakdown of the search path showing where the tail is
+             * spent: routing, serialize+send, MPI wait (which includes
+             * server execute) or merge.
+             */
+            void printLatencyReport() const;
+
             /**
              * Recover all server indices from disk
              */
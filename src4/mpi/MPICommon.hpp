@@ -1,9 +1,13 @@
 #ifndef IDIOMS_MPI_COMMON_HPP
 #define IDIOMS_MPI_COMMON_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <mutex>
 #include <mpi.h>
+#include "../index/MemoryAccounting.hpp"
+#include "../server/Server.hpp" // ServerStats, carried by ServerStatsMessage
 
 namespace idioms
 {
@@ -33,7 +37,94 @@ namespace idioms
             HEARTBEAT = 9,
             SERVER_FAILURE = 10,
             RECOVERY_REQUEST = 11,
-            RECOVERY_COMPLETE = 12
+            RECOVERY_COMPLETE = 12,
+
+            // Bulk ingest operations
+            BATCH_CREATE_INDEX = 13,
+
+            // Asynchronous checkpoint operations
+            CHECKPOINT_ASYNC = 14,
+            CHECKPOINT_STATUS = 15,
+
+            // Routing epoch protocol
+            EPOCH_UPDATE = 16,
+
+            // Tree-structured query fan-out
+            TREE_QUERY = 17,
+
+            // Chunked response streaming
+            STREAM_QUERY = 18,
+            RESPONSE_CHUNK = 19,
+
+            // Shared-memory transport descriptor
+            SHM_PAYLOAD = 20,
+
+            // Standing query subscriptions
+            SUBSCRIBE_QUERY = 21,
+            QUERY_NOTIFY = 22,
+
+            // Vnode-granular re-replication after a server failure
+            REPLICATE_VNODES = 23,
+            VNODE_SHARD = 24,
+
+            // Primary-driven streaming replication
+            REPL_APPEND = 25,
+            REPL_ACK = 26,
+
+            // Delta catch-up for rejoining replicas
+            CATCH_UP = 27,
+            REPL_CATCHUP_REQUEST = 28,
+            REPL_CATCHUP = 29,
+
+            // Server statistics snapshot (request and response)
+            STATS = 30,
+
+            // Admission control: query rejected under load, retry later
+            BUSY_RESPONSE = 31,
+
+            // Per-key statistics lookup (request and response)
+            KEY_STATS = 32,
+
+            // Snapshot transfer: ask a source server to stream its image
+            SNAPSHOT_REQUEST = 33,
+
+            // Snapshot transfer: one chunk of the streamed image
+            SNAPSHOT_CHUNK = 34,
+
+            // Cursor-paged query (request and response)
+            PAGED_QUERY = 35,
+            PAGED_RESPONSE = 36,
+
+            // Delete a whole batch of index records in one message
+            BATCH_DELETE_INDEX = 37,
+
+            // Delete every record of every object matching a query,
+            // evaluated on the server
+            DELETE_BY_QUERY = 38,
+
+            // Notice that a payload too big for a pre-posted receive slot
+            // follows on OVERSIZE_TAG
+            LARGE_PAYLOAD = 39,
+
+            // Cancel an in-flight query by its request ID
+            CANCEL_QUERY = 40,
+
+            // Cluster-wide checkpoint stamped with one epoch; all servers
+            // write concurrently and a manifest marks the consistent set
+            COORD_CHECKPOINT = 41
+        };
+
+        /**
+         * Query priority classes carried in QueryMessage
+         *
+         * Interactive is the default; batch consumers (analytics, bulk
+         * exports) declare themselves so the servers can keep them from
+         * starving production traffic.
+         */
+        enum QueryPriority : uint8_t
+        {
+            PRIORITY_INTERACTIVE = 0,
+            PRIORITY_BATCH = 1
         };
 
         // MPI tags
@@ -42,31 +133,247 @@ namespace idioms
         const int QUERY_TAG = 3;  // For query operations
         const int RESULT_TAG = 4; // For query results
         const int FAULT_TAG = 5;  // For fault tolerance messages
+        const int NOTIFY_TAG = 6;   // For pushed standing-query deltas
+        const int OVERSIZE_TAG = 7; // For payloads too big for a pre-posted slot
+
+        // Size of each pre-posted receive slot in a server's persistent
+        // channel ring. Messages at most this big land directly in a
+        // pre-posted buffer; bigger ones announce themselves with a
+        // LARGE_PAYLOAD notice and follow on OVERSIZE_TAG, where the
+        // receiver posts an exactly-sized receive before the payload
+        // arrives, so neither path takes an unexpected-message copy.
+        const size_t CHANNEL_SLOT_BYTES = 64 * 1024;
+
+        // Wire protocol header
+        //
+        // Every message starts with a fixed 16-byte little-endian header:
+        //
+        //   u32 length      payload bytes following the header
+        //   u16 type        MessageType
+        //   u16 version     wire protocol version (WIRE_VERSION)
+        //   u64 requestId   client-assigned ID echoed in responses (0 = none)
+        //
+        // Fixed-width fields keep the protocol portable across 32/64-bit
+        // builds (the old format shipped raw size_t and enum bytes), and
+        // the length prefix lets a receiver pre-size its buffer exactly.
+        // Length prefixes inside the payload are fixed-width u32 for the
+        // same reason.
+        const uint16_t WIRE_VERSION = 1;
+        const size_t WIRE_HEADER_BYTES = 16;
+
+        // Little-endian field accessors, independent of host byte order
+        inline void writeLE16(char *dest, uint16_t value)
+        {
+            dest[0] = static_cast<char>(value & 0xFF);
+            dest[1] = static_cast<char>((value >> 8) & 0xFF);
+        }
+
+        inline void writeLE32(char *dest, uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                dest[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        inline void writeLE64(char *dest, uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                dest[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        inline uint16_t readLE16(const char *src)
+        {
+            return static_cast<uint16_t>(static_cast<unsigned char>(src[0])) |
+                   static_cast<uint16_t>(static_cast<unsigned char>(src[1])) << 8;
+        }
+
+        inline uint32_t readLE32(const char *src)
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                value |= static_cast<uint32_t>(static_cast<unsigned char>(src[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        inline uint64_t readLE64(const char *src)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(src[i])) << (8 * i);
+            }
+            return value;
+        }
 
         // Serialization utilities
 
-        // Serialize a string
-        inline std::vector<char> serializeString(const std::string &str)
+        /**
+         * Pool of reusable message buffers.
+         *
+         * Every request cycle used to allocate and free fresh
+         * std::vector<char> buffers for serialization and receive —
+         * millions of short-lived allocations per second under load.
+         * Buffers drawn from here keep their capacity across uses, so
+         * once the pool is warm the steady-state message path performs
+         * no allocations at all (the flat BufferWriter draws from the
+         * pool too). Thread-safe: server workers release concurrently.
+         */
+        class BufferPool
+        {
+        private:
+            std::vector<std::vector<char>> freeBuffers;
+            std::mutex poolMutex;
+
+            // Cap so a burst cannot pin unbounded memory
+            static constexpr size_t MAX_POOLED = 64;
+
+        public:
+            // Get an empty buffer with at least capacityHint reserved
+            std::vector<char> acquire(size_t capacityHint)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(poolMutex);
+                    if (!freeBuffers.empty())
+                    {
+                        std::vector<char> buffer = std::move(freeBuffers.back());
+                        freeBuffers.pop_back();
+                        memoryAccounting().sub(MEM_MESSAGE_BUFFERS, buffer.capacity());
+                        buffer.clear();
+                        buffer.reserve(capacityHint);
+                        return buffer;
+                    }
+                }
+
+                std::vector<char> buffer;
+                buffer.reserve(capacityHint);
+                return buffer;
+            }
+
+            // Return a buffer for reuse, keeping its capacity
+            void release(std::vector<char> &&buffer)
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                if (freeBuffers.size() < MAX_POOLED)
+                {
+                    // The footprint report charges idle pooled capacity;
+                    // buffers out with callers are transient
+                    memoryAccounting().add(MEM_MESSAGE_BUFFERS, buffer.capacity());
+                    freeBuffers.push_back(std::move(buffer));
+                }
+            }
+        };
+
+        // Process-wide pool shared by senders, receivers and BufferWriter
+        inline BufferPool &messageBufferPool()
         {
-            size_t size = str.size();
-            std::vector<char> buffer(sizeof(size_t) + size);
+            static BufferPool pool;
+            return pool;
+        }
+
+        /**
+         * Flat single-pass buffer writer.
+         *
+         * Messages size their wire image up front, then append each field
+         * directly into one buffer. This replaces the old pattern of
+         * serializing every field into its own sub-buffer and memcpy'ing
+         * the pieces together, which cost several allocations and copies
+         * per message even for tiny payloads.
+         */
+        class BufferWriter
+        {
+        private:
+            std::vector<char> buffer;
+
+        public:
+            // Starts the buffer with the wire header; length is patched
+            // in take() once the payload size is known
+            BufferWriter(MessageType type, size_t payloadCapacity,
+                         uint64_t requestId = 0)
+                : buffer(messageBufferPool().acquire(WIRE_HEADER_BYTES + payloadCapacity))
+            {
+                buffer.resize(WIRE_HEADER_BYTES);
+                writeLE32(buffer.data(), 0);
+                writeLE16(buffer.data() + 4, static_cast<uint16_t>(type));
+                writeLE16(buffer.data() + 6, WIRE_VERSION);
+                writeLE64(buffer.data() + 8, requestId);
+            }
+
+            // Append a trivially-copyable value (message type, sizes, IDs)
+            template <typename T>
+            void appendValue(const T &value)
+            {
+                const char *raw = reinterpret_cast<const char *>(&value);
+                buffer.insert(buffer.end(), raw, raw + sizeof(T));
+            }
+
+            // Append one LEB128 varint (7 payload bits per byte, high bit
+            // marks continuation)
+            void appendVarint(uint64_t value)
+            {
+                while (value >= 0x80)
+                {
+                    buffer.push_back(static_cast<char>(value | 0x80));
+                    value >>= 7;
+                }
+                buffer.push_back(static_cast<char>(value));
+            }
+
+            // Append a length-prefixed string
+            void appendString(const std::string &str)
+            {
+                appendValue(static_cast<uint32_t>(str.size()));
+                buffer.insert(buffer.end(), str.data(), str.data() + str.size());
+            }
+
+            // Append a length-prefixed vector of integers
+            void appendIntVector(const std::vector<int> &vec)
+            {
+                appendValue(static_cast<uint32_t>(vec.size()));
+                if (!vec.empty())
+                {
+                    const char *raw = reinterpret_cast<const char *>(vec.data());
+                    buffer.insert(buffer.end(), raw, raw + vec.size() * sizeof(int));
+                }
+            }
+
+            // Append pre-encoded bytes
+            void appendBytes(const std::vector<char> &bytes)
+            {
+                buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+            }
 
-            // Copy the size
-            memcpy(buffer.data(), &size, sizeof(size_t));
+            // Patch the header's length field and hand the finished
+            // buffer to the caller without copying
+            std::vector<char> take()
+            {
+                writeLE32(buffer.data(),
+                          static_cast<uint32_t>(buffer.size() - WIRE_HEADER_BYTES));
+                return std::move(buffer);
+            }
+        };
 
-            // Copy the string content
-            memcpy(buffer.data() + sizeof(size_t), str.c_str(), size);
+        // Wire sizes of length-prefixed fields, for sizing a BufferWriter
+        inline size_t stringWireSize(const std::string &str)
+        {
+            return sizeof(uint32_t) + str.size();
+        }
 
-            return buffer;
+        inline size_t intVectorWireSize(const std::vector<int> &vec)
+        {
+            return sizeof(uint32_t) + vec.size() * sizeof(int);
         }
 
         // Deserialize a string
         inline std::string deserializeString(const std::vector<char> &buffer, size_t &offset)
         {
             // Read the size
-            size_t size;
-            memcpy(&size, buffer.data() + offset, sizeof(size_t));
-            offset += sizeof(size_t);
+            size_t size = readLE32(buffer.data() + offset);
+            offset += sizeof(uint32_t);
 
             // Read the string content
             std::string str(buffer.data() + offset, buffer.data() + offset + size);
@@ -75,31 +382,57 @@ namespace idioms
             return str;
         }
 
-        // Serialize a vector of integers
-        inline std::vector<char> serializeIntVector(const std::vector<int> &vec)
+        // ID list compression
+        //
+        // Result ID lists and batch object IDs are highly compressible:
+        // sorted results have small positive gaps and ingest IDs cluster.
+        // Lists at or above this many IDs are shipped delta-encoded with
+        // zigzag varints. Result lists arrive sorted (ResultSet keeps its
+        // IDs ordered end to end), so the deltas are small positives that
+        // encode in one byte instead of four; the break-even point is low,
+        // and below it the savings disappear into the fixed header. A flag
+        // byte ahead of each list records which encoding was used, so both
+        // forms interoperate transparently.
+        const size_t ID_COMPRESSION_THRESHOLD = 64;
+
+        // Decode count IDs from a delta-varint stream at offset
+        inline std::vector<int> deltaVarintDecode(const std::vector<char> &buffer,
+                                                  size_t &offset, size_t count)
         {
-            size_t size = vec.size();
-            std::vector<char> buffer(sizeof(size_t) + size * sizeof(int));
+            std::vector<int> ids;
+            ids.reserve(count);
 
-            // Copy the size
-            memcpy(buffer.data(), &size, sizeof(size_t));
-
-            // Copy the vector content
-            if (size > 0)
+            int64_t prev = 0;
+            for (size_t i = 0; i < count; i++)
             {
-                memcpy(buffer.data() + sizeof(size_t), vec.data(), size * sizeof(int));
+                uint64_t encoded = 0;
+                int shift = 0;
+                while (true)
+                {
+                    unsigned char byte = static_cast<unsigned char>(buffer[offset++]);
+                    encoded |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if ((byte & 0x80) == 0)
+                    {
+                        break;
+                    }
+                    shift += 7;
+                }
+
+                int64_t delta = static_cast<int64_t>(encoded >> 1) ^
+                                -static_cast<int64_t>(encoded & 1);
+                prev += delta;
+                ids.push_back(static_cast<int>(prev));
             }
 
-            return buffer;
+            return ids;
         }
 
         // Deserialize a vector of integers
         inline std::vector<int> deserializeIntVector(const std::vector<char> &buffer, size_t &offset)
         {
             // Read the size
-            size_t size;
-            memcpy(&size, buffer.data() + offset, sizeof(size_t));
-            offset += sizeof(size_t);
+            size_t size = readLE32(buffer.data() + offset);
+            offset += sizeof(uint32_t);
 
             // Read the vector content
             std::vector<int> vec(size);
@@ -112,6 +445,56 @@ namespace idioms
             return vec;
         }
 
+        // Append an ID list, compressed when it is large enough to pay off
+        inline void appendIdList(BufferWriter &writer, const std::vector<int> &ids)
+        {
+            char compressed = ids.size() >= ID_COMPRESSION_THRESHOLD ? 1 : 0;
+            writer.appendValue(compressed);
+
+            if (!compressed)
+            {
+                writer.appendIntVector(ids);
+                return;
+            }
+
+            writer.appendValue(static_cast<uint32_t>(ids.size()));
+
+            // Delta + zigzag straight into the writer, no staging buffer;
+            // zigzag keeps the occasional negative delta (unsorted ingest
+            // IDs) to one byte too
+            int64_t prev = 0;
+            for (int id : ids)
+            {
+                int64_t delta = static_cast<int64_t>(id) - prev;
+                writer.appendVarint((static_cast<uint64_t>(delta) << 1) ^
+                                    static_cast<uint64_t>(delta >> 63));
+                prev = id;
+            }
+        }
+
+        // Read an ID list written by appendIdList, either encoding
+        inline std::vector<int> readIdList(const std::vector<char> &buffer, size_t &offset)
+        {
+            char compressed = buffer[offset++];
+
+            if (!compressed)
+            {
+                return deserializeIntVector(buffer, offset);
+            }
+
+            size_t count = readLE32(buffer.data() + offset);
+            offset += sizeof(uint32_t);
+
+            return deltaVarintDecode(buffer, offset, count);
+        }
+
+        // Worst-case wire size of an appendIdList field, for sizing a
+        // BufferWriter (varints are at most 5 bytes for a 32-bit delta)
+        inline size_t idListWireSize(const std::vector<int> &ids)
+        {
+            return 1 + sizeof(uint32_t) + ids.size() * 5;
+        }
+
         // MPI message classes
 
         // Base message class
@@ -124,16 +507,30 @@ namespace idioms
 
             virtual std::vector<char> serialize() const
             {
-                std::vector<char> buffer(sizeof(MessageType));
-                memcpy(buffer.data(), &type, sizeof(MessageType));
-                return buffer;
+                BufferWriter writer(type, 0);
+                return writer.take();
             }
 
             static MessageType getType(const std::vector<char> &buffer)
             {
-                MessageType type;
-                memcpy(&type, buffer.data(), sizeof(MessageType));
-                return type;
+                return static_cast<MessageType>(readLE16(buffer.data() + 4));
+            }
+
+            static uint16_t getVersion(const std::vector<char> &buffer)
+            {
+                return readLE16(buffer.data() + 6);
+            }
+
+            static uint64_t getRequestId(const std::vector<char> &buffer)
+            {
+                return readLE64(buffer.data() + 8);
+            }
+
+            // Payload bytes following the header, so a receiver can
+            // pre-size its buffer without probing
+            static uint32_t getPayloadLength(const std::vector<char> &buffer)
+            {
+                return readLE32(buffer.data());
             }
         };
 
@@ -150,37 +547,19 @@ namespace idioms
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                auto keyBuffer = serializeString(key);
-                auto valueBuffer = serializeString(value);
-
-                std::vector<char> buffer(baseBuffer.size() + keyBuffer.size() + valueBuffer.size() + sizeof(int));
-
-                size_t offset = 0;
-
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
-
-                // Copy the key
-                memcpy(buffer.data() + offset, keyBuffer.data(), keyBuffer.size());
-                offset += keyBuffer.size();
-
-                // Copy the value
-                memcpy(buffer.data() + offset, valueBuffer.data(), valueBuffer.size());
-                offset += valueBuffer.size();
-
-                // Copy the object ID
-                memcpy(buffer.data() + offset, &objectId, sizeof(int));
-
-                return buffer;
+                BufferWriter writer(type, stringWireSize(key) +
+                                              stringWireSize(value) + sizeof(int));
+                writer.appendString(key);
+                writer.appendString(value);
+                writer.appendValue(objectId);
+                return writer.take();
             }
 
             static CreateIndexMessage deserialize(const std::vector<char> &buffer)
             {
                 CreateIndexMessage msg;
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
                 // Read the key
                 msg.key = deserializeString(buffer, offset);
@@ -208,37 +587,19 @@ namespace idioms
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                auto keyBuffer = serializeString(key);
-                auto valueBuffer = serializeString(value);
-
-                std::vector<char> buffer(baseBuffer.size() + keyBuffer.size() + valueBuffer.size() + sizeof(int));
-
-                size_t offset = 0;
-
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
-
-                // Copy the key
-                memcpy(buffer.data() + offset, keyBuffer.data(), keyBuffer.size());
-                offset += keyBuffer.size();
-
-                // Copy the value
-                memcpy(buffer.data() + offset, valueBuffer.data(), valueBuffer.size());
-                offset += valueBuffer.size();
-
-                // Copy the object ID
-                memcpy(buffer.data() + offset, &objectId, sizeof(int));
-
-                return buffer;
+                BufferWriter writer(type, stringWireSize(key) +
+                                              stringWireSize(value) + sizeof(int));
+                writer.appendString(key);
+                writer.appendString(value);
+                writer.appendValue(objectId);
+                return writer.take();
             }
 
             static DeleteIndexMessage deserialize(const std::vector<char> &buffer)
             {
                 DeleteIndexMessage msg;
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
                 // Read the key
                 msg.key = deserializeString(buffer, offset);
@@ -253,330 +614,1627 @@ namespace idioms
             }
         };
 
-        // Query message
-        struct QueryMessage : public Message
+        // Batch create index message: a whole ingest batch for one server in
+        // a single message, loaded through the server's bulk-load path
+        struct BatchCreateIndexMessage : public Message
         {
-            std::string queryStr;
+            // Parallel vectors, one entry per record
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            std::vector<int> objectIds;
 
-            QueryMessage() : Message(QUERY) {}
-            QueryMessage(const std::string &q) : Message(QUERY), queryStr(q) {}
+            BatchCreateIndexMessage() : Message(BATCH_CREATE_INDEX) {}
 
-            std::vector<char> serialize() const override
+            void addRecord(const std::string &key, const std::string &value, int objectId)
             {
-                auto baseBuffer = Message::serialize();
-                auto queryBuffer = serializeString(queryStr);
-
-                std::vector<char> buffer(baseBuffer.size() + queryBuffer.size());
-
-                size_t offset = 0;
-
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+                keys.push_back(key);
+                values.push_back(value);
+                objectIds.push_back(objectId);
+            }
 
-                // Copy the query string
-                memcpy(buffer.data() + offset, queryBuffer.data(), queryBuffer.size());
+            size_t recordCount() const
+            {
+                return keys.size();
+            }
 
-                return buffer;
+            std::vector<char> serialize() const override
+            {
+                // Size the wire image once, then append everything in place
+                size_t stringBytes = 0;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    stringBytes += stringWireSize(keys[i]) + stringWireSize(values[i]);
+                }
+
+                BufferWriter writer(type, sizeof(uint32_t) + stringBytes +
+                                              idListWireSize(objectIds));
+                writer.appendValue(static_cast<uint32_t>(keys.size()));
+
+                // Append the key/value strings record by record
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    writer.appendString(keys[i]);
+                    writer.appendString(values[i]);
+                }
+
+                appendIdList(writer, objectIds);
+                return writer.take();
             }
 
-            static QueryMessage deserialize(const std::vector<char> &buffer)
+            static BatchCreateIndexMessage deserialize(const std::vector<char> &buffer)
             {
-                QueryMessage msg;
+                BatchCreateIndexMessage msg;
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Read the query string
-                msg.queryStr = deserializeString(buffer, offset);
+                // Read the record count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the key/value strings
+                msg.keys.reserve(count);
+                msg.values.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.keys.push_back(deserializeString(buffer, offset));
+                    msg.values.push_back(deserializeString(buffer, offset));
+                }
+
+                // Read the object IDs
+                msg.objectIds = readIdList(buffer, offset);
 
                 return msg;
             }
         };
 
-        // Administrative message
-        struct AdminMessage : public Message
+        // Batch delete index message: a whole batch of deletions for one
+        // server in a single message, removed through the server's batched
+        // tombstone path
+        struct BatchDeleteIndexMessage : public Message
         {
-            // No additional data for now
+            // Parallel vectors, one entry per record
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            std::vector<int> objectIds;
 
-            AdminMessage(MessageType t) : Message(t) {}
+            BatchDeleteIndexMessage() : Message(BATCH_DELETE_INDEX) {}
 
-            std::vector<char> serialize() const override
+            void addRecord(const std::string &key, const std::string &value, int objectId)
             {
-                return Message::serialize();
+                keys.push_back(key);
+                values.push_back(value);
+                objectIds.push_back(objectId);
             }
 
-            static AdminMessage deserialize(const std::vector<char> &buffer)
+            size_t recordCount() const
             {
-                MessageType type = getType(buffer);
-                return AdminMessage(type);
+                return keys.size();
             }
-        };
-
-        // Response message
-        struct ResponseMessage : public Message
-        {
-            std::vector<int> results;
-            bool success;
-
-            ResponseMessage() : Message(RESPONSE), success(true) {}
-            ResponseMessage(const std::vector<int> &r) : Message(RESPONSE), results(r), success(true) {}
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                auto resultsBuffer = serializeIntVector(results);
-
-                std::vector<char> buffer(baseBuffer.size() + resultsBuffer.size() + sizeof(bool));
-
-                size_t offset = 0;
-
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
-
-                // Copy the success flag
-                memcpy(buffer.data() + offset, &success, sizeof(bool));
-                offset += sizeof(bool);
-
-                // Copy the results
-                memcpy(buffer.data() + offset, resultsBuffer.data(), resultsBuffer.size());
-
-                return buffer;
+                // Size the wire image once, then append everything in place
+                size_t stringBytes = 0;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    stringBytes += stringWireSize(keys[i]) + stringWireSize(values[i]);
+                }
+
+                BufferWriter writer(type, sizeof(uint32_t) + stringBytes +
+                                              idListWireSize(objectIds));
+                writer.appendValue(static_cast<uint32_t>(keys.size()));
+
+                // Append the key/value strings record by record
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    writer.appendString(keys[i]);
+                    writer.appendString(values[i]);
+                }
+
+                appendIdList(writer, objectIds);
+                return writer.take();
             }
 
-            static ResponseMessage deserialize(const std::vector<char> &buffer)
+            static BatchDeleteIndexMessage deserialize(const std::vector<char> &buffer)
             {
-                ResponseMessage msg;
+                BatchDeleteIndexMessage msg;
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Read the success flag
-                memcpy(&msg.success, buffer.data() + offset, sizeof(bool));
-                offset += sizeof(bool);
+                // Read the record count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
 
-                // Read the results
-                msg.results = deserializeIntVector(buffer, offset);
+                // Read the key/value strings
+                msg.keys.reserve(count);
+                msg.values.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.keys.push_back(deserializeString(buffer, offset));
+                    msg.values.push_back(deserializeString(buffer, offset));
+                }
+
+                // Read the object IDs
+                msg.objectIds = readIdList(buffer, offset);
 
                 return msg;
             }
         };
 
-        // Error response message
-        struct ErrorResponseMessage : public Message
+        // Delete-by-query message: the server evaluates the query itself
+        // and removes every record of every matching object in one pass,
+        // answering with the number of objects deleted
+        struct DeleteByQueryMessage : public Message
         {
-            std::string errorMessage;
+            std::string queryStr;
 
-            ErrorResponseMessage() : Message(ERROR_RESPONSE) {}
-            ErrorResponseMessage(const std::string &error) : Message(ERROR_RESPONSE), errorMessage(error) {}
+            DeleteByQueryMessage() : Message(DELETE_BY_QUERY) {}
+            DeleteByQueryMessage(const std::string &q)
+                : Message(DELETE_BY_QUERY), queryStr(q) {}
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                auto errorBuffer = serializeString(errorMessage);
+                BufferWriter writer(type, stringWireSize(queryStr));
+                writer.appendString(queryStr);
+                return writer.take();
+            }
 
-                std::vector<char> buffer(baseBuffer.size() + errorBuffer.size());
+            static DeleteByQueryMessage deserialize(const std::vector<char> &buffer)
+            {
+                DeleteByQueryMessage msg;
 
-                size_t offset = 0;
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.queryStr = deserializeString(buffer, offset);
 
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+                return msg;
+            }
+        };
 
-                // Copy the error message
-                memcpy(buffer.data() + offset, errorBuffer.data(), errorBuffer.size());
+        // Cancel message: names a running query by the request ID its
+        // QueryMessage carried. Fire-and-forget — the cancelled query
+        // itself answers with an error response, and an unknown ID
+        // (already finished, or never routed here) is silently ignored.
+        struct CancelQueryMessage : public Message
+        {
+            uint64_t targetRequestId;
 
-                return buffer;
-            }
+            CancelQueryMessage() : Message(CANCEL_QUERY), targetRequestId(0) {}
+            explicit CancelQueryMessage(uint64_t target)
+                : Message(CANCEL_QUERY), targetRequestId(target) {}
 
-            static ErrorResponseMessage deserialize(const std::vector<char> &buffer)
+            std::vector<char> serialize() const override
             {
-                ErrorResponseMessage msg;
+                BufferWriter writer(type, sizeof(uint64_t));
+                writer.appendValue(targetRequestId);
+                return writer.take();
+            }
 
-                size_t offset = sizeof(MessageType);
+            static CancelQueryMessage deserialize(const std::vector<char> &buffer)
+            {
+                CancelQueryMessage msg;
 
-                // Read the error message
-                msg.errorMessage = deserializeString(buffer, offset);
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.targetRequestId = readLE64(buffer.data() + offset);
 
                 return msg;
             }
         };
 
-        // Heartbeat message
-        struct HeartbeatMessage : public Message
+        // Query message
+        struct QueryMessage : public Message
         {
-            int serverId;
-            int64_t timestamp;
-
-            HeartbeatMessage() : Message(HEARTBEAT), serverId(0), timestamp(0) {}
-            HeartbeatMessage(int id, int64_t ts) : Message(HEARTBEAT), serverId(id), timestamp(ts) {}
-
-            std::vector<char> serialize() const override
-            {
-                auto baseBuffer = Message::serialize();
-                std::vector<char> buffer(baseBuffer.size() + sizeof(int) + sizeof(int64_t));
+            std::string queryStr;
 
-                size_t offset = 0;
+            // Routing epoch the client routed under; 0 means unversioned
+            // and is always accepted
+            uint64_t epoch;
 
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+            // Client-assigned ID echoed in the response, so responses
+            // completed out of order by the server worker pool can still
+            // be matched to their requests (0 = unmatched)
+            uint64_t requestId;
 
-                // Copy the server ID
-                memcpy(buffer.data() + offset, &serverId, sizeof(int));
-                offset += sizeof(int);
+            // Priority class (see QueryPriority); the server's admission
+            // layer schedules batch traffic behind interactive traffic
+            uint8_t priority;
 
-                // Copy the timestamp
-                memcpy(buffer.data() + offset, &timestamp, sizeof(int64_t));
+            QueryMessage() : Message(QUERY), epoch(0), requestId(0),
+                             priority(PRIORITY_INTERACTIVE) {}
+            QueryMessage(const std::string &q, uint64_t routingEpoch = 0, uint64_t reqId = 0,
+                         uint8_t prio = PRIORITY_INTERACTIVE)
+                : Message(QUERY), queryStr(q), epoch(routingEpoch), requestId(reqId),
+                  priority(prio) {}
 
-                return buffer;
+            std::vector<char> serialize() const override
+            {
+                // The request ID rides in the wire header
+                BufferWriter writer(type, stringWireSize(queryStr) + sizeof(uint64_t) +
+                                              sizeof(uint8_t),
+                                    requestId);
+                writer.appendString(queryStr);
+                writer.appendValue(epoch);
+                writer.appendValue(priority);
+                return writer.take();
             }
 
-            static HeartbeatMessage deserialize(const std::vector<char> &buffer)
+            static QueryMessage deserialize(const std::vector<char> &buffer)
             {
-                HeartbeatMessage msg;
+                QueryMessage msg;
+                msg.requestId = getRequestId(buffer);
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Read the server ID
-                memcpy(&msg.serverId, buffer.data() + offset, sizeof(int));
-                offset += sizeof(int);
+                // Read the query string
+                msg.queryStr = deserializeString(buffer, offset);
 
-                // Read the timestamp
-                memcpy(&msg.timestamp, buffer.data() + offset, sizeof(int64_t));
+                // Read the routing epoch
+                memcpy(&msg.epoch, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Priority (absent in pre-priority senders: interactive)
+                if (offset < buffer.size())
+                {
+                    msg.priority = static_cast<uint8_t>(buffer[offset]);
+                }
 
                 return msg;
             }
         };
 
-        // Server failure message
-        struct ServerFailureMessage : public Message
+        // Tree query message: one node of an aggregation tree over the
+        // destination servers. Each server executes the query, merges the
+        // already-deduplicated results of its children, and forwards one
+        // response to its parent, so a wide fan-out reaches the client as
+        // a single message instead of one receive per server.
+        struct TreeQueryMessage : public Message
         {
-            int failedServerId;
-
-            ServerFailureMessage() : Message(SERVER_FAILURE), failedServerId(0) {}
-            ServerFailureMessage(int id) : Message(SERVER_FAILURE), failedServerId(id) {}
+            std::string queryStr;
 
-            std::vector<char> serialize() const override
-            {
-                auto baseBuffer = Message::serialize();
-                std::vector<char> buffer(baseBuffer.size() + sizeof(int));
+            // Routing epoch the client routed under; 0 means unversioned
+            uint64_t epoch;
 
-                size_t offset = 0;
+            // MPI rank to send the merged results to (0 = the client)
+            int parentRank;
 
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+            // MPI ranks whose results this server merges before replying
+            std::vector<int> childRanks;
 
-                // Copy the failed server ID
-                memcpy(buffer.data() + offset, &failedServerId, sizeof(int));
+            TreeQueryMessage() : Message(TREE_QUERY), epoch(0), parentRank(0) {}
+            TreeQueryMessage(const std::string &q, uint64_t routingEpoch,
+                             int parent, const std::vector<int> &children)
+                : Message(TREE_QUERY), queryStr(q), epoch(routingEpoch),
+                  parentRank(parent), childRanks(children) {}
 
-                return buffer;
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, stringWireSize(queryStr) +
+                                              sizeof(uint64_t) + sizeof(int) +
+                                              intVectorWireSize(childRanks));
+                writer.appendString(queryStr);
+                writer.appendValue(epoch);
+                writer.appendValue(parentRank);
+                writer.appendIntVector(childRanks);
+                return writer.take();
             }
 
-            static ServerFailureMessage deserialize(const std::vector<char> &buffer)
+            static TreeQueryMessage deserialize(const std::vector<char> &buffer)
             {
-                ServerFailureMessage msg;
+                TreeQueryMessage msg;
 
-                size_t offset = sizeof(MessageType);
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Read the failed server ID
-                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
+                // Read the query string
+                msg.queryStr = deserializeString(buffer, offset);
 
-                return msg;
+                // Read the routing epoch
+                memcpy(&msg.epoch, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Read the parent rank
+                memcpy(&msg.parentRank, buffer.data() + offset, sizeof(int));
+                offset += sizeof(int);
+
+                // Read the child ranks
+                msg.childRanks = deserializeIntVector(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Stream query message: asks the server to deliver its results as
+        // fixed-size RESPONSE_CHUNK messages instead of one buffer, so a
+        // huge result never needs a single contiguous allocation
+        struct StreamQueryMessage : public Message
+        {
+            std::string queryStr;
+
+            // Routing epoch the client routed under; 0 means unversioned
+            uint64_t epoch;
+
+            // Maximum number of object IDs per chunk
+            size_t chunkSize;
+
+            StreamQueryMessage() : Message(STREAM_QUERY), epoch(0), chunkSize(0) {}
+            StreamQueryMessage(const std::string &q, uint64_t routingEpoch, size_t chunk)
+                : Message(STREAM_QUERY), queryStr(q), epoch(routingEpoch), chunkSize(chunk) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, stringWireSize(queryStr) +
+                                              2 * sizeof(uint64_t));
+                writer.appendString(queryStr);
+                writer.appendValue(epoch);
+                writer.appendValue(static_cast<uint64_t>(chunkSize));
+                return writer.take();
+            }
+
+            static StreamQueryMessage deserialize(const std::vector<char> &buffer)
+            {
+                StreamQueryMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the query string
+                msg.queryStr = deserializeString(buffer, offset);
+
+                // Read the routing epoch
+                memcpy(&msg.epoch, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Read the chunk size
+                uint64_t chunk;
+                memcpy(&chunk, buffer.data() + offset, sizeof(uint64_t));
+                msg.chunkSize = static_cast<size_t>(chunk);
+
+                return msg;
+            }
+        };
+
+        // One chunk of a streamed query response; last marks the final
+        // (possibly empty) chunk of the stream
+        struct ResponseChunkMessage : public Message
+        {
+            std::vector<int> results;
+            bool last;
+
+            ResponseChunkMessage() : Message(RESPONSE_CHUNK), last(false) {}
+            ResponseChunkMessage(const std::vector<int> &r, bool isLast)
+                : Message(RESPONSE_CHUNK), results(r), last(isLast) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(bool) + idListWireSize(results));
+                writer.appendValue(last);
+                appendIdList(writer, results);
+                return writer.take();
+            }
+
+            static ResponseChunkMessage deserialize(const std::vector<char> &buffer)
+            {
+                ResponseChunkMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the last-chunk marker
+                memcpy(&msg.last, buffer.data() + offset, sizeof(bool));
+                offset += sizeof(bool);
+
+                // Read the chunk contents
+                msg.results = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Administrative message
+        struct AdminMessage : public Message
+        {
+            // No additional data for now
+
+            AdminMessage(MessageType t) : Message(t) {}
+
+            std::vector<char> serialize() const override
+            {
+                return Message::serialize();
+            }
+
+            static AdminMessage deserialize(const std::vector<char> &buffer)
+            {
+                MessageType type = getType(buffer);
+                return AdminMessage(type);
+            }
+        };
+
+        // Coordinated checkpoint message: the coordinator stamps one
+        // checkpoint epoch for the whole cluster and drives two phases.
+        // PREPARE makes every server write its image (concurrently, since
+        // the coordinator broadcasts before collecting); COMMIT marks the
+        // manifests once every server acknowledged, so recovery can tell
+        // a complete cluster-wide set from a partial one.
+        struct CoordinatedCheckpointMessage : public Message
+        {
+            static const uint8_t PHASE_PREPARE = 1;
+            static const uint8_t PHASE_COMMIT = 2;
+
+            uint64_t checkpointEpoch;
+            uint8_t phase;
+
+            CoordinatedCheckpointMessage()
+                : Message(COORD_CHECKPOINT), checkpointEpoch(0), phase(PHASE_PREPARE) {}
+            CoordinatedCheckpointMessage(uint64_t epoch, uint8_t checkpointPhase)
+                : Message(COORD_CHECKPOINT), checkpointEpoch(epoch), phase(checkpointPhase) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint64_t) + sizeof(uint8_t));
+                writer.appendValue(checkpointEpoch);
+                writer.appendValue(phase);
+                return writer.take();
+            }
+
+            static CoordinatedCheckpointMessage deserialize(const std::vector<char> &buffer)
+            {
+                CoordinatedCheckpointMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.checkpointEpoch = readLE64(buffer.data() + offset);
+                offset += sizeof(uint64_t);
+                msg.phase = static_cast<uint8_t>(buffer[offset]);
+
+                return msg;
+            }
+        };
+
+        // Routing epoch update: publishes a new epoch plus the servers
+        // currently confirmed down, so every process reroutes immediately
+        struct EpochUpdateMessage : public Message
+        {
+            uint64_t epoch;
+            std::vector<int> downServers;
+
+            EpochUpdateMessage() : Message(EPOCH_UPDATE), epoch(0) {}
+            EpochUpdateMessage(uint64_t e, const std::vector<int> &down)
+                : Message(EPOCH_UPDATE), epoch(e), downServers(down) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint64_t) +
+                                              intVectorWireSize(downServers));
+                writer.appendValue(epoch);
+                writer.appendIntVector(downServers);
+                return writer.take();
+            }
+
+            static EpochUpdateMessage deserialize(const std::vector<char> &buffer)
+            {
+                EpochUpdateMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the epoch
+                memcpy(&msg.epoch, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Read the down-server list
+                msg.downServers = deserializeIntVector(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Shared-memory payload descriptor: the real message sits in the
+        // sender's shared-memory slab and only this slot reference crosses
+        // the MPI transport (see ShmTransport)
+        struct ShmPayloadMessage : public Message
+        {
+            size_t slot;
+
+            ShmPayloadMessage() : Message(SHM_PAYLOAD), slot(0) {}
+            explicit ShmPayloadMessage(size_t s) : Message(SHM_PAYLOAD), slot(s) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint64_t));
+                writer.appendValue(static_cast<uint64_t>(slot));
+                return writer.take();
+            }
+
+            static ShmPayloadMessage deserialize(const std::vector<char> &buffer)
+            {
+                ShmPayloadMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the slot index
+                uint64_t slot;
+                memcpy(&slot, buffer.data() + offset, sizeof(uint64_t));
+                msg.slot = static_cast<size_t>(slot);
+
+                return msg;
+            }
+        };
+
+        // Oversize notice: the real message did not fit a pre-posted
+        // receive slot and follows as a raw payload on OVERSIZE_TAG. The
+        // byte count lets the receiver post an exactly-sized receive
+        // before the payload arrives.
+        struct LargePayloadMessage : public Message
+        {
+            uint64_t payloadBytes;
+
+            LargePayloadMessage() : Message(LARGE_PAYLOAD), payloadBytes(0) {}
+            explicit LargePayloadMessage(uint64_t bytes)
+                : Message(LARGE_PAYLOAD), payloadBytes(bytes) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint64_t));
+                writer.appendValue(payloadBytes);
+                return writer.take();
+            }
+
+            static LargePayloadMessage deserialize(const std::vector<char> &buffer)
+            {
+                LargePayloadMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.payloadBytes = readLE64(buffer.data() + offset);
+
+                return msg;
+            }
+        };
+
+        // Response message
+        struct ResponseMessage : public Message
+        {
+            std::vector<int> results;
+            bool success;
+
+            // Echo of the request ID this response answers (0 = unmatched)
+            uint64_t requestId;
+
+            // Client-side only: set when the server answered with a
+            // BUSY_RESPONSE instead of results (never serialized)
+            bool busy = false;
+            uint32_t retryAfterMs = 0;
+
+            ResponseMessage() : Message(RESPONSE), success(true), requestId(0) {}
+            ResponseMessage(const std::vector<int> &r)
+                : Message(RESPONSE), results(r), success(true), requestId(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                // The request ID echo rides in the wire header
+                BufferWriter writer(type, sizeof(bool) + idListWireSize(results),
+                                    requestId);
+                writer.appendValue(success);
+                appendIdList(writer, results);
+                return writer.take();
+            }
+
+            static ResponseMessage deserialize(const std::vector<char> &buffer)
+            {
+                ResponseMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the success flag
+                memcpy(&msg.success, buffer.data() + offset, sizeof(bool));
+                offset += sizeof(bool);
+
+                // Read the results
+                msg.results = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Admission-control rejection: the server's batch queue is full,
+        // so instead of queueing the query it tells the client when to
+        // retry. The request ID echo rides in the wire header like a
+        // normal response, so the client's matching logic applies.
+        struct BusyResponseMessage : public Message
+        {
+            uint64_t requestId;
+
+            // How long the client should back off before resending
+            uint32_t retryAfterMs;
+
+            BusyResponseMessage() : Message(BUSY_RESPONSE), requestId(0), retryAfterMs(0) {}
+            BusyResponseMessage(uint64_t reqId, uint32_t retryMs)
+                : Message(BUSY_RESPONSE), requestId(reqId), retryAfterMs(retryMs) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint32_t), requestId);
+                writer.appendValue(retryAfterMs);
+                return writer.take();
+            }
+
+            static BusyResponseMessage deserialize(const std::vector<char> &buffer)
+            {
+                BusyResponseMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+                memcpy(&msg.retryAfterMs, buffer.data() + offset, sizeof(uint32_t));
+
+                return msg;
+            }
+        };
+
+        // Subscribe to a standing query: the server evaluates it once and
+        // replies with a QueryNotifyMessage carrying the subscription ID
+        // and the initial matches, then pushes membership deltas on
+        // NOTIFY_TAG as later inserts and deletes change the answer
+        struct SubscribeQueryMessage : public Message
+        {
+            std::string queryStr;
+
+            // Client-assigned ID echoed in the registration reply
+            uint64_t requestId;
+
+            SubscribeQueryMessage() : Message(SUBSCRIBE_QUERY), requestId(0) {}
+            SubscribeQueryMessage(const std::string &q, uint64_t reqId = 0)
+                : Message(SUBSCRIBE_QUERY), queryStr(q), requestId(reqId) {}
+
+            std::vector<char> serialize() const override
+            {
+                // The request ID rides in the wire header
+                BufferWriter writer(type, stringWireSize(queryStr), requestId);
+                writer.appendString(queryStr);
+                return writer.take();
+            }
+
+            static SubscribeQueryMessage deserialize(const std::vector<char> &buffer)
+            {
+                SubscribeQueryMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the query string
+                msg.queryStr = deserializeString(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // One standing-query notification: the objects that started and
+        // stopped matching a subscription since the previous one. Also
+        // serves as the registration reply, with added holding the initial
+        // matches.
+        struct QueryNotifyMessage : public Message
+        {
+            int subscriptionId;
+            std::vector<int> added;
+            std::vector<int> removed;
+
+            // Echo of the subscribe request ID (0 for pushed deltas)
+            uint64_t requestId;
+
+            QueryNotifyMessage() : Message(QUERY_NOTIFY), subscriptionId(0), requestId(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int) + idListWireSize(added) +
+                                              idListWireSize(removed),
+                                    requestId);
+                writer.appendValue(subscriptionId);
+                appendIdList(writer, added);
+                appendIdList(writer, removed);
+                return writer.take();
+            }
+
+            static QueryNotifyMessage deserialize(const std::vector<char> &buffer)
+            {
+                QueryNotifyMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the subscription ID
+                memcpy(&msg.subscriptionId, buffer.data() + offset, sizeof(int));
+                offset += sizeof(int);
+
+                // Read the membership deltas
+                msg.added = readIdList(buffer, offset);
+                msg.removed = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Error response message
+        struct ErrorResponseMessage : public Message
+        {
+            std::string errorMessage;
+
+            ErrorResponseMessage() : Message(ERROR_RESPONSE) {}
+            ErrorResponseMessage(const std::string &error) : Message(ERROR_RESPONSE), errorMessage(error) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, stringWireSize(errorMessage));
+                writer.appendString(errorMessage);
+                return writer.take();
+            }
+
+            static ErrorResponseMessage deserialize(const std::vector<char> &buffer)
+            {
+                ErrorResponseMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the error message
+                msg.errorMessage = deserializeString(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Heartbeat message
+        struct HeartbeatMessage : public Message
+        {
+            int serverId;
+            int64_t timestamp;
+
+            HeartbeatMessage() : Message(HEARTBEAT), serverId(0), timestamp(0) {}
+            HeartbeatMessage(int id, int64_t ts) : Message(HEARTBEAT), serverId(id), timestamp(ts) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int) + sizeof(int64_t));
+                writer.appendValue(serverId);
+                writer.appendValue(timestamp);
+                return writer.take();
+            }
+
+            static HeartbeatMessage deserialize(const std::vector<char> &buffer)
+            {
+                HeartbeatMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the server ID
+                memcpy(&msg.serverId, buffer.data() + offset, sizeof(int));
+                offset += sizeof(int);
+
+                // Read the timestamp
+                memcpy(&msg.timestamp, buffer.data() + offset, sizeof(int64_t));
+
+                return msg;
+            }
+        };
+
+        // Server failure message
+        struct ServerFailureMessage : public Message
+        {
+            int failedServerId;
+
+            ServerFailureMessage() : Message(SERVER_FAILURE), failedServerId(0) {}
+            ServerFailureMessage(int id) : Message(SERVER_FAILURE), failedServerId(id) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int));
+                writer.appendValue(failedServerId);
+                return writer.take();
+            }
+
+            static ServerFailureMessage deserialize(const std::vector<char> &buffer)
+            {
+                ServerFailureMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the failed server ID
+                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
+
+                return msg;
+            }
+        };
+
+        // Recovery request message
+        struct RecoveryRequestMessage : public Message
+        {
+            int failedServerId;
+            int coordinatorId;
+
+            RecoveryRequestMessage() : Message(RECOVERY_REQUEST), failedServerId(0), coordinatorId(0) {}
+            RecoveryRequestMessage(int failed, int coordinator)
+                : Message(RECOVERY_REQUEST), failedServerId(failed), coordinatorId(coordinator) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, 2 * sizeof(int));
+                writer.appendValue(failedServerId);
+                writer.appendValue(coordinatorId);
+                return writer.take();
+            }
+
+            static RecoveryRequestMessage deserialize(const std::vector<char> &buffer)
+            {
+                RecoveryRequestMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the failed server ID
+                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
+                offset += sizeof(int);
+
+                // Read the coordinator ID
+                memcpy(&msg.coordinatorId, buffer.data() + offset, sizeof(int));
+
+                return msg;
             }
         };
 
-        // Recovery request message
-        struct RecoveryRequestMessage : public Message
+        // Recovery complete message
+        struct RecoveryCompleteMessage : public Message
         {
             int failedServerId;
-            int coordinatorId;
+            bool success;
 
-            RecoveryRequestMessage() : Message(RECOVERY_REQUEST), failedServerId(0), coordinatorId(0) {}
-            RecoveryRequestMessage(int failed, int coordinator)
-                : Message(RECOVERY_REQUEST), failedServerId(failed), coordinatorId(coordinator) {}
+            RecoveryCompleteMessage() : Message(RECOVERY_COMPLETE), failedServerId(0), success(false) {}
+            RecoveryCompleteMessage(int id, bool succ)
+                : Message(RECOVERY_COMPLETE), failedServerId(id), success(succ) {}
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                std::vector<char> buffer(baseBuffer.size() + 2 * sizeof(int));
+                BufferWriter writer(type, sizeof(int) + sizeof(bool));
+                writer.appendValue(failedServerId);
+                writer.appendValue(success);
+                return writer.take();
+            }
 
-                size_t offset = 0;
+            static RecoveryCompleteMessage deserialize(const std::vector<char> &buffer)
+            {
+                RecoveryCompleteMessage msg;
 
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Copy the failed server ID
-                memcpy(buffer.data() + offset, &failedServerId, sizeof(int));
+                // Read the failed server ID
+                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
                 offset += sizeof(int);
 
-                // Copy the coordinator ID
-                memcpy(buffer.data() + offset, &coordinatorId, sizeof(int));
+                // Read the success flag
+                memcpy(&msg.success, buffer.data() + offset, sizeof(bool));
 
-                return buffer;
+                return msg;
             }
+        };
 
-            static RecoveryRequestMessage deserialize(const std::vector<char> &buffer)
+        // Ask a surviving server to stream listed vnodes' shards to their
+        // new owners: vnodeIds[i] goes to server targetServers[i]. One of
+        // these per source server lets every survivor export and push its
+        // share of a failed server's vnodes concurrently.
+        struct ReplicateVnodesMessage : public Message
+        {
+            std::vector<uint32_t> vnodeIds;
+            std::vector<int> targetServers;
+
+            ReplicateVnodesMessage() : Message(REPLICATE_VNODES) {}
+
+            void addVnode(uint32_t vnodeId, int targetServer)
             {
-                RecoveryRequestMessage msg;
+                vnodeIds.push_back(vnodeId);
+                targetServers.push_back(targetServer);
+            }
 
-                size_t offset = sizeof(MessageType);
+            size_t vnodeCount() const
+            {
+                return vnodeIds.size();
+            }
 
-                // Read the failed server ID
-                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint32_t) +
+                                              vnodeIds.size() * sizeof(uint32_t) +
+                                              intVectorWireSize(targetServers));
+                writer.appendValue(static_cast<uint32_t>(vnodeIds.size()));
+                for (uint32_t vnodeId : vnodeIds)
+                {
+                    writer.appendValue(vnodeId);
+                }
+                writer.appendIntVector(targetServers);
+                return writer.take();
+            }
+
+            static ReplicateVnodesMessage deserialize(const std::vector<char> &buffer)
+            {
+                ReplicateVnodesMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the vnode count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the vnode IDs
+                msg.vnodeIds.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.vnodeIds.push_back(readLE32(buffer.data() + offset));
+                    offset += sizeof(uint32_t);
+                }
+
+                // Read the target servers
+                msg.targetServers = deserializeIntVector(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // One vnode's shard pushed from a surviving replica to its new
+        // owner during re-replication. Applied through the bulk loader;
+        // deliberately unacknowledged, so concurrently recovering servers
+        // never block on each other.
+        struct VnodeShardMessage : public Message
+        {
+            uint32_t vnodeId;
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            std::vector<int> objectIds;
+
+            VnodeShardMessage() : Message(VNODE_SHARD), vnodeId(0) {}
+            explicit VnodeShardMessage(uint32_t vnode) : Message(VNODE_SHARD), vnodeId(vnode) {}
+
+            void addRecord(const std::string &key, const std::string &value, int objectId)
+            {
+                keys.push_back(key);
+                values.push_back(value);
+                objectIds.push_back(objectId);
+            }
+
+            size_t recordCount() const
+            {
+                return keys.size();
+            }
+
+            std::vector<char> serialize() const override
+            {
+                // Size the wire image once, then append everything in place
+                size_t stringBytes = 0;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    stringBytes += stringWireSize(keys[i]) + stringWireSize(values[i]);
+                }
+
+                BufferWriter writer(type, 2 * sizeof(uint32_t) + stringBytes +
+                                              idListWireSize(objectIds));
+                writer.appendValue(vnodeId);
+                writer.appendValue(static_cast<uint32_t>(keys.size()));
+
+                // Append the key/value strings record by record
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    writer.appendString(keys[i]);
+                    writer.appendString(values[i]);
+                }
+
+                appendIdList(writer, objectIds);
+                return writer.take();
+            }
+
+            static VnodeShardMessage deserialize(const std::vector<char> &buffer)
+            {
+                VnodeShardMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the vnode ID
+                msg.vnodeId = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the record count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the key/value strings
+                msg.keys.reserve(count);
+                msg.values.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.keys.push_back(deserializeString(buffer, offset));
+                    msg.values.push_back(deserializeString(buffer, offset));
+                }
+
+                // Read the object IDs
+                msg.objectIds = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // A batch of log records a primary streams to one replica, tagged
+        // with the highest replication sequence included so the replica
+        // can acknowledge a cumulative high-water mark
+        struct ReplAppendMessage : public Message
+        {
+            uint64_t lastSequence;
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            std::vector<int> objectIds;
+
+            ReplAppendMessage() : Message(REPL_APPEND), lastSequence(0) {}
+
+            void addRecord(const std::string &key, const std::string &value, int objectId)
+            {
+                keys.push_back(key);
+                values.push_back(value);
+                objectIds.push_back(objectId);
+            }
+
+            size_t recordCount() const
+            {
+                return keys.size();
+            }
+
+            std::vector<char> serialize() const override
+            {
+                // Size the wire image once, then append everything in place
+                size_t stringBytes = 0;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    stringBytes += stringWireSize(keys[i]) + stringWireSize(values[i]);
+                }
+
+                BufferWriter writer(type, sizeof(uint64_t) + sizeof(uint32_t) +
+                                              stringBytes + idListWireSize(objectIds));
+                writer.appendValue(lastSequence);
+                writer.appendValue(static_cast<uint32_t>(keys.size()));
+
+                // Append the key/value strings record by record
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    writer.appendString(keys[i]);
+                    writer.appendString(values[i]);
+                }
+
+                appendIdList(writer, objectIds);
+                return writer.take();
+            }
+
+            static ReplAppendMessage deserialize(const std::vector<char> &buffer)
+            {
+                ReplAppendMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the last sequence number
+                memcpy(&msg.lastSequence, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Read the record count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the key/value strings
+                msg.keys.reserve(count);
+                msg.values.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.keys.push_back(deserializeString(buffer, offset));
+                    msg.values.push_back(deserializeString(buffer, offset));
+                }
+
+                // Read the object IDs
+                msg.objectIds = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // A replica's cumulative acknowledgment: every streamed record up
+        // to highWaterMark has been applied. Fire-and-forget, so the
+        // stream never blocks on a slow replica.
+        struct ReplAckMessage : public Message
+        {
+            int serverId;
+            uint64_t highWaterMark;
+
+            ReplAckMessage() : Message(REPL_ACK), serverId(0), highWaterMark(0) {}
+            ReplAckMessage(int server, uint64_t mark)
+                : Message(REPL_ACK), serverId(server), highWaterMark(mark) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int) + sizeof(uint64_t));
+                writer.appendValue(serverId);
+                writer.appendValue(highWaterMark);
+                return writer.take();
+            }
+
+            static ReplAckMessage deserialize(const std::vector<char> &buffer)
+            {
+                ReplAckMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the replica's server ID
+                memcpy(&msg.serverId, buffer.data() + offset, sizeof(int));
                 offset += sizeof(int);
 
-                // Read the coordinator ID
-                memcpy(&msg.coordinatorId, buffer.data() + offset, sizeof(int));
+                // Read the acknowledged high-water mark
+                memcpy(&msg.highWaterMark, buffer.data() + offset, sizeof(uint64_t));
 
                 return msg;
             }
         };
 
-        // Recovery complete message
-        struct RecoveryCompleteMessage : public Message
+        // A rejoining replica asking a peer for everything streamed after
+        // its last applied sequence, so a transient failure costs a delta
+        // instead of a full resync
+        struct ReplCatchupRequestMessage : public Message
         {
-            int failedServerId;
-            bool success;
+            int serverId;
+            uint64_t lastAppliedSequence;
 
-            RecoveryCompleteMessage() : Message(RECOVERY_COMPLETE), failedServerId(0), success(false) {}
-            RecoveryCompleteMessage(int id, bool succ)
-                : Message(RECOVERY_COMPLETE), failedServerId(id), success(succ) {}
+            ReplCatchupRequestMessage() : Message(REPL_CATCHUP_REQUEST), serverId(0), lastAppliedSequence(0) {}
+            ReplCatchupRequestMessage(int server, uint64_t lastApplied)
+                : Message(REPL_CATCHUP_REQUEST), serverId(server), lastAppliedSequence(lastApplied) {}
 
             std::vector<char> serialize() const override
             {
-                auto baseBuffer = Message::serialize();
-                std::vector<char> buffer(baseBuffer.size() + sizeof(int) + sizeof(bool));
+                BufferWriter writer(type, sizeof(int) + sizeof(uint64_t));
+                writer.appendValue(serverId);
+                writer.appendValue(lastAppliedSequence);
+                return writer.take();
+            }
 
-                size_t offset = 0;
+            static ReplCatchupRequestMessage deserialize(const std::vector<char> &buffer)
+            {
+                ReplCatchupRequestMessage msg;
 
-                // Copy the base message
-                memcpy(buffer.data() + offset, baseBuffer.data(), baseBuffer.size());
-                offset += baseBuffer.size();
+                size_t offset = WIRE_HEADER_BYTES;
 
-                // Copy the failed server ID
-                memcpy(buffer.data() + offset, &failedServerId, sizeof(int));
+                // Read the requesting replica's server ID
+                memcpy(&msg.serverId, buffer.data() + offset, sizeof(int));
                 offset += sizeof(int);
 
-                // Copy the success flag
-                memcpy(buffer.data() + offset, &success, sizeof(bool));
+                // Read the last applied sequence
+                memcpy(&msg.lastAppliedSequence, buffer.data() + offset, sizeof(uint64_t));
 
-                return buffer;
+                return msg;
             }
+        };
 
-            static RecoveryCompleteMessage deserialize(const std::vector<char> &buffer)
+        // The peer's catch-up reply: the retained records after the
+        // requested sequence, or windowCovered = false when the bounded
+        // history no longer reaches back far enough and only a full
+        // resync can close the gap
+        struct ReplCatchupMessage : public Message
+        {
+            bool windowCovered;
+            uint64_t lastSequence;
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            std::vector<int> objectIds;
+
+            ReplCatchupMessage() : Message(REPL_CATCHUP), windowCovered(true), lastSequence(0) {}
+
+            void addRecord(const std::string &key, const std::string &value, int objectId)
             {
-                RecoveryCompleteMessage msg;
+                keys.push_back(key);
+                values.push_back(value);
+                objectIds.push_back(objectId);
+            }
 
-                size_t offset = sizeof(MessageType);
+            size_t recordCount() const
+            {
+                return keys.size();
+            }
 
-                // Read the failed server ID
-                memcpy(&msg.failedServerId, buffer.data() + offset, sizeof(int));
+            std::vector<char> serialize() const override
+            {
+                // Size the wire image once, then append everything in place
+                size_t stringBytes = 0;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    stringBytes += stringWireSize(keys[i]) + stringWireSize(values[i]);
+                }
+
+                BufferWriter writer(type, sizeof(bool) + sizeof(uint64_t) +
+                                              sizeof(uint32_t) + stringBytes +
+                                              idListWireSize(objectIds));
+                writer.appendValue(windowCovered);
+                writer.appendValue(lastSequence);
+                writer.appendValue(static_cast<uint32_t>(keys.size()));
+
+                // Append the key/value strings record by record
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    writer.appendString(keys[i]);
+                    writer.appendString(values[i]);
+                }
+
+                appendIdList(writer, objectIds);
+                return writer.take();
+            }
+
+            static ReplCatchupMessage deserialize(const std::vector<char> &buffer)
+            {
+                ReplCatchupMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                // Read the window-covered flag
+                memcpy(&msg.windowCovered, buffer.data() + offset, sizeof(bool));
+                offset += sizeof(bool);
+
+                // Read the last sequence number
+                memcpy(&msg.lastSequence, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                // Read the record count
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                // Read the key/value strings
+                msg.keys.reserve(count);
+                msg.values.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.keys.push_back(deserializeString(buffer, offset));
+                    msg.values.push_back(deserializeString(buffer, offset));
+                }
+
+                // Read the object IDs
+                msg.objectIds = readIdList(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // A server's statistics snapshot: the response to an
+        // AdminMessage(STATS), all fixed-width counters
+        struct ServerStatsMessage : public Message
+        {
+            int serverId;
+            ServerStats stats;
+
+            ServerStatsMessage() : Message(STATS), serverId(0) {}
+            ServerStatsMessage(int server, const ServerStats &s)
+                : Message(STATS), serverId(server), stats(s) {}
+
+            // The counters, in wire order; keep this list in sync with
+            // serialize/deserialize below
+            static constexpr size_t FIELD_COUNT = 24;
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int) + FIELD_COUNT * sizeof(uint64_t));
+                writer.appendValue(serverId);
+                writer.appendValue(stats.exactQueries);
+                writer.appendValue(stats.prefixQueries);
+                writer.appendValue(stats.suffixQueries);
+                writer.appendValue(stats.infixQueries);
+                writer.appendValue(stats.wildcardQueries);
+                writer.appendValue(stats.exactLatencyNs);
+                writer.appendValue(stats.prefixLatencyNs);
+                writer.appendValue(stats.suffixLatencyNs);
+                writer.appendValue(stats.infixLatencyNs);
+                writer.appendValue(stats.wildcardLatencyNs);
+                writer.appendValue(stats.keyTrieNodes);
+                writer.appendValue(stats.valueTrieNodes);
+                writer.appendValue(stats.indexMemoryBytes);
+                writer.appendValue(stats.postingLists);
+                writer.appendValue(stats.postingEntries);
+                writer.appendValue(stats.maxPostingEntries);
+                writer.appendValue(stats.lockWaitNs);
+                writer.appendValue(stats.checkpointCount);
+                writer.appendValue(stats.lastCheckpointMs);
+                writer.appendValue(stats.totalCheckpointMs);
+                writer.appendValue(stats.trieArenaBytes);
+                writer.appendValue(stats.suffixIndexBytes);
+                writer.appendValue(stats.metadataBytes);
+                writer.appendValue(stats.messageBufferBytes);
+                return writer.take();
+            }
+
+            static ServerStatsMessage deserialize(const std::vector<char> &buffer)
+            {
+                ServerStatsMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                memcpy(&msg.serverId, buffer.data() + offset, sizeof(int));
                 offset += sizeof(int);
 
-                // Read the success flag
-                memcpy(&msg.success, buffer.data() + offset, sizeof(bool));
+                // Read the counters in the same order serialize wrote them
+                auto readU64 = [&buffer, &offset]() -> uint64_t
+                {
+                    uint64_t value;
+                    memcpy(&value, buffer.data() + offset, sizeof(uint64_t));
+                    offset += sizeof(uint64_t);
+                    return value;
+                };
+
+                msg.stats.exactQueries = readU64();
+                msg.stats.prefixQueries = readU64();
+                msg.stats.suffixQueries = readU64();
+                msg.stats.infixQueries = readU64();
+                msg.stats.wildcardQueries = readU64();
+                msg.stats.exactLatencyNs = readU64();
+                msg.stats.prefixLatencyNs = readU64();
+                msg.stats.suffixLatencyNs = readU64();
+                msg.stats.infixLatencyNs = readU64();
+                msg.stats.wildcardLatencyNs = readU64();
+                msg.stats.keyTrieNodes = readU64();
+                msg.stats.valueTrieNodes = readU64();
+                msg.stats.indexMemoryBytes = readU64();
+                msg.stats.postingLists = readU64();
+                msg.stats.postingEntries = readU64();
+                msg.stats.maxPostingEntries = readU64();
+                msg.stats.lockWaitNs = readU64();
+                msg.stats.checkpointCount = readU64();
+                msg.stats.lastCheckpointMs = readU64();
+                msg.stats.totalCheckpointMs = readU64();
+                msg.stats.trieArenaBytes = readU64();
+                msg.stats.suffixIndexBytes = readU64();
+                msg.stats.metadataBytes = readU64();
+                msg.stats.messageBufferBytes = readU64();
+
+                return msg;
+            }
+        };
+
+        // Per-key statistics request: names the key whose incrementally
+        // maintained counters the client wants
+        struct KeyStatsRequestMessage : public Message
+        {
+            std::string key;
+            uint64_t requestId;
+
+            KeyStatsRequestMessage() : Message(KEY_STATS), requestId(0) {}
+            KeyStatsRequestMessage(const std::string &k) : Message(KEY_STATS), key(k), requestId(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, stringWireSize(key), requestId);
+                writer.appendString(key);
+                return writer.take();
+            }
+
+            static KeyStatsRequestMessage deserialize(const std::vector<char> &buffer)
+            {
+                KeyStatsRequestMessage msg;
+                msg.requestId = getRequestId(buffer);
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.key = deserializeString(buffer, offset);
+                return msg;
+            }
+        };
+
+        // The key's statistics: record and distinct-value counts plus the
+        // sampled values, so a client can estimate a query's fan-out cost
+        // before issuing it
+        struct KeyStatsResponseMessage : public Message
+        {
+            uint64_t requestId;
+            uint64_t records;
+            uint64_t distinctValues;
+            std::vector<std::string> sampleValues;
+
+            KeyStatsResponseMessage() : Message(KEY_STATS), requestId(0), records(0), distinctValues(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                size_t sampleBytes = 0;
+                for (const auto &value : sampleValues)
+                {
+                    sampleBytes += stringWireSize(value);
+                }
+
+                BufferWriter writer(type, 2 * sizeof(uint64_t) +
+                                              sizeof(uint32_t) + sampleBytes,
+                                    requestId);
+                writer.appendValue(records);
+                writer.appendValue(distinctValues);
+                writer.appendValue(static_cast<uint32_t>(sampleValues.size()));
+                for (const auto &value : sampleValues)
+                {
+                    writer.appendString(value);
+                }
+                return writer.take();
+            }
+
+            static KeyStatsResponseMessage deserialize(const std::vector<char> &buffer)
+            {
+                KeyStatsResponseMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+
+                memcpy(&msg.records, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+                memcpy(&msg.distinctValues, buffer.data() + offset, sizeof(uint64_t));
+                offset += sizeof(uint64_t);
+
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                msg.sampleValues.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.sampleValues.push_back(deserializeString(buffer, offset));
+                }
+
+                return msg;
+            }
+        };
+
+        // Asks a source server to stream a binary snapshot image of the
+        // given vnodes to a joining server. Sent by the coordinating
+        // client on FAULT_TAG; the source acks on RESULT_TAG once every
+        // chunk is on the wire.
+        struct SnapshotRequestMessage : public Message
+        {
+            int32_t targetServer; // DART server ID receiving the snapshot
+            std::vector<uint32_t> vnodeIds;
+
+            SnapshotRequestMessage() : Message(SNAPSHOT_REQUEST), targetServer(-1) {}
+            SnapshotRequestMessage(int target, const std::vector<uint32_t> &vnodes)
+                : Message(SNAPSHOT_REQUEST), targetServer(target), vnodeIds(vnodes) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(int32_t) + sizeof(uint32_t) +
+                                              vnodeIds.size() * sizeof(uint32_t));
+                writer.appendValue(targetServer);
+                writer.appendValue(static_cast<uint32_t>(vnodeIds.size()));
+                for (uint32_t vnodeId : vnodeIds)
+                {
+                    writer.appendValue(vnodeId);
+                }
+                return writer.take();
+            }
+
+            static SnapshotRequestMessage deserialize(const std::vector<char> &buffer)
+            {
+                SnapshotRequestMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.targetServer = static_cast<int32_t>(readLE32(buffer.data() + offset));
+                offset += sizeof(int32_t);
+
+                size_t count = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+
+                msg.vnodeIds.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    msg.vnodeIds.push_back(readLE32(buffer.data() + offset));
+                    offset += sizeof(uint32_t);
+                }
+
+                return msg;
+            }
+        };
+
+        // One chunk of a snapshot image streamed from a source server to a
+        // joining server. Chunks from one source arrive in order; the
+        // final chunk carries lastChunk = 1 and the receiver checks the
+        // reassembled size against imageBytes before loading.
+        struct SnapshotChunkMessage : public Message
+        {
+            uint32_t chunkIndex;
+            uint8_t lastChunk;
+            uint64_t imageBytes; // Total image size, for the reassembly check
+            std::string payload;
+
+            SnapshotChunkMessage()
+                : Message(SNAPSHOT_CHUNK), chunkIndex(0), lastChunk(0), imageBytes(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, sizeof(uint32_t) + sizeof(uint8_t) +
+                                              sizeof(uint64_t) + stringWireSize(payload));
+                writer.appendValue(chunkIndex);
+                writer.appendValue(lastChunk);
+                writer.appendValue(imageBytes);
+                writer.appendString(payload);
+                return writer.take();
+            }
+
+            static SnapshotChunkMessage deserialize(const std::vector<char> &buffer)
+            {
+                SnapshotChunkMessage msg;
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.chunkIndex = readLE32(buffer.data() + offset);
+                offset += sizeof(uint32_t);
+                msg.lastChunk = static_cast<uint8_t>(buffer[offset]);
+                offset += sizeof(uint8_t);
+                msg.imageBytes = readLE64(buffer.data() + offset);
+                offset += sizeof(uint64_t);
+                msg.payload = deserializeString(buffer, offset);
+
+                return msg;
+            }
+        };
+
+        // Cursor-paged query: cursor 0 opens the query, the response's
+        // cursor resumes it, and the server slices pages out of a pinned
+        // result set instead of recomputing the query per page
+        struct PagedQueryMessage : public Message
+        {
+            std::string queryStr;
+            uint64_t epoch; // Routing epoch the client routed under; 0 means unversioned
+            uint64_t cursor;
+            uint32_t pageSize;
+            uint64_t requestId;
+
+            PagedQueryMessage() : Message(PAGED_QUERY), epoch(0), cursor(0), pageSize(0), requestId(0) {}
+            PagedQueryMessage(const std::string &q, uint64_t routingEpoch, uint64_t resumeCursor,
+                              uint32_t page, uint64_t reqId)
+                : Message(PAGED_QUERY), queryStr(q), epoch(routingEpoch),
+                  cursor(resumeCursor), pageSize(page), requestId(reqId) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, stringWireSize(queryStr) + 2 * sizeof(uint64_t) +
+                                              sizeof(uint32_t),
+                                    requestId);
+                writer.appendString(queryStr);
+                writer.appendValue(epoch);
+                writer.appendValue(cursor);
+                writer.appendValue(pageSize);
+                return writer.take();
+            }
+
+            static PagedQueryMessage deserialize(const std::vector<char> &buffer)
+            {
+                PagedQueryMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.queryStr = deserializeString(buffer, offset);
+                msg.epoch = readLE64(buffer.data() + offset);
+                offset += sizeof(uint64_t);
+                msg.cursor = readLE64(buffer.data() + offset);
+                offset += sizeof(uint64_t);
+                msg.pageSize = readLE32(buffer.data() + offset);
+
+                return msg;
+            }
+        };
+
+        // One page of a paged query's results, with the cursor that
+        // resumes the traversal (0 once the result set is exhausted)
+        struct PagedResponseMessage : public Message
+        {
+            uint64_t requestId;
+            uint64_t cursor;
+            uint8_t exhausted;
+            std::vector<int> results;
+
+            PagedResponseMessage() : Message(PAGED_RESPONSE), requestId(0), cursor(0), exhausted(0) {}
+
+            std::vector<char> serialize() const override
+            {
+                BufferWriter writer(type, 2 * sizeof(uint64_t) + sizeof(uint8_t) +
+                                              idListWireSize(results),
+                                    requestId);
+                writer.appendValue(cursor);
+                writer.appendValue(exhausted);
+                appendIdList(writer, results);
+                return writer.take();
+            }
+
+            static PagedResponseMessage deserialize(const std::vector<char> &buffer)
+            {
+                PagedResponseMessage msg;
+                msg.requestId = getRequestId(buffer);
+
+                size_t offset = WIRE_HEADER_BYTES;
+                msg.cursor = readLE64(buffer.data() + offset);
+                offset += sizeof(uint64_t);
+                msg.exhausted = static_cast<uint8_t>(buffer[offset]);
+                offset += sizeof(uint8_t);
+                msg.results = readIdList(buffer, offset);
 
                 return msg;
             }
@@ -1,6 +1,61 @@
 #include "MPIServer.hpp"
+#include "../query/ResultSet.hpp"
+#include "../query/MultiConditionQuery.hpp"
+#include "../query/QueryGovernor.hpp"
+#include "../trace/Tracer.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace
+{
+
+    // Hint log helpers, mirroring the server's checkpoint encoding:
+    // fixed-width fields appended to an in-memory image
+
+    template <typename T>
+    void appendScalar(std::string &buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readScalar(const std::string &buffer, size_t &offset, T &value)
+    {
+        if (offset + sizeof(T) > buffer.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    void appendString(std::string &buffer, const std::string &s)
+    {
+        appendScalar(buffer, static_cast<uint32_t>(s.length()));
+        buffer.append(s);
+    }
+
+    bool readString(const std::string &buffer, size_t &offset, std::string &s)
+    {
+        uint32_t length;
+        if (!readScalar(buffer, offset, length) || offset + length > buffer.size())
+        {
+            return false;
+        }
+        s.assign(buffer.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+} // namespace
 
 namespace idioms
 {
@@ -24,33 +79,490 @@ namespace idioms
             server = std::make_unique<DistributedIdiomsServer>(
                 rank - 1, dataDir, router, useSuffixTreeMode);
 
+            // Hints held for down replicas survive our own restarts; the
+            // server constructor has already created the data directory
+            loadHintQueue();
+            hintLog.open(hintLogPath(), std::ios::binary | std::ios::app);
+
+            // Governor limits; unset keeps the defaults, "0" disables
+            if (const char *env = std::getenv("IDIOMS_QUERY_COST_CAP"))
+            {
+                queryCostCap = std::strtoull(env, nullptr, 10);
+            }
+            if (const char *env = std::getenv("IDIOMS_QUERY_VISIT_BUDGET"))
+            {
+                queryVisitBudget = std::strtoull(env, nullptr, 10);
+            }
+            if (const char *env = std::getenv("IDIOMS_QUERY_TIME_BUDGET_MS"))
+            {
+                queryTimeBudgetMs = std::strtoll(env, nullptr, 10);
+            }
+
             std::cout << "MPI Server " << rank << " initialized (DART server ID: " << (rank - 1) << ")" << std::endl;
         }
 
         MPIServer::~MPIServer()
         {
             shutdown();
+
+            // Stop the replication stream
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+                replRunning = false;
+            }
+            replCv.notify_all();
+            if (replThread.joinable())
+            {
+                replThread.join();
+            }
+
+            // Stop the worker pool
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+                workersRunning = false;
+            }
+            workCv.notify_all();
+            for (auto &worker : workerThreads)
+            {
+                if (worker.joinable())
+                {
+                    worker.join();
+                }
+            }
+
+            // Stop the writer pool; each writer drains its queue first
+            writersRunning.store(false);
+            for (auto &queue : writeQueues)
+            {
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                queue->cv.notify_all();
+            }
+            for (auto &writer : writerThreads)
+            {
+                if (writer.joinable())
+                {
+                    writer.join();
+                }
+            }
+        }
+
+        bool MPIServer::enableWorkerPool(int numThreads)
+        {
+            // Workers send responses concurrently, which needs full MPI
+            // thread support
+            int provided;
+            MPI_Query_thread(&provided);
+            if (provided != MPI_THREAD_MULTIPLE)
+            {
+                std::cout << "Server " << rank << " worker pool disabled: "
+                          << "MPI_THREAD_MULTIPLE not available" << std::endl;
+                return false;
+            }
+
+            workersRunning = true;
+
+            // Batch-class work may hold at most half the pool, so
+            // interactive queries always find a free worker
+            batchConcurrencyLimit = numThreads > 1 ? numThreads / 2 : 1;
+
+            for (int i = 0; i < numThreads; i++)
+            {
+                workerThreads.emplace_back(&MPIServer::workerLoop, this);
+            }
+
+            std::cout << "Server " << rank << " worker pool started with "
+                      << numThreads << " threads (batch limit "
+                      << batchConcurrencyLimit << ")" << std::endl;
+            return true;
+        }
+
+        bool MPIServer::enableWriterPool(int numThreads)
+        {
+            // Writers acknowledge writes concurrently, which needs full
+            // MPI thread support
+            int provided;
+            MPI_Query_thread(&provided);
+            if (provided != MPI_THREAD_MULTIPLE)
+            {
+                std::cout << "Server " << rank << " writer pool disabled: "
+                          << "MPI_THREAD_MULTIPLE not available" << std::endl;
+                return false;
+            }
+
+            writersRunning.store(true);
+            for (int i = 0; i < numThreads; i++)
+            {
+                writeQueues.push_back(std::make_unique<WriteQueue>());
+            }
+            for (int i = 0; i < numThreads; i++)
+            {
+                writerThreads.emplace_back(&MPIServer::writerLoop, this,
+                                           static_cast<size_t>(i));
+            }
+
+            std::cout << "Server " << rank << " writer pool started with "
+                      << numThreads << " threads" << std::endl;
+            return true;
+        }
+
+        bool MPIServer::isWritePathMessage(MessageType type)
+        {
+            // Batch loads stay on the worker pool: the bulk loader already
+            // partitions its runs per shard internally
+            return type == CREATE_INDEX || type == DELETE_INDEX;
+        }
+
+        size_t MPIServer::writeQueueIndexFor(const std::vector<char> &buffer) const
+        {
+            // Both write messages serialize the length-prefixed key first;
+            // peek it in place instead of deserializing the whole message
+            size_t offset = WIRE_HEADER_BYTES;
+            uint32_t keyLength = readLE32(buffer.data() + offset);
+            std::string_view key(buffer.data() + offset + sizeof(uint32_t), keyLength);
+
+            // Same shard, same queue: writes to one virtual node stay
+            // ordered while different shards drain in parallel
+            return router->getVirtualNodeId(key) % writeQueues.size();
+        }
+
+        void MPIServer::writerLoop(size_t queueIndex)
+        {
+            WriteQueue &queue = *writeQueues[queueIndex];
+
+            while (true)
+            {
+                WorkItem item;
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    queue.cv.wait(lock, [this, &queue]
+                                  { return !queue.items.empty() ||
+                                           !writersRunning.load(); });
+
+                    if (queue.items.empty())
+                    {
+                        return; // Shutting down and drained
+                    }
+
+                    item = std::move(queue.items.front());
+                    queue.items.pop();
+                }
+
+                try
+                {
+                    handleMessage(item.buffer, item.sourceRank);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Error handling write on server " << rank << ": "
+                              << e.what() << std::endl;
+
+                    sendErrorResponse(e.what(), item.sourceRank, RESULT_TAG);
+                }
+
+                // Recycle the receive buffer for the next request
+                messageBufferPool().release(std::move(item.buffer));
+            }
+        }
+
+        bool MPIServer::isPoolableMessage(MessageType type)
+        {
+            switch (type)
+            {
+            case CREATE_INDEX:
+            case BATCH_CREATE_INDEX:
+            case DELETE_INDEX:
+            case BATCH_DELETE_INDEX:
+            case DELETE_BY_QUERY:
+            case QUERY:
+            case TREE_QUERY:
+            case STREAM_QUERY:
+            case PAGED_QUERY:
+            case SUBSCRIBE_QUERY:
+            case REPL_APPEND:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        int MPIServer::classifyWork(const std::vector<char> &buffer) const
+        {
+            if (Message::getType(buffer) != QUERY)
+            {
+                // Index mutations and other poolable work stay interactive
+                return 0;
+            }
+
+            QueryMessage msg = QueryMessage::deserialize(buffer);
+            if (msg.priority >= PRIORITY_BATCH)
+            {
+                return 1;
+            }
+
+            // Expensive shapes run batch-class regardless of what the
+            // client declared: *=* from an interactive session is still a
+            // full scan. The planner's per-condition estimate is the
+            // classifier; 40 is the cost of a single wildcard.
+            try
+            {
+                std::shared_ptr<const query::MultiConditionQuery> parsed =
+                    query::parsedQuery(msg.queryStr);
+                int cost = 0;
+                for (const query::QueryCondition &cond : parsed->getConditions())
+                {
+                    cost += query::conditionCost(cond);
+                }
+                if (cost >= 40)
+                {
+                    return 1;
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Unparseable here means the handler will reject it; let
+                // it through on the interactive queue
+            }
+            return 0;
+        }
+
+        void MPIServer::workerLoop()
+        {
+            while (true)
+            {
+                WorkItem item;
+                bool isBatch = false;
+
+                {
+                    std::unique_lock<std::mutex> lock(workMutex);
+                    workCv.wait(lock, [this]
+                                { return !workQueues[0].empty() ||
+                                         (!workQueues[1].empty() &&
+                                          batchInFlight < batchConcurrencyLimit) ||
+                                         !workersRunning; });
+
+                    if (!workersRunning && workQueues[0].empty() && workQueues[1].empty())
+                    {
+                        return;
+                    }
+
+                    // Interactive work first; batch only within its limit
+                    if (!workQueues[0].empty())
+                    {
+                        item = std::move(workQueues[0].front());
+                        workQueues[0].pop();
+                    }
+                    else if (!workQueues[1].empty() &&
+                             batchInFlight < batchConcurrencyLimit)
+                    {
+                        item = std::move(workQueues[1].front());
+                        workQueues[1].pop();
+                        isBatch = true;
+                        batchInFlight++;
+                    }
+                    else
+                    {
+                        continue; // Shutting down with batch gated
+                    }
+                }
+
+                try
+                {
+                    handleMessage(item.buffer, item.sourceRank);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Error handling message on server " << rank << ": "
+                              << e.what() << std::endl;
+
+                    sendErrorResponse(e.what(), item.sourceRank, RESULT_TAG);
+                }
+
+                if (isBatch)
+                {
+                    std::lock_guard<std::mutex> lock(workMutex);
+                    batchInFlight--;
+                    workCv.notify_one();
+                }
+
+                // Recycle the receive buffer for the next request
+                messageBufferPool().release(std::move(item.buffer));
+            }
+        }
+
+        void MPIServer::enableSharedMemoryTransport()
+        {
+            shm = std::make_unique<ShmTransport>();
         }
 
         void MPIServer::run()
         {
             std::cout << "MPI Server " << rank << " running..." << std::endl;
 
+            // Ring of pre-posted persistent receives: the channel to every
+            // client and peer is fixed for the process lifetime, so the
+            // envelopes are set up once with MPI_Recv_init and each message
+            // lands directly in a pre-posted slot instead of taking an
+            // unexpected-message copy. One ring per inbound tag — never
+            // OVERSIZE_TAG, whose exactly-sized payloads must only match
+            // the receive posted for them below after their notice arrives.
+            //
+            // Each tag's slots are consumed strictly in the order they were
+            // posted. MPI matches same-tag messages to posted receives in
+            // posting order, but makes no promise about which completed
+            // request a wait over all slots hands back first — waiting on
+            // the whole ring at once can surface a later arrival before an
+            // earlier one. Waiting only on every tag's oldest-posted slot
+            // keeps delivery a per-tag FIFO (and therefore per-source FIFO),
+            // which the replication and writer paths rely on; the remaining
+            // depth still absorbs bursts behind the front slot.
+            const int inboundTags[] = {ADMIN_TAG, INDEX_TAG, QUERY_TAG,
+                                       RESULT_TAG, FAULT_TAG};
+            const int numTags = static_cast<int>(sizeof(inboundTags) / sizeof(inboundTags[0]));
+            const int ringSize = numTags * RECV_RING_DEPTH;
+
+            std::vector<std::vector<char>> ringSlots(ringSize,
+                                                     std::vector<char>(CHANNEL_SLOT_BYTES));
+            std::vector<MPI_Request> ringRequests(ringSize);
+            for (int i = 0; i < ringSize; i++)
+            {
+                MPI_Recv_init(ringSlots[i].data(), static_cast<int>(CHANNEL_SLOT_BYTES),
+                              MPI_CHAR, MPI_ANY_SOURCE, inboundTags[i / RECV_RING_DEPTH],
+                              MPI_COMM_WORLD, &ringRequests[i]);
+            }
+            // Start one slot at a time — MPI_Startall posts in arbitrary
+            // order, which would leave the initial matching order undefined
+            for (int i = 0; i < ringSize; i++)
+            {
+                MPI_Start(&ringRequests[i]);
+            }
+
+            // Posting order per tag, oldest slot at the front; the wait set
+            // holds a handle copy of each tag's front slot (persistent
+            // request handles stay valid across completion, so the copies
+            // never dangle)
+            std::vector<std::deque<int>> postedOrder(numTags);
+            for (int i = 0; i < ringSize; i++)
+            {
+                postedOrder[i / RECV_RING_DEPTH].push_back(i);
+            }
+            std::vector<MPI_Request> frontRequests(numTags);
+            for (int t = 0; t < numTags; t++)
+            {
+                frontRequests[t] = ringRequests[postedOrder[t].front()];
+            }
+
             MPI_Status status;
             int msgSize;
 
             while (running.load())
             {
-                // Probe for any incoming message
-                MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-
-                // Get the message size
+                // Wait for the next filled front slot
+                int tagIndex;
+                MPI_Waitany(numTags, frontRequests.data(), &tagIndex, &status);
                 MPI_Get_count(&status, MPI_CHAR, &msgSize);
+                int slot = postedOrder[tagIndex].front();
+
+                // Copy out and restart the slot right away, so the ring
+                // keeps absorbing messages while this one is handled; the
+                // recycled slot moves to the back of its tag's posting order
+                auto buffer = messageBufferPool().acquire(msgSize);
+                buffer.resize(msgSize);
+                memcpy(buffer.data(), ringSlots[slot].data(), msgSize);
+                MPI_Start(&ringRequests[slot]);
+                postedOrder[tagIndex].pop_front();
+                postedOrder[tagIndex].push_back(slot);
+                frontRequests[tagIndex] = ringRequests[postedOrder[tagIndex].front()];
+
+                // An oversize notice means the real message follows on
+                // OVERSIZE_TAG; post its receive exactly-sized
+                if (Message::getType(buffer) == LARGE_PAYLOAD)
+                {
+                    auto notice = LargePayloadMessage::deserialize(buffer);
+                    messageBufferPool().release(std::move(buffer));
+
+                    buffer = messageBufferPool().acquire(notice.payloadBytes);
+                    buffer.resize(notice.payloadBytes);
+                    MPI_Recv(buffer.data(), static_cast<int>(notice.payloadBytes), MPI_CHAR,
+                             status.MPI_SOURCE, OVERSIZE_TAG, MPI_COMM_WORLD,
+                             MPI_STATUS_IGNORE);
+                }
+
+                // A descriptor means the real message is in shared memory
+                if (shm && Message::getType(buffer) == SHM_PAYLOAD)
+                {
+                    auto descriptor = ShmPayloadMessage::deserialize(buffer);
+                    messageBufferPool().release(std::move(buffer));
+                    buffer = shm->fetchPayload(status.MPI_SOURCE, descriptor.slot);
+                }
+
+                // Responses addressed to this rank belong to a handler
+                // waiting on them (tree-query child results); deposit them
+                // in the mailbox instead of dispatching
+                MessageType incomingType = Message::getType(buffer);
+                if (incomingType == RESPONSE || incomingType == ERROR_RESPONSE)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(childResultMutex);
+                        childResults[status.MPI_SOURCE].push(std::move(buffer));
+                    }
+                    childResultCv.notify_all();
+                    continue;
+                }
+
+                // Single-record writes go to the partitioned writer pool:
+                // one queue per writer, chosen by the key's virtual node,
+                // so different shards ingest concurrently and one shard's
+                // writes keep their arrival order
+                if (!writerThreads.empty() && isWritePathMessage(Message::getType(buffer)))
+                {
+                    size_t queueIndex = writeQueueIndexFor(buffer);
+                    WriteQueue &queue = *writeQueues[queueIndex];
+                    {
+                        std::lock_guard<std::mutex> lock(queue.mutex);
+                        queue.items.push(WorkItem{std::move(buffer), status.MPI_SOURCE, 0});
+                    }
+                    queue.cv.notify_one();
+                    continue;
+                }
 
-                // Read the message
-                std::vector<char> buffer(msgSize);
-                MPI_Recv(buffer.data(), msgSize, MPI_CHAR, status.MPI_SOURCE,
-                         status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                // Data operations go to the worker pool when one is
+                // running; admin and membership messages stay here
+                if (!workerThreads.empty() && isPoolableMessage(Message::getType(buffer)))
+                {
+                    int priorityClass = classifyWork(buffer);
+
+                    if (priorityClass > 0)
+                    {
+                        // Queue-depth admission: past the limit, queueing
+                        // another scan only grows everyone's tail. Tell
+                        // the client when to come back instead.
+                        size_t depth;
+                        {
+                            std::lock_guard<std::mutex> lock(workMutex);
+                            depth = workQueues[1].size();
+                        }
+                        if (depth >= BATCH_QUEUE_LIMIT)
+                        {
+                            uint64_t requestId = Message::getRequestId(buffer);
+                            uint32_t retryMs = static_cast<uint32_t>(10 * depth);
+                            BusyResponseMessage busy(requestId, retryMs);
+                            auto busyBuffer = busy.serialize();
+                            MPI_Send(busyBuffer.data(), busyBuffer.size(), MPI_CHAR,
+                                     status.MPI_SOURCE, RESULT_TAG, MPI_COMM_WORLD);
+                            messageBufferPool().release(std::move(busyBuffer));
+                            messageBufferPool().release(std::move(buffer));
+                            continue;
+                        }
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(workMutex);
+                        workQueues[priorityClass].push(
+                            WorkItem{std::move(buffer), status.MPI_SOURCE, priorityClass});
+                    }
+                    workCv.notify_one();
+                    continue;
+                }
 
                 // Handle the message
                 try
@@ -65,6 +577,18 @@ namespace idioms
                     // Send error response
                     sendErrorResponse(e.what(), status.MPI_SOURCE, RESULT_TAG);
                 }
+
+                // Recycle the receive buffer for the next request
+                messageBufferPool().release(std::move(buffer));
+            }
+
+            // Retire the ring: cancel the still-posted receives and free
+            // the persistent requests before the slots go out of scope
+            for (int i = 0; i < ringSize; i++)
+            {
+                MPI_Cancel(&ringRequests[i]);
+                MPI_Wait(&ringRequests[i], MPI_STATUS_IGNORE);
+                MPI_Request_free(&ringRequests[i]);
             }
 
             std::cout << "MPI Server " << rank << " shutting down..." << std::endl;
@@ -94,20 +618,138 @@ namespace idioms
                 handleCreateIndexMessage(msg, sourceRank);
                 break;
             }
+            case BATCH_CREATE_INDEX:
+            {
+                auto msg = BatchCreateIndexMessage::deserialize(message);
+                handleBatchCreateIndexMessage(msg, sourceRank);
+                break;
+            }
             case DELETE_INDEX:
             {
                 auto msg = DeleteIndexMessage::deserialize(message);
                 handleDeleteIndexMessage(msg, sourceRank);
                 break;
             }
+            case BATCH_DELETE_INDEX:
+            {
+                auto msg = BatchDeleteIndexMessage::deserialize(message);
+                handleBatchDeleteIndexMessage(msg, sourceRank);
+                break;
+            }
+            case DELETE_BY_QUERY:
+            {
+                auto msg = DeleteByQueryMessage::deserialize(message);
+                handleDeleteByQueryMessage(msg, sourceRank);
+                break;
+            }
             case QUERY:
             {
                 auto msg = QueryMessage::deserialize(message);
                 handleQueryMessage(msg, sourceRank);
                 break;
             }
+            case CANCEL_QUERY:
+            {
+                auto msg = CancelQueryMessage::deserialize(message);
+                handleCancelQueryMessage(msg, sourceRank);
+                break;
+            }
+            case TREE_QUERY:
+            {
+                auto msg = TreeQueryMessage::deserialize(message);
+                handleTreeQueryMessage(msg, sourceRank);
+                break;
+            }
+            case STREAM_QUERY:
+            {
+                auto msg = StreamQueryMessage::deserialize(message);
+                handleStreamQueryMessage(msg, sourceRank);
+                break;
+            }
+            case PAGED_QUERY:
+            {
+                auto msg = PagedQueryMessage::deserialize(message);
+                handlePagedQueryMessage(msg, sourceRank);
+                break;
+            }
+            case EPOCH_UPDATE:
+            {
+                auto msg = EpochUpdateMessage::deserialize(message);
+                handleEpochUpdateMessage(msg, sourceRank);
+                break;
+            }
+            case SUBSCRIBE_QUERY:
+            {
+                auto msg = SubscribeQueryMessage::deserialize(message);
+                handleSubscribeQueryMessage(msg, sourceRank);
+                break;
+            }
+            case REPLICATE_VNODES:
+            {
+                auto msg = ReplicateVnodesMessage::deserialize(message);
+                handleReplicateVnodesMessage(msg, sourceRank);
+                break;
+            }
+            case VNODE_SHARD:
+            {
+                auto msg = VnodeShardMessage::deserialize(message);
+                handleVnodeShardMessage(msg, sourceRank);
+                break;
+            }
+            case SNAPSHOT_REQUEST:
+            {
+                auto msg = SnapshotRequestMessage::deserialize(message);
+                handleSnapshotRequestMessage(msg, sourceRank);
+                break;
+            }
+            case SNAPSHOT_CHUNK:
+            {
+                auto msg = SnapshotChunkMessage::deserialize(message);
+                handleSnapshotChunkMessage(msg, sourceRank);
+                break;
+            }
+            case REPL_APPEND:
+            {
+                auto msg = ReplAppendMessage::deserialize(message);
+                handleReplAppendMessage(msg, sourceRank);
+                break;
+            }
+            case REPL_ACK:
+            {
+                auto msg = ReplAckMessage::deserialize(message);
+                handleReplAckMessage(msg, sourceRank);
+                break;
+            }
+            case REPL_CATCHUP_REQUEST:
+            {
+                auto msg = ReplCatchupRequestMessage::deserialize(message);
+                handleReplCatchupRequestMessage(msg, sourceRank);
+                break;
+            }
+            case REPL_CATCHUP:
+            {
+                auto msg = ReplCatchupMessage::deserialize(message);
+                handleReplCatchupMessage(msg, sourceRank);
+                break;
+            }
+            case KEY_STATS:
+            {
+                auto msg = KeyStatsRequestMessage::deserialize(message);
+                handleKeyStatsMessage(msg, sourceRank);
+                break;
+            }
+            case COORD_CHECKPOINT:
+            {
+                auto msg = CoordinatedCheckpointMessage::deserialize(message);
+                handleCoordinatedCheckpointMessage(msg, sourceRank);
+                break;
+            }
             case CHECKPOINT:
+            case CHECKPOINT_ASYNC:
+            case CHECKPOINT_STATUS:
             case RECOVER:
+            case CATCH_UP:
+            case STATS:
             case SHUTDOWN:
             {
                 auto msg = AdminMessage::deserialize(message);
@@ -127,10 +769,49 @@ namespace idioms
             // Add the indexed key to the server
             server->addIndexedKey(msg.key, msg.value, msg.objectId);
 
+            // Stream the record to this key's replicas asynchronously; the
+            // client pays for one write, not one per replica
+            enqueueReplication(msg.key, msg.value, msg.objectId);
+
+            // Send success response
+            ResponseMessage response;
+            response.success = true;
+            sendResponse(response, sourceRank, RESULT_TAG);
+
+            // Deliver any standing-query deltas this insert produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::handleBatchCreateIndexMessage(const BatchCreateIndexMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling BATCH_CREATE_INDEX with "
+                      << msg.recordCount() << " records" << std::endl;
+
+            // Hand the whole batch to the server's bulk loader
+            std::vector<IndexRecord> records;
+            records.reserve(msg.recordCount());
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                records.emplace_back(msg.keys[i], msg.values[i], msg.objectIds[i]);
+            }
+
+            server->bulkLoadIndexedKeys(std::move(records));
+
+            // Stream the batch to each key's replicas asynchronously; the
+            // stream regroups the records per replica, so each one receives
+            // a batch of its own
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                enqueueReplication(msg.keys[i], msg.values[i], msg.objectIds[i]);
+            }
+
             // Send success response
             ResponseMessage response;
             response.success = true;
             sendResponse(response, sourceRank, RESULT_TAG);
+
+            // One notification covers the whole batch's deltas
+            pushStandingQueryNotifications();
         }
 
         void MPIServer::handleDeleteIndexMessage(const DeleteIndexMessage &msg, int sourceRank)
@@ -145,13 +826,81 @@ namespace idioms
             ResponseMessage response;
             response.success = true;
             sendResponse(response, sourceRank, RESULT_TAG);
+
+            // Deliver any standing-query deltas this delete produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::handleBatchDeleteIndexMessage(const BatchDeleteIndexMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling BATCH_DELETE_INDEX with "
+                      << msg.recordCount() << " records" << std::endl;
+
+            // Hand the whole batch to the server's batched tombstone path
+            std::vector<IndexRecord> records;
+            records.reserve(msg.recordCount());
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                records.emplace_back(msg.keys[i], msg.values[i], msg.objectIds[i]);
+            }
+
+            server->bulkRemoveIndexedKeys(std::move(records));
+
+            // Send success response
+            ResponseMessage response;
+            response.success = true;
+            sendResponse(response, sourceRank, RESULT_TAG);
+
+            // One notification covers the whole batch's deltas
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::handleDeleteByQueryMessage(const DeleteByQueryMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling DELETE_BY_QUERY: '"
+                      << msg.queryStr << "'" << std::endl;
+
+            size_t deleted = 0;
+            if (server->canHandleQuery(msg.queryStr))
+            {
+                deleted = server->deleteByQuery(msg.queryStr);
+            }
+
+            // Answer with the victim count, COUNT-query style
+            ResponseMessage response;
+            response.success = true;
+            response.results.push_back(static_cast<int>(deleted));
+            sendResponse(response, sourceRank, RESULT_TAG);
+
+            pushStandingQueryNotifications();
         }
 
         void MPIServer::handleQueryMessage(const QueryMessage &msg, int sourceRank)
         {
+            // The trace ID is the request ID, so this rank's sampling
+            // decision matches the client's for the same request
+            bool traced = trace::tracer().sampled(msg.requestId);
+            uint64_t handleStart = traced ? trace::Tracer::now() : 0;
+
             std::cout << "Server " << rank << " handling QUERY: '"
                       << msg.queryStr << "'" << std::endl;
 
+            // One cheap epoch check replaces timing out against dead ranks:
+            // a client routing under an older epoch gets told to refresh
+            // instead of a possibly wrong answer (epoch 0 is unversioned)
+            if (msg.epoch != 0 && msg.epoch < router->getRoutingEpoch())
+            {
+                std::cout << "Server " << rank << " rejecting stale epoch "
+                          << msg.epoch << " (current "
+                          << router->getRoutingEpoch() << ")" << std::endl;
+
+                sendErrorResponse("Stale routing epoch " + std::to_string(msg.epoch) +
+                                      "; current epoch is " +
+                                      std::to_string(router->getRoutingEpoch()),
+                                  sourceRank, RESULT_TAG);
+                return;
+            }
+
             // Check if this server can handle the query
             if (!server->canHandleQuery(msg.queryStr))
             {
@@ -161,26 +910,992 @@ namespace idioms
                 // Send empty response
                 ResponseMessage response;
                 response.success = true;
+                response.requestId = msg.requestId;
                 sendResponse(response, sourceRank, RESULT_TAG);
                 return;
             }
 
-            // Execute the query
-            std::vector<int> results = server->executeQuery(msg.queryStr);
+            // Reject up front when the planner's estimate already exceeds
+            // the cost cap; cheaper than starting a walk the budget would
+            // kill anyway
+            if (queryCostCap != 0)
+            {
+                uint64_t estimate = server->estimateQueryCost(msg.queryStr);
+                if (estimate > queryCostCap)
+                {
+                    std::cout << "Server " << rank << " rejecting query '"
+                              << msg.queryStr << "': estimated cost "
+                              << estimate << " exceeds cap " << queryCostCap
+                              << std::endl;
+
+                    sendErrorResponse("Query rejected: estimated cost " +
+                                          std::to_string(estimate) +
+                                          " exceeds cap " +
+                                          std::to_string(queryCostCap),
+                                      sourceRank, RESULT_TAG);
+                    return;
+                }
+            }
+
+            // Execute the query under a governor budget: the traversal
+            // checkpoints stop a runaway walk or a client cancel, and the
+            // unwind is answered as an error response
+            uint64_t execStart = traced ? trace::Tracer::now() : 0;
+            std::vector<int> results;
+            auto budget = query::governor().begin(msg.requestId, queryVisitBudget,
+                                                  queryTimeBudgetMs);
+            try
+            {
+                query::BudgetScope scope(budget.get());
+                results = server->executeQuery(msg.queryStr);
+            }
+            catch (const query::QueryCancelled &e)
+            {
+                query::governor().end(msg.requestId);
+
+                std::cout << "Server " << rank << " aborted query '"
+                          << msg.queryStr << "': " << e.what() << std::endl;
+
+                sendErrorResponse(std::string("Query aborted: ") + e.what(),
+                                  sourceRank, RESULT_TAG);
+                return;
+            }
+            query::governor().end(msg.requestId);
+
+            if (traced)
+            {
+                trace::tracer().record(msg.requestId, "server.execute",
+                                       execStart, trace::Tracer::now());
+            }
 
             std::cout << "Server " << rank << " found " << results.size()
                       << " results for query '" << msg.queryStr << "'" << std::endl;
 
-            // Send results
+            // Send results, echoing the request ID so the client can match
+            // responses that completed out of order
             ResponseMessage response(results);
+            response.requestId = msg.requestId;
+            sendResponse(response, sourceRank, RESULT_TAG);
+
+            // The handle span brackets execute plus the reply send; the
+            // gap against the client's wait span is MPI queueing
+            if (traced)
+            {
+                trace::tracer().record(msg.requestId, "server.handle",
+                                       handleStart, trace::Tracer::now());
+            }
+        }
+
+        void MPIServer::handleCancelQueryMessage(const CancelQueryMessage &msg, int sourceRank)
+        {
+            // Runs on the dispatch thread — CANCEL_QUERY is not poolable,
+            // so it cannot queue behind the query it is trying to stop.
+            // Fire-and-forget: the cancelled query answers its own
+            // request with an error response, so a reply here would only
+            // interleave with the response stream the client is matching.
+            bool found = query::governor().cancel(msg.targetRequestId);
+
+            std::cout << "Server " << rank << " CANCEL for request "
+                      << msg.targetRequestId << " from rank " << sourceRank
+                      << (found ? "" : " (not running here)") << std::endl;
+        }
+
+        void MPIServer::handleTreeQueryMessage(const TreeQueryMessage &msg, int sourceRank)
+        {
+            (void)sourceRank; // The reply goes to the tree parent, not the sender
+
+            std::cout << "Server " << rank << " handling TREE_QUERY: '"
+                      << msg.queryStr << "' (" << msg.childRanks.size()
+                      << " children, parent rank " << msg.parentRank << ")" << std::endl;
+
+            // Start with this server's own contribution. A stale epoch only
+            // skips local execution; the children still get drained so the
+            // rest of the tree keeps flowing
+            query::ResultSet resultSet;
+
+            bool staleEpoch = msg.epoch != 0 && msg.epoch < router->getRoutingEpoch();
+            if (staleEpoch)
+            {
+                std::cout << "Server " << rank << " skipping local execution for stale epoch "
+                          << msg.epoch << " (current "
+                          << router->getRoutingEpoch() << ")" << std::endl;
+            }
+            else if (server->canHandleQuery(msg.queryStr))
+            {
+                resultSet.unionWith(query::ResultSet(server->executeQuery(msg.queryStr)));
+            }
+
+            // Merge the children's already-deduplicated results. The
+            // dispatch ring owns every receive on this rank, so child
+            // responses arrive through its mailbox rather than an inline
+            // receive racing the ring's pre-posted slots.
+            for (int childRank : msg.childRanks)
+            {
+                auto buffer = waitForChildResult(childRank);
+
+                if (Message::getType(buffer) == ERROR_RESPONSE)
+                {
+                    auto errorMsg = ErrorResponseMessage::deserialize(buffer);
+                    std::cerr << "Tree query child rank " << childRank
+                              << " failed: " << errorMsg.errorMessage << std::endl;
+                    messageBufferPool().release(std::move(buffer));
+                    continue;
+                }
+
+                auto childResponse = ResponseMessage::deserialize(buffer);
+                messageBufferPool().release(std::move(buffer));
+                resultSet.unionWith(query::ResultSet(std::move(childResponse.results)));
+            }
+
+            // Forward one merged response up the tree
+            ResponseMessage response(resultSet.takeVector());
+            sendResponse(response, msg.parentRank, RESULT_TAG);
+        }
+
+        void MPIServer::handleStreamQueryMessage(const StreamQueryMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling STREAM_QUERY: '"
+                      << msg.queryStr << "' (chunk size " << msg.chunkSize
+                      << ")" << std::endl;
+
+            if (msg.epoch != 0 && msg.epoch < router->getRoutingEpoch())
+            {
+                sendErrorResponse("Stale routing epoch " + std::to_string(msg.epoch) +
+                                      "; current epoch is " +
+                                      std::to_string(router->getRoutingEpoch()),
+                                  sourceRank, RESULT_TAG);
+                return;
+            }
+
+            // Ring of outstanding chunk sends, bounded at STREAM_WINDOW:
+            // reusing a slot waits for its previous send first, so memory
+            // stays bounded and a slow receiver throttles the stream
+            std::vector<std::vector<char>> buffers(STREAM_WINDOW);
+            std::vector<MPI_Request> requests(STREAM_WINDOW, MPI_REQUEST_NULL);
+            size_t next = 0;
+
+            auto sendChunk = [&](const std::vector<int> &ids, bool isLast)
+            {
+                if (requests[next] != MPI_REQUEST_NULL)
+                {
+                    MPI_Wait(&requests[next], MPI_STATUS_IGNORE);
+                }
+
+                ResponseChunkMessage chunk(ids, isLast);
+                buffers[next] = chunk.serialize();
+                MPI_Isend(buffers[next].data(), buffers[next].size(), MPI_CHAR,
+                          sourceRank, RESULT_TAG, MPI_COMM_WORLD, &requests[next]);
+                next = (next + 1) % STREAM_WINDOW;
+            };
+
+            size_t totalSent = 0;
+
+            if (server->canHandleQuery(msg.queryStr))
+            {
+                server->executeQueryStreaming(msg.queryStr, msg.chunkSize,
+                                              [&](const std::vector<int> &chunk)
+                                              {
+                                                  sendChunk(chunk, false);
+                                                  totalSent += chunk.size();
+                                              });
+            }
+
+            // Completion marker, then drain the window
+            sendChunk(std::vector<int>(), true);
+            MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+            // All sends are complete; recycle the ring's buffers
+            for (auto &chunkBuffer : buffers)
+            {
+                messageBufferPool().release(std::move(chunkBuffer));
+            }
+
+            std::cout << "Server " << rank << " streamed " << totalSent
+                      << " results for query '" << msg.queryStr << "'" << std::endl;
+        }
+
+        void MPIServer::handlePagedQueryMessage(const PagedQueryMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling PAGED_QUERY: '"
+                      << msg.queryStr << "' (cursor " << msg.cursor
+                      << ", page size " << msg.pageSize << ")" << std::endl;
+
+            if (msg.epoch != 0 && msg.epoch < router->getRoutingEpoch())
+            {
+                sendErrorResponse("Stale routing epoch " + std::to_string(msg.epoch) +
+                                      "; current epoch is " +
+                                      std::to_string(router->getRoutingEpoch()),
+                                  sourceRank, RESULT_TAG);
+                return;
+            }
+
+            PagedResponseMessage reply;
+            reply.requestId = msg.requestId;
+
+            if (server->canHandleQuery(msg.queryStr))
+            {
+                auto page = server->executeQueryPage(msg.queryStr, msg.cursor,
+                                                     msg.pageSize);
+                reply.cursor = page.cursor;
+                reply.exhausted = page.exhausted ? 1 : 0;
+                reply.results = std::move(page.results);
+            }
+            else
+            {
+                // Nothing here for this query: an empty, exhausted page
+                reply.exhausted = 1;
+            }
+
+            auto buffer = reply.serialize();
+            MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, sourceRank,
+                     RESULT_TAG, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
+        }
+
+        void MPIServer::handleEpochUpdateMessage(const EpochUpdateMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " adopting routing epoch "
+                      << msg.epoch << " (" << msg.downServers.size()
+                      << " servers down)" << std::endl;
+
+            // Servers leaving the down set in this update get their
+            // queued hints replayed once the new view is adopted
+            std::vector<int> recovered;
+            std::unordered_set<int> stillDown(msg.downServers.begin(),
+                                              msg.downServers.end());
+            for (int serverId = 0; serverId < worldSize - 1; serverId++)
+            {
+                if (router->isServerDown(serverId) &&
+                    stillDown.find(serverId) == stillDown.end())
+                {
+                    recovered.push_back(serverId);
+                }
+            }
+
+            // Replace the membership view with the published one, then
+            // adopt the epoch so stale-epoch queries are rejected from
+            // here. The verbatim adoption matters: re-marking transitions
+            // with markServerDown/Up would bump this rank's epoch past
+            // the published one, and the coordinator's own queries would
+            // then be rejected as stale
+            router->adoptMembershipView(msg.downServers, msg.epoch);
+
+            ResponseMessage response;
+            response.success = true;
+            sendResponse(response, sourceRank, ADMIN_TAG);
+
+            for (int serverId : recovered)
+            {
+                replayHintedWrites(serverId + 1);
+            }
+        }
+
+        void MPIServer::handleSubscribeQueryMessage(const SubscribeQueryMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling SUBSCRIBE_QUERY: '"
+                      << msg.queryStr << "'" << std::endl;
+
+            // The registration reply is itself a notification, with added
+            // carrying the initial matches
+            QueryNotifyMessage reply;
+            reply.requestId = msg.requestId;
+            reply.subscriptionId = server->registerStandingQuery(msg.queryStr, reply.added);
+
+            {
+                std::lock_guard<std::mutex> lock(subscriberMutex);
+                subscriberRanks[reply.subscriptionId] = sourceRank;
+            }
+
+            auto buffer = reply.serialize();
+            MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, sourceRank,
+                     RESULT_TAG, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
+        }
+
+        void MPIServer::handleReplicateVnodesMessage(const ReplicateVnodesMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling REPLICATE_VNODES ("
+                      << msg.vnodeCount() << " vnodes)" << std::endl;
+
+            size_t shippedRecords = 0;
+            for (size_t i = 0; i < msg.vnodeIds.size(); i++)
+            {
+                uint32_t vnodeId = msg.vnodeIds[i];
+                int targetServer = msg.targetServers[i];
+
+                // Export only this vnode's live entries from the local
+                // shards; a replica holding nothing of the vnode ships
+                // nothing
+                std::vector<IndexRecord> records = server->exportVirtualNodes({vnodeId});
+                if (records.empty())
+                {
+                    continue;
+                }
+
+                VnodeShardMessage shard(vnodeId);
+                for (const IndexRecord &record : records)
+                {
+                    shard.addRecord(record.key, record.value, record.objectId);
+                }
+
+                // MPI ranks start at 0, but rank 0 is reserved for client.
+                // The push is unacknowledged, so survivors streaming shards
+                // to each other at the same time never block on each other.
+                int targetRank = targetServer + 1;
+                sendToServer(shard.serialize(), targetRank, FAULT_TAG);
+
+                shippedRecords += records.size();
+            }
+
+            std::cout << "Server " << rank << " streamed " << shippedRecords
+                      << " records for re-replication" << std::endl;
+
+            // Ack the coordinator once every shard is on the wire
+            ResponseMessage response;
+            response.success = true;
             sendResponse(response, sourceRank, RESULT_TAG);
         }
 
+        void MPIServer::handleVnodeShardMessage(const VnodeShardMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " adopting vnode " << msg.vnodeId
+                      << " shard (" << msg.recordCount() << " records) from rank "
+                      << sourceRank << std::endl;
+
+            // Several survivors can push overlapping copies of the same
+            // vnode, and this server may hold replica copies itself; load
+            // only the records not already present so metadata pairs never
+            // duplicate
+            std::unordered_set<std::string> present;
+            for (const IndexRecord &record : server->exportVirtualNodes({msg.vnodeId}))
+            {
+                present.insert(record.key + '\x1f' + record.value + '\x1f' +
+                               std::to_string(record.objectId));
+            }
+
+            std::vector<IndexRecord> records;
+            records.reserve(msg.recordCount());
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                std::string fingerprint = msg.keys[i] + '\x1f' + msg.values[i] + '\x1f' +
+                                          std::to_string(msg.objectIds[i]);
+                if (present.insert(fingerprint).second)
+                {
+                    records.emplace_back(msg.keys[i], msg.values[i], msg.objectIds[i]);
+                }
+            }
+
+            if (!records.empty())
+            {
+                server->bulkLoadIndexedKeys(std::move(records));
+            }
+
+            // Deliver any standing-query deltas the adopted shard produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::handleSnapshotRequestMessage(const SnapshotRequestMessage &msg,
+                                                     int sourceRank)
+        {
+            std::cout << "Server " << rank << " handling SNAPSHOT_REQUEST ("
+                      << msg.vnodeIds.size() << " vnodes for server "
+                      << msg.targetServer << ")" << std::endl;
+
+            // One encoded image, sliced into large chunks; the receiver
+            // reassembles and loads it in a single bulk pass
+            std::string image = server->exportSnapshotImage(msg.vnodeIds);
+
+            // MPI ranks start at 0, but rank 0 is reserved for client
+            int targetRank = msg.targetServer + 1;
+            uint32_t chunkIndex = 0;
+            size_t offset = 0;
+            do
+            {
+                size_t chunkBytes = std::min(SNAPSHOT_CHUNK_BYTES, image.size() - offset);
+
+                SnapshotChunkMessage chunk;
+                chunk.chunkIndex = chunkIndex++;
+                chunk.imageBytes = image.size();
+                chunk.payload = image.substr(offset, chunkBytes);
+                offset += chunkBytes;
+                chunk.lastChunk = offset >= image.size() ? 1 : 0;
+
+                sendToServer(chunk.serialize(), targetRank, FAULT_TAG);
+            } while (offset < image.size());
+
+            std::cout << "Server " << rank << " streamed " << image.size()
+                      << " snapshot bytes in " << chunkIndex << " chunks" << std::endl;
+
+            // Ack the coordinator once the whole image is on the wire
+            ResponseMessage response;
+            response.success = true;
+            sendResponse(response, sourceRank, RESULT_TAG);
+        }
+
+        void MPIServer::handleSnapshotChunkMessage(const SnapshotChunkMessage &msg,
+                                                   int sourceRank)
+        {
+            std::string &image = snapshotAssembly[sourceRank];
+            image.append(msg.payload);
+
+            if (!msg.lastChunk)
+            {
+                return;
+            }
+
+            std::cout << "Server " << rank << " reassembled " << image.size()
+                      << " snapshot bytes from rank " << sourceRank << std::endl;
+
+            bool loaded = image.size() == msg.imageBytes &&
+                          server->importSnapshotImage(image);
+            snapshotAssembly.erase(sourceRank);
+
+            if (!loaded)
+            {
+                std::cerr << "Server " << rank << " failed to load snapshot from rank "
+                          << sourceRank << std::endl;
+                return;
+            }
+
+            // The image reflects the source at export time; pull the
+            // records streamed past it so the bootstrap ends current
+            requestCatchUp();
+
+            // Deliver any standing-query deltas the loaded image produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::enqueueReplication(const std::string &key, const std::string &value,
+                                           int objectId)
+        {
+            // The key's replica set minus this server; a write the primary
+            // is the only holder of has nowhere to stream
+            std::vector<int> replicaRanks;
+            for (int serverId : router->getServersForKey(key))
+            {
+                if (serverId == rank - 1)
+                {
+                    continue;
+                }
+
+                // MPI ranks start at 0, but rank 0 is reserved for client
+                if (router->isServerDown(serverId))
+                {
+                    // Hinted handoff: hold the down replica's copy here
+                    // instead of dropping it, and replay it when the
+                    // replica is reported active again
+                    std::lock_guard<std::mutex> lock(hintMutex);
+                    recordHintedWrite(serverId + 1, key, value, objectId);
+                }
+                else
+                {
+                    replicaRanks.push_back(serverId + 1);
+                }
+            }
+
+            if (replicaRanks.empty())
+            {
+                return;
+            }
+
+            startReplicationStream();
+
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+                ReplRecord record{nextReplSequence++, key, value, objectId,
+                                  std::move(replicaRanks)};
+
+                // Retain a bounded window for delta catch-up: a replica
+                // that missed this record while partitioned can fetch it
+                // by sequence instead of resyncing everything
+                replHistory.push_back(record);
+                if (replHistory.size() > REPL_HISTORY_CAPACITY)
+                {
+                    replHistory.pop_front();
+                }
+
+                replQueue.push_back(std::move(record));
+            }
+
+            if (replInline)
+            {
+                // For now, without MPI_THREAD_MULTIPLE the stream flushes
+                // on the ingest path itself; the client still pays for one
+                // write, the primary absorbs the fan-out
+                std::deque<ReplRecord> batch;
+                {
+                    std::lock_guard<std::mutex> lock(replMutex);
+                    batch.swap(replQueue);
+                }
+                shipReplicationBatch(batch);
+            }
+            else
+            {
+                replCv.notify_one();
+            }
+        }
+
+        void MPIServer::startReplicationStream()
+        {
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+                if (replRunning || replInline)
+                {
+                    return;
+                }
+
+                // Streaming from a background thread needs full MPI thread
+                // support, same as the worker pool
+                int provided;
+                MPI_Query_thread(&provided);
+                if (provided != MPI_THREAD_MULTIPLE)
+                {
+                    replInline = true;
+                    return;
+                }
+
+                replRunning = true;
+            }
+
+            replThread = std::thread(&MPIServer::replicationLoop, this);
+            std::cout << "Server " << rank << " replication stream started" << std::endl;
+        }
+
+        void MPIServer::replicationLoop()
+        {
+            while (true)
+            {
+                std::deque<ReplRecord> batch;
+
+                {
+                    std::unique_lock<std::mutex> lock(replMutex);
+
+                    // The wait interval bounds how far the replicas can lag
+                    // behind the primary
+                    replCv.wait_for(lock,
+                                    std::chrono::milliseconds(REPL_FLUSH_INTERVAL_MS),
+                                    [this]
+                                    { return !replQueue.empty() || !replRunning; });
+
+                    if (!replRunning && replQueue.empty())
+                    {
+                        return;
+                    }
+
+                    batch.swap(replQueue);
+                }
+
+                if (!batch.empty())
+                {
+                    shipReplicationBatch(batch);
+                }
+            }
+        }
+
+        void MPIServer::shipReplicationBatch(std::deque<ReplRecord> &batch)
+        {
+            // Group the drained records by destination, so each replica
+            // receives one append per flush regardless of batch size
+            std::unordered_map<int, ReplAppendMessage> perReplica;
+            for (const ReplRecord &record : batch)
+            {
+                for (int replicaRank : record.replicaRanks)
+                {
+                    ReplAppendMessage &msg = perReplica[replicaRank];
+                    msg.addRecord(record.key, record.value, record.objectId);
+                    if (record.sequence > msg.lastSequence)
+                    {
+                        msg.lastSequence = record.sequence;
+                    }
+                }
+            }
+
+            for (const auto &[replicaRank, msg] : perReplica)
+            {
+                sendToServer(msg.serialize(), replicaRank, FAULT_TAG);
+            }
+        }
+
+        void MPIServer::handleReplAppendMessage(const ReplAppendMessage &msg, int sourceRank)
+        {
+            std::cout << "Server " << rank << " applying replication stream ("
+                      << msg.recordCount() << " records, seq "
+                      << msg.lastSequence << ")" << std::endl;
+
+            // Apply through the normal write path so the replica's own WAL
+            // covers the records; no re-replication happens here
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                server->addIndexedKey(msg.keys[i], msg.values[i], msg.objectIds[i]);
+            }
+
+            // Remember how far this source's stream has been applied; a
+            // catch-up after a partition resumes from here
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+                uint64_t &applied = appliedHighWater[sourceRank];
+                if (msg.lastSequence > applied)
+                {
+                    applied = msg.lastSequence;
+                }
+            }
+
+            // Cumulative ack, fire-and-forget: the primary's stream never
+            // blocks on a slow replica
+            ReplAckMessage ack(rank - 1, msg.lastSequence);
+            sendToServer(ack.serialize(), sourceRank, FAULT_TAG);
+
+            // Deliver any standing-query deltas the applied records produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::handleReplAckMessage(const ReplAckMessage &msg, int sourceRank)
+        {
+            (void)sourceRank;
+
+            // High-water marks only move forward; a reordered ack is stale
+            std::lock_guard<std::mutex> lock(replMutex);
+            uint64_t &mark = replicaHighWater[msg.serverId];
+            if (msg.highWaterMark > mark)
+            {
+                mark = msg.highWaterMark;
+            }
+        }
+
+        std::string MPIServer::hintLogPath() const
+        {
+            return dataDir + "/server_" + std::to_string(rank - 1) + "/hints.log";
+        }
+
+        void MPIServer::loadHintQueue()
+        {
+            std::ifstream in(hintLogPath(), std::ios::binary);
+            if (!in.is_open())
+            {
+                return;
+            }
+            std::ostringstream contents;
+            contents << in.rdbuf();
+            std::string buffer = contents.str();
+
+            size_t offset = 0;
+            while (offset < buffer.length())
+            {
+                HintedWrite hint;
+                int32_t targetRank, objectId;
+                if (!readScalar(buffer, offset, targetRank) ||
+                    !readString(buffer, offset, hint.key) ||
+                    !readString(buffer, offset, hint.value) ||
+                    !readScalar(buffer, offset, objectId))
+                {
+                    // Torn tail from a crash mid-append: stop at the last
+                    // complete hint
+                    break;
+                }
+                hint.targetRank = targetRank;
+                hint.objectId = objectId;
+                hintQueue.push_back(std::move(hint));
+            }
+
+            if (!hintQueue.empty())
+            {
+                std::cout << "Server " << rank << " reloaded " << hintQueue.size()
+                          << " hinted writes" << std::endl;
+            }
+        }
+
+        void MPIServer::recordHintedWrite(int targetRank, const std::string &key,
+                                          const std::string &value, int objectId)
+        {
+            hintQueue.push_back({targetRank, key, value, objectId});
+
+            if (hintLog.is_open())
+            {
+                std::string buffer;
+                appendScalar(buffer, static_cast<int32_t>(targetRank));
+                appendString(buffer, key);
+                appendString(buffer, value);
+                appendScalar(buffer, static_cast<int32_t>(objectId));
+
+                // Hints are rare enough to flush one at a time; losing one
+                // silently would recreate the hole handoff exists to close
+                hintLog.write(buffer.data(), buffer.length());
+                hintLog.flush();
+            }
+        }
+
+        void MPIServer::rewriteHintLog()
+        {
+            if (hintLog.is_open())
+            {
+                hintLog.close();
+            }
+
+            std::string buffer;
+            for (const HintedWrite &hint : hintQueue)
+            {
+                appendScalar(buffer, static_cast<int32_t>(hint.targetRank));
+                appendString(buffer, hint.key);
+                appendString(buffer, hint.value);
+                appendScalar(buffer, static_cast<int32_t>(hint.objectId));
+            }
+
+            std::ofstream out(hintLogPath(), std::ios::binary | std::ios::trunc);
+            out.write(buffer.data(), buffer.length());
+            out.close();
+
+            hintLog.open(hintLogPath(), std::ios::binary | std::ios::app);
+        }
+
+        void MPIServer::replayHintedWrites(int recoveredRank)
+        {
+            ReplAppendMessage replay;
+            {
+                std::lock_guard<std::mutex> lock(hintMutex);
+
+                std::deque<HintedWrite> remaining;
+                for (HintedWrite &hint : hintQueue)
+                {
+                    if (hint.targetRank == recoveredRank)
+                    {
+                        replay.addRecord(hint.key, hint.value, hint.objectId);
+                    }
+                    else
+                    {
+                        remaining.push_back(std::move(hint));
+                    }
+                }
+
+                if (replay.recordCount() == 0)
+                {
+                    return;
+                }
+
+                hintQueue.swap(remaining);
+                rewriteHintLog();
+            }
+
+            std::cout << "Server " << rank << " replaying " << replay.recordCount()
+                      << " hinted writes to recovered rank " << recoveredRank
+                      << std::endl;
+
+            // lastSequence stays zero: hints are a side channel, so the
+            // replay must not advance the applied mark past streamed
+            // records a later catch-up still has to fetch
+            sendToServer(replay.serialize(), recoveredRank, FAULT_TAG);
+        }
+
+        void MPIServer::requestCatchUp()
+        {
+            // Ask every live peer for the records it streamed past the
+            // last sequence we applied from it; a 30-second blip then
+            // costs one delta exchange instead of a full resync
+            for (int peerRank = 1; peerRank < worldSize; peerRank++)
+            {
+                if (peerRank == rank || router->isServerDown(peerRank - 1))
+                {
+                    continue;
+                }
+
+                uint64_t lastApplied;
+                {
+                    std::lock_guard<std::mutex> lock(replMutex);
+                    lastApplied = appliedHighWater[peerRank];
+                }
+
+                std::cout << "Server " << rank << " requesting catch-up from rank "
+                          << peerRank << " after sequence " << lastApplied << std::endl;
+
+                ReplCatchupRequestMessage request(rank - 1, lastApplied);
+                sendToServer(request.serialize(), peerRank, FAULT_TAG);
+            }
+        }
+
+        void MPIServer::handleReplCatchupRequestMessage(const ReplCatchupRequestMessage &msg,
+                                                        int sourceRank)
+        {
+            ReplCatchupMessage delta;
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+
+                // The history window only covers the request if nothing
+                // before its resume point has been evicted
+                if (replHistory.empty())
+                {
+                    delta.windowCovered = msg.lastAppliedSequence + 1 >= nextReplSequence;
+                }
+                else
+                {
+                    delta.windowCovered = msg.lastAppliedSequence + 1 >= replHistory.front().sequence;
+                }
+
+                for (const ReplRecord &record : replHistory)
+                {
+                    if (record.sequence <= msg.lastAppliedSequence)
+                    {
+                        continue;
+                    }
+
+                    // Only re-ship what the requester was a live target
+                    // of; records enqueued while it was down were hinted
+                    // to it instead and replay through hinted handoff
+                    int requesterRank = msg.serverId + 1;
+                    if (std::find(record.replicaRanks.begin(), record.replicaRanks.end(),
+                                  requesterRank) == record.replicaRanks.end())
+                    {
+                        continue;
+                    }
+
+                    delta.addRecord(record.key, record.value, record.objectId);
+                    if (record.sequence > delta.lastSequence)
+                    {
+                        delta.lastSequence = record.sequence;
+                    }
+                }
+            }
+
+            std::cout << "Server " << rank << " sending catch-up delta to rank "
+                      << sourceRank << " (" << delta.recordCount() << " records, "
+                      << (delta.windowCovered ? "window covered" : "window expired")
+                      << ")" << std::endl;
+
+            // Fire-and-forget, like the shard pushes: peers catching up
+            // from each other at the same time never block on each other
+            sendToServer(delta.serialize(), sourceRank, FAULT_TAG);
+        }
+
+        void MPIServer::handleReplCatchupMessage(const ReplCatchupMessage &msg, int sourceRank)
+        {
+            if (!msg.windowCovered)
+            {
+                // The peer evicted records we never applied; only a full
+                // recovery can close the gap now
+                std::cout << "Server " << rank << " catch-up window from rank "
+                          << sourceRank << " expired; full recovery required"
+                          << std::endl;
+                return;
+            }
+
+            std::cout << "Server " << rank << " applying catch-up delta ("
+                      << msg.recordCount() << " records) from rank "
+                      << sourceRank << std::endl;
+
+            // Apply through the normal write path so the replica's own WAL
+            // covers the records, same as the live stream
+            for (size_t i = 0; i < msg.recordCount(); i++)
+            {
+                server->addIndexedKey(msg.keys[i], msg.values[i], msg.objectIds[i]);
+            }
+
+            if (msg.lastSequence > 0)
+            {
+                std::lock_guard<std::mutex> lock(replMutex);
+                uint64_t &applied = appliedHighWater[sourceRank];
+                if (msg.lastSequence > applied)
+                {
+                    applied = msg.lastSequence;
+                }
+            }
+
+            // Deliver any standing-query deltas the applied records produced
+            pushStandingQueryNotifications();
+        }
+
+        void MPIServer::pushStandingQueryNotifications()
+        {
+            for (auto &[subscriptionId, delta] : server->drainAllStandingQueryDeltas())
+            {
+                int destRank;
+                {
+                    std::lock_guard<std::mutex> lock(subscriberMutex);
+                    auto it = subscriberRanks.find(subscriptionId);
+                    if (it == subscriberRanks.end())
+                    {
+                        continue;
+                    }
+                    destRank = it->second;
+                }
+
+                QueryNotifyMessage notify;
+                notify.subscriptionId = subscriptionId;
+                notify.added = std::move(delta.added);
+                notify.removed = std::move(delta.removed);
+
+                auto buffer = notify.serialize();
+                MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank,
+                         NOTIFY_TAG, MPI_COMM_WORLD);
+                messageBufferPool().release(std::move(buffer));
+            }
+        }
+
+        void MPIServer::handleKeyStatsMessage(const KeyStatsRequestMessage &msg, int sourceRank)
+        {
+            // A map lookup against the incrementally maintained store;
+            // nothing here walks the trie
+            KeyStatistics stats = server->getKeyStatistics(msg.key);
+
+            KeyStatsResponseMessage reply;
+            reply.requestId = msg.requestId;
+            reply.records = stats.records;
+            reply.distinctValues = stats.distinctValues;
+            reply.sampleValues = std::move(stats.sampleValues);
+
+            auto buffer = reply.serialize();
+            MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, sourceRank,
+                     ADMIN_TAG, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
+        }
+
+        void MPIServer::handleCoordinatedCheckpointMessage(const CoordinatedCheckpointMessage &msg,
+                                                           int sourceRank)
+        {
+            bool success;
+            if (msg.phase == CoordinatedCheckpointMessage::PHASE_PREPARE)
+            {
+                // The coordinator broadcasts prepares before collecting
+                // acks, so every server's image write runs concurrently
+                std::cout << "Server " << rank
+                          << " writing coordinated checkpoint epoch "
+                          << msg.checkpointEpoch << std::endl;
+                success = server->checkpointIndexPrepare(msg.checkpointEpoch);
+            }
+            else
+            {
+                success = server->commitCheckpointManifest(msg.checkpointEpoch);
+            }
+
+            ResponseMessage response;
+            response.success = success;
+            sendResponse(response, sourceRank, ADMIN_TAG);
+        }
+
         void MPIServer::handleAdminMessage(const AdminMessage &msg, int sourceRank)
         {
             std::cout << "Server " << rank << " handling admin message type "
                       << msg.type << std::endl;
 
+            if (msg.type == STATS)
+            {
+                // Stats carry their own response shape; everything else
+                // acks with a plain ResponseMessage below
+                ServerStatsMessage reply(rank - 1, server->getStats());
+                auto buffer = reply.serialize();
+                MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, sourceRank,
+                         ADMIN_TAG, MPI_COMM_WORLD);
+                messageBufferPool().release(std::move(buffer));
+
+                // The per-key attribution goes to this rank's log rather
+                // than the wire: the key list is unbounded and the heavy
+                // keys are what an operator greps for after an OOM
+                for (const auto &[key, bytes] : server->topMemoryKeys(10))
+                {
+                    std::cout << "Server " << (rank - 1) << " memory: key '"
+                              << key << "' ~" << (bytes / 1024) << " KB"
+                              << std::endl;
+                }
+                return;
+            }
+
             bool success = true;
 
             switch (msg.type)
@@ -188,10 +1903,25 @@ namespace idioms
             case CHECKPOINT:
                 success = server->checkpointIndex();
                 break;
+            case CHECKPOINT_ASYNC:
+                success = server->checkpointIndexAsync();
+                break;
+            case CHECKPOINT_STATUS:
+                // Success means the last checkpoint finished and wrote cleanly
+                success = !server->isCheckpointInProgress() &&
+                          server->lastCheckpointSucceeded();
+                break;
             case RECOVER:
                 success = server->recoverIndex();
                 break;
+            case CATCH_UP:
+                requestCatchUp();
+                break;
             case SHUTDOWN:
+                if (trace::tracer().enabled())
+                {
+                    trace::tracer().dump("trace_rank" + std::to_string(rank) + ".log");
+                }
                 shutdown();
                 break;
             default:
@@ -204,13 +1934,81 @@ namespace idioms
             sendResponse(response, sourceRank, ADMIN_TAG);
         }
 
+        std::vector<char> MPIServer::waitForChildResult(int childRank)
+        {
+            std::unique_lock<std::mutex> lock(childResultMutex);
+            childResultCv.wait(lock, [&]()
+                               { auto it = childResults.find(childRank);
+                                 return it != childResults.end() && !it->second.empty(); });
+
+            auto &pending = childResults[childRank];
+            auto buffer = std::move(pending.front());
+            pending.pop();
+            return buffer;
+        }
+
+        void MPIServer::sendToServer(std::vector<char> buffer, int destRank, int tag)
+        {
+            // Small messages land in one of the destination ring's
+            // pre-posted slots as-is
+            if (buffer.size() <= CHANNEL_SLOT_BYTES)
+            {
+                MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank, tag,
+                         MPI_COMM_WORLD);
+                messageBufferPool().release(std::move(buffer));
+                return;
+            }
+
+            // Oversize: announce the byte count so the receiver can post
+            // an exactly-sized receive, then follow with the payload on
+            // OVERSIZE_TAG. The pair goes out under one lock so concurrent
+            // senders cannot interleave their notices and payloads.
+            LargePayloadMessage notice(buffer.size());
+            auto noticeBuffer = notice.serialize();
+
+            {
+                std::lock_guard<std::mutex> lock(oversizeSendMutex);
+                MPI_Send(noticeBuffer.data(), noticeBuffer.size(), MPI_CHAR,
+                         destRank, tag, MPI_COMM_WORLD);
+                MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank,
+                         OVERSIZE_TAG, MPI_COMM_WORLD);
+            }
+
+            messageBufferPool().release(std::move(noticeBuffer));
+            messageBufferPool().release(std::move(buffer));
+        }
+
         void MPIServer::sendResponse(const ResponseMessage &response, int destRank, int tag)
         {
             // Serialize the response
             auto buffer = response.serialize();
 
-            // Send the response
+            // Co-located destinations get the payload through shared
+            // memory; only a slot descriptor crosses the MPI transport
+            if (shm && shm->isLocal(destRank) &&
+                buffer.size() <= ShmTransport::maxPayloadBytes())
+            {
+                ShmPayloadMessage descriptor(shm->stagePayload(buffer));
+                auto descBuffer = descriptor.serialize();
+                MPI_Send(descBuffer.data(), descBuffer.size(), MPI_CHAR,
+                         destRank, tag, MPI_COMM_WORLD);
+                messageBufferPool().release(std::move(descBuffer));
+                messageBufferPool().release(std::move(buffer));
+                return;
+            }
+
+            // A peer server receives through its pre-posted ring, so big
+            // responses (tree-query merges) must respect the slot protocol;
+            // the client probes for its messages and takes any size
+            if (destRank != 0)
+            {
+                sendToServer(std::move(buffer), destRank, tag);
+                return;
+            }
+
+            // Send the response and recycle the buffer
             MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank, tag, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
         }
 
         void MPIServer::sendErrorResponse(const std::string &errorMsg, int destRank, int tag)
@@ -219,8 +2017,9 @@ namespace idioms
             ErrorResponseMessage response(errorMsg);
             auto buffer = response.serialize();
 
-            // Send the error response
+            // Send the error response and recycle the buffer
             MPI_Send(buffer.data(), buffer.size(), MPI_CHAR, destRank, tag, MPI_COMM_WORLD);
+            messageBufferPool().release(std::move(buffer));
         }
 
     } // namespace mpi
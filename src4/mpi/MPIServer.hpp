@@ -4,10 +4,19 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <mpi.h>
 #include "../server/Server.hpp"
 #include "../dart/DART.hpp"
 #include "MPICommon.hpp"
+#include "ShmTransport.hpp"
 
 namespace idioms
 {
@@ -34,15 +43,256 @@ namespace idioms
             // Shared DART router
             std::shared_ptr<DARTRouter> router;
 
+            // Shared-memory fast path for co-located ranks (optional)
+            std::unique_ptr<ShmTransport> shm;
+
+            // Worker pool: the dispatch loop decodes messages and hands
+            // data operations to these threads, so a long wildcard query
+            // no longer blocks cheap queries queued behind it. Responses
+            // go out as workers finish, matched by the request ID echo.
+            struct WorkItem
+            {
+                std::vector<char> buffer;
+                int sourceRank;
+                int priorityClass = 0; // Index into workQueues
+            };
+
+            // Admission control: one queue per priority class. Workers
+            // always drain interactive work first, and at most
+            // batchConcurrencyLimit of them run batch-class work at once,
+            // so a stream of wildcard scans cannot occupy the whole pool.
+            static const int PRIORITY_CLASSES = 2;
+
+            std::vector<std::thread> workerThreads;
+            std::queue<WorkItem> workQueues[PRIORITY_CLASSES];
+            std::mutex workMutex;
+            std::condition_variable workCv;
+            bool workersRunning = false;
+
+            // Batch-class work currently executing (guarded by workMutex)
+            int batchInFlight = 0;
+            int batchConcurrencyLimit = 1;
+
+            // Batch queue depth beyond which new batch-class queries are
+            // rejected with a retry hint instead of queued
+            static const size_t BATCH_QUEUE_LIMIT = 64;
+
+            // Query governor limits, read from the environment at startup
+            // (IDIOMS_QUERY_COST_CAP, IDIOMS_QUERY_VISIT_BUDGET,
+            // IDIOMS_QUERY_TIME_BUDGET_MS; 0 disables a limit). The cost
+            // cap rejects a query up front from the planner's estimate;
+            // the budgets stop one that got past the estimate anyway.
+            uint64_t queryCostCap = 0;
+            uint64_t queryVisitBudget = 100 * 1000 * 1000;
+            int64_t queryTimeBudgetMs = 60 * 1000;
+
+            // Partitioned ingest path: single-record writes are classified
+            // by their key's virtual node and queued per writer thread, so
+            // writes to different shards drain in parallel while writes to
+            // the same shard stay ordered on one thread — and ingest never
+            // occupies the query workers.
+            struct WriteQueue
+            {
+                std::mutex mutex;
+                std::condition_variable cv;
+                std::queue<WorkItem> items;
+            };
+
+            std::vector<std::thread> writerThreads;
+            std::vector<std::unique_ptr<WriteQueue>> writeQueues;
+            std::atomic<bool> writersRunning{false};
+
+            // Writer thread body: drain one write queue in arrival order
+            void writerLoop(size_t queueIndex);
+
+            // True for message types the writer pool may process
+            static bool isWritePathMessage(MessageType type);
+
+            // Writer queue a buffered write dispatches to, derived from
+            // the record key's virtual node
+            size_t writeQueueIndexFor(const std::vector<char> &buffer) const;
+
+            // Worker thread body: drain the work queues in priority order
+            void workerLoop();
+
+            // Priority class a buffered message schedules under: the
+            // client's declared priority, or batch if the planner's cost
+            // estimate marks the query expensive
+            int classifyWork(const std::vector<char> &buffer) const;
+
+            // True for message types the worker pool may process; admin
+            // and membership messages stay on the dispatch thread
+            static bool isPoolableMessage(MessageType type);
+
             // Handle a message from a client
             void handleMessage(const std::vector<char> &message, int sourceRank);
 
             // Handle specific message types
             void handleCreateIndexMessage(const CreateIndexMessage &msg, int sourceRank);
+            void handleBatchCreateIndexMessage(const BatchCreateIndexMessage &msg, int sourceRank);
             void handleDeleteIndexMessage(const DeleteIndexMessage &msg, int sourceRank);
+            void handleBatchDeleteIndexMessage(const BatchDeleteIndexMessage &msg, int sourceRank);
+            void handleDeleteByQueryMessage(const DeleteByQueryMessage &msg, int sourceRank);
             void handleQueryMessage(const QueryMessage &msg, int sourceRank);
+            void handleCancelQueryMessage(const CancelQueryMessage &msg, int sourceRank);
+            void handleTreeQueryMessage(const TreeQueryMessage &msg, int sourceRank);
+            void handleStreamQueryMessage(const StreamQueryMessage &msg, int sourceRank);
+            void handlePagedQueryMessage(const PagedQueryMessage &msg, int sourceRank);
+
+            // Bound on outstanding chunk sends in a streamed response; a
+            // slow client applies backpressure through this window instead
+            // of the server buffering the whole result
+            static constexpr size_t STREAM_WINDOW = 8;
+            void handleEpochUpdateMessage(const EpochUpdateMessage &msg, int sourceRank);
+            void handleSubscribeQueryMessage(const SubscribeQueryMessage &msg, int sourceRank);
+            void handleReplicateVnodesMessage(const ReplicateVnodesMessage &msg, int sourceRank);
+            void handleVnodeShardMessage(const VnodeShardMessage &msg, int sourceRank);
+            void handleSnapshotRequestMessage(const SnapshotRequestMessage &msg, int sourceRank);
+            void handleSnapshotChunkMessage(const SnapshotChunkMessage &msg, int sourceRank);
+            void handleReplAppendMessage(const ReplAppendMessage &msg, int sourceRank);
+            void handleReplAckMessage(const ReplAckMessage &msg, int sourceRank);
+            void handleReplCatchupRequestMessage(const ReplCatchupRequestMessage &msg, int sourceRank);
+            void handleReplCatchupMessage(const ReplCatchupMessage &msg, int sourceRank);
+            void handleKeyStatsMessage(const KeyStatsRequestMessage &msg, int sourceRank);
+            void handleCoordinatedCheckpointMessage(const CoordinatedCheckpointMessage &msg,
+                                                    int sourceRank);
             void handleAdminMessage(const AdminMessage &msg, int sourceRank);
 
+            /**
+             * One index write waiting on the replication stream, with the
+             * replica ranks it still has to reach
+             */
+            struct ReplRecord
+            {
+                uint64_t sequence;
+                std::string key;
+                std::string value;
+                int objectId;
+                std::vector<int> replicaRanks;
+            };
+
+            // How long a queued record may wait before the stream flushes;
+            // this bounds the replicas' lag behind the primary
+            static constexpr int REPL_FLUSH_INTERVAL_MS = 20;
+
+            // Primary-driven replication stream: writes land on the
+            // primary once, queue here, and a background thread ships them
+            // to the key's replicas in batches
+            std::mutex replMutex;
+            std::condition_variable replCv;
+            std::deque<ReplRecord> replQueue;
+            uint64_t nextReplSequence = 1;
+            std::unordered_map<int, uint64_t> replicaHighWater; // Acked marks by server ID
+            std::thread replThread;
+            bool replRunning = false;
+            bool replInline = false; // No MPI_THREAD_MULTIPLE: flush on the ingest path
+
+            // Streamed records retained after shipping, so a briefly
+            // partitioned replica can catch up from the sequence it last
+            // applied instead of resyncing everything; bounded, oldest out
+            static const size_t REPL_HISTORY_CAPACITY = 65536;
+            std::deque<ReplRecord> replHistory;
+
+            // Highest streamed sequence applied from each source rank;
+            // what a catch-up request asks to resume from
+            std::unordered_map<int, uint64_t> appliedHighWater;
+
+            /**
+             * A write accepted on behalf of a down replica, held until
+             * the intended owner is reported active again
+             */
+            struct HintedWrite
+            {
+                int targetRank;
+                std::string key;
+                std::string value;
+                int objectId;
+            };
+
+            // Hinted handoff: writes for down replicas queue here instead
+            // of being dropped, backed by a log so hints survive a restart
+            // of the server holding them
+            std::mutex hintMutex;
+            std::deque<HintedWrite> hintQueue;
+            std::ofstream hintLog;
+
+            // Path of the durable hint log
+            std::string hintLogPath() const;
+
+            // Reload queued hints from the log at startup
+            void loadHintQueue();
+
+            // Queue a write for a down replica; hintMutex must be held
+            void recordHintedWrite(int targetRank, const std::string &key,
+                                   const std::string &value, int objectId);
+
+            // Rewrite the hint log from the in-memory queue; hintMutex
+            // must be held
+            void rewriteHintLog();
+
+            // Ship every hint held for a recovered replica and drop them
+            void replayHintedWrites(int recoveredRank);
+
+            // Ask every live peer for the records streamed past our last
+            // applied sequence (runs on the CATCH_UP admin trigger)
+            void requestCatchUp();
+
+            // Queue a write for streaming to this key's replicas
+            void enqueueReplication(const std::string &key, const std::string &value,
+                                    int objectId);
+
+            // Start the streaming thread on first use, or fall back to
+            // inline flushing when MPI lacks thread support
+            void startReplicationStream();
+
+            // Replication thread body: batch and ship queued records
+            void replicationLoop();
+
+            // Ship one drained batch, grouped per replica rank
+            void shipReplicationBatch(std::deque<ReplRecord> &batch);
+
+            // Bytes of snapshot image carried per SNAPSHOT_CHUNK message
+            static constexpr size_t SNAPSHOT_CHUNK_BYTES = 4 * 1024 * 1024;
+
+            // Partially reassembled snapshot images, keyed by source rank;
+            // chunks from one source arrive in order on the dispatch thread
+            std::unordered_map<int, std::string> snapshotAssembly;
+
+            // Rank that owns each standing-query subscription, so pushed
+            // deltas reach the right client
+            std::mutex subscriberMutex;
+            std::unordered_map<int, int> subscriberRanks;
+
+            // Push accumulated standing-query deltas to their subscribers
+            // on NOTIFY_TAG; called after index mutations
+            void pushStandingQueryNotifications();
+
+            // Pre-posted persistent receives per inbound tag in the
+            // dispatch loop's ring; enough that a burst on one tag never
+            // finds every slot busy
+            static constexpr int RECV_RING_DEPTH = 8;
+
+            // Responses the dispatch loop received on behalf of a handler
+            // (tree-query child results), keyed by source rank. Handlers
+            // must not receive inline themselves: the ring's pre-posted
+            // receives would win the match every time.
+            std::mutex childResultMutex;
+            std::condition_variable childResultCv;
+            std::unordered_map<int, std::queue<std::vector<char>>> childResults;
+
+            // Block until the dispatch loop deposits a response from this
+            // rank, then hand its buffer over
+            std::vector<char> waitForChildResult(int childRank);
+
+            // Serializes oversize (notice, payload) pairs so concurrent
+            // senders cannot interleave them on the wire
+            std::mutex oversizeSendMutex;
+
+            // Send a serialized message to another server's dispatch ring,
+            // splitting it into a notice plus OVERSIZE_TAG payload when it
+            // exceeds the pre-posted slot size
+            void sendToServer(std::vector<char> buffer, int destRank, int tag);
+
             // Send a response to a client
             void sendResponse(const ResponseMessage &response, int destRank, int tag);
 
@@ -65,6 +315,43 @@ namespace idioms
              */
             ~MPIServer();
 
+            /**
+             * Start a worker pool for request processing
+             *
+             * Queries run concurrently against the index's shared read
+             * path; index writes serialize per shard inside the server.
+             * Requires MPI_THREAD_MULTIPLE since workers send their own
+             * responses; with less thread support this is a no-op and the
+             * server stays single-threaded.
+             *
+             * @param numThreads Number of worker threads
+             * @return True if the pool was started
+             */
+            bool enableWorkerPool(int numThreads);
+
+            /**
+             * Start dedicated writer threads for single-record ingest
+             *
+             * Incoming writes are routed to a per-writer queue by their
+             * key's virtual node, so writes to different shards never
+             * contend while writes to one shard stay ordered. Requires
+             * MPI_THREAD_MULTIPLE since writers send their own acks; with
+             * less thread support this is a no-op.
+             *
+             * @param numThreads Number of writer threads (and queues)
+             * @return True if the pool was started
+             */
+            bool enableWriterPool(int numThreads);
+
+            /**
+             * Enable the shared-memory fast path for co-located ranks
+             *
+             * COLLECTIVE over MPI_COMM_WORLD: every rank must call its
+             * enableSharedMemoryTransport at the same point (the client
+             * has a matching method).
+             */
+            void enableSharedMemoryTransport();
+
             /**
              * Run the server
              * This method blocks and listens for client messages until shutdown
@@ -0,0 +1,153 @@
+#include "ShmTransport.hpp"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace idioms
+{
+    namespace mpi
+    {
+
+        ShmTransport::ShmTransport()
+            : nodeComm(MPI_COMM_NULL), window(MPI_WIN_NULL), localSlab(nullptr),
+              nodeRank(-1), nodeSize(0), nextSlot(0)
+        {
+            // Group the ranks sharing this physical node
+            MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                                MPI_INFO_NULL, &nodeComm);
+            MPI_Comm_rank(nodeComm, &nodeRank);
+            MPI_Comm_size(nodeComm, &nodeSize);
+
+            // One slab of slots per rank inside a single shared window
+            MPI_Win_allocate_shared(static_cast<MPI_Aint>(SLOT_BYTES * NUM_SLOTS), 1,
+                                    MPI_INFO_NULL, nodeComm, &localSlab, &window);
+            std::memset(localSlab, 0, SLOT_BYTES * NUM_SLOTS);
+
+            // Passive access for the lifetime of the transport
+            MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+            // Translate node ranks back to world ranks so senders can tell
+            // which destinations are local
+            MPI_Group worldGroup, nodeGroup;
+            MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+            MPI_Comm_group(nodeComm, &nodeGroup);
+
+            std::vector<int> nodeRanks(nodeSize);
+            std::vector<int> worldRanks(nodeSize);
+            for (int i = 0; i < nodeSize; i++)
+            {
+                nodeRanks[i] = i;
+            }
+            MPI_Group_translate_ranks(nodeGroup, nodeSize, nodeRanks.data(),
+                                      worldGroup, worldRanks.data());
+            for (int i = 0; i < nodeSize; i++)
+            {
+                worldToNode[worldRanks[i]] = i;
+            }
+
+            MPI_Group_free(&worldGroup);
+            MPI_Group_free(&nodeGroup);
+
+            // Nobody may stage before every slab is zeroed
+            MPI_Barrier(nodeComm);
+
+            std::cout << "Shared-memory transport ready: " << nodeSize
+                      << " co-located ranks on this node" << std::endl;
+        }
+
+        ShmTransport::~ShmTransport()
+        {
+            if (window != MPI_WIN_NULL)
+            {
+                MPI_Win_unlock_all(window);
+                MPI_Win_free(&window);
+            }
+            if (nodeComm != MPI_COMM_NULL)
+            {
+                MPI_Comm_free(&nodeComm);
+            }
+        }
+
+        bool ShmTransport::isLocal(int worldRank) const
+        {
+            auto it = worldToNode.find(worldRank);
+            return it != worldToNode.end() && it->second != nodeRank;
+        }
+
+        size_t ShmTransport::maxPayloadBytes()
+        {
+            return SLOT_BYTES - sizeof(SlotHeader);
+        }
+
+        size_t ShmTransport::stagePayload(const std::vector<char> &payload)
+        {
+            if (payload.size() > maxPayloadBytes())
+            {
+                throw std::runtime_error("Payload too large for shared-memory slot");
+            }
+
+            std::lock_guard<std::mutex> lock(stageMutex);
+
+            size_t slot = nextSlot;
+            nextSlot = (nextSlot + 1) % NUM_SLOTS;
+
+            SlotHeader *header = reinterpret_cast<SlotHeader *>(localSlab + slot * SLOT_BYTES);
+
+            // Wait for the previous lap's receiver to release this slot;
+            // in the request/response pattern this effectively never spins
+            while (header->ready != 0)
+            {
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            header->size = payload.size();
+            std::memcpy(localSlab + slot * SLOT_BYTES + sizeof(SlotHeader),
+                        payload.data(), payload.size());
+
+            // Publish: the payload must be visible before the ready flag
+            std::atomic_thread_fence(std::memory_order_release);
+            header->ready = 1;
+            MPI_Win_sync(window);
+
+            return slot;
+        }
+
+        std::vector<char> ShmTransport::fetchPayload(int worldRank, size_t slot)
+        {
+            auto it = worldToNode.find(worldRank);
+            if (it == worldToNode.end())
+            {
+                throw std::runtime_error("Shared-memory payload from a rank that is not co-located");
+            }
+
+            // Map the sender's slab (same window, different node rank)
+            MPI_Aint slabSize;
+            int dispUnit;
+            char *base;
+            MPI_Win_shared_query(window, it->second, &slabSize, &dispUnit, &base);
+
+            SlotHeader *header = reinterpret_cast<SlotHeader *>(base + slot * SLOT_BYTES);
+
+            // The descriptor arrives after the payload was published, so
+            // this only spins on delayed memory visibility
+            while (header->ready != 1)
+            {
+                MPI_Win_sync(window);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            std::vector<char> payload(header->size);
+            std::memcpy(payload.data(), base + slot * SLOT_BYTES + sizeof(SlotHeader),
+                        header->size);
+
+            // Release the slot for the sender's next lap
+            std::atomic_thread_fence(std::memory_order_release);
+            header->ready = 0;
+            MPI_Win_sync(window);
+
+            return payload;
+        }
+
+    } // namespace mpi
+} // namespace idioms
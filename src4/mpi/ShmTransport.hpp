@@ -0,0 +1,105 @@
+#ifndef IDIOMS_MPI_SHM_TRANSPORT_HPP
+#define IDIOMS_MPI_SHM_TRANSPORT_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <mpi.h>
+
+namespace idioms
+{
+    namespace mpi
+    {
+
+        /**
+         * Shared-memory payload transport for co-located ranks.
+         *
+         * Every rank owns a slab of fixed-size slots inside one MPI
+         * shared-memory window per physical node. A sender stages a
+         * serialized message in its own slab and ships only a small slot
+         * descriptor through MPI; a co-located receiver reads the payload
+         * straight out of the sender's slab, so the message bytes never
+         * pass through the MPI transport at all.
+         *
+         * Construction is collective over MPI_COMM_WORLD and must run on
+         * every rank at the same point (it splits the world by node and
+         * allocates the shared window).
+         */
+        class ShmTransport
+        {
+        private:
+            MPI_Comm nodeComm;
+            MPI_Win window;
+            char *localSlab;
+            int nodeRank;
+            int nodeSize;
+
+            // Next slot to stage into, round-robin; staging is serialized
+            // so server worker threads can send responses concurrently
+            std::mutex stageMutex;
+            size_t nextSlot;
+
+            // Co-located world rank -> rank inside the node communicator
+            std::unordered_map<int, int> worldToNode;
+
+            // Each slot starts with this header; ready flips to 1 when the
+            // payload is complete and back to 0 once the receiver copied it
+            struct SlotHeader
+            {
+                volatile int ready;
+                size_t size;
+            };
+
+            // Fixed-size slots keep the ready-flag protocol exact: a slot
+            // is reused only after its previous payload was consumed
+            static constexpr size_t SLOT_BYTES = 64 * 1024;
+            static constexpr size_t NUM_SLOTS = 64;
+
+        public:
+            ShmTransport();
+            ~ShmTransport();
+
+            /**
+             * Check whether a world rank lives on this physical node
+             *
+             * @param worldRank Rank in MPI_COMM_WORLD
+             * @return True if the rank shares this node's memory
+             */
+            bool isLocal(int worldRank) const;
+
+            /**
+             * Largest payload that fits in one slot; bigger messages fall
+             * back to the regular MPI path
+             *
+             * @return Maximum stageable payload size in bytes
+             */
+            static size_t maxPayloadBytes();
+
+            /**
+             * Stage a serialized message in this rank's slab
+             *
+             * Spins if the chosen slot has not been consumed yet, which
+             * bounds the number of outstanding local payloads at the slot
+             * count.
+             *
+             * @param payload Serialized message bytes
+             * @return Slot index to put in the descriptor message
+             */
+            size_t stagePayload(const std::vector<char> &payload);
+
+            /**
+             * Fetch a payload staged by a co-located rank and release the
+             * slot for reuse
+             *
+             * @param worldRank World rank of the sender
+             * @param slot Slot index from the descriptor message
+             * @return The staged message bytes
+             */
+            std::vector<char> fetchPayload(int worldRank, size_t slot);
+        };
+
+    } // namespace mpi
+} // namespace idioms
+
+#endif // IDIOMS_MPI_SHM_TRANSPORT_HPP
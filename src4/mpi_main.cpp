@@ -197,6 +197,18 @@ void runAsServer(int rank, int worldSize)
 
     // Create and run the server
     idioms::mpi::MPIServer server(rank, worldSize, dataDir, true); // true = use suffix tree mode
+
+    // Collective across all ranks; the client enables it at the same point
+    server.enableSharedMemoryTransport();
+
+    // Process requests on a worker pool so a long wildcard query does
+    // not block cheap queries queued behind it
+    server.enableWorkerPool(4);
+
+    // Drain single-record ingest on per-shard writer queues, off the
+    // query workers
+    server.enableWriterPool(2);
+
     server.run();
 }
 
@@ -208,6 +220,9 @@ void runAsClient(int rank, int worldSize)
     // Create the MPI client
     idioms::mpi::MPIClient client(rank, worldSize, true); // true = use suffix tree mode
 
+    // Collective across all ranks; the servers enable it at the same point
+    client.enableSharedMemoryTransport();
+
     std::cout << "\n=== Initializing IDIOMS with example metadata ===" << std::endl;
 
     // Microscopy data examples from the paper
@@ -317,8 +332,10 @@ void runAsClient(int rank, int worldSize)
 
 int main(int argc, char **argv)
 {
-    // Initialize MPI
-    MPI_Init(&argc, &argv);
+    // Initialize MPI with full thread support so servers can run their
+    // worker pools (workers send responses concurrently)
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
 
     // Get rank and world size
     int rank, worldSize;
@@ -1,15 +1,48 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <iostream>
-#include <vector>
+#include <sstream>
 #include <string>
 #include <thread>
-#include <chrono>
-#include <mutex>
+#include <vector>
 #include <mpi.h>
 #include "client/ClientManager.hpp"
 #include "mpi/MPIServer.hpp"
-
-// Mutex for synchronized console output
-std::mutex consoleMutex;
+#include "benchmark/LatencyHistogram.hpp"
+#include "benchmark/WorkloadGenerator.hpp"
+
+// Open-loop multi-client scaling benchmark.
+//
+// Rank 0 runs the ClientManager and drives N concurrent client threads
+// through its multiplexed query engine; the other ranks run servers. Each
+// step fixes a client count, splits the target aggregate rate evenly and
+// issues queries open-loop: a query is released at its scheduled instant
+// whether or not earlier ones have completed, so queueing delay shows up
+// in the latency numbers instead of silently throttling the offered load.
+//
+// Per step the benchmark reports achieved throughput against the target,
+// the completion latency percentiles (measured from the scheduled release,
+// not the actual send), and a saturation verdict: if the submitting
+// threads themselves fell behind their schedule the client-side path is
+// the bottleneck, otherwise the missing throughput queued on the server /
+// MPI side.
+
+// How one client thread fared over a step
+struct ClientStepResult
+{
+    idioms::benchmark::LatencyHistogram latency; // Release-to-completion
+    idioms::benchmark::LatencyHistogram sendLag; // Release-to-actual-submit
+    uint64_t issued = 0;
+    uint64_t completed = 0;
+};
+
+// Queries a client still has in flight, oldest first
+struct PendingQuery
+{
+    uint64_t requestId;
+    std::chrono::steady_clock::time_point releasedAt;
+};
 
 // Function to run as a server process
 void runAsServer(int rank, int worldSize)
@@ -21,146 +54,211 @@ void runAsServer(int rank, int worldSize)
 
     // Create and run the server
     idioms::mpi::MPIServer server(rank, worldSize, dataDir, true); // true = use suffix tree mode
+    server.enableWorkerPool(4);
+    server.enableWriterPool(2);
     server.run();
 }
 
-// Function to simulate a client making queries
-void simulateClient(int clientId, std::shared_ptr<idioms::mpi::MPIClient> client)
+// Workload shape shared by the preload and the query stream: the pools
+// are derived from the seed and cardinalities only, so a write-only and
+// a read-only generator draw from the same keys and values
+static idioms::benchmark::WorkloadConfig benchmarkShape()
 {
-    // Sample metadata to add
-    struct MetadataItem
-    {
-        std::string key;
-        std::string value;
-        int objectId;
-    };
+    idioms::benchmark::WorkloadConfig config;
+    config.seed = 42;
+    config.keyCardinality = 200;
+    config.valueCardinality = 1000;
+    config.zipfSkew = 0.99;
+    return config;
+}
+
+// One client thread: release queries at the generator's open-loop
+// schedule, reap completions opportunistically, and drain the tail at the
+// end of the step
+static void runClientStep(idioms::client::ClientManager &clientManager,
+                          int clientId, int threadIndex, int numClients,
+                          double aggregateRate, double seconds,
+                          ClientStepResult &result)
+{
+    idioms::benchmark::WorkloadConfig config = benchmarkShape();
+    config.seed += threadIndex; // Distinct stream per client
+    config.readFraction = 1.0;
+    config.arrival = "open";
+    config.targetOpsPerSec = aggregateRate / numClients;
+    config.numOperations = static_cast<size_t>(config.targetOpsPerSec * seconds) + 1;
 
-    std::vector<MetadataItem> metadataItems = {
-        {"FILE_PATH", "/data/client" + std::to_string(clientId) + "/image1.tif", 2000 + clientId * 100 + 1},
-        {"FILE_PATH", "/data/client" + std::to_string(clientId) + "/image2.tif", 2000 + clientId * 100 + 2},
-        {"StageX", std::to_string(100.0 + clientId * 10.0), 2000 + clientId * 100 + 1},
-        {"StageY", std::to_string(200.0 + clientId * 10.0), 2000 + clientId * 100 + 1},
-        {"StageZ", std::to_string(50.0 + clientId * 5.0), 2000 + clientId * 100 + 1},
-        {"StageX", std::to_string(300.0 + clientId * 10.0), 2000 + clientId * 100 + 2},
-        {"StageY", std::to_string(400.0 + clientId * 10.0), 2000 + clientId * 100 + 2},
-        {"StageZ", std::to_string(75.0 + clientId * 5.0), 2000 + clientId * 100 + 2},
-        {"creation_date", "2023-01-" + std::to_string(1 + clientId), 2000 + clientId * 100 + 1},
-        {"creation_date", "2023-01-" + std::to_string(15 + clientId), 2000 + clientId * 100 + 2},
-        {"client_id", std::to_string(clientId), 2000 + clientId * 100 + 1},
-        {"client_id", std::to_string(clientId), 2000 + clientId * 100 + 2}};
+    idioms::benchmark::WorkloadGenerator generator(config);
 
-    // Add metadata
-    {
-        std::lock_guard<std::mutex> lock(consoleMutex);
-        std::cout << "Client " << clientId << ": Adding metadata..." << std::endl;
-    }
+    std::deque<PendingQuery> pending;
+    auto start = std::chrono::steady_clock::now();
 
-    for (const auto &item : metadataItems)
+    auto reapCompleted = [&](bool block)
     {
-        client->create_md_index(item.key, item.value, item.objectId);
-
-        // Small delay to avoid flooding the server
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
+        while (!pending.empty())
+        {
+            std::vector<int> results;
+            if (block)
+            {
+                results = clientManager.waitForResult(clientId, pending.front().requestId);
+            }
+            else if (!clientManager.tryGetResult(clientId, pending.front().requestId, results))
+            {
+                return;
+            }
 
-    // Sample queries to execute
-    std::vector<std::string> queries = {
-        "StageX=" + std::to_string(300.0 + clientId * 10.0), // Exact query for this client's data
-        "Stage*=*",                                          // Prefix query for all stage data
-        "*PATH=*tif",                                        // Suffix query for all TIF files
-        "*client_id=" + std::to_string(clientId),            // Query for this client's data
-        "creation_date=2023-01-*"                            // Date prefix query
+            result.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - pending.front().releasedAt)
+                                      .count());
+            result.completed++;
+            pending.pop_front();
+        }
     };
 
-    // Execute queries
+    while (generator.hasNext())
     {
-        std::lock_guard<std::mutex> lock(consoleMutex);
-        std::cout << "Client " << clientId << ": Executing queries..." << std::endl;
+        idioms::benchmark::Operation op = generator.next();
+
+        auto release = start + std::chrono::microseconds(
+                                   static_cast<int64_t>(op.releaseAtUs));
+        std::this_thread::sleep_until(release);
+
+        // Open loop: the query counts from its scheduled release, and any
+        // delay getting it submitted is the client side falling behind
+        uint64_t requestId = clientManager.submitQuery(clientId, op.key + "=" + op.value);
+        result.sendLag.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - release)
+                                  .count());
+        result.issued++;
+        pending.push_back({requestId, release});
+
+        reapCompleted(false);
     }
 
-    for (const auto &query : queries)
+    reapCompleted(true);
+}
+
+// Run one step at a fixed client count and print its report line
+static void runScalingStep(idioms::client::ClientManager &clientManager,
+                           int numClients, double aggregateRate, double seconds)
+{
+    std::vector<int> clientIds;
+    for (int i = 0; i < numClients; i++)
     {
-        // Execute query
-        std::vector<int> results = client->md_search(query);
+        clientIds.push_back(clientManager.registerClient());
+    }
 
-        // Print results
-        {
-            std::lock_guard<std::mutex> lock(consoleMutex);
-            std::cout << "Client " << clientId << " - Query: \"" << query << "\" - Found "
-                      << results.size() << " results: ";
+    std::vector<ClientStepResult> results(numClients);
+    std::vector<std::thread> threads;
+    threads.reserve(numClients);
 
-            for (size_t i = 0; i < results.size(); i++)
-            {
-                if (i > 0)
-                    std::cout << ", ";
-                std::cout << results[i];
-            }
-            std::cout << std::endl;
-        }
+    auto stepStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < numClients; i++)
+    {
+        threads.emplace_back(runClientStep, std::ref(clientManager),
+                             clientIds[i], i, numClients, aggregateRate,
+                             seconds, std::ref(results[i]));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - stepStart)
+                         .count();
 
-        // Small delay between queries
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (int clientId : clientIds)
+    {
+        clientManager.unregisterClient(clientId);
     }
 
-    // Checkpoint the index
+    // Fold the per-client histograms and counters together
+    uint64_t issued = 0, completed = 0;
+    idioms::benchmark::LatencyHistogram latency, sendLag;
+    for (const ClientStepResult &r : results)
     {
-        std::lock_guard<std::mutex> lock(consoleMutex);
-        std::cout << "Client " << clientId << ": Checkpointing index..." << std::endl;
+        issued += r.issued;
+        completed += r.completed;
+        latency.merge(r.latency);
+        sendLag.merge(r.sendLag);
     }
 
-    client->checkpointAllIndices();
+    double achieved = completed / elapsed;
+
+    std::cout << "clients=" << numClients
+              << "  target=" << static_cast<uint64_t>(aggregateRate) << " op/s"
+              << "  achieved=" << static_cast<uint64_t>(achieved) << " op/s"
+              << "  issued=" << issued << std::endl;
+    latency.printSummary("  release-to-completion");
+    sendLag.printSummary("  release-to-submit lag");
 
+    // Saturation verdict: missing throughput is either the submit path
+    // (threads behind their own schedule) or everything past it
+    double perClientIntervalNs = 1e9 * numClients / aggregateRate;
+    if (achieved >= 0.95 * aggregateRate)
     {
-        std::lock_guard<std::mutex> lock(consoleMutex);
-        std::cout << "Client " << clientId << ": Finished simulation" << std::endl;
+        std::cout << "  verdict: keeping up with the offered load" << std::endl;
+    }
+    else if (sendLag.valueAtPercentile(50.0) > perClientIntervalNs)
+    {
+        std::cout << "  verdict: SATURATED client-side (submit path behind schedule)"
+                  << std::endl;
+    }
+    else
+    {
+        std::cout << "  verdict: SATURATED server/MPI-side (completions lagging releases)"
+                  << std::endl;
     }
 }
 
-// Function to run as the client manager process
-void runAsClientManager(int rank, int worldSize)
+// Function to run as the benchmark driver process
+void runAsBenchmarkDriver(int rank, int worldSize,
+                          const std::vector<int> &clientCounts,
+                          double aggregateRate, double seconds, size_t preloadRecords)
 {
-    std::cout << "=== IDIOMS Multi-Client Demo ===" << std::endl;
+    std::cout << "=== IDIOMS Multi-Client Scaling Benchmark ===" << std::endl;
+    std::cout << "Servers: " << (worldSize - 1)
+              << "  target rate: " << aggregateRate << " op/s"
+              << "  step length: " << seconds << " s" << std::endl;
 
     // Create the client manager
     std::string dataDir = "./idioms_data";
     idioms::client::ClientManager clientManager(worldSize, dataDir, true);
 
-    // Start the client manager
-    clientManager.start();
-
-    // Register multiple clients
-    const int NUM_CLIENTS = 5;
-    std::vector<int> clientIds;
-    std::vector<std::thread> clientThreads;
-
-    std::cout << "Registering " << NUM_CLIENTS << " clients..." << std::endl;
-
-    for (int i = 0; i < NUM_CLIENTS; i++)
+    // Preload through one client so the query stream hits real postings;
+    // the write-only generator draws from the same key and value pools.
+    // This runs before the engine starts: the direct client waits for its
+    // batch acks on RESULT_TAG, the same tag the engine drains, and the
+    // engine would swallow them.
     {
-        int clientId = clientManager.registerClient();
-        clientIds.push_back(clientId);
-
-        auto client = clientManager.getClient(clientId);
-
-        // Start a thread to simulate client activity
-        clientThreads.emplace_back(simulateClient, clientId, client);
-
-        // Small delay between client registrations
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    }
+        int loaderId = clientManager.registerClient();
+        auto loader = clientManager.getClient(loaderId);
+
+        idioms::benchmark::WorkloadConfig config = benchmarkShape();
+        config.readFraction = 0.0;
+        config.numOperations = preloadRecords;
+        idioms::benchmark::WorkloadGenerator generator(config);
+
+        std::vector<idioms::IndexRecord> records;
+        records.reserve(preloadRecords);
+        int objectId = 1;
+        while (generator.hasNext())
+        {
+            idioms::benchmark::Operation op = generator.next();
+            records.emplace_back(op.key, op.value, objectId++);
+        }
+        loader->create_md_index_batch(records);
 
-    // Wait for all client threads to finish
-    for (auto &thread : clientThreads)
-    {
-        thread.join();
+        std::cout << "Preloaded " << records.size() << " records" << std::endl;
+        clientManager.unregisterClient(loaderId);
     }
 
-    // Unregister clients
-    std::cout << "Unregistering clients..." << std::endl;
+    // Start the multiplexing engine; from here on all queries go through
+    // submitQuery and the engine owns RESULT_TAG
+    clientManager.start();
 
-    for (int clientId : clientIds)
+    for (int numClients : clientCounts)
     {
-        clientManager.unregisterClient(clientId);
+        runScalingStep(clientManager, numClients, aggregateRate, seconds);
     }
 
     // Stop the client manager
@@ -171,19 +269,33 @@ void runAsClientManager(int rank, int worldSize)
     auto mainClient = std::make_shared<idioms::mpi::MPIClient>(rank, worldSize, true);
     mainClient->shutdownAllServers();
 
-    std::cout << "Multi-Client Demo finished" << std::endl;
+    std::cout << "Scaling benchmark finished" << std::endl;
 }
 
 int main(int argc, char **argv)
 {
-    // Initialize MPI
-    MPI_Init(&argc, &argv);
+    // Initialize MPI with full thread support: the ClientManager's engine
+    // thread and the per-client submitter threads all make MPI calls
+    // concurrently, which is undefined behavior at any lower level
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
 
     // Get rank and world size
     int rank, worldSize;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
 
+    if (provided < MPI_THREAD_MULTIPLE)
+    {
+        if (rank == 0)
+        {
+            std::cerr << "Error: this benchmark needs MPI_THREAD_MULTIPLE, but the"
+                      << " MPI library only provides level " << provided << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return 1;
+    }
+
     if (worldSize < 2)
     {
         std::cerr << "Error: This program requires at least 2 MPI processes." << std::endl;
@@ -192,10 +304,51 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    // Process with rank 0 is the client manager, others are servers
+    // Defaults keep a laptop run short; production sweeps pass
+    // --clients 1,2,4,8,16,32,64 and longer steps
+    std::vector<int> clientCounts = {1, 2, 4, 8};
+    double aggregateRate = 2000.0;
+    double seconds = 3.0;
+    size_t preloadRecords = 5000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc)
+        {
+            clientCounts.clear();
+            std::stringstream list(argv[++i]);
+            std::string token;
+            while (std::getline(list, token, ','))
+            {
+                clientCounts.push_back(std::stoi(token));
+            }
+        }
+        else if (arg == "--rate" && i + 1 < argc)
+        {
+            aggregateRate = std::stod(argv[++i]);
+        }
+        else if (arg == "--seconds" && i + 1 < argc)
+        {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (arg == "--records" && i + 1 < argc)
+        {
+            preloadRecords = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if (rank == 0)
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: idioms_multi_client [--clients 1,2,4,8] [--rate OPS]"
+                      << " [--seconds S] [--records N]" << std::endl;
+        }
+    }
+
+    // Process with rank 0 drives the benchmark, others are servers
     if (rank == 0)
     {
-        runAsClientManager(rank, worldSize);
+        runAsBenchmarkDriver(rank, worldSize, clientCounts, aggregateRate,
+                             seconds, preloadRecords);
     }
     else
     {
@@ -206,4 +359,4 @@ int main(int argc, char **argv)
     MPI_Finalize();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,144 @@
+#include "NumaPolicy.hpp"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace idioms
+{
+    namespace numa
+    {
+
+        namespace
+        {
+            // MPOL_PREFERRED from linux/mempolicy.h, defined locally so
+            // the build does not depend on kernel headers being installed
+            const int MBIND_MODE_PREFERRED = 1;
+
+            // Allocation-node preference for this thread (see the guard)
+            thread_local int allocationNode = -1;
+
+            // Parse a cpulist like "0-7,16-23" into a cpu_set_t
+            bool parseCpuList(const std::string &list, cpu_set_t &cpus)
+            {
+                CPU_ZERO(&cpus);
+                std::istringstream stream(list);
+                std::string range;
+                bool any = false;
+
+                while (std::getline(stream, range, ','))
+                {
+                    size_t dash = range.find('-');
+                    int first = std::atoi(range.c_str());
+                    int last = dash != std::string::npos
+                                   ? std::atoi(range.c_str() + dash + 1)
+                                   : first;
+                    for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+                    {
+                        CPU_SET(cpu, &cpus);
+                        any = true;
+                    }
+                }
+                return any;
+            }
+
+            // Count the nodes once; /sys is authoritative and stable
+            int detectNodeCount()
+            {
+                int count = 0;
+                while (true)
+                {
+                    std::ifstream cpulist("/sys/devices/system/node/node" +
+                                          std::to_string(count) + "/cpulist");
+                    if (!cpulist)
+                    {
+                        break;
+                    }
+                    count++;
+                }
+                return count > 0 ? count : 1;
+            }
+        } // namespace
+
+        int nodeCount()
+        {
+            static const int count = detectNodeCount();
+            return count;
+        }
+
+        bool bindCurrentThreadToNode(int node)
+        {
+            if (node < 0)
+            {
+                return false;
+            }
+
+            std::ifstream file("/sys/devices/system/node/node" +
+                               std::to_string(node) + "/cpulist");
+            std::string list;
+            if (!file || !std::getline(file, list))
+            {
+                return false;
+            }
+
+            cpu_set_t cpus;
+            if (!parseCpuList(list, cpus))
+            {
+                return false;
+            }
+            return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+        }
+
+        void bindMemoryToNode(void *addr, size_t bytes, int node)
+        {
+#ifdef __NR_mbind
+            if (node < 0 || node >= nodeCount())
+            {
+                return;
+            }
+
+            // mbind wants page-aligned ranges; bind the whole pages
+            // inside the block and leave the ragged edges alone
+            const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+            uintptr_t start = (reinterpret_cast<uintptr_t>(addr) + pageSize - 1) &
+                              ~(pageSize - 1);
+            uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + bytes) &
+                            ~(pageSize - 1);
+            if (start >= end)
+            {
+                return;
+            }
+
+            unsigned long nodemask = 1UL << node;
+            // Best effort: a failed bind just means default placement
+            syscall(__NR_mbind, start, end - start, MBIND_MODE_PREFERRED,
+                    &nodemask, sizeof(nodemask) * 8 + 1, 0);
+#else
+            (void)addr;
+            (void)bytes;
+            (void)node;
+#endif
+        }
+
+        int currentAllocationNode()
+        {
+            return allocationNode;
+        }
+
+        AllocationNodeGuard::AllocationNodeGuard(int node)
+            : previousNode(allocationNode)
+        {
+            allocationNode = node;
+        }
+
+        AllocationNodeGuard::~AllocationNodeGuard()
+        {
+            allocationNode = previousNode;
+        }
+
+    } // namespace numa
+} // namespace idioms
@@ -0,0 +1,89 @@
+#ifndef IDIOMS_NUMA_POLICY_HPP
+#define IDIOMS_NUMA_POLICY_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace idioms
+{
+    namespace numa
+    {
+
+        /**
+         * NUMA placement for standalone mode
+         *
+         * Standalone deployments run many virtual servers in one process
+         * on multi-socket machines; without placement, trie allocations
+         * land on whichever socket the ingest thread happens to run,
+         * and queries then cross the interconnect. Each server gets a
+         * NUMA node (assignment is chosen in main.cpp's setup): its
+         * arena blocks are bound to that node's memory as they are
+         * allocated, and the client's query workers pin themselves to
+         * the node before touching the server's tries.
+         *
+         * Everything here degrades to a no-op on single-node machines
+         * or kernels without the mbind/sched_setaffinity interfaces.
+         */
+
+        /**
+         * Number of NUMA nodes on this machine
+         *
+         * @return Node count from /sys/devices/system/node (1 if unknown)
+         */
+        int nodeCount();
+
+        /**
+         * Pin the calling thread to the CPUs of a NUMA node
+         *
+         * @param node NUMA node ID; negative means unpinned (no-op)
+         * @return true if the affinity change took effect
+         */
+        bool bindCurrentThreadToNode(int node);
+
+        /**
+         * Bind a memory range to a NUMA node (preferred policy)
+         *
+         * Only whole pages inside the range are bound; already-touched
+         * pages stay where they are, so callers bind blocks right after
+         * allocating them.
+         *
+         * @param addr Start of the range
+         * @param bytes Length of the range
+         * @param node NUMA node ID; negative means no binding (no-op)
+         */
+        void bindMemoryToNode(void *addr, size_t bytes, int node);
+
+        /**
+         * The allocation node for the calling thread
+         *
+         * Arena block allocation consults this so the node preference
+         * reaches the allocator without threading a parameter through
+         * every trie constructor. Set it with AllocationNodeGuard.
+         *
+         * @return Node ID, or -1 when no preference is active
+         */
+        int currentAllocationNode();
+
+        /**
+         * Scoped allocation-node preference for the calling thread
+         *
+         * The servers wrap their index mutations in one of these so any
+         * arena blocks allocated underneath land on the server's node.
+         */
+        class AllocationNodeGuard
+        {
+        private:
+            int previousNode;
+
+        public:
+            explicit AllocationNodeGuard(int node);
+            ~AllocationNodeGuard();
+
+            AllocationNodeGuard(const AllocationNodeGuard &) = delete;
+            AllocationNodeGuard &operator=(const AllocationNodeGuard &) = delete;
+        };
+
+    } // namespace numa
+} // namespace idioms
+
+#endif // IDIOMS_NUMA_POLICY_HPP
@@ -1,6 +1,9 @@
 #include "PopularityTracker.hpp"
+#include "../common/Hash.hpp"
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <fstream>
 #include <vector>
 
 namespace idioms
@@ -14,7 +17,8 @@ namespace idioms
 
         PopularityTracker::PopularityTracker(int baseReplication, int maxReplication,
                                              double threshold, double decay)
-            : decayFactor(decay),
+            : lastDecay(std::chrono::steady_clock::now()),
+              decayFactor(decay),
               popularityThreshold(threshold),
               maxReplicationFactor(maxReplication),
               baseReplicationFactor(baseReplication)
@@ -24,73 +28,197 @@ namespace idioms
                       << " maxReplication=" << maxReplicationFactor
                       << " threshold=" << popularityThreshold
                       << " decay=" << decayFactor << std::endl;
-        }
-
-        double PopularityTracker::calculateDecay(const std::string &key) const
-        {
-            auto now = std::chrono::steady_clock::now();
-            auto it = lastAccess.find(key);
 
-            if (it == lastAccess.end())
+            for (auto &row : sketch)
             {
-                return 1.0; // No decay for first access
+                row.assign(CMS_WIDTH, 0.0);
             }
 
-            // Calculate hours since last access
-            double hoursSinceLastAccess =
-                std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second).count() /
-                (1000.0 * 60.0 * 60.0);
-
-            // Calculate decay factor using exponential decay
-            return std::exp(-decayFactor * hoursSinceLastAccess);
+            // Background sweep: merges the write stripes and ages the
+            // scoreboard, so neither happens on the query path
+            sweeperRunning = true;
+            sweeperThread = std::thread(
+                [this]()
+                {
+                    std::unique_lock<std::mutex> lock(sweeperMutex);
+                    while (sweeperRunning)
+                    {
+                        sweeperCv.wait_for(lock, std::chrono::seconds(SWEEP_INTERVAL_SECONDS),
+                                           [this]()
+                                           { return !sweeperRunning; });
+                        if (!sweeperRunning)
+                        {
+                            break;
+                        }
+
+                        lock.unlock();
+                        mergeAndDecay();
+                        lock.lock();
+
+                        // Periodic save, so a crash loses at most one
+                        // interval of popularity movement
+                        if (!statePath.empty() &&
+                            std::chrono::steady_clock::now() - lastSave >=
+                                std::chrono::seconds(SAVE_INTERVAL_SECONDS))
+                        {
+                            std::string path = statePath;
+                            lastSave = std::chrono::steady_clock::now();
+                            lock.unlock();
+                            saveState(path);
+                            lock.lock();
+                        }
+                    }
+                });
         }
 
-        void PopularityTracker::updatePopularityWithDecay(const std::string &key, double increment)
+        PopularityTracker::~PopularityTracker()
         {
-            // Calculate current decayed popularity
-            double decay = calculateDecay(key);
-            double currentPopularity = 0.0;
-
-            auto it = keyPopularity.find(key);
-            if (it != keyPopularity.end())
             {
-                currentPopularity = it->second * decay;
+                std::lock_guard<std::mutex> lock(sweeperMutex);
+                sweeperRunning = false;
+            }
+            sweeperCv.notify_all();
+            if (sweeperThread.joinable())
+            {
+                sweeperThread.join();
             }
+        }
 
-            // Update with new increment
-            keyPopularity[key] = currentPopularity + increment;
+        size_t PopularityTracker::stripeFor(const std::string &keyPattern) const
+        {
+            // FNV-1a (shared kernel), folded down to a stripe index
+            return common::fnvHash32(keyPattern.data(), keyPattern.size()) % NUM_STRIPES;
+        }
 
-            // Update last access time
-            lastAccess[key] = std::chrono::steady_clock::now();
+        size_t PopularityTracker::sketchColumn(const std::string &keyPattern, size_t row) const
+        {
+            // FNV-1a with a per-row seed gives the independent hash
+            // functions the sketch needs
+            uint32_t seed = common::FNV32_BASIS + static_cast<uint32_t>(row) * 16777619;
+            return common::fnvHash32(keyPattern.data(), keyPattern.size(), seed) % CMS_WIDTH;
         }
 
-        // void PopularityTracker::recordQuery(const std::string &keyPattern, double increment)
-        // {
-        //     std::lock_guard<std::mutex> lock(popularityMutex);
-        //     updatePopularityWithDecay(keyPattern, increment);
-        // }
+        double PopularityTracker::sketchEstimate(const std::string &keyPattern) const
+        {
+            // Min over rows: collisions only ever inflate a cell, so the
+            // smallest row is the tightest estimate
+            double estimate = sketch[0][sketchColumn(keyPattern, 0)];
+            for (size_t row = 1; row < CMS_DEPTH; row++)
+            {
+                estimate = std::min(estimate, sketch[row][sketchColumn(keyPattern, row)]);
+            }
+            return estimate;
+        }
 
-        void PopularityTracker::recordQuery(const std::string &keyPattern, double increment)
+        void PopularityTracker::mergeAndDecay()
         {
+            // Drain each stripe under its own lock so writers stall for at
+            // most one stripe swap
+            std::unordered_map<std::string, double> drained;
+            for (auto &stripe : stripes)
+            {
+                std::unordered_map<std::string, double> pending;
+                {
+                    std::lock_guard<std::mutex> stripeLock(stripe.mutex);
+                    pending.swap(stripe.pending);
+                }
+                for (const auto &[keyPattern, increment] : pending)
+                {
+                    drained[keyPattern] += increment;
+                }
+            }
+
             std::lock_guard<std::mutex> lock(popularityMutex);
 
-            // Apply bonus to already-popular keys (rich get richer)
-            double actualIncrement = increment;
-            auto it = keyPopularity.find(keyPattern);
-            if (it != keyPopularity.end() && it->second > popularityThreshold)
+            // Age every score by the time elapsed since the last sweep;
+            // one exp() per sweep replaces per-access chrono math
+            auto now = std::chrono::steady_clock::now();
+            double hoursSinceLastDecay =
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - lastDecay).count() /
+                (1000.0 * 60.0 * 60.0);
+            double decay = std::exp(-decayFactor * hoursSinceLastDecay);
+            lastDecay = now;
+
+            // The sketch and the exact top-K entries age together
+            for (auto &row : sketch)
+            {
+                for (double &cell : row)
+                {
+                    cell *= decay;
+                }
+            }
+            for (auto it = keyPopularity.begin(); it != keyPopularity.end();)
             {
-                // Exponential bonus for already popular keys
-                actualIncrement *= (1.0 + std::log10(it->second / popularityThreshold));
+                it->second *= decay;
+                if (it->second < 0.01 && drained.find(it->first) == drained.end())
+                {
+                    it = keyPopularity.erase(it); // Aged out entirely
+                }
+                else
+                {
+                    ++it;
+                }
             }
 
-            updatePopularityWithDecay(keyPattern, actualIncrement);
+            // Fold in the drained increments, applying the rich-get-richer
+            // bonus against the merged score
+            for (const auto &[keyPattern, increment] : drained)
+            {
+                double actualIncrement = increment;
+                auto it = keyPopularity.find(keyPattern);
+                double current = it != keyPopularity.end()
+                                     ? it->second
+                                     : sketchEstimate(keyPattern);
+                if (current > popularityThreshold)
+                {
+                    // Exponential bonus for already popular keys
+                    actualIncrement *= (1.0 + std::log10(current / popularityThreshold));
+                }
+
+                // Every key lands in the fixed-size sketch
+                for (size_t row = 0; row < CMS_DEPTH; row++)
+                {
+                    sketch[row][sketchColumn(keyPattern, row)] += actualIncrement;
+                }
+
+                // Exact entries exist only for the current top-K: promote a
+                // key when its estimate beats the weakest tracked key,
+                // evicting that key back to sketch-only accuracy
+                if (it != keyPopularity.end())
+                {
+                    it->second += actualIncrement;
+                }
+                else if (keyPopularity.size() < TOP_K)
+                {
+                    keyPopularity[keyPattern] = sketchEstimate(keyPattern);
+                }
+                else
+                {
+                    auto weakest = std::min_element(
+                        keyPopularity.begin(), keyPopularity.end(),
+                        [](const auto &a, const auto &b)
+                        { return a.second < b.second; });
+                    double estimate = sketchEstimate(keyPattern);
+                    if (estimate > weakest->second)
+                    {
+                        keyPopularity.erase(weakest);
+                        keyPopularity[keyPattern] = estimate;
+                    }
+                }
+            }
         }
 
-        int PopularityTracker::getReplicationFactor(const std::string &keyPattern) const
+        void PopularityTracker::recordQuery(const std::string &keyPattern, double increment)
         {
-            std::lock_guard<std::mutex> lock(popularityMutex);
+            // Hot path: one short stripe lock, no decay math, no touch of
+            // the shared scoreboard
+            Stripe &stripe = stripes[stripeFor(keyPattern)];
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            stripe.pending[keyPattern] += increment;
+        }
 
-            // Get current popularity (with decay)
+        int PopularityTracker::getReplicationFactor(const std::string &keyPattern) const
+        {
             double popularity = getPopularity(keyPattern);
 
             // If popularity is below threshold, use base replication
@@ -109,33 +237,35 @@ namespace idioms
 
         double PopularityTracker::getPopularity(const std::string &keyPattern) const
         {
-            // Note: This method assumes popularityMutex is already locked by caller
+            // Scores are at most one sweep interval stale; routing decisions
+            // tolerate that in exchange for an uncontended write path
+            std::lock_guard<std::mutex> lock(popularityMutex);
 
+            // Exact for top-K keys, sketch estimate for the long tail
             auto it = keyPopularity.find(keyPattern);
-            if (it == keyPopularity.end())
+            if (it != keyPopularity.end())
             {
-                return 0.0;
+                return it->second;
             }
-
-            // Apply decay
-            double decay = calculateDecay(keyPattern);
-            return it->second * decay;
+            return sketchEstimate(keyPattern);
         }
 
         std::vector<std::pair<std::string, double>> PopularityTracker::getAllKeysSortedByPopularity() const
         {
+            // Pull in everything still sitting in the stripes so the
+            // report reflects the latest traffic
+            const_cast<PopularityTracker *>(this)->mergeAndDecay();
+
             std::lock_guard<std::mutex> lock(popularityMutex);
 
             // Create a vector for sorting
             std::vector<std::pair<std::string, double>> result;
 
-            // Populate with decayed scores
             for (const auto &entry : keyPopularity)
             {
-                double decayedPopularity = entry.second * calculateDecay(entry.first);
-                if (decayedPopularity > 0.01)
+                if (entry.second > 0.01)
                 { // Filter out extremely unpopular keys
-                    result.push_back({entry.first, decayedPopularity});
+                    result.push_back(entry);
                 }
             }
 
@@ -147,11 +277,122 @@ namespace idioms
             return result;
         }
 
+        bool PopularityTracker::saveState(const std::string &filename) const
+        {
+            // Pull in everything still sitting in the stripes so the
+            // snapshot reflects the latest traffic
+            const_cast<PopularityTracker *>(this)->mergeAndDecay();
+
+            std::ofstream file(filename);
+            if (!file.is_open())
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(popularityMutex);
+
+            // Write format version and the wall-clock time of the snapshot;
+            // the steady clock the decay runs on does not survive a restart
+            file << "IDIOMS_POPULARITY_V1" << std::endl;
+            file << std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count()
+                 << std::endl;
+
+            // Only the exact top-K entries are worth carrying across a
+            // restart; the sketch's long tail re-accumulates in minutes
+            file << keyPopularity.size() << std::endl;
+            for (const auto &[keyPattern, score] : keyPopularity)
+            {
+                file << score << " " << keyPattern << std::endl;
+            }
+
+            return true;
+        }
+
+        bool PopularityTracker::loadState(const std::string &filename)
+        {
+            std::ifstream file(filename);
+            if (!file.is_open())
+            {
+                return false;
+            }
+
+            std::string version;
+            file >> version;
+            if (version != "IDIOMS_POPULARITY_V1")
+            {
+                return false;
+            }
+
+            long long savedAtSeconds;
+            size_t count;
+            file >> savedAtSeconds >> count;
+
+            // Age the saved scores by however long the process was down,
+            // with the same per-hour factor the live decay uses
+            long long nowSeconds = std::chrono::duration_cast<std::chrono::seconds>(
+                                       std::chrono::system_clock::now().time_since_epoch())
+                                       .count();
+            double downtimeHours = std::max(0LL, nowSeconds - savedAtSeconds) / (60.0 * 60.0);
+            double decay = std::exp(-decayFactor * downtimeHours);
+
+            std::lock_guard<std::mutex> lock(popularityMutex);
+
+            size_t loaded = 0;
+            for (size_t i = 0; i < count && file.good(); i++)
+            {
+                double score;
+                file >> score >> std::ws;
+                std::string keyPattern;
+                std::getline(file, keyPattern);
+
+                score *= decay;
+                if (keyPattern.empty() || score < 0.01)
+                {
+                    continue; // Aged out during the downtime
+                }
+
+                // The sketch and the exact entry start out agreeing, the
+                // same invariant the sweep maintains
+                for (size_t row = 0; row < CMS_DEPTH; row++)
+                {
+                    sketch[row][sketchColumn(keyPattern, row)] += score;
+                }
+                keyPopularity[keyPattern] = score;
+                loaded++;
+            }
+
+            std::cout << "PopularityTracker warm-started with " << loaded
+                      << " keys (" << downtimeHours << "h downtime decay)" << std::endl;
+
+            return true;
+        }
+
+        void PopularityTracker::enablePersistence(const std::string &filename)
+        {
+            loadState(filename);
+
+            std::lock_guard<std::mutex> lock(sweeperMutex);
+            statePath = filename;
+            lastSave = std::chrono::steady_clock::now();
+        }
+
         void PopularityTracker::reset()
         {
+            for (auto &stripe : stripes)
+            {
+                std::lock_guard<std::mutex> stripeLock(stripe.mutex);
+                stripe.pending.clear();
+            }
+
             std::lock_guard<std::mutex> lock(popularityMutex);
             keyPopularity.clear();
-            lastAccess.clear();
+            for (auto &row : sketch)
+            {
+                row.assign(CMS_WIDTH, 0.0);
+            }
+            lastDecay = std::chrono::steady_clock::now();
         }
 
         // Static methods for the manager
@@ -6,7 +6,10 @@
 #include <mutex>
 #include <chrono>
 #include <algorithm>
+#include <array>
+#include <condition_variable>
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace idioms
@@ -17,18 +20,73 @@ namespace idioms
         /**
          * Class that tracks metadata key/value popularity for adaptive replication
          * Uses a time-decay mechanism to age popularity scores over time
+         *
+         * Writes land in striped pending counters so concurrent recordQuery
+         * calls for different keys never share a lock; a background sweep
+         * merges the stripes into the scoreboard and applies decay in one
+         * pass instead of per-access chrono math.
+         *
+         * Memory is bounded: scores live in a fixed-size count-min sketch,
+         * with exact entries kept only for the current top-K keys. A week of
+         * unique-query traffic costs the same 256KB as a quiet hour.
          */
         class PopularityTracker
         {
         private:
-            // Mutex for thread safety
+            // Number of independently locked write stripes
+            static const size_t NUM_STRIPES = 16;
+
+            // Seconds between background merge-and-decay sweeps
+            static constexpr int SWEEP_INTERVAL_SECONDS = 1;
+
+            // A stripe of pending, not-yet-merged increments
+            struct Stripe
+            {
+                std::mutex mutex;
+                std::unordered_map<std::string, double> pending;
+            };
+
+            mutable std::array<Stripe, NUM_STRIPES> stripes;
+
+            // Count-min sketch dimensions: the sketch is the bounded-memory
+            // backend, so popularity of an arbitrary key never needs a map
+            // entry. Width 8192 x depth 4 doubles is a fixed 256KB.
+            static constexpr size_t CMS_DEPTH = 4;
+            static constexpr size_t CMS_WIDTH = 8192;
+
+            // Only this many keys are tracked exactly; everything else is
+            // answered from the sketch estimate
+            static constexpr size_t TOP_K = 256;
+
+            // Guards the merged scoreboard; only readers and the sweep take
+            // it, never the recordQuery hot path
             mutable std::mutex popularityMutex;
 
-            // Map of metadata key patterns to their popularity scores
+            // Count-min sketch of decayed popularity scores
+            std::array<std::vector<double>, CMS_DEPTH> sketch;
+
+            // Exact scores for the current top-K keys only; bounded, and the
+            // source of getAllKeysSortedByPopularity
             std::unordered_map<std::string, double> keyPopularity;
 
-            // Map of last access times for decay calculation
-            std::unordered_map<std::string, std::chrono::time_point<std::chrono::steady_clock>> lastAccess;
+            // When decay was last applied to the scoreboard
+            std::chrono::time_point<std::chrono::steady_clock> lastDecay;
+
+            // Background sweep state
+            std::thread sweeperThread;
+            std::mutex sweeperMutex;
+            std::condition_variable sweeperCv;
+            bool sweeperRunning = false;
+
+            // Seconds between periodic state saves once persistence is on
+            static constexpr int SAVE_INTERVAL_SECONDS = 60;
+
+            // Where periodic saves go; empty means persistence is off.
+            // Guarded by sweeperMutex, like the rest of the sweeper state.
+            std::string statePath;
+
+            // When the state was last saved
+            std::chrono::time_point<std::chrono::steady_clock> lastSave;
 
             // Decay factor (per hour) - configurable
             double decayFactor;
@@ -42,11 +100,19 @@ namespace idioms
             // Base replication factor (from DART)
             int baseReplicationFactor;
 
-            // Calculate time decay for a key based on last access time
-            double calculateDecay(const std::string &key) const;
+            // Map a key pattern to its write stripe
+            size_t stripeFor(const std::string &keyPattern) const;
+
+            // Sketch column for a key in a given row
+            size_t sketchColumn(const std::string &keyPattern, size_t row) const;
 
-            // Update popularity score with decay applied
-            void updatePopularityWithDecay(const std::string &key, double increment);
+            // Point estimate for a key from the sketch (min over rows);
+            // assumes popularityMutex is held
+            double sketchEstimate(const std::string &keyPattern) const;
+
+            // Drain every stripe into the scoreboard and age the scores by
+            // the time elapsed since the previous sweep
+            void mergeAndDecay();
 
         public:
             /**
@@ -60,9 +126,14 @@ namespace idioms
             PopularityTracker(int baseReplication, int maxReplication = 5,
                               double threshold = 10.0, double decay = 0.1);
 
+            ~PopularityTracker();
+
             /**
              * Record a query for a metadata key pattern
              *
+             * Only touches the key's write stripe; the increment becomes
+             * visible to readers at the next background sweep.
+             *
              * @param keyPattern The key pattern queried (can include wildcards)
              * @param increment Amount to increment popularity (default: 1.0)
              */
@@ -91,6 +162,39 @@ namespace idioms
              */
             std::vector<std::pair<std::string, double>> getAllKeysSortedByPopularity() const;
 
+            /**
+             * Save the current top-K popularity scores to a file
+             *
+             * The snapshot carries a wall-clock timestamp, so a restarted
+             * process can age the scores by however long it was down.
+             *
+             * @param filename Path to save the state to
+             * @return True if saved successfully
+             */
+            bool saveState(const std::string &filename) const;
+
+            /**
+             * Load popularity scores saved by saveState
+             *
+             * Scores are decayed for the wall-clock time elapsed since the
+             * snapshot was taken, then folded into the sketch and the exact
+             * top-K entries; scores that aged below the tracking floor are
+             * dropped. Routing decisions warm-start from the loaded table
+             * instead of re-accumulating popularity from zero.
+             *
+             * @param filename Path to load the state from
+             * @return True if loaded successfully
+             */
+            bool loadState(const std::string &filename);
+
+            /**
+             * Load any saved state from the file and save the table there
+             * periodically from the background sweep
+             *
+             * @param filename Path for the persistent popularity state
+             */
+            void enablePersistence(const std::string &filename);
+
             /**
              * Reset all popularity tracking data
              */
@@ -1,9 +1,12 @@
 #include "MultiConditionQuery.hpp"
+#include "SubstringMatch.hpp"
 #include <iostream>
 #include <sstream>
 #include <regex>
 #include <cmath>
 #include <algorithm>
+#include <list>
+#include <mutex>
 
 namespace idioms
 {
@@ -135,27 +138,20 @@ namespace idioms
                 }
 
             case CONTAINS:
-                return testValue.find(value) != std::string::npos;
+                return containsSubstring(testValue, value);
 
             case STARTS_WITH:
-                return testValue.find(value) == 0;
+                return startsWith(testValue, value);
 
             case ENDS_WITH:
-                return testValue.length() >= value.length() &&
-                       testValue.compare(testValue.length() - value.length(),
-                                         value.length(), value) == 0;
+                return endsWith(testValue, value);
 
             case REGEX_MATCH:
-                try
-                {
-                    std::regex pattern(value);
-                    return std::regex_match(testValue, pattern);
-                }
-                catch (const std::regex_error &e)
-                {
-                    std::cerr << "Invalid regex pattern: " << value << std::endl;
-                    return false;
-                }
+            {
+                // Compiled once per distinct pattern, not per candidate
+                auto pattern = compiledRegex(value);
+                return pattern && std::regex_match(testValue, *pattern);
+            }
             }
 
             return false; // Should never reach here
@@ -339,6 +335,112 @@ namespace idioms
             return result;
         }
 
+        std::vector<int> MultiConditionQuery::combineResults(std::vector<std::vector<int>> conditionResults) const
+        {
+            if (conditionResults.empty())
+            {
+                return {};
+            }
+
+            ResultSet combined(std::move(conditionResults[0]));
+
+            size_t i = 0;
+            while (i < operators.size() && i + 1 < conditionResults.size())
+            {
+                if (operators[i] == OR)
+                {
+                    combined.unionWith(ResultSet(std::move(conditionResults[i + 1])));
+                    i++;
+                    continue;
+                }
+
+                // Maximal run of AND-connected conditions starting here.
+                // Intersection is commutative, so the run can be taken
+                // smallest list first: the working set collapses to the
+                // most selective condition before the wide lists of
+                // expensive operators are touched.
+                size_t runEnd = i;
+                while (runEnd < operators.size() &&
+                       runEnd + 1 < conditionResults.size() &&
+                       operators[runEnd] == AND)
+                {
+                    runEnd++;
+                }
+
+                std::vector<size_t> runIndices;
+                for (size_t j = i + 1; j <= runEnd; j++)
+                {
+                    runIndices.push_back(j);
+                }
+                std::sort(runIndices.begin(), runIndices.end(),
+                          [&](size_t a, size_t b)
+                          {
+                              return conditionResults[a].size() <
+                                     conditionResults[b].size();
+                          });
+
+                for (size_t idx : runIndices)
+                {
+                    combined.intersectWith(ResultSet(std::move(conditionResults[idx])));
+
+                    // Short-circuit: an empty intersection stays empty
+                    if (combined.empty())
+                    {
+                        return {};
+                    }
+                }
+
+                // The operator that ended the run is processed next
+                i = runEnd;
+            }
+
+            return combined.takeVector();
+        }
+
+        std::vector<size_t> MultiConditionQuery::planConditionOrder(
+            const std::vector<size_t> &cardinalities) const
+        {
+            std::vector<size_t> order(conditions.size());
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                order[i] = i;
+            }
+
+            if (order.empty())
+            {
+                return order;
+            }
+
+            // Most selective first: smaller posting list when known,
+            // cheaper operator otherwise
+            auto moreSelective = [&](size_t a, size_t b)
+            {
+                if (a < cardinalities.size() && b < cardinalities.size() &&
+                    cardinalities[a] != cardinalities[b])
+                {
+                    return cardinalities[a] < cardinalities[b];
+                }
+                return conditionCost(conditions[a]) < conditionCost(conditions[b]);
+            };
+
+            // Sort within each run of AND-connected conditions; OR
+            // boundaries delimit the runs and are never crossed
+            size_t runStart = 0;
+            for (size_t i = 0; i <= operators.size(); i++)
+            {
+                if (i < operators.size() && operators[i] == AND)
+                {
+                    continue;
+                }
+
+                std::stable_sort(order.begin() + runStart, order.begin() + i + 1,
+                                 moreSelective);
+                runStart = i + 1;
+            }
+
+            return order;
+        }
+
         std::string MultiConditionQuery::toString() const
         {
             if (conditions.empty())
@@ -429,6 +531,48 @@ namespace idioms
 
         // Utility functions implementation
 
+        int conditionCost(const QueryCondition &condition)
+        {
+            int cost;
+
+            switch (condition.op)
+            {
+            case EQUALS:
+                cost = condition.valueHasWildcard ? 40 : 0;
+                break;
+            case STARTS_WITH:
+                cost = 10;
+                break;
+            case ENDS_WITH:
+                cost = 15;
+                break;
+            case GREATER_THAN:
+            case LESS_THAN:
+            case GREATER_EQUAL:
+            case LESS_EQUAL:
+                cost = 20;
+                break;
+            case NOT_EQUALS:
+                cost = 30;
+                break;
+            case CONTAINS:
+                cost = 50;
+                break;
+            case REGEX_MATCH:
+            default:
+                cost = 100;
+                break;
+            }
+
+            // A wildcarded key has to scan many keys whatever the operator
+            if (condition.keyHasWildcard)
+            {
+                cost += 40;
+            }
+
+            return cost;
+        }
+
         bool containsWildcard(const std::string &str)
         {
             return str.find('*') != std::string::npos || str.find('?') != std::string::npos;
@@ -471,6 +615,69 @@ namespace idioms
             return end != str.c_str() && *end == '\0' && str[0] != ' ';
         }
 
+        bool isCountQuery(const std::string &queryStr)
+        {
+            return queryStr.length() > 7 &&
+                   queryStr.compare(0, 6, "COUNT(") == 0 &&
+                   queryStr.back() == ')';
+        }
+
+        std::string countQueryCondition(const std::string &queryStr)
+        {
+            return queryStr.substr(6, queryStr.length() - 7);
+        }
+
+        bool isCountDistinctQuery(const std::string &queryStr)
+        {
+            return isCountQuery(queryStr) &&
+                   countQueryCondition(queryStr).compare(0, 9, "DISTINCT ") == 0;
+        }
+
+        std::string countDistinctKey(const std::string &queryStr)
+        {
+            return countQueryCondition(queryStr).substr(9);
+        }
+
+        bool isGroupByQuery(const std::string &queryStr)
+        {
+            return queryStr.length() > 10 &&
+                   queryStr.compare(0, 9, "GROUP BY(") == 0 &&
+                   queryStr.back() == ')';
+        }
+
+        std::string groupByKey(const std::string &queryStr)
+        {
+            return queryStr.substr(9, queryStr.length() - 10);
+        }
+
+        size_t parseLimitModifier(const std::string &queryStr, std::string &condition)
+        {
+            size_t pos = queryStr.rfind(" LIMIT ");
+            if (pos != std::string::npos)
+            {
+                std::string digits = queryStr.substr(pos + 7);
+                if (!digits.empty() &&
+                    digits.find_first_not_of("0123456789") == std::string::npos)
+                {
+                    condition = queryStr.substr(0, pos);
+                    return static_cast<size_t>(std::stoul(digits));
+                }
+            }
+
+            condition = queryStr;
+            return 0;
+        }
+
+        std::string stripQueryModifiers(const std::string &queryStr)
+        {
+            std::string condition =
+                isCountQuery(queryStr) ? countQueryCondition(queryStr) : queryStr;
+
+            std::string bare;
+            parseLimitModifier(condition, bare);
+            return bare;
+        }
+
         std::string normalizeWildcardPattern(const std::string &pattern)
         {
             // Convert wildcard pattern to regex pattern
@@ -506,26 +713,154 @@ namespace idioms
             return "^" + regexPattern + "$";
         }
 
-        bool matchWildcard(const std::string &str, const std::string &pattern)
+        bool matchWildcard(std::string_view str, std::string_view pattern)
         {
             if (pattern == "*")
             {
                 return true; // Match everything
             }
 
-            // Convert wildcard pattern to regex
-            std::string regexPattern = normalizeWildcardPattern(pattern);
+            // Patterns without '?' and with at most simple star shapes
+            // dispatch to the substring kernels: candidate verification
+            // calls this once per candidate, and "*needle*" is by far
+            // the hottest shape
+            if (pattern.find('?') == std::string_view::npos)
+            {
+                size_t star = pattern.find('*');
+                if (star == std::string_view::npos)
+                {
+                    return str == pattern;
+                }
+
+                size_t star2 = pattern.find('*', star + 1);
+                if (star2 == std::string_view::npos)
+                {
+                    // One star, "a*b": fixed prefix and suffix around it
+                    std::string_view prefix = pattern.substr(0, star);
+                    std::string_view suffix = pattern.substr(star + 1);
+                    return str.size() >= prefix.size() + suffix.size() &&
+                           startsWith(str, prefix) && endsWith(str, suffix);
+                }
+
+                if (star == 0 && star2 == pattern.size() - 1)
+                {
+                    // Two stars bracketing the pattern, "*needle*": a
+                    // pure infix test
+                    return containsSubstring(
+                        str, pattern.substr(1, pattern.size() - 2));
+                }
+            }
+
+            // Greedy two-pointer match over '*' and '?'. This replaces the
+            // old regex conversion, which compiled a std::regex on every
+            // call and dominated wildcard-heavy query runtime.
+            size_t s = 0, p = 0;
+            size_t starP = std::string::npos;
+            size_t starS = 0;
 
+            while (s < str.size())
+            {
+                if (p < pattern.size() &&
+                    (pattern[p] == '?' || pattern[p] == str[s]))
+                {
+                    s++;
+                    p++;
+                }
+                else if (p < pattern.size() && pattern[p] == '*')
+                {
+                    // Try '*' matching nothing first; remember where to
+                    // backtrack if the rest of the pattern fails
+                    starP = p++;
+                    starS = s;
+                }
+                else if (starP != std::string::npos)
+                {
+                    // Backtrack: let the last '*' absorb one more character
+                    p = starP + 1;
+                    s = ++starS;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            // Only trailing stars may remain in the pattern
+            while (p < pattern.size() && pattern[p] == '*')
+            {
+                p++;
+            }
+            return p == pattern.size();
+        }
+
+        std::shared_ptr<const std::regex> compiledRegex(const std::string &pattern)
+        {
+            static std::mutex cacheMutex;
+            static std::unordered_map<std::string, std::shared_ptr<const std::regex>> cache;
+
+            std::lock_guard<std::mutex> lock(cacheMutex);
+
+            auto it = cache.find(pattern);
+            if (it != cache.end())
+            {
+                return it->second;
+            }
+
+            std::shared_ptr<const std::regex> compiled;
             try
             {
-                std::regex re(regexPattern);
-                return std::regex_match(str, re);
+                compiled = std::make_shared<const std::regex>(pattern);
             }
             catch (const std::regex_error &e)
             {
-                std::cerr << "Invalid regex pattern: " << regexPattern << std::endl;
-                return false;
+                // Cache the failure too, so the pattern is reported once
+                // instead of once per candidate
+                std::cerr << "Invalid regex pattern: " << pattern << std::endl;
             }
+
+            cache.emplace(pattern, compiled);
+            return compiled;
+        }
+
+        std::shared_ptr<const MultiConditionQuery> parsedQuery(const std::string &queryStr)
+        {
+            // Bounded LRU: the workload repeats a few hundred query shapes,
+            // which stay resident, while one-off strings age out instead of
+            // growing the cache without limit
+            static const size_t PLAN_CACHE_CAPACITY = 512;
+
+            struct PlanCacheEntry
+            {
+                std::shared_ptr<const MultiConditionQuery> plan;
+                std::list<std::string>::iterator lruPosition;
+            };
+
+            static std::mutex cacheMutex;
+            static std::unordered_map<std::string, PlanCacheEntry> cache;
+            static std::list<std::string> lru; // Most recent at front
+
+            std::lock_guard<std::mutex> lock(cacheMutex);
+
+            auto it = cache.find(queryStr);
+            if (it != cache.end())
+            {
+                lru.splice(lru.begin(), lru, it->second.lruPosition);
+                return it->second.plan;
+            }
+
+            auto plan = std::make_shared<const MultiConditionQuery>(
+                MultiConditionQuery::fromString(queryStr));
+
+            // Evict the least recently used entry if the cache is full
+            if (cache.size() >= PLAN_CACHE_CAPACITY)
+            {
+                cache.erase(lru.back());
+                lru.pop_back();
+            }
+
+            lru.push_front(queryStr);
+            cache.emplace(queryStr, PlanCacheEntry{plan, lru.begin()});
+            return plan;
         }
 
     } // namespace query
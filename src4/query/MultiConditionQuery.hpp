@@ -2,11 +2,14 @@
 #define IDIOMS_MULTI_CONDITION_QUERY_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <functional>
+#include <regex>
+#include "ResultSet.hpp"
 
 namespace idioms
 {
@@ -96,6 +99,42 @@ namespace idioms
              */
             bool matches(const std::unordered_map<std::string, std::string> &objectMetadata) const;
 
+            /**
+             * Combine per-condition result sets with this query's AND/OR
+             * operators, applied left to right
+             *
+             * Each entry of conditionResults holds the sorted object IDs that
+             * matched the corresponding condition. Combination runs on sorted
+             * vectors (merge-based union, galloping intersection) rather than
+             * hash sets. Within each run of AND-connected conditions the
+             * lists are intersected smallest first — intersection is
+             * commutative, so the working set collapses to the most
+             * selective condition before the wide lists are touched.
+             *
+             * @param conditionResults Sorted matching IDs, one vector per condition
+             * @return Sorted object IDs matching the whole query
+             */
+            std::vector<int> combineResults(std::vector<std::vector<int>> conditionResults) const;
+
+            /**
+             * Plan the order in which this query's conditions should be
+             * evaluated
+             *
+             * Within each run of AND-connected conditions the indices come
+             * back most-selective first: by posting-list cardinality when
+             * the caller supplies one per condition (the trie has them),
+             * falling back to operator cost, so a cheap selective EQUALS
+             * runs before an expensive CONTAINS or REGEX_MATCH. Reordering
+             * never crosses an OR boundary, which preserves the query's
+             * left-to-right semantics.
+             *
+             * @param cardinalities Estimated matching IDs per condition, or
+             *                      empty to order by operator cost alone
+             * @return Condition indices in evaluation order
+             */
+            std::vector<size_t> planConditionOrder(
+                const std::vector<size_t> &cardinalities = {}) const;
+
             /**
              * Convert to a string representation
              *
@@ -128,6 +167,11 @@ namespace idioms
 
         // Utility functions
 
+        // Relative evaluation cost of a condition: exact EQUALS is the
+        // cheapest, REGEX_MATCH the most expensive, and wildcards add to
+        // either. Used to order AND groups when no cardinalities are known.
+        int conditionCost(const QueryCondition &condition);
+
         // Check if a string contains a wildcard
         bool containsWildcard(const std::string &str);
 
@@ -143,11 +187,51 @@ namespace idioms
         // Check if a string represents a numeric value
         bool isNumeric(const std::string &str);
 
+        // Query modifiers
+
+        // Check whether a query string has the form COUNT(<condition>)
+        bool isCountQuery(const std::string &queryStr);
+
+        // Extract the condition inside COUNT(...)
+        std::string countQueryCondition(const std::string &queryStr);
+
+        // Check whether a query string has the form COUNT(DISTINCT <key>)
+        bool isCountDistinctQuery(const std::string &queryStr);
+
+        // Extract the key inside COUNT(DISTINCT ...)
+        std::string countDistinctKey(const std::string &queryStr);
+
+        // Check whether a query string has the form GROUP BY(<key>)
+        bool isGroupByQuery(const std::string &queryStr);
+
+        // Extract the key inside GROUP BY(...)
+        std::string groupByKey(const std::string &queryStr);
+
+        // Parse a trailing " LIMIT k" modifier. The bare condition is left
+        // in condition; returns k, or 0 when no limit is present.
+        size_t parseLimitModifier(const std::string &queryStr, std::string &condition);
+
+        // Strip all modifiers, leaving the bare condition used for routing
+        std::string stripQueryModifiers(const std::string &queryStr);
+
         // Normalize a wildcard pattern for matching
         std::string normalizeWildcardPattern(const std::string &pattern);
 
-        // Match a string against a wildcard pattern
-        bool matchWildcard(const std::string &str, const std::string &pattern);
+        // Match a string against a wildcard pattern. Runs a direct
+        // two-pointer match over '*' and '?' with no compilation step, so
+        // it is safe to call per candidate record.
+        bool matchWildcard(std::string_view str, std::string_view pattern);
+
+        // Fetch the compiled std::regex for a pattern, compiling on first
+        // use and caching by pattern string across queries. Returns nullptr
+        // for an invalid pattern (reported once, not per candidate).
+        std::shared_ptr<const std::regex> compiledRegex(const std::string &pattern);
+
+        // Fetch the parsed plan for a condition string, parsing on first
+        // use and caching in a bounded process-wide LRU. Repeated query
+        // shapes cost a hash lookup instead of a full re-parse; the plan
+        // is shared and immutable, so callers on any thread may hold it.
+        std::shared_ptr<const MultiConditionQuery> parsedQuery(const std::string &queryStr);
 
     } // namespace query
 } // namespace idioms
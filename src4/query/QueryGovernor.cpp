@@ -0,0 +1,69 @@
+#include "QueryGovernor.hpp"
+
+namespace idioms
+{
+    namespace query
+    {
+
+        QueryGovernor &QueryGovernor::instance()
+        {
+            static QueryGovernor governor;
+            return governor;
+        }
+
+        std::shared_ptr<QueryBudget> QueryGovernor::begin(uint64_t requestId,
+                                                          uint64_t maxNodeVisits,
+                                                          int64_t maxMillis)
+        {
+            auto budget = std::make_shared<QueryBudget>();
+            budget->maxNodeVisits = maxNodeVisits;
+            if (maxMillis > 0)
+            {
+                budget->deadline = std::chrono::steady_clock::now() +
+                                   std::chrono::milliseconds(maxMillis);
+            }
+
+            // Request ID 0 is the unversioned/legacy case: the budget
+            // still governs the execution but cannot be cancelled by name
+            if (requestId != 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active[requestId] = budget;
+            }
+
+            return budget;
+        }
+
+        void QueryGovernor::end(uint64_t requestId)
+        {
+            if (requestId == 0)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            active.erase(requestId);
+        }
+
+        bool QueryGovernor::cancel(uint64_t requestId)
+        {
+            std::shared_ptr<QueryBudget> budget;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = active.find(requestId);
+                if (it == active.end())
+                {
+                    return false;
+                }
+                budget = it->second;
+            }
+
+            // Flip outside the lock: the victim's next checkpoint throws
+            // and its handler deregisters the budget itself
+            budget->reason.store("cancelled by client");
+            budget->cancelled.store(true);
+            return true;
+        }
+
+    } // namespace query
+} // namespace idioms
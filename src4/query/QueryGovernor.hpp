@@ -0,0 +1,210 @@
+#ifndef IDIOMS_QUERY_GOVERNOR_HPP
+#define IDIOMS_QUERY_GOVERNOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace idioms
+{
+    namespace query
+    {
+
+        /**
+         * Thrown from a traversal checkpoint when a query's budget runs
+         * out or the client cancels it
+         *
+         * Unwinds the trie walk back to the message handler, which turns
+         * it into an error response. Nothing in the walk holds state the
+         * unwind cannot release: reader locks are scope-guarded and the
+         * partial posting sets are locals.
+         */
+        class QueryCancelled : public std::runtime_error
+        {
+        public:
+            explicit QueryCancelled(const std::string &reason)
+                : std::runtime_error(reason) {}
+        };
+
+        /**
+         * Per-query execution budget
+         *
+         * One instance lives for the duration of one query execution.
+         * Traversal checkpoints charge node visits against it; the cancel
+         * path flips the flag from another thread. The members are
+         * atomics so the parallel scan workers share one budget without
+         * taking a lock.
+         */
+        struct QueryBudget
+        {
+            // Set by cancel() or by the first checkpoint that trips a
+            // limit; every later checkpoint then aborts immediately
+            std::atomic<bool> cancelled{false};
+
+            // Why the query stopped: a string literal, written before the
+            // flag so a checkpoint that sees the flag sees the reason
+            std::atomic<const char *> reason{nullptr};
+
+            // Nodes the traversal may touch; 0 means unlimited
+            uint64_t maxNodeVisits = 0;
+
+            // Wall-clock cutoff for the whole execution
+            std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::time_point::max();
+
+            // Nodes charged so far, summed across all scan workers
+            std::atomic<uint64_t> nodeVisits{0};
+        };
+
+        namespace detail
+        {
+            // The budget charged by this thread's checkpoints; null when
+            // the thread is not executing a governed query
+            inline thread_local QueryBudget *activeBudget = nullptr;
+        }
+
+        // The budget governing this thread's traversal, if any. The scan
+        // workers read this before spawning so the parallel walk charges
+        // the same budget as its parent.
+        inline QueryBudget *currentBudget()
+        {
+            return detail::activeBudget;
+        }
+
+        /**
+         * Installs a budget on the current thread for one scope
+         *
+         * The trie code never sees the budget directly; it reaches the
+         * checkpoints through the thread-local, so the traversal
+         * signatures stay untouched.
+         */
+        class BudgetScope
+        {
+        private:
+            QueryBudget *previous;
+
+        public:
+            explicit BudgetScope(QueryBudget *budget)
+                : previous(detail::activeBudget)
+            {
+                detail::activeBudget = budget;
+            }
+
+            ~BudgetScope()
+            {
+                detail::activeBudget = previous;
+            }
+
+            BudgetScope(const BudgetScope &) = delete;
+            BudgetScope &operator=(const BudgetScope &) = delete;
+        };
+
+        /**
+         * One cooperative cancellation checkpoint
+         *
+         * Called once per visited node from the trie traversal loops.
+         * With no budget installed this is a thread-local load and a
+         * branch; with one, a relaxed increment. The deadline is only
+         * consulted every 1024 visits so the hot path never reads the
+         * clock.
+         *
+         * @throws QueryCancelled when the budget is exhausted or the
+         *         query was cancelled
+         */
+        inline void checkBudget()
+        {
+            QueryBudget *budget = detail::activeBudget;
+            if (budget == nullptr)
+            {
+                return;
+            }
+
+            if (budget->cancelled.load(std::memory_order_relaxed))
+            {
+                const char *reason = budget->reason.load();
+                throw QueryCancelled(reason != nullptr ? reason
+                                                       : "query cancelled");
+            }
+
+            uint64_t visits =
+                budget->nodeVisits.fetch_add(1, std::memory_order_relaxed) + 1;
+
+            if (budget->maxNodeVisits != 0 && visits > budget->maxNodeVisits)
+            {
+                budget->reason.store("node visit budget exceeded");
+                budget->cancelled.store(true);
+                throw QueryCancelled("node visit budget exceeded");
+            }
+
+            if ((visits & 1023) == 0 &&
+                std::chrono::steady_clock::now() > budget->deadline)
+            {
+                budget->reason.store("time budget exceeded");
+                budget->cancelled.store(true);
+                throw QueryCancelled("time budget exceeded");
+            }
+        }
+
+        /**
+         * Registry of in-flight query budgets, keyed by request ID
+         *
+         * The request ID already rides the wire header, so a CANCEL from
+         * the client names its victim with no new bookkeeping. cancel()
+         * only flips a flag; the running query notices at its next
+         * checkpoint and unwinds on its own thread.
+         */
+        class QueryGovernor
+        {
+        private:
+            mutable std::mutex mutex;
+            std::unordered_map<uint64_t, std::shared_ptr<QueryBudget>> active;
+
+            QueryGovernor() = default;
+
+        public:
+            // The process-wide governor
+            static QueryGovernor &instance();
+
+            /**
+             * Register a budget for a query about to execute
+             *
+             * @param requestId The query's wire request ID
+             * @param maxNodeVisits Node visit cap, 0 for unlimited
+             * @param maxMillis Wall-clock cap in ms, 0 for unlimited
+             * @return The budget, to install with a BudgetScope
+             */
+            std::shared_ptr<QueryBudget> begin(uint64_t requestId,
+                                               uint64_t maxNodeVisits,
+                                               int64_t maxMillis);
+
+            /**
+             * Deregister a finished query's budget
+             *
+             * @param requestId The request ID passed to begin()
+             */
+            void end(uint64_t requestId);
+
+            /**
+             * Cancel an in-flight query
+             *
+             * @param requestId The request ID of the query to cancel
+             * @return true if the ID named a registered query
+             */
+            bool cancel(uint64_t requestId);
+        };
+
+        // The process-wide governor
+        inline QueryGovernor &governor()
+        {
+            return QueryGovernor::instance();
+        }
+
+    } // namespace query
+} // namespace idioms
+
+#endif // IDIOMS_QUERY_GOVERNOR_HPP
@@ -20,7 +20,7 @@ namespace idioms
 
         RangeQuery::RangeQuery(const std::string &key, const std::string &minDate,
                                const std::string &maxDate, const std::string &format)
-            : key(key), dateFormat(format), isDateRange(true)
+            : key(key), isDateRange(true), dateFormat(format)
         {
 
             keyHasWildcard = containsWildcard(key);
@@ -142,10 +142,11 @@ namespace idioms
         RangeQuery RangeQuery::fromString(const std::string &queryStr)
         {
             // Parse format: "key in range [min to max]"
-            std::regex rangePattern(R"((.+)\s+in\s+range\s+\[(.+)\s+to\s+(.+)\])");
+            auto rangePattern = compiledRegex(R"((.+)\s+in\s+range\s+\[(.+)\s+to\s+(.+)\])");
             std::smatch matches;
 
-            if (std::regex_match(queryStr, matches, rangePattern) && matches.size() == 4)
+            if (rangePattern && std::regex_match(queryStr, matches, *rangePattern) &&
+                matches.size() == 4)
             {
                 std::string key = matches[1].str();
                 std::string minStr = matches[2].str();
@@ -298,18 +299,18 @@ namespace idioms
 
             if (dateFormat == "YYYY-MM-DD" || dateFormat.empty())
             {
-                std::regex dateRegex(R"(\d{4}-\d{2}-\d{2})");
-                return std::regex_match(dateStr, dateRegex);
+                auto dateRegex = compiledRegex(R"(\d{4}-\d{2}-\d{2})");
+                return dateRegex && std::regex_match(dateStr, *dateRegex);
             }
             else if (dateFormat == "MM/DD/YYYY")
             {
-                std::regex dateRegex(R"(\d{2}/\d{2}/\d{4})");
-                return std::regex_match(dateStr, dateRegex);
+                auto dateRegex = compiledRegex(R"(\d{2}/\d{2}/\d{4})");
+                return dateRegex && std::regex_match(dateStr, *dateRegex);
             }
             else if (dateFormat == "DD-MM-YYYY")
             {
-                std::regex dateRegex(R"(\d{2}-\d{2}-\d{4})");
-                return std::regex_match(dateStr, dateRegex);
+                auto dateRegex = compiledRegex(R"(\d{2}-\d{2}-\d{4})");
+                return dateRegex && std::regex_match(dateStr, *dateRegex);
             }
             else
             {
@@ -0,0 +1,98 @@
+#ifndef IDIOMS_RANGE_QUERY_HPP
+#define IDIOMS_RANGE_QUERY_HPP
+
+#include <string>
+#include "MultiConditionQuery.hpp"
+
+namespace idioms
+{
+    namespace query
+    {
+
+        /**
+         * A range query over numeric or date-valued metadata
+         * Matches objects whose value for a key falls within [min, max]
+         */
+        class RangeQuery
+        {
+        private:
+            std::string key;        // Metadata attribute key
+            double minValue;        // Lower bound (inclusive)
+            double maxValue;        // Upper bound (inclusive)
+            bool isDateRange;       // Whether the bounds are dates
+            std::string dateFormat; // Date format for date ranges
+            bool keyHasWildcard;    // Whether key contains wildcards
+
+            // Convert a date string to days since epoch
+            double dateToNumeric(const std::string &dateStr) const;
+
+            // Convert days since epoch back to a date string
+            std::string numericToDate(double value) const;
+
+            // Check if a date string matches the expected format
+            bool isValidDateFormat(const std::string &dateStr) const;
+
+        public:
+            /**
+             * Constructor for a numeric range
+             *
+             * @param key Metadata attribute key
+             * @param min Lower bound (inclusive)
+             * @param max Upper bound (inclusive)
+             */
+            RangeQuery(const std::string &key, double min, double max);
+
+            /**
+             * Constructor for a date range
+             *
+             * @param key Metadata attribute key
+             * @param minDate Lower bound date (inclusive)
+             * @param maxDate Upper bound date (inclusive)
+             * @param format Date format (YYYY-MM-DD, MM/DD/YYYY or DD-MM-YYYY)
+             */
+            RangeQuery(const std::string &key, const std::string &minDate,
+                       const std::string &maxDate, const std::string &format = "YYYY-MM-DD");
+
+            /**
+             * Check if a key-value pair falls within this range
+             *
+             * @param metadataKey Metadata attribute key to test
+             * @param metadataValue Metadata attribute value to test
+             * @return True if the value is in range for a matching key
+             */
+            bool isInRange(const std::string &metadataKey, const std::string &metadataValue) const;
+
+            /**
+             * Convert to an equivalent multi-condition query (min AND max)
+             *
+             * @return MultiConditionQuery with >= and <= conditions
+             */
+            MultiConditionQuery toMultiConditionQuery() const;
+
+            /**
+             * Convert to a string representation
+             *
+             * @return String in the format "key in range [min to max]"
+             */
+            std::string toString() const;
+
+            /**
+             * Create a range query from a string representation
+             *
+             * @param queryStr String in the format "key in range [min to max]"
+             * @return RangeQuery object
+             */
+            static RangeQuery fromString(const std::string &queryStr);
+
+            // Accessors
+            const std::string &getKey() const;
+            double getMinValue() const;
+            double getMaxValue() const;
+            bool isDateRangeQuery() const;
+            const std::string &getDateFormat() const;
+        };
+
+    } // namespace query
+} // namespace idioms
+
+#endif // IDIOMS_RANGE_QUERY_HPP
@@ -0,0 +1,138 @@
+#include "ResultSet.hpp"
+#include <algorithm>
+
+namespace idioms
+{
+    namespace query
+    {
+
+        namespace
+        {
+            // Find the first position in [lo, values.size()) whose value is
+            // >= target, by exponential probing followed by binary search.
+            // Touches O(log distance) elements instead of scanning linearly.
+            size_t gallopLowerBound(const std::vector<int> &values, size_t lo, int target)
+            {
+                size_t step = 1;
+                size_t hi = lo;
+
+                while (hi < values.size() && values[hi] < target)
+                {
+                    lo = hi + 1;
+                    hi += step;
+                    step *= 2;
+                }
+
+                if (hi > values.size())
+                {
+                    hi = values.size();
+                }
+
+                return std::lower_bound(values.begin() + lo, values.begin() + hi, target) -
+                       values.begin();
+            }
+        } // namespace
+
+        ResultSet::ResultSet()
+        {
+        }
+
+        ResultSet::ResultSet(std::vector<int> sortedIds)
+            : ids(std::move(sortedIds))
+        {
+        }
+
+        ResultSet ResultSet::fromUnsorted(std::vector<int> unsortedIds)
+        {
+            std::sort(unsortedIds.begin(), unsortedIds.end());
+            unsortedIds.erase(std::unique(unsortedIds.begin(), unsortedIds.end()),
+                              unsortedIds.end());
+            return ResultSet(std::move(unsortedIds));
+        }
+
+        void ResultSet::unionWith(const ResultSet &other)
+        {
+            if (other.ids.empty())
+            {
+                return;
+            }
+            if (ids.empty())
+            {
+                ids = other.ids;
+                return;
+            }
+
+            std::vector<int> merged;
+            merged.reserve(ids.size() + other.ids.size());
+            std::set_union(ids.begin(), ids.end(),
+                           other.ids.begin(), other.ids.end(),
+                           std::back_inserter(merged));
+            ids = std::move(merged);
+        }
+
+        void ResultSet::intersectWith(const ResultSet &other)
+        {
+            if (ids.empty() || other.ids.empty())
+            {
+                ids.clear();
+                return;
+            }
+
+            const std::vector<int> &small = ids.size() <= other.ids.size() ? ids : other.ids;
+            const std::vector<int> &large = ids.size() <= other.ids.size() ? other.ids : ids;
+
+            std::vector<int> result;
+            result.reserve(small.size());
+
+            if (large.size() / small.size() >= GALLOP_RATIO)
+            {
+                // Heavily skewed: gallop through the large side, probing for
+                // each element of the small side
+                size_t pos = 0;
+                for (int id : small)
+                {
+                    pos = gallopLowerBound(large, pos, id);
+                    if (pos == large.size())
+                    {
+                        break;
+                    }
+                    if (large[pos] == id)
+                    {
+                        result.push_back(id);
+                        pos++;
+                    }
+                }
+            }
+            else
+            {
+                // Comparable sizes: single linear merge pass
+                std::set_intersection(small.begin(), small.end(),
+                                      large.begin(), large.end(),
+                                      std::back_inserter(result));
+            }
+
+            ids = std::move(result);
+        }
+
+        size_t ResultSet::size() const
+        {
+            return ids.size();
+        }
+
+        bool ResultSet::empty() const
+        {
+            return ids.empty();
+        }
+
+        const std::vector<int> &ResultSet::toVector() const
+        {
+            return ids;
+        }
+
+        std::vector<int> ResultSet::takeVector()
+        {
+            return std::move(ids);
+        }
+
+    } // namespace query
+} // namespace idioms
@@ -0,0 +1,99 @@
+#ifndef IDIOMS_RESULT_SET_HPP
+#define IDIOMS_RESULT_SET_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace idioms
+{
+    namespace query
+    {
+
+        /**
+         * Sorted-vector set of object IDs for combining per-condition results.
+         *
+         * Per-server and per-condition results arrive as sorted object ID
+         * vectors, so AND/OR combination can run as linear merges over
+         * contiguous memory instead of hash-set insert/erase loops. When the
+         * two sides of an intersection are heavily skewed (a selective
+         * condition against a broad one), a galloping search over the larger
+         * side skips most of it instead of scanning element by element.
+         */
+        class ResultSet
+        {
+        private:
+            std::vector<int> ids; // Sorted ascending, no duplicates
+
+            // Size ratio beyond which intersection switches from a linear
+            // merge to galloping search over the larger side
+            static const size_t GALLOP_RATIO = 16;
+
+        public:
+            ResultSet();
+
+            /**
+             * Construct from an already-sorted, duplicate-free vector
+             *
+             * @param sortedIds Sorted object IDs (moved in)
+             */
+            explicit ResultSet(std::vector<int> sortedIds);
+
+            /**
+             * Construct from an arbitrary vector, sorting and deduplicating
+             *
+             * @param unsortedIds Object IDs in any order
+             * @return ResultSet over the normalized IDs
+             */
+            static ResultSet fromUnsorted(std::vector<int> unsortedIds);
+
+            /**
+             * Union another result set into this one (linear merge)
+             *
+             * @param other Result set to merge in
+             */
+            void unionWith(const ResultSet &other);
+
+            /**
+             * Intersect this result set with another, in place
+             *
+             * Uses a linear merge for comparably-sized inputs and galloping
+             * (exponential) search over the larger side when the sizes are
+             * skewed by more than GALLOP_RATIO.
+             *
+             * @param other Result set to intersect with
+             */
+            void intersectWith(const ResultSet &other);
+
+            /**
+             * Get the number of object IDs in the set
+             *
+             * @return Cardinality
+             */
+            size_t size() const;
+
+            /**
+             * Check whether the set is empty
+             *
+             * @return True if empty
+             */
+            bool empty() const;
+
+            /**
+             * View the sorted object IDs
+             *
+             * @return Sorted object IDs
+             */
+            const std::vector<int> &toVector() const;
+
+            /**
+             * Move the sorted object IDs out of the set
+             *
+             * @return Sorted object IDs (the set is left empty)
+             */
+            std::vector<int> takeVector();
+        };
+
+    } // namespace query
+} // namespace idioms
+
+#endif // IDIOMS_RESULT_SET_HPP
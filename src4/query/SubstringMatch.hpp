@@ -0,0 +1,138 @@
+#ifndef IDIOMS_SUBSTRING_MATCH_HPP
+#define IDIOMS_SUBSTRING_MATCH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace idioms
+{
+    namespace query
+    {
+
+        /**
+         * Vectorized substring kernels for pattern matching
+         *
+         * Infix verification over candidate sets is a tight byte loop in
+         * the naive form; these kernels move through the haystack a
+         * vector register at a time instead. The filter is memmem-style:
+         * scan for positions where the needle's first AND last byte both
+         * land, and only memcmp the middle at those positions — for
+         * typical metadata values almost every position fails the filter
+         * without a verify.
+         *
+         * Builds with -mavx2 (or -march=native) take the explicit AVX2
+         * path, 32 candidate positions per iteration. The portable path
+         * leans on libc memchr/memcmp, which are themselves vectorized,
+         * so it still beats the byte loop without any arch flags.
+         */
+
+        // Whether str begins with prefix (memcmp, not a byte loop)
+        inline bool startsWith(std::string_view str, std::string_view prefix)
+        {
+            return str.size() >= prefix.size() &&
+                   std::memcmp(str.data(), prefix.data(), prefix.size()) == 0;
+        }
+
+        // Whether str ends with suffix (memcmp, not a byte loop)
+        inline bool endsWith(std::string_view str, std::string_view suffix)
+        {
+            return str.size() >= suffix.size() &&
+                   std::memcmp(str.data() + str.size() - suffix.size(),
+                               suffix.data(), suffix.size()) == 0;
+        }
+
+        /**
+         * Whether haystack contains needle
+         *
+         * @param haystack String to scan
+         * @param needle Substring to look for (empty always matches)
+         * @return true if needle occurs anywhere in haystack
+         */
+        inline bool containsSubstring(std::string_view haystack,
+                                      std::string_view needle)
+        {
+            if (needle.empty())
+            {
+                return true;
+            }
+            if (needle.size() > haystack.size())
+            {
+                return false;
+            }
+            if (needle.size() == 1)
+            {
+                return std::memchr(haystack.data(), needle.front(),
+                                   haystack.size()) != nullptr;
+            }
+
+            const char *hay = haystack.data();
+            const size_t lastIndex = needle.size() - 1;
+
+            // Candidate start positions: [0, limit]
+            const size_t limit = haystack.size() - needle.size();
+            size_t pos = 0;
+
+#if defined(__AVX2__)
+            // 32 candidate positions per iteration: one block read at the
+            // first-byte offset, one at the last-byte offset, and the AND
+            // of their equality masks marks positions worth verifying
+            const __m256i first = _mm256_set1_epi8(needle.front());
+            const __m256i last = _mm256_set1_epi8(needle.back());
+
+            for (; pos + 32 <= limit + 1; pos += 32)
+            {
+                __m256i blockFirst = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(hay + pos));
+                __m256i blockLast = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(hay + pos + lastIndex));
+
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst),
+                                     _mm256_cmpeq_epi8(last, blockLast))));
+
+                while (mask != 0)
+                {
+                    unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+                    if (std::memcmp(hay + pos + bit + 1, needle.data() + 1,
+                                    needle.size() - 2) == 0)
+                    {
+                        return true;
+                    }
+                    mask &= mask - 1; // Clear the tried position
+                }
+            }
+#endif
+
+            // Portable filter (and the AVX2 tail): memchr skips to the
+            // next first-byte hit, the last byte gates the verify
+            while (pos <= limit)
+            {
+                const void *hit = std::memchr(hay + pos, needle.front(),
+                                              limit - pos + 1);
+                if (hit == nullptr)
+                {
+                    return false;
+                }
+                pos = static_cast<size_t>(static_cast<const char *>(hit) - hay);
+
+                if (hay[pos + lastIndex] == needle.back() &&
+                    std::memcmp(hay + pos + 1, needle.data() + 1,
+                                needle.size() - 2) == 0)
+                {
+                    return true;
+                }
+                pos++;
+            }
+
+            return false;
+        }
+
+    } // namespace query
+} // namespace idioms
+
+#endif // IDIOMS_SUBSTRING_MATCH_HPP
@@ -0,0 +1,206 @@
+#include "MetadataStore.hpp"
+#include "../index/MemoryAccounting.hpp"
+
+namespace idioms
+{
+
+    MetadataStore::MetadataStore() : accountedBytes(0) {}
+
+    MetadataStore::~MetadataStore()
+    {
+        memoryAccounting().sub(MEM_OBJECT_METADATA, accountedBytes);
+    }
+
+    void MetadataStore::refreshAccounting() const
+    {
+        // The text pool, the span tables and the record arena dominate;
+        // the hash maps' bucket overhead is not charged
+        size_t current = text.capacity() +
+                         starts.capacity() * sizeof(uint32_t) +
+                         lengths.capacity() * sizeof(uint32_t) +
+                         arena.capacity() * sizeof(PairRef) +
+                         objects.size() * (sizeof(int) + sizeof(ObjectSlice));
+
+        if (current > accountedBytes)
+        {
+            memoryAccounting().add(MEM_OBJECT_METADATA, current - accountedBytes);
+        }
+        else if (current < accountedBytes)
+        {
+            memoryAccounting().sub(MEM_OBJECT_METADATA, accountedBytes - current);
+        }
+        accountedBytes = current;
+    }
+
+    bool MetadataStore::equalsString(uint32_t id, const std::string &str) const
+    {
+        return lengths[id] == str.length() &&
+               text.compare(starts[id], str.length(), str) == 0;
+    }
+
+    uint32_t MetadataStore::findInterned(const std::string &str) const
+    {
+        auto it = idsByHash.find(std::hash<std::string>{}(str));
+        if (it != idsByHash.end())
+        {
+            for (uint32_t id : it->second)
+            {
+                if (equalsString(id, str))
+                {
+                    return id;
+                }
+            }
+        }
+        return NO_ID;
+    }
+
+    uint32_t MetadataStore::intern(const std::string &str)
+    {
+        size_t hash = std::hash<std::string>{}(str);
+
+        auto it = idsByHash.find(hash);
+        if (it != idsByHash.end())
+        {
+            for (uint32_t id : it->second)
+            {
+                if (equalsString(id, str))
+                {
+                    return id; // Already interned
+                }
+            }
+        }
+
+        uint32_t id = static_cast<uint32_t>(starts.size());
+        idsByHash[hash].push_back(id);
+
+        starts.push_back(static_cast<uint32_t>(text.size()));
+        lengths.push_back(static_cast<uint32_t>(str.length()));
+        text += str;
+        return id;
+    }
+
+    void MetadataStore::extract(uint32_t id, std::string &out) const
+    {
+        out.assign(text, starts[id], lengths[id]);
+    }
+
+    void MetadataStore::add(int objectId, const std::string &key, const std::string &value)
+    {
+        PairRef ref = {intern(key), intern(value)};
+
+        ObjectSlice &slice = objects[objectId];
+        if (slice.count == slice.capacity)
+        {
+            // Relocate the slice to the arena's end with doubled capacity;
+            // the old entries' slots become a hole squeezed out by the next
+            // clear
+            uint32_t grown = slice.capacity == 0 ? 2 : slice.capacity * 2;
+            uint32_t offset = static_cast<uint32_t>(arena.size());
+
+            arena.resize(arena.size() + grown);
+            for (uint32_t i = 0; i < slice.count; i++)
+            {
+                arena[offset + i] = arena[slice.offset + i];
+            }
+
+            slice.offset = offset;
+            slice.capacity = grown;
+        }
+
+        arena[slice.offset + slice.count] = ref;
+        slice.count++;
+
+        refreshAccounting();
+    }
+
+    void MetadataStore::removePair(int objectId, const std::string &key, const std::string &value)
+    {
+        auto it = objects.find(objectId);
+        if (it == objects.end())
+        {
+            return;
+        }
+
+        // A pair can only match if both strings are already in the pool
+        uint32_t keyId = findInterned(key);
+        uint32_t valueId = findInterned(value);
+        if (keyId == NO_ID || valueId == NO_ID)
+        {
+            return;
+        }
+
+        ObjectSlice &slice = it->second;
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < slice.count; i++)
+        {
+            const PairRef &ref = arena[slice.offset + i];
+            if (ref.keyId == keyId && ref.valueId == valueId)
+            {
+                continue;
+            }
+            arena[slice.offset + kept] = ref;
+            kept++;
+        }
+        slice.count = kept;
+
+        // If no metadata left for this object, remove the entry
+        if (slice.count == 0)
+        {
+            objects.erase(it);
+        }
+
+        refreshAccounting();
+    }
+
+    size_t MetadataStore::objectCount() const
+    {
+        return objects.size();
+    }
+
+    void MetadataStore::clear()
+    {
+        std::string().swap(text);
+        std::vector<uint32_t>().swap(starts);
+        std::vector<uint32_t>().swap(lengths);
+        idsByHash.clear();
+        std::vector<PairRef>().swap(arena);
+        objects.clear();
+
+        refreshAccounting();
+    }
+
+    std::vector<std::pair<std::string, std::string>> MetadataStore::pairsOf(int objectId) const
+    {
+        std::vector<std::pair<std::string, std::string>> pairs;
+
+        auto it = objects.find(objectId);
+        if (it == objects.end())
+        {
+            return pairs;
+        }
+
+        pairs.reserve(it->second.count);
+        for (uint32_t i = 0; i < it->second.count; i++)
+        {
+            const PairRef &ref = arena[it->second.offset + i];
+            pairs.emplace_back(text.substr(starts[ref.keyId], lengths[ref.keyId]),
+                               text.substr(starts[ref.valueId], lengths[ref.valueId]));
+        }
+        return pairs;
+    }
+
+    std::unordered_map<int, std::vector<std::pair<std::string, std::string>>>
+    MetadataStore::exportAll() const
+    {
+        std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> exported;
+        exported.reserve(objects.size());
+
+        for (const auto &[objectId, slice] : objects)
+        {
+            (void)slice;
+            exported[objectId] = pairsOf(objectId);
+        }
+        return exported;
+    }
+
+} // namespace idioms
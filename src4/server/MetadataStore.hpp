@@ -0,0 +1,235 @@
+#ifndef IDIOMS_METADATA_STORE_HPP
+#define IDIOMS_METADATA_STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace idioms
+{
+
+    /**
+     * Compact reverse map from object ID to its (key, value) metadata pairs
+     *
+     * Every key and value string is interned once into a shared text pool,
+     * and each object's pairs are (key ID, value ID) entries in one
+     * contiguous record arena. Compared to a map of string-pair vectors,
+     * repeated keys like "run_id" cost four bytes per occurrence instead of
+     * a full string, and the per-object candidate probes the compound-query
+     * semi-join relies on walk a dense array instead of chasing per-object
+     * heap allocations.
+     *
+     * The store is not internally synchronized; callers guard it with the
+     * same mutex that covered the map it replaces.
+     */
+    class MetadataStore
+    {
+    private:
+        // Interned string pool: concatenated text referenced by
+        // (start, length), deduplicated by content hash. Candidate IDs are
+        // verified against the pool, so colliding hashes cost only an
+        // extra compare.
+        std::string text;
+        std::vector<uint32_t> starts;
+        std::vector<uint32_t> lengths;
+        std::unordered_map<size_t, std::vector<uint32_t>> idsByHash;
+
+        // One metadata pair as references into the pool
+        struct PairRef
+        {
+            uint32_t keyId;
+            uint32_t valueId;
+        };
+
+        // Record arena: each object's pairs sit back to back in one slice.
+        // A slice that outgrows its capacity relocates to the arena's end
+        // with doubled capacity; the hole it leaves is reclaimed when the
+        // next index rebuild clears the store.
+        std::vector<PairRef> arena;
+
+        struct ObjectSlice
+        {
+            uint32_t offset = 0;
+            uint32_t count = 0;
+            uint32_t capacity = 0;
+        };
+
+        std::unordered_map<int, ObjectSlice> objects;
+
+        // Bytes currently charged to MEM_OBJECT_METADATA for this store
+        mutable size_t accountedBytes;
+
+        // Re-charge the memory accounting after the pool or arena grow
+        void refreshAccounting() const;
+
+        // Intern a string, returning its pool ID (existing ID if present)
+        uint32_t intern(const std::string &str);
+
+        // Pool ID of an already interned string, or NO_ID
+        static const uint32_t NO_ID = UINT32_MAX;
+        uint32_t findInterned(const std::string &str) const;
+
+        // Whether the interned string with this ID equals str
+        bool equalsString(uint32_t id, const std::string &str) const;
+
+        // Materialize an interned string into out (reuses out's storage)
+        void extract(uint32_t id, std::string &out) const;
+
+    public:
+        MetadataStore();
+        ~MetadataStore();
+
+        /**
+         * Record one metadata pair for an object
+         *
+         * @param objectId Object the pair belongs to
+         * @param key Metadata attribute key
+         * @param value Metadata attribute value
+         */
+        void add(int objectId, const std::string &key, const std::string &value);
+
+        /**
+         * Remove every copy of one metadata pair from an object
+         *
+         * An object with no pairs left is dropped entirely.
+         *
+         * @param objectId Object the pair belongs to
+         * @param key Metadata attribute key
+         * @param value Metadata attribute value
+         */
+        void removePair(int objectId, const std::string &key, const std::string &value);
+
+        /**
+         * Get the number of objects with at least one pair
+         *
+         * @return Object count
+         */
+        size_t objectCount() const;
+
+        /**
+         * Drop everything and release the pool and arena storage
+         */
+        void clear();
+
+        /**
+         * Copy one object's pairs out as plain strings
+         *
+         * @param objectId Object to copy
+         * @return The object's (key, value) pairs; empty if unknown
+         */
+        std::vector<std::pair<std::string, std::string>> pairsOf(int objectId) const;
+
+        /**
+         * Copy the whole store out in the legacy map-of-vectors shape
+         *
+         * Used by the checkpoint paths, which freeze a copy under the lock
+         * and serialize it off the write path.
+         *
+         * @return Map from object ID to its (key, value) pairs
+         */
+        std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> exportAll() const;
+
+        /**
+         * Visit every stored pair
+         *
+         * The strings passed to fn are scratch buffers reused between
+         * calls; copy them if they must outlive the visit.
+         *
+         * @param fn Callback taking (objectId, key, value)
+         */
+        template <typename Fn>
+        void forEachPair(Fn &&fn) const
+        {
+            std::string key, value;
+            for (const auto &[objectId, slice] : objects)
+            {
+                for (uint32_t i = 0; i < slice.count; i++)
+                {
+                    const PairRef &ref = arena[slice.offset + i];
+                    extract(ref.keyId, key);
+                    extract(ref.valueId, value);
+                    fn(objectId, key, value);
+                }
+            }
+        }
+
+        /**
+         * Visit one object's pairs
+         *
+         * Same scratch-buffer contract as forEachPair.
+         *
+         * @param objectId Object to visit
+         * @param fn Callback taking (key, value)
+         */
+        template <typename Fn>
+        void forEachPairOf(int objectId, Fn &&fn) const
+        {
+            auto it = objects.find(objectId);
+            if (it == objects.end())
+            {
+                return;
+            }
+
+            std::string key, value;
+            for (uint32_t i = 0; i < it->second.count; i++)
+            {
+                const PairRef &ref = arena[it->second.offset + i];
+                extract(ref.keyId, key);
+                extract(ref.valueId, value);
+                fn(key, value);
+            }
+        }
+
+        /**
+         * Visit every object ID with at least one pair
+         *
+         * @param fn Callback taking the object ID
+         */
+        template <typename Fn>
+        void forEachObject(Fn &&fn) const
+        {
+            for (const auto &[objectId, slice] : objects)
+            {
+                (void)slice;
+                fn(objectId);
+            }
+        }
+
+        /**
+         * Whether any of an object's pairs satisfies a predicate
+         *
+         * This is the hot probe of the semi-join pushdown: one dense scan
+         * over the object's slice, stopping at the first match.
+         *
+         * @param objectId Object to probe
+         * @param pred Predicate taking (key, value)
+         * @return True if some pair satisfies pred
+         */
+        template <typename Pred>
+        bool anyPairOf(int objectId, Pred &&pred) const
+        {
+            auto it = objects.find(objectId);
+            if (it == objects.end())
+            {
+                return false;
+            }
+
+            std::string key, value;
+            for (uint32_t i = 0; i < it->second.count; i++)
+            {
+                const PairRef &ref = arena[it->second.offset + i];
+                extract(ref.keyId, key);
+                extract(ref.valueId, value);
+                if (pred(key, value))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+} // namespace idioms
+
+#endif // IDIOMS_METADATA_STORE_HPP
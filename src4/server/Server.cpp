@@ -1,16 +1,75 @@
 #include "Server.hpp"
+#include "../index/MemoryAccounting.hpp"
+#include "../numa/NumaPolicy.hpp"
+#include "../index/OrderedEncoding.hpp"
+#include "../query/MultiConditionQuery.hpp"
+#include "../query/QueryGovernor.hpp"
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+    // Binary checkpoint helpers: fixed-width fields appended to an
+    // in-memory image that is written (and read back) in a single call
+
+    template <typename T>
+    void appendScalar(std::string &buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readScalar(const std::string &buffer, size_t &offset, T &value)
+    {
+        if (offset + sizeof(T) > buffer.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    void appendString(std::string &buffer, const std::string &s)
+    {
+        appendScalar(buffer, static_cast<uint32_t>(s.length()));
+        buffer.append(s);
+    }
+
+    bool readString(const std::string &buffer, size_t &offset, std::string &s)
+    {
+        uint32_t length;
+        if (!readScalar(buffer, offset, length) || offset + length > buffer.size())
+        {
+            return false;
+        }
+        s.assign(buffer.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+} // namespace
 
 namespace idioms
 {
 
     DistributedIdiomsServer::DistributedIdiomsServer(int id, const std::string &dataDirectory,
-                                                     std::shared_ptr<DARTRouter> dartRouter, bool useSuffixMode)
+                                                     std::shared_ptr<DARTRouter> dartRouter, bool useSuffixMode,
+                                                     bool usePathCompressedMode)
         : serverId(id), dataDir(dataDirectory), router(dartRouter),
-          useSuffixTreeMode(useSuffixMode)
+          useSuffixTreeMode(useSuffixMode), usePathCompression(usePathCompressedMode)
     {
 
         // Create data directory if it doesn't exist
@@ -18,327 +77,3923 @@ namespace idioms
         std::string cmd = "mkdir -p " + serverDir;
         system(cmd.c_str());
 
-        // Initialize the trie-based index
-        keyTrie = std::make_unique<KeyTrie>(useSuffixTreeMode);
-    }
+        // Index shards are created lazily, one per virtual node, as records
+        // for that virtual node arrive
 
-    void DistributedIdiomsServer::addIndexedKey(const std::string &key, const std::string &value, int objectId)
-    {
-        std::lock_guard<std::mutex> lock(indexMutex);
+        // Open the write-ahead log for appending; an existing log is kept
+        // so recoverIndex can replay what a crash left behind
+        walFile.open(walPath(), std::ios::binary | std::ios::app);
 
-        // Add to the trie index
-        std::shared_ptr<ValueTrie> valueTrie;
+        // Zero the statistics counters explicitly; atomics in arrays do
+        // not zero-initialize on their own
+        for (int shape = 0; shape < SHAPE_COUNT; shape++)
+        {
+            statQueryCount[shape].store(0);
+            statQueryLatencyNs[shape].store(0);
+        }
+    }
 
-        if (useSuffixTreeMode)
+    DistributedIdiomsServer::~DistributedIdiomsServer()
+    {
+        if (compactionThread.joinable())
         {
-            valueTrie = keyTrie->insertKeyWithSuffixMode(key);
-            valueTrie->insertValueWithSuffixMode(value, objectId);
+            compactionThread.join();
         }
-        else
+        if (checkpointThread.joinable())
         {
-            valueTrie = keyTrie->insertKeyOnly(key);
-            valueTrie->insertValue(value, objectId);
+            checkpointThread.join();
+        }
+        if (spillThread.joinable())
+        {
+            spillThread.join();
         }
 
-        // Store in the object metadata map for easier lookup
-        objectMetadata[objectId].push_back({key, value});
+        if (imageData != nullptr)
+        {
+            ::munmap(const_cast<char *>(imageData), imageSize);
+        }
+
+        std::lock_guard<std::mutex> lock(walMutex);
+        flushWalLocked();
     }
 
-    void DistributedIdiomsServer::removeIndexedKey(const std::string &key, const std::string &value, int objectId)
+    std::string DistributedIdiomsServer::walPath() const
     {
-        std::lock_guard<std::mutex> lock(indexMutex);
+        return dataDir + "/server_" + std::to_string(serverId) + "/wal.log";
+    }
 
-        // In a production system, we would:
-        // 1. Look up the key in the trie
-        // 2. Find the value in the second layer trie
-        // 3. Remove the objectId from the set of objects
-        // 4. If the object set becomes empty and there are no child nodes, remove the node
+    std::string DistributedIdiomsServer::checkpointManifestPath() const
+    {
+        return dataDir + "/server_" + std::to_string(serverId) + "/checkpoint.manifest";
+    }
 
-        // For this implementation, we'll just remove from the objectMetadata map
-        auto it = objectMetadata.find(objectId);
-        if (it != objectMetadata.end())
-        {
-            auto &metadataList = it->second;
-            metadataList.erase(
-                std::remove_if(metadataList.begin(), metadataList.end(),
-                               [&](const auto &pair)
-                               {
-                                   return pair.first == key && pair.second == value;
-                               }),
-                metadataList.end());
+    std::string DistributedIdiomsServer::pendingManifestPath() const
+    {
+        return dataDir + "/server_" + std::to_string(serverId) + "/checkpoint.manifest.pending";
+    }
 
-            // If no metadata left for this object, remove the entry
-            if (metadataList.empty())
-            {
-                objectMetadata.erase(it);
-            }
+    void DistributedIdiomsServer::appendToWal(uint8_t op, const std::string &key,
+                                              const std::string &value, int objectId)
+    {
+        std::lock_guard<std::mutex> lock(walMutex);
+
+        // Replay must not log the records it is re-applying
+        if (walReplaying || !walFile.is_open())
+        {
+            return;
         }
 
-        std::cout << "Deleted metadata '" << key << "=" << value
-                  << "' for object " << objectId << " on server " << serverId << std::endl;
-    }
+        appendScalar(walBuffer, op);
+        appendString(walBuffer, key);
+        appendString(walBuffer, value);
+        appendScalar(walBuffer, static_cast<int32_t>(objectId));
 
-    bool DistributedIdiomsServer::hasKey(const std::string &key) const
-    {
-        // Check if the key exists in the trie
-        return keyTrie->searchExactKey(key) != nullptr;
+        // Group commit: one sequential write and flush per batch
+        walBufferedRecords++;
+        if (walBufferedRecords >= WAL_GROUP_SIZE)
+        {
+            flushWalLocked();
+        }
     }
 
-    bool DistributedIdiomsServer::hasSuffix(const std::string &suffix) const
+    void DistributedIdiomsServer::flushWalLocked()
     {
-        // In suffix-tree mode, we can check if a suffix is indexed
-        if (!useSuffixTreeMode)
+        if (walBuffer.empty() || !walFile.is_open())
         {
-            return false;
+            return;
         }
 
-        auto valueTries = keyTrie->searchKeySuffix(suffix);
-        return !valueTries.empty();
+        walFile.write(walBuffer.data(), walBuffer.length());
+        walFile.flush();
+        walBuffer.clear();
+        walBufferedRecords = 0;
     }
 
-    bool DistributedIdiomsServer::canHandleQuery(const std::string &query) const
+    void DistributedIdiomsServer::replayWal()
     {
-        // Parse the query string
-        std::string keyPart;
-        size_t pos = query.find('=');
-        if (pos != std::string::npos)
+        std::string buffer;
         {
-            keyPart = query.substr(0, pos);
+            std::lock_guard<std::mutex> lock(walMutex);
+
+            std::ifstream in(walPath(), std::ios::binary);
+            if (!in.is_open())
+            {
+                return;
+            }
+            std::ostringstream contents;
+            contents << in.rdbuf();
+            buffer = contents.str();
+
+            walReplaying = true;
         }
-        else
+
+        size_t offset = 0;
+        size_t replayed = 0;
+        while (offset < buffer.length())
         {
-            keyPart = query;
+            uint8_t op;
+            std::string key, value;
+            int32_t objectId;
+            if (!readScalar(buffer, offset, op) ||
+                !readString(buffer, offset, key) ||
+                !readString(buffer, offset, value) ||
+                !readScalar(buffer, offset, objectId))
+            {
+                // Torn tail from a crash mid-append: stop at the last
+                // complete record
+                break;
+            }
+
+            if (op == 1)
+            {
+                addIndexedKey(key, value, objectId);
+            }
+            else if (op == 2)
+            {
+                removeIndexedKey(key, value, objectId);
+            }
+            else
+            {
+                break;
+            }
+            replayed++;
         }
 
-        // Check if this server can handle the query based on the key part
-        if (keyPart == "*")
         {
-            // Wildcard queries can be handled by any server
-            return true;
+            std::lock_guard<std::mutex> lock(walMutex);
+            walReplaying = false;
         }
-        else if (keyPart.front() == '*' && keyPart.back() == '*' && keyPart.length() > 2)
+
+        if (replayed > 0)
         {
-            // Infix query
-            std::string infix = keyPart.substr(1, keyPart.length() - 2);
-            auto valueTries = keyTrie->searchKeyInfix(infix);
-            return !valueTries.empty();
+            std::cout << "Replayed " << replayed << " WAL records on server "
+                      << serverId << std::endl;
         }
-        else if (keyPart.front() == '*')
+    }
+
+    DistributedIdiomsServer::IndexShard &DistributedIdiomsServer::getShard(uint32_t virtualNodeId)
+    {
+        IndexShard *existing = nullptr;
         {
-            // Suffix query
-            std::string suffix = keyPart.substr(1);
-            return hasSuffix(suffix);
+            std::shared_lock<std::shared_mutex> lock(shardsMutex);
+            auto it = shards.find(virtualNodeId);
+            if (it != shards.end())
+            {
+                existing = it->second.get();
+            }
         }
-        else if (keyPart.back() == '*')
+        if (existing != nullptr)
         {
-            // Prefix query
-            std::string prefix = keyPart.substr(0, keyPart.length() - 1);
-            auto valueTries = keyTrie->searchKeyPrefix(prefix);
-            return !valueTries.empty();
+            // A write to a spilled shard faults it in first, so the
+            // segment on disk never shadows newer trie contents
+            ensureShardResident(*existing);
+            return *existing;
         }
-        else
+
+        std::unique_lock<std::shared_mutex> lock(shardsMutex);
+        auto &slot = shards[virtualNodeId];
+        if (!slot)
         {
-            // Exact query
-            return hasKey(keyPart);
+            slot = std::make_shared<IndexShard>();
+            slot->keyTrie = std::make_unique<KeyTrie>(useSuffixTreeMode, usePathCompression);
+            slot->virtualNodeId = virtualNodeId;
+            slot->lastAccessMs.store(steadyNowMs(), std::memory_order_relaxed);
         }
+        return *slot;
     }
 
-    std::vector<int> DistributedIdiomsServer::executeQuery(const std::string &query) const
+    std::shared_ptr<const DistributedIdiomsServer::IndexShard>
+    DistributedIdiomsServer::findShard(uint32_t virtualNodeId) const
     {
-        // Parse the query
-        std::string keyPart, valuePart;
-        size_t pos = query.find('=');
-        if (pos != std::string::npos)
+        std::shared_lock<std::shared_mutex> lock(shardsMutex);
+        auto it = shards.find(virtualNodeId);
+        return it != shards.end() ? it->second : nullptr;
+    }
+
+    std::vector<std::shared_ptr<const DistributedIdiomsServer::IndexShard>>
+    DistributedIdiomsServer::getAllShards() const
+    {
+        std::shared_lock<std::shared_mutex> lock(shardsMutex);
+
+        std::vector<std::shared_ptr<const IndexShard>> result;
+        result.reserve(shards.size());
+        for (const auto &[virtualNodeId, shard] : shards)
         {
-            keyPart = query.substr(0, pos);
-            valuePart = query.substr(pos + 1);
+            result.push_back(shard);
         }
-        else
+        return result;
+    }
+
+    std::shared_ptr<const DistributedIdiomsServer::IndexSnapshot> DistributedIdiomsServer::currentSnapshot() const
+    {
+        return std::atomic_load(&snapshot);
+    }
+
+    uint64_t DistributedIdiomsServer::steadyNowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    std::string DistributedIdiomsServer::segmentPath(uint32_t virtualNodeId) const
+    {
+        return dataDir + "/server_" + std::to_string(serverId) + "/cold_vnode_" +
+               std::to_string(virtualNodeId) + ".seg";
+    }
+
+    void DistributedIdiomsServer::ensureShardResident(const IndexShard &shard) const
+    {
+        shard.lastAccessMs.store(steadyNowMs(), std::memory_order_relaxed);
+
         {
-            keyPart = query;
-            valuePart = "*";
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            if (!shard.spilled)
+            {
+                return;
+            }
         }
 
-        // Get value tries based on key condition
-        std::vector<std::shared_ptr<ValueTrie>> valueTries;
-        std::unordered_set<int> resultSet;
+        faultInShard(shard);
+    }
 
-        // Determine key query type
-        if (keyPart == "*")
+    void DistributedIdiomsServer::faultInShard(const IndexShard &shard) const
+    {
+        // The rebuilt trie should land on our node like any other block
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (!shard.spilled)
         {
-            // Wildcard key
-            valueTries = keyTrie->getAllValueTries();
+            return; // Another access won the fault-in race
         }
-        else if (keyPart.front() == '*' && keyPart.back() == '*' && keyPart.length() > 2)
+
+        // Map the segment and parse its records in place; only the pages
+        // actually touched are read, and nothing is double-buffered
+        std::vector<IndexRecord> records;
+        bool loaded = false;
+
+        std::string path = segmentPath(shard.virtualNodeId);
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                size_t size = static_cast<size_t>(st.st_size);
+                void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    const char *base = static_cast<const char *>(mapped);
+                    size_t offset = 0;
+
+                    auto readBytes = [&](void *out, size_t n)
+                    {
+                        if (offset + n > size)
+                        {
+                            return false;
+                        }
+                        std::memcpy(out, base + offset, n);
+                        offset += n;
+                        return true;
+                    };
+                    auto readSegString = [&](std::string &s)
+                    {
+                        uint32_t length;
+                        if (!readBytes(&length, sizeof(length)) || offset + length > size)
+                        {
+                            return false;
+                        }
+                        s.assign(base + offset, length);
+                        offset += length;
+                        return true;
+                    };
+
+                    uint32_t count = 0;
+                    loaded = readBytes(&count, sizeof(count));
+                    records.reserve(count);
+                    for (uint32_t r = 0; loaded && r < count; r++)
+                    {
+                        IndexRecord record;
+                        int32_t objectId;
+                        loaded = readSegString(record.key) &&
+                                 readSegString(record.value) &&
+                                 readBytes(&objectId, sizeof(objectId));
+                        if (loaded)
+                        {
+                            record.objectId = objectId;
+                            records.push_back(std::move(record));
+                        }
+                    }
+
+                    ::munmap(mapped, size);
+                }
+            }
+            ::close(fd);
+        }
+
+        if (!loaded)
         {
-            // Infix key
-            std::string infix = keyPart.substr(1, keyPart.length() - 2);
-            valueTries = keyTrie->searchKeyInfix(infix);
+            // A missing or truncated segment is not fatal: the metadata map
+            // still has every live record, it just costs a full scan
+            std::cerr << "Segment for vnode " << shard.virtualNodeId << " on server "
+                      << serverId << " unreadable; rebuilding from metadata" << std::endl;
+
+            records.clear();
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    if (router->getVirtualNodeId(key) == shard.virtualNodeId)
+                    {
+                        records.emplace_back(key, value, objectId);
+                    }
+                });
         }
-        else if (keyPart.front() == '*')
+
+        // Rebuild the trie through the run-insert path, like a bulk load
+        std::sort(records.begin(), records.end(),
+                  [](const IndexRecord &a, const IndexRecord &b)
+                  {
+                      if (a.key != b.key)
+                      {
+                          return a.key < b.key;
+                      }
+                      if (a.value != b.value)
+                      {
+                          return a.value < b.value;
+                      }
+                      return a.objectId < b.objectId;
+                  });
+
+        auto fresh = std::make_unique<KeyTrie>(useSuffixTreeMode, usePathCompression);
+        size_t i = 0;
+        while (i < records.size())
         {
-            // Suffix key
-            std::string suffix = keyPart.substr(1);
-            valueTries = keyTrie->searchKeySuffix(suffix);
+            i = insertKeyRun(*fresh, records, i);
         }
-        else if (keyPart.back() == '*')
+
+        shard.keyTrie = std::move(fresh);
+        shard.spilled = false;
+        lock.unlock();
+
+        ::unlink(path.c_str());
+
+        std::cout << "Faulted " << records.size() << " records for vnode "
+                  << shard.virtualNodeId << " back in on server " << serverId << std::endl;
+    }
+
+    bool DistributedIdiomsServer::spillShard(uint32_t virtualNodeId)
+    {
+        // Metadata is the source of truth, exactly as compaction and vnode
+        // export read it; the exclusive compaction lock held by the caller
+        // means no write can slip between this copy and the trie swap below
+        std::vector<IndexRecord> records;
         {
-            // Prefix key
-            std::string prefix = keyPart.substr(0, keyPart.length() - 1);
-            valueTries = keyTrie->searchKeyPrefix(prefix);
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    if (router->getVirtualNodeId(key) == virtualNodeId)
+                    {
+                        records.emplace_back(key, value, objectId);
+                    }
+                });
         }
-        else
+
+        std::string image;
+        appendScalar(image, static_cast<uint32_t>(records.size()));
+        for (const auto &record : records)
         {
-            // Exact key
-            auto valueTrie = keyTrie->searchExactKey(keyPart);
-            if (valueTrie)
+            appendString(image, record.key);
+            appendString(image, record.value);
+            appendScalar(image, static_cast<int32_t>(record.objectId));
+        }
+
+        // The trie only drops once the segment is safely on disk
+        std::string path = segmentPath(virtualNodeId);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+            {
+                std::cerr << "Failed to write segment " << path << std::endl;
+                return false;
+            }
+            out.write(image.data(), image.size());
+            if (!out.good())
             {
-                valueTries.push_back(valueTrie);
+                std::cerr << "Failed to write segment " << path << std::endl;
+                return false;
             }
         }
 
-        // Determine value query type
-        for (const auto &valueTrie : valueTries)
+        IndexShard *shard = nullptr;
         {
-            if (valuePart == "*")
+            std::shared_lock<std::shared_mutex> lock(shardsMutex);
+            auto it = shards.find(virtualNodeId);
+            if (it != shards.end())
             {
-                // Wildcard value
-                auto objectIds = valueTrie->getAllObjectIds();
-                resultSet.insert(objectIds.begin(), objectIds.end());
+                shard = it->second.get();
             }
-            else if (valuePart.front() == '*' && valuePart.back() == '*' && valuePart.length() > 2)
+        }
+        if (shard == nullptr)
+        {
+            return false;
+        }
+
+        {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            shard->keyTrie = std::make_unique<KeyTrie>(useSuffixTreeMode, usePathCompression);
+            shard->spilled = true;
+        }
+
+        std::cout << "Spilled vnode " << virtualNodeId << " on server " << serverId
+                  << " (" << records.size() << " records, " << image.size()
+                  << " bytes)" << std::endl;
+        return true;
+    }
+
+    size_t DistributedIdiomsServer::spillPass()
+    {
+        uint64_t budget = ramBudgetBytes.load();
+        if (budget == 0)
+        {
+            return 0;
+        }
+
+        // Exclude writers, as compaction does, so the metadata copies and
+        // the trie swaps see the same index
+        std::unique_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // A shard covered by the published snapshot only holds a delta;
+        // dropping it would not release the snapshot's copy, so skip those
+        auto snap = currentSnapshot();
+
+        // Coldest-first victim list over the resident shards
+        std::vector<std::pair<uint64_t, uint32_t>> victims;
+        {
+            std::shared_lock<std::shared_mutex> lock(shardsMutex);
+            for (const auto &[virtualNodeId, shard] : shards)
             {
-                // Infix value
-                std::string infix = valuePart.substr(1, valuePart.length() - 2);
-                auto objectIds = valueTrie->searchValueInfix(infix);
-                resultSet.insert(objectIds.begin(), objectIds.end());
+                std::shared_lock<std::shared_mutex> shardLock(shard->mutex);
+                if (shard->spilled)
+                {
+                    continue;
+                }
+                if (snap != nullptr && snap->shards.count(virtualNodeId) > 0)
+                {
+                    continue;
+                }
+                victims.push_back({shard->lastAccessMs.load(std::memory_order_relaxed),
+                                   virtualNodeId});
             }
-            else if (valuePart.front() == '*')
+        }
+        std::sort(victims.begin(), victims.end());
+
+        size_t spilled = 0;
+        for (const auto &victim : victims)
+        {
+            if (memoryAccounting().bytes(MEM_TRIE_ARENA) <= budget)
             {
-                // Suffix value
-                std::string suffix = valuePart.substr(1);
-                auto objectIds = valueTrie->searchValueSuffix(suffix);
-                resultSet.insert(objectIds.begin(), objectIds.end());
+                break;
             }
-            else if (valuePart.back() == '*')
+            if (spillShard(victim.second))
             {
-                // Prefix value
-                std::string prefix = valuePart.substr(0, valuePart.length() - 1);
-                auto objectIds = valueTrie->searchValuePrefix(prefix);
-                resultSet.insert(objectIds.begin(), objectIds.end());
+                spilled++;
             }
-            else
+        }
+        return spilled;
+    }
+
+    void DistributedIdiomsServer::maybeStartSpill()
+    {
+        uint64_t budget = ramBudgetBytes.load();
+        if (budget == 0 || memoryAccounting().bytes(MEM_TRIE_ARENA) <= budget)
+        {
+            return;
+        }
+
+        if (spillRunning.exchange(true))
+        {
+            return; // A pass is already in flight
+        }
+
+        if (spillThread.joinable())
+        {
+            spillThread.join();
+        }
+        spillThread = std::thread([this]
+                                  {
+                                      spillPass();
+                                      spillRunning.store(false);
+                                  });
+    }
+
+    void DistributedIdiomsServer::dropColdSegments()
+    {
+        std::shared_lock<std::shared_mutex> lock(shardsMutex);
+        for (const auto &[virtualNodeId, shard] : shards)
+        {
+            std::shared_lock<std::shared_mutex> shardLock(shard->mutex);
+            if (shard->spilled)
             {
-                // Exact value
-                auto objectIds = valueTrie->searchExactValue(valuePart);
-                resultSet.insert(objectIds.begin(), objectIds.end());
+                ::unlink(segmentPath(virtualNodeId).c_str());
             }
         }
+    }
 
-        // Convert set to vector
-        std::vector<int> results(resultSet.begin(), resultSet.end());
-        std::sort(results.begin(), results.end());
+    void DistributedIdiomsServer::setRamBudget(size_t bytes)
+    {
+        ramBudgetBytes.store(bytes);
+    }
 
-        return results;
+    size_t DistributedIdiomsServer::spillColdShards()
+    {
+        if (spillRunning.exchange(true))
+        {
+            return 0; // The background pass is already spilling
+        }
+        if (spillThread.joinable())
+        {
+            spillThread.join();
+        }
+
+        size_t spilled = spillPass();
+        spillRunning.store(false);
+        return spilled;
     }
 
-    bool DistributedIdiomsServer::checkpointIndex()
+    size_t DistributedIdiomsServer::insertKeyRun(KeyTrie &keyTrie, const std::vector<IndexRecord> &records,
+                                                 size_t i) const
     {
-        std::lock_guard<std::mutex> lock(indexMutex);
+        const std::string key = records[i].key;
 
-        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
-        std::ofstream file(indexFile, std::ios::binary);
-        if (!file.is_open())
+        // One root-to-leaf descent per distinct key
+        std::shared_ptr<ValueTrie> valueTrie;
+        if (useSuffixTreeMode)
         {
-            return false;
+            valueTrie = keyTrie.insertKeyWithSuffixMode(key);
+        }
+        else
+        {
+            valueTrie = keyTrie.insertKeyOnly(key);
         }
 
-        // Write format version
-        file << "IDIOMS_INDEX_V1" << std::endl;
+        while (i < records.size() && records[i].key == key)
+        {
+            const std::string value = records[i].value;
 
-        // Write server configuration
-        file << serverId << " " << (useSuffixTreeMode ? 1 : 0) << std::endl;
+            // Gather all object IDs sharing this (key, value) pair
+            std::vector<int> objectIds;
+            while (i < records.size() && records[i].key == key &&
+                   records[i].value == value)
+            {
+                objectIds.push_back(records[i].objectId);
+                i++;
+            }
 
-        // Write object metadata
-        file << objectMetadata.size() << std::endl;
-        for (const auto &[objectId, metadata] : objectMetadata)
-        {
-            file << objectId << " " << metadata.size() << std::endl;
-            for (const auto &[key, value] : metadata)
+            // One value-trie descent per distinct value
+            if (useSuffixTreeMode)
+            {
+                valueTrie->insertValueWithSuffixMode(value, objectIds);
+            }
+            else
             {
-                file << key << std::endl;
-                file << value << std::endl;
+                valueTrie->insertValue(value, objectIds);
+            }
+
+            // Order-preserving encoded copy for range conditions
+            if (query::isNumeric(value))
+            {
+                valueTrie->insertValue(ENCODED_VALUE_PREFIX +
+                                           encodeOrderedDouble(query::parseNumeric(value)),
+                                       objectIds);
             }
         }
 
-        file.close();
-        return true;
+        return i;
     }
 
-    bool DistributedIdiomsServer::recoverIndex()
+    void DistributedIdiomsServer::addToShardLocked(IndexShard &shard, const std::string &key,
+                                                   const std::string &value, int objectId)
     {
-        std::lock_guard<std::mutex> lock(indexMutex);
+        std::shared_ptr<ValueTrie> valueTrie;
 
-        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
-        std::ifstream file(indexFile, std::ios::binary);
-        if (!file.is_open())
+        if (useSuffixTreeMode)
         {
-            return false;
+            valueTrie = shard.keyTrie->insertKeyWithSuffixMode(key);
+            valueTrie->insertValueWithSuffixMode(value, objectId);
         }
-
-        // Read format version
-        std::string version;
-        std::getline(file, version);
-        if (version != "IDIOMS_INDEX_V1")
+        else
         {
-            return false;
+            valueTrie = shard.keyTrie->insertKeyOnly(key);
+            valueTrie->insertValue(value, objectId);
         }
 
-        // Read server configuration
-        int storedServerId;
-        int storedSuffixMode;
-        file >> storedServerId >> storedSuffixMode;
-
-        if (storedServerId != serverId)
+        // Numeric values are additionally stored under an order-preserving
+        // encoding so range conditions become bounded trie walks. The
+        // sentinel prefix keeps encoded entries out of ordinary value queries.
+        if (query::isNumeric(value))
         {
-            std::cerr << "Warning: Stored server ID (" << storedServerId
-                      << ") doesn't match current server ID (" << serverId
-                      << ")." << std::endl;
-            return false;
+            valueTrie->insertValue(ENCODED_VALUE_PREFIX +
+                                       encodeOrderedDouble(query::parseNumeric(value)),
+                                   objectId);
         }
+    }
 
-        // Clear existing data
-        objectMetadata.clear();
-        keyTrie = std::make_unique<KeyTrie>(useSuffixTreeMode);
+    void DistributedIdiomsServer::recordKeyInFilters(const std::string &key)
+    {
+        std::unique_lock<std::shared_mutex> lock(filterMutex);
 
-        // Read object metadata
-        int objectCount;
-        file >> objectCount;
+        keyFilter.add(key);
 
-        for (int i = 0; i < objectCount; i++)
+        if (useSuffixTreeMode)
         {
-            int objectId, metadataCount;
-            file >> objectId >> metadataCount;
-            file.ignore(); // Skip newline
-
-            for (int j = 0; j < metadataCount; j++)
+            // Every suffix of the key (including the key itself) can satisfy
+            // a "*suffix" condition; slices of the key, no substring copies
+            std::string_view keyView(key);
+            for (size_t i = 0; i < keyView.length(); i++)
             {
-                std::string key, value;
-                std::getline(file, key);
-                std::getline(file, value);
-
-                // Recreate the index
-                addIndexedKey(key, value, objectId);
+                keySuffixFilter.add(keyView.substr(i));
             }
         }
 
-        file.close();
-        return true;
+        filterVersion.fetch_add(1);
     }
 
-    int DistributedIdiomsServer::getId() const
+    bool DistributedIdiomsServer::lookupQueryCache(const std::string &query, uint64_t version,
+                                                   std::vector<int> &results) const
     {
-        return serverId;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+
+        auto it = queryCache.find(query);
+        if (it == queryCache.end() || it->second.version != version)
+        {
+            // Missing or computed against an older index version
+            cacheMisses.fetch_add(1);
+            return false;
+        }
+
+        // Move to the front of the recency list
+        queryCacheLru.splice(queryCacheLru.begin(), queryCacheLru, it->second.lruPosition);
+
+        cacheHits.fetch_add(1);
+        results = it->second.results;
+        return true;
+    }
+
+    void DistributedIdiomsServer::storeQueryCache(const std::string &query, uint64_t version,
+                                                  const std::vector<int> &results) const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+
+        auto it = queryCache.find(query);
+        if (it != queryCache.end())
+        {
+            // Refresh the stale entry in place
+            it->second.version = version;
+            it->second.results = results;
+            queryCacheLru.splice(queryCacheLru.begin(), queryCacheLru, it->second.lruPosition);
+            return;
+        }
+
+        // Evict the least recently used entry if the cache is full
+        if (queryCache.size() >= QUERY_CACHE_CAPACITY)
+        {
+            queryCache.erase(queryCacheLru.back());
+            queryCacheLru.pop_back();
+        }
+
+        queryCacheLru.push_front(query);
+        queryCache[query] = {version, results, queryCacheLru.begin()};
+    }
+
+    void DistributedIdiomsServer::recordKeyStatsInsert(const std::string &key, const std::string &value)
+    {
+        std::lock_guard<std::mutex> lock(keyStatsMutex);
+        KeyStatsEntry &entry = keyStatsStore[key];
+        entry.records++;
+        entry.valueRefs[value]++;
+
+        // Reservoir sampling (algorithm R): every inserted value ends up
+        // in the sample with equal probability
+        entry.sampleSeen++;
+        if (entry.sampleValues.size() < KEY_STATS_SAMPLE_SIZE)
+        {
+            entry.sampleValues.push_back(value);
+        }
+        else
+        {
+            std::uniform_int_distribution<uint64_t> slot(0, entry.sampleSeen - 1);
+            uint64_t chosen = slot(keyStatsRng);
+            if (chosen < KEY_STATS_SAMPLE_SIZE)
+            {
+                entry.sampleValues[chosen] = value;
+            }
+        }
+    }
+
+    void DistributedIdiomsServer::recordKeyStatsDelete(const std::string &key, const std::string &value)
+    {
+        std::lock_guard<std::mutex> lock(keyStatsMutex);
+        auto it = keyStatsStore.find(key);
+        if (it == keyStatsStore.end())
+        {
+            return;
+        }
+
+        KeyStatsEntry &entry = it->second;
+        if (entry.records > 0)
+        {
+            entry.records--;
+        }
+
+        auto refIt = entry.valueRefs.find(value);
+        if (refIt != entry.valueRefs.end() && --refIt->second == 0)
+        {
+            entry.valueRefs.erase(refIt);
+        }
+    }
+
+    KeyStatistics DistributedIdiomsServer::getKeyStatistics(const std::string &key) const
+    {
+        KeyStatistics stats;
+
+        std::lock_guard<std::mutex> lock(keyStatsMutex);
+        auto it = keyStatsStore.find(key);
+        if (it != keyStatsStore.end())
+        {
+            stats.records = it->second.records;
+            stats.distinctValues = it->second.valueRefs.size();
+            stats.sampleValues = it->second.sampleValues;
+        }
+
+        return stats;
+    }
+
+    std::vector<size_t> DistributedIdiomsServer::estimateConditionCardinalities(
+        const std::vector<query::QueryCondition> &conditions) const
+    {
+        std::vector<size_t> estimates(conditions.size(), SIZE_MAX);
+
+        std::lock_guard<std::mutex> lock(keyStatsMutex);
+        for (size_t i = 0; i < conditions.size(); i++)
+        {
+            const query::QueryCondition &cond = conditions[i];
+            if (cond.keyHasWildcard)
+            {
+                continue; // Spans unknown keys; no estimate
+            }
+
+            auto it = keyStatsStore.find(cond.key);
+            if (it == keyStatsStore.end())
+            {
+                estimates[i] = 0; // Key absent here: nothing can match
+                continue;
+            }
+
+            const KeyStatsEntry &entry = it->second;
+            if (cond.op == query::EQUALS && !cond.valueHasWildcard)
+            {
+                // Exact pair: the average postings per distinct value
+                size_t distinct = entry.valueRefs.size();
+                estimates[i] = distinct == 0 ? 0 : entry.records / distinct;
+            }
+            else
+            {
+                // Anything wider is bounded by the key's total postings
+                estimates[i] = entry.records;
+            }
+        }
+
+        return estimates;
+    }
+
+    uint64_t DistributedIdiomsServer::estimateQueryCost(const std::string &queryStr) const
+    {
+        // COUNT(DISTINCT key) is answered from the statistics store
+        // without a trie walk
+        if (query::isCountDistinctQuery(queryStr))
+        {
+            return 0;
+        }
+
+        // Reduce the query to its bare conditions: COUNT wraps one and
+        // LIMIT trims one, but neither changes what the walk touches
+        std::string condition;
+        if (query::isCountQuery(queryStr))
+        {
+            condition = query::countQueryCondition(queryStr);
+        }
+        else
+        {
+            query::parseLimitModifier(queryStr, condition);
+        }
+
+        // Split a compound condition; AND and OR cost the same here
+        // since every part is evaluated before combining
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start < condition.length())
+        {
+            size_t andPos = condition.find(" AND ", start);
+            size_t orPos = condition.find(" OR ", start);
+            size_t sep = std::min(andPos, orPos);
+            if (sep == std::string::npos)
+            {
+                parts.push_back(condition.substr(start));
+                break;
+            }
+            parts.push_back(condition.substr(start, sep - start));
+            start = sep + (sep == andPos ? 5 : 4);
+        }
+
+        std::lock_guard<std::mutex> lock(keyStatsMutex);
+
+        uint64_t totalRecords = 0;
+        for (const auto &entry : keyStatsStore)
+        {
+            totalRecords += entry.second.records;
+        }
+
+        uint64_t cost = 0;
+        for (const std::string &part : parts)
+        {
+            query::QueryCondition cond = query::QueryCondition::fromString(part);
+            if (cond.keyHasWildcard)
+            {
+                // A pattern key can match any key on this server
+                cost += totalRecords;
+                continue;
+            }
+
+            auto it = keyStatsStore.find(cond.key);
+            if (it == keyStatsStore.end())
+            {
+                continue; // Key absent here: nothing to walk
+            }
+
+            const KeyStatsEntry &entry = it->second;
+            if (cond.op == query::EQUALS && !cond.valueHasWildcard)
+            {
+                // Exact pair: the average postings per distinct value
+                size_t distinct = entry.valueRefs.size();
+                cost += distinct == 0 ? 0 : entry.records / distinct;
+            }
+            else
+            {
+                cost += entry.records;
+            }
+        }
+
+        return cost;
+    }
+
+    int DistributedIdiomsServer::internObjectId(int externalId)
+    {
+        std::lock_guard<std::mutex> lock(denseIdMutex);
+        auto [it, inserted] = denseIdByExternal.emplace(
+            externalId, static_cast<int>(externalIdByDense.size()));
+        if (inserted)
+        {
+            externalIdByDense.push_back(externalId);
+        }
+        return it->second;
+    }
+
+    int DistributedIdiomsServer::lookupDenseObjectId(int externalId) const
+    {
+        std::lock_guard<std::mutex> lock(denseIdMutex);
+        auto it = denseIdByExternal.find(externalId);
+        return it == denseIdByExternal.end() ? -1 : it->second;
+    }
+
+    int DistributedIdiomsServer::externalObjectId(int denseId) const
+    {
+        std::lock_guard<std::mutex> lock(denseIdMutex);
+        if (denseId < 0 || static_cast<size_t>(denseId) >= externalIdByDense.size())
+        {
+            return denseId;
+        }
+        return externalIdByDense[denseId];
+    }
+
+    std::vector<int> DistributedIdiomsServer::externalizeObjectIds(std::vector<int> denseIds) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(denseIdMutex);
+            for (int &id : denseIds)
+            {
+                if (id >= 0 && static_cast<size_t>(id) < externalIdByDense.size())
+                {
+                    id = externalIdByDense[id];
+                }
+            }
+        }
+
+        // Posting lists materialize sorted in dense order; restore the
+        // external ordering callers observe
+        std::sort(denseIds.begin(), denseIds.end());
+        return denseIds;
+    }
+
+    void DistributedIdiomsServer::addIndexedKey(const std::string &key, const std::string &value, int objectId)
+    {
+        if (readOnlyReplica)
+        {
+            std::cerr << "Server " << serverId
+                      << " is a read-only replica; rejecting write" << std::endl;
+            return;
+        }
+
+        // Writers share the compaction lock; only a compaction pass holds
+        // it exclusively
+        std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // New arena blocks under this mutation land on this server's node
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        // Log ahead of applying, so a crash loses at most one unflushed group
+        appendToWal(1, key, value, objectId);
+
+        // The WAL keeps the external ID; everything below this point works
+        // in the dense internal space
+        const int denseId = internObjectId(objectId);
+
+        // A re-added pair must shed any tombstone left by an earlier delete
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            auto it = tombstones.find(key + '\x1F' + value);
+            if (it != tombstones.end() && it->second.contains(denseId))
+            {
+                PostingList revived;
+                revived.add(denseId);
+                it->second.subtract(revived);
+                tombstoneCount--;
+                if (it->second.empty())
+                {
+                    tombstones.erase(it);
+                }
+            }
+        }
+
+        // Only the shard owning this key's virtual node is locked, so inserts
+        // for different virtual nodes proceed in parallel
+        uint32_t virtualNodeId = router->getVirtualNodeId(key);
+        IndexShard &shard = getShard(virtualNodeId);
+
+        {
+            auto lockStart = std::chrono::steady_clock::now();
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            statLockWaitNs.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - lockStart)
+                    .count(),
+                std::memory_order_relaxed);
+            addToShardLocked(shard, key, value, denseId);
+        }
+
+        router->recordVnodeInsert(virtualNodeId);
+
+        recordKeyInFilters(key);
+
+        // Values that parse as numbers also go into the range index
+        if (query::isNumeric(value))
+        {
+            std::unique_lock<std::shared_mutex> numLock(numericMutex);
+            numericIndex.insert(key, query::parseNumeric(value), denseId);
+        }
+
+        // Store in the object metadata map for easier lookup
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.add(denseId, key, value);
+        }
+
+        recordKeyStatsInsert(key, value);
+
+        // Standing queries see the change as a delta, not on a re-poll
+        updateStandingQueries(key, denseId);
+
+        // Invalidate cached query results only now that the write is
+        // visible: a query that raced with it read the old version, so
+        // whatever it cached is keyed stale instead of masking this record
+        indexVersion.fetch_add(1);
+
+        maybeStartSpill();
+    }
+
+    void DistributedIdiomsServer::bulkLoadIndexedKeys(std::vector<IndexRecord> records)
+    {
+        if (readOnlyReplica)
+        {
+            std::cerr << "Server " << serverId
+                      << " is a read-only replica; rejecting bulk load" << std::endl;
+            return;
+        }
+
+        std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // One log group covers the whole batch
+        for (const auto &record : records)
+        {
+            appendToWal(1, record.key, record.value, record.objectId);
+        }
+
+        // Wire and WAL carry external IDs; the loaded records use dense
+        for (auto &record : records)
+        {
+            record.objectId = internObjectId(record.objectId);
+        }
+
+        bulkLoadRecords(std::move(records));
+
+        maybeStartSpill();
+    }
+
+    void DistributedIdiomsServer::bulkLoadRecords(std::vector<IndexRecord> records)
+    {
+        // Bulk loads allocate most of the arena; keep the blocks local
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        if (records.empty())
+        {
+            return;
+        }
+
+        // Sort so each distinct key, and each distinct value within a key,
+        // is visited exactly once
+        std::sort(records.begin(), records.end(),
+                  [](const IndexRecord &a, const IndexRecord &b)
+                  {
+                      if (a.key != b.key)
+                      {
+                          return a.key < b.key;
+                      }
+                      if (a.value != b.value)
+                      {
+                          return a.value < b.value;
+                      }
+                      return a.objectId < b.objectId;
+                  });
+
+        // Resolve the virtual node for every record in one batch call; the
+        // sorted order means runs of the same key route with a single lookup
+        std::vector<std::string> keys;
+        keys.reserve(records.size());
+        for (const auto &record : records)
+        {
+            keys.push_back(record.key);
+        }
+        std::vector<uint32_t> vnodeIds = router->getVirtualNodeIds(keys);
+
+        // Partition by virtual node; sorted order is preserved within each slice
+        std::unordered_map<uint32_t, std::vector<IndexRecord>> perShard;
+        for (size_t r = 0; r < records.size(); r++)
+        {
+            perShard[vnodeIds[r]].push_back(std::move(records[r]));
+        }
+
+        // Flatten into a work list so shards can be rebuilt in parallel;
+        // each shard's trie is independent, so workers never contend on the
+        // inserts themselves
+        std::vector<std::pair<uint32_t, std::vector<IndexRecord>>> shardWork;
+        shardWork.reserve(perShard.size());
+        for (auto &[virtualNodeId, shardRecords] : perShard)
+        {
+            shardWork.emplace_back(virtualNodeId, std::move(shardRecords));
+        }
+
+        auto loadShard = [this](uint32_t virtualNodeId, const std::vector<IndexRecord> &shardRecords)
+        {
+            IndexShard &shard = getShard(virtualNodeId);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+            size_t i = 0;
+            while (i < shardRecords.size())
+            {
+                recordKeyInFilters(shardRecords[i].key);
+                i = insertKeyRun(*shard.keyTrie, shardRecords, i);
+            }
+
+            lock.unlock();
+
+            // Feed numeric values into the range index
+            {
+                std::unique_lock<std::shared_mutex> numLock(numericMutex);
+                for (const auto &record : shardRecords)
+                {
+                    if (query::isNumeric(record.value))
+                    {
+                        numericIndex.insert(record.key, query::parseNumeric(record.value),
+                                            record.objectId);
+                    }
+                }
+            }
+
+            // Record the metadata outside the shard lock
+            {
+                std::lock_guard<std::mutex> metaLock(metadataMutex);
+                for (const auto &record : shardRecords)
+                {
+                    objectMetadata.add(record.objectId, record.key, record.value);
+                }
+            }
+
+            // Standing queries see the batch as deltas, not on a re-poll
+            for (const auto &record : shardRecords)
+            {
+                updateStandingQueries(record.key, record.objectId);
+            }
+
+            for (const auto &record : shardRecords)
+            {
+                recordKeyStatsInsert(record.key, record.value);
+            }
+
+            router->recordVnodeInsert(virtualNodeId, shardRecords.size());
+        };
+
+        size_t numWorkers = std::thread::hardware_concurrency();
+        if (numWorkers == 0)
+        {
+            numWorkers = 1;
+        }
+        numWorkers = std::min(numWorkers, shardWork.size());
+
+        if (numWorkers <= 1)
+        {
+            for (const auto &[virtualNodeId, shardRecords] : shardWork)
+            {
+                loadShard(virtualNodeId, shardRecords);
+            }
+        }
+        else
+        {
+            std::atomic<size_t> nextShard{0};
+            std::vector<std::thread> workers;
+            workers.reserve(numWorkers);
+
+            for (size_t w = 0; w < numWorkers; w++)
+            {
+                workers.emplace_back(
+                    [&]()
+                    {
+                        size_t i;
+                        while ((i = nextShard.fetch_add(1)) < shardWork.size())
+                        {
+                            loadShard(shardWork[i].first, shardWork[i].second);
+                        }
+                    });
+            }
+
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        // Retire cached results only once every shard is loaded: a query
+        // overlapping the load saw partial shards and cached them under
+        // the version this bump replaces
+        indexVersion.fetch_add(1);
+    }
+
+    void DistributedIdiomsServer::removeIndexedKey(const std::string &key, const std::string &value, int objectId)
+    {
+        if (readOnlyReplica)
+        {
+            std::cerr << "Server " << serverId
+                      << " is a read-only replica; rejecting delete" << std::endl;
+            return;
+        }
+
+        // An external ID never interned has nothing indexed to remove
+        const int denseId = lookupDenseObjectId(objectId);
+        if (denseId < 0)
+        {
+            return;
+        }
+
+        {
+            std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+            appendToWal(2, key, value, objectId);
+
+            // Lazy deletion: tombstone the posting instead of mutating the
+            // trie. Queries subtract matching tombstones, and compaction
+            // prunes the trie nodes later, off the hot path.
+            {
+                std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+                PostingList &deleted = tombstones[key + '\x1F' + value];
+                if (!deleted.contains(denseId))
+                {
+                    deleted.add(denseId);
+                    tombstoneCount++;
+                }
+            }
+
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+
+            objectMetadata.removePair(denseId, key, value);
+
+            std::cout << "Deleted metadata '" << key << "=" << value
+                      << "' for object " << objectId << " on server " << serverId << std::endl;
+        }
+
+        // Retire cached results only after the tombstone is in place, so a
+        // racing query's entry lands under the stale version
+        indexVersion.fetch_add(1);
+
+        recordKeyStatsDelete(key, value);
+
+        // Standing queries see the removal as a delta, not on a re-poll
+        updateStandingQueries(key, denseId);
+
+        maybeStartCompaction();
+    }
+
+    void DistributedIdiomsServer::removeRecordsDense(const std::vector<IndexRecord> &denseRecords)
+    {
+        if (denseRecords.empty())
+        {
+            return;
+        }
+
+        // One tombstone lock covers the whole batch
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            for (const auto &record : denseRecords)
+            {
+                PostingList &deleted = tombstones[record.key + '\x1F' + record.value];
+                if (!deleted.contains(record.objectId))
+                {
+                    deleted.add(record.objectId);
+                    tombstoneCount++;
+                }
+            }
+        }
+
+        // Likewise one metadata lock
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            for (const auto &record : denseRecords)
+            {
+                objectMetadata.removePair(record.objectId, record.key, record.value);
+            }
+        }
+
+        // The whole batch is visible; cached results go stale together
+        indexVersion.fetch_add(1);
+    }
+
+    void DistributedIdiomsServer::bulkRemoveIndexedKeys(std::vector<IndexRecord> records)
+    {
+        if (readOnlyReplica)
+        {
+            std::cerr << "Server " << serverId
+                      << " is a read-only replica; rejecting bulk delete" << std::endl;
+            return;
+        }
+
+        // Wire and WAL carry external IDs; the removal pass uses dense.
+        // Records whose external ID was never interned have nothing
+        // indexed to remove and are dropped here.
+        std::vector<IndexRecord> denseRecords;
+        denseRecords.reserve(records.size());
+
+        {
+            std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+            for (auto &record : records)
+            {
+                const int denseId = lookupDenseObjectId(record.objectId);
+                if (denseId < 0)
+                {
+                    continue;
+                }
+
+                appendToWal(2, record.key, record.value, record.objectId);
+                record.objectId = denseId;
+                denseRecords.push_back(std::move(record));
+            }
+
+            removeRecordsDense(denseRecords);
+        }
+
+        // Statistics and standing queries see the batch as per-record
+        // deltas, outside the compaction lock like the single-record path
+        for (const auto &record : denseRecords)
+        {
+            recordKeyStatsDelete(record.key, record.value);
+            updateStandingQueries(record.key, record.objectId);
+        }
+
+        std::cout << "Bulk deleted " << denseRecords.size() << " index records on server "
+                  << serverId << std::endl;
+
+        maybeStartCompaction();
+    }
+
+    size_t DistributedIdiomsServer::deleteByQuery(const std::string &queryStr)
+    {
+        if (readOnlyReplica)
+        {
+            std::cerr << "Server " << serverId
+                      << " is a read-only replica; rejecting delete-by-query" << std::endl;
+            return 0;
+        }
+
+        // Evaluate once, in the dense space, to find the victims
+        std::vector<int> victims;
+        if (queryStr.find(" AND ") != std::string::npos ||
+            queryStr.find(" OR ") != std::string::npos)
+        {
+            victims = computeMultiConditionMatches(queryStr);
+        }
+        else
+        {
+            victims = computeQueryResult(queryStr).toVector();
+        }
+
+        if (victims.empty())
+        {
+            return 0;
+        }
+
+        size_t records = removeObjectsDense(victims);
+
+        std::cout << "Delete-by-query '" << queryStr << "' removed " << victims.size()
+                  << " objects (" << records << " records) on server "
+                  << serverId << std::endl;
+
+        return victims.size();
+    }
+
+    size_t DistributedIdiomsServer::removeObjectsDense(const std::vector<int> &victims)
+    {
+        // Every surviving pair of a victim is removed; gather them under
+        // the metadata lock, then reuse the batched tombstone pass
+        std::vector<IndexRecord> denseRecords;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            for (int denseId : victims)
+            {
+                for (const auto &[key, value] : objectMetadata.pairsOf(denseId))
+                {
+                    denseRecords.emplace_back(key, value, denseId);
+                }
+            }
+        }
+
+        {
+            std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+            // The WAL carries external IDs, like every on-disk image
+            for (const auto &record : denseRecords)
+            {
+                appendToWal(2, record.key, record.value, externalObjectId(record.objectId));
+            }
+
+            removeRecordsDense(denseRecords);
+        }
+
+        for (const auto &record : denseRecords)
+        {
+            recordKeyStatsDelete(record.key, record.value);
+            updateStandingQueries(record.key, record.objectId);
+        }
+
+        maybeStartCompaction();
+
+        return denseRecords.size();
+    }
+
+    void DistributedIdiomsServer::enableTimePartitioning(int64_t spanMs, size_t maxWindows)
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        windowSpanMs = spanMs;
+        maxTimeWindows = maxWindows;
+
+        std::cout << "Time partitioning enabled on server " << serverId
+                  << " (window " << spanMs << "ms, ring of " << maxWindows
+                  << ")" << std::endl;
+    }
+
+    void DistributedIdiomsServer::addIndexedKey(const std::string &key, const std::string &value,
+                                                int objectId, int64_t timestampMs)
+    {
+        addIndexedKey(key, value, objectId);
+
+        // Route the object into its window; never hold the window lock
+        // while the expiry below walks the index paths
+        std::vector<int> expired;
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            if (windowSpanMs == 0)
+            {
+                return;
+            }
+
+            const int denseId = lookupDenseObjectId(objectId);
+            if (denseId < 0)
+            {
+                return; // The insert was rejected (read-only replica)
+            }
+
+            int64_t windowStart = timestampMs - (timestampMs % windowSpanMs);
+            timeWindows[windowStart].add(denseId);
+
+            // Ring retention: a new window past capacity expires the oldest
+            while (maxTimeWindows != 0 && timeWindows.size() > maxTimeWindows)
+            {
+                auto oldest = timeWindows.begin();
+                std::vector<int> members = oldest->second.toVector();
+                expired.insert(expired.end(), members.begin(), members.end());
+                timeWindows.erase(oldest);
+            }
+        }
+
+        if (!expired.empty())
+        {
+            size_t records = removeObjectsDense(expired);
+            std::cout << "Window ring expired " << expired.size() << " objects ("
+                      << records << " records) on server " << serverId << std::endl;
+        }
+    }
+
+    std::vector<int> DistributedIdiomsServer::executeQueryInWindow(const std::string &query,
+                                                                   int64_t fromMs,
+                                                                   int64_t toMs) const
+    {
+        // Evaluate once in the dense space, then mask by the union of the
+        // windows the range touches; windows outside it are never visited
+        std::vector<int> matches;
+        if (query.find(" AND ") != std::string::npos ||
+            query.find(" OR ") != std::string::npos)
+        {
+            matches = computeMultiConditionMatches(query);
+        }
+        else
+        {
+            matches = computeQueryResult(query).toVector();
+        }
+
+        PostingList inRange;
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            for (const auto &[windowStart, members] : timeWindows)
+            {
+                if (windowStart >= toMs)
+                {
+                    break; // Later windows only get later still
+                }
+                if (windowStart + windowSpanMs > fromMs)
+                {
+                    inRange.unionWith(members);
+                }
+            }
+        }
+
+        PostingList results;
+        for (int denseId : matches)
+        {
+            if (inRange.contains(denseId))
+            {
+                results.add(denseId);
+            }
+        }
+
+        return externalizeObjectIds(results.toVector());
+    }
+
+    size_t DistributedIdiomsServer::expireWindowsBefore(int64_t cutoffMs)
+    {
+        // Collect the expired windows under the lock, remove outside it
+        std::vector<int> victims;
+        size_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            if (windowSpanMs == 0)
+            {
+                return 0;
+            }
+
+            while (!timeWindows.empty() &&
+                   timeWindows.begin()->first + windowSpanMs <= cutoffMs)
+            {
+                std::vector<int> members = timeWindows.begin()->second.toVector();
+                victims.insert(victims.end(), members.begin(), members.end());
+                timeWindows.erase(timeWindows.begin());
+                dropped++;
+            }
+        }
+
+        if (!victims.empty())
+        {
+            size_t records = removeObjectsDense(victims);
+            std::cout << "Expired " << dropped << " windows (" << victims.size()
+                      << " objects, " << records << " records) on server "
+                      << serverId << std::endl;
+        }
+
+        return dropped;
+    }
+
+    bool DistributedIdiomsServer::pairMatchesCondition(std::string_view keyPart, std::string_view valuePart,
+                                                       const std::string &key, const std::string &value)
+    {
+        bool keyMatches;
+        if (keyPart == "*")
+        {
+            keyMatches = true;
+        }
+        else if (keyPart.find('*') != std::string::npos)
+        {
+            keyMatches = query::matchWildcard(key, keyPart);
+        }
+        else
+        {
+            keyMatches = key == keyPart;
+        }
+
+        if (!keyMatches)
+        {
+            return false;
+        }
+
+        if (valuePart == "*")
+        {
+            return true;
+        }
+        if (valuePart.length() > 2 && valuePart.front() == '[' && valuePart.back() == ']' &&
+            valuePart.find("..") != std::string::npos)
+        {
+            if (!query::isNumeric(value))
+            {
+                return false;
+            }
+            size_t sep = valuePart.find("..");
+            double minValue = query::parseNumeric(
+                std::string(valuePart.substr(1, sep - 1)));
+            double maxValue = query::parseNumeric(
+                std::string(valuePart.substr(sep + 2, valuePart.length() - sep - 3)));
+            double numeric = query::parseNumeric(value);
+            return numeric >= minValue && numeric <= maxValue;
+        }
+        if (valuePart.find('*') != std::string::npos)
+        {
+            return query::matchWildcard(value, valuePart);
+        }
+        return value == valuePart;
+    }
+
+    bool DistributedIdiomsServer::objectHasLivePair(int objectId,
+                                                    const std::function<bool(const std::string &, const std::string &)> &pred) const
+    {
+        std::lock_guard<std::mutex> metaLock(metadataMutex);
+        return objectMetadata.anyPairOf(objectId, pred);
+    }
+
+    void DistributedIdiomsServer::subtractTombstones(std::string_view keyPart, std::string_view valuePart,
+                                                     PostingList &results) const
+    {
+        // Union the tombstoned postings whose (key, value) falls under the
+        // condition; these objects may still match through other live pairs
+        PostingList candidates;
+        {
+            std::shared_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            if (tombstones.empty())
+            {
+                return;
+            }
+
+            for (const auto &[pairKey, deleted] : tombstones)
+            {
+                size_t sep = pairKey.find('\x1F');
+                if (pairMatchesCondition(keyPart, valuePart,
+                                         pairKey.substr(0, sep), pairKey.substr(sep + 1)))
+                {
+                    candidates.unionWith(deleted);
+                }
+            }
+        }
+
+        if (candidates.empty())
+        {
+            return;
+        }
+
+        // Only drop objects whose surviving metadata no longer matches the
+        // condition; metadata is deletion-accurate, the tries are not
+        PostingList removals;
+        for (int objectId : candidates.toVector())
+        {
+            if (results.contains(objectId) &&
+                !objectHasLivePair(objectId,
+                                   [&](const std::string &key, const std::string &value)
+                                   {
+                                       return pairMatchesCondition(keyPart, valuePart, key, value);
+                                   }))
+            {
+                removals.add(objectId);
+            }
+        }
+
+        results.subtract(removals);
+    }
+
+    void DistributedIdiomsServer::maybeStartCompaction()
+    {
+        {
+            std::shared_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            if (tombstoneCount < COMPACTION_THRESHOLD)
+            {
+                return;
+            }
+        }
+
+        if (compactionRunning.exchange(true))
+        {
+            return; // A pass is already in flight
+        }
+
+        if (compactionThread.joinable())
+        {
+            compactionThread.join();
+        }
+        compactionThread = std::thread([this]
+                                       { compactionPass(); });
+    }
+
+    void DistributedIdiomsServer::compactIndex()
+    {
+        if (compactionRunning.exchange(true))
+        {
+            return;
+        }
+
+        if (compactionThread.joinable())
+        {
+            compactionThread.join();
+        }
+        compactionPass();
+    }
+
+    void DistributedIdiomsServer::compactionPass()
+    {
+        // The pass may run on a background thread: pin it to our node so
+        // the rebuilt tries are allocated and first-touched locally
+        numa::bindCurrentThreadToNode(numaNode);
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        // Exclude writers for the whole pass so the rebuild cannot lose a
+        // concurrent insert or delete; readers keep running against the old
+        // shards through the shared_ptrs they copied, and each old shard is
+        // destroyed once its last reader drains
+        std::unique_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // Snapshot surviving records; objectMetadata already excludes
+        // everything that was tombstoned
+        std::vector<IndexRecord> records;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    records.emplace_back(key, value, objectId);
+                });
+        }
+
+        std::cout << "Compacting index on server " << serverId
+                  << " (" << records.size() << " live records)" << std::endl;
+
+        // Rebuild through the bulk-load path, exactly as recovery does;
+        // dead postings and the trie nodes that held them simply are not
+        // recreated
+        {
+            dropColdSegments();
+            std::unique_lock<std::shared_mutex> lock(shardsMutex);
+            shards.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> numLock(numericMutex);
+            numericIndex.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> filterLock(filterMutex);
+            keyFilter.clear();
+            keySuffixFilter.clear();
+            filterVersion.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> statsLock(keyStatsMutex);
+            keyStatsStore.clear();
+        }
+        {
+            // bulkLoadRecords re-records every surviving pair, so the store
+            // must start empty or each pass would duplicate it; rebuilding
+            // also squeezes relocation holes out of the record arena
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.clear();
+        }
+
+        bulkLoadRecords(std::move(records));
+
+        // The rebuilt live shards now cover everything; retire the published
+        // snapshot before dropping the tombstones that were masking its
+        // dead postings
+        std::atomic_store(&snapshot, std::shared_ptr<const IndexSnapshot>());
+
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            tombstones.clear();
+            tombstoneCount = 0;
+        }
+
+        // A final bump retires anything a query cached against the
+        // half-rebuilt index while the pass ran
+        indexVersion.fetch_add(1);
+
+        compactionRunning.store(false);
+    }
+
+    void DistributedIdiomsServer::publishSnapshot()
+    {
+        // The snapshot tries should live on our node like the live shards
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        // Writers are excluded for the duration of the build so the
+        // snapshot plus an empty delta is exactly the current index
+        std::unique_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // Build from surviving metadata, so tombstoned postings are folded
+        // out of the snapshot instead of being subtracted on every query
+        std::vector<IndexRecord> records;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    records.emplace_back(key, value, objectId);
+                });
+        }
+
+        std::sort(records.begin(), records.end(),
+                  [](const IndexRecord &a, const IndexRecord &b)
+                  {
+                      if (a.key != b.key)
+                      {
+                          return a.key < b.key;
+                      }
+                      if (a.value != b.value)
+                      {
+                          return a.value < b.value;
+                      }
+                      return a.objectId < b.objectId;
+                  });
+
+        // Partition by virtual node and build the frozen tries
+        std::unordered_map<uint32_t, std::vector<IndexRecord>> perShard;
+        for (auto &record : records)
+        {
+            perShard[router->getVirtualNodeId(record.key)].push_back(std::move(record));
+        }
+
+        auto fresh = std::make_shared<IndexSnapshot>();
+        for (auto &[virtualNodeId, shardRecords] : perShard)
+        {
+            auto &keyTrie = fresh->shards[virtualNodeId];
+            keyTrie = std::make_unique<KeyTrie>(useSuffixTreeMode, usePathCompression);
+
+            size_t i = 0;
+            while (i < shardRecords.size())
+            {
+                i = insertKeyRun(*keyTrie, shardRecords, i);
+            }
+
+            // The snapshot is read-only from here on: relayout its nodes
+            // into traversal order while nobody else can see them
+            keyTrie->freeze();
+        }
+
+        std::cout << "Published index snapshot on server " << serverId
+                  << " (" << fresh->shards.size() << " shards)" << std::endl;
+
+        // Swap the frozen tries in and reset the live delta. The numeric
+        // index is rebuilt alongside so its dead entries disappear with
+        // the tombstones.
+        std::atomic_store(&snapshot,
+                          std::shared_ptr<const IndexSnapshot>(std::move(fresh)));
+
+        {
+            // Clearing the map only drops this side's references; a query
+            // still holding a shard's shared_ptr finishes against it
+            dropColdSegments();
+            std::unique_lock<std::shared_mutex> lock(shardsMutex);
+            shards.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> numLock(numericMutex);
+            numericIndex.clear();
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    if (query::isNumeric(value))
+                    {
+                        numericIndex.insert(key, query::parseNumeric(value), objectId);
+                    }
+                });
+        }
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            tombstones.clear();
+            tombstoneCount = 0;
+        }
+
+        // Only now is the swap complete from a reader's point of view;
+        // results cached mid-publish stay keyed to the retired version
+        indexVersion.fetch_add(1);
+    }
+
+    void DistributedIdiomsServer::freezeIndexes()
+    {
+        // The relaid-out tries should live on our node like the originals
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        // Writers are excluded for the pass; each shard is additionally
+        // frozen under its own exclusive lock so in-flight readers drain
+        // before its nodes move
+        std::unique_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        size_t frozen = 0;
+        std::shared_lock<std::shared_mutex> mapLock(shardsMutex);
+        for (auto &entry : shards)
+        {
+            const IndexShard &shard = *entry.second;
+            std::unique_lock<std::shared_mutex> shardLock(shard.mutex);
+
+            // A spilled shard's stub trie has nothing worth relaying out;
+            // its records get a fresh trie when they fault back in
+            if (shard.spilled)
+            {
+                continue;
+            }
+
+            shard.keyTrie->freeze();
+            frozen++;
+        }
+
+        std::cout << "Froze " << frozen << " index shards on server "
+                  << serverId << std::endl;
+    }
+
+    std::vector<IndexRecord> DistributedIdiomsServer::exportVirtualNodes(
+        const std::vector<uint32_t> &vnodeIds)
+    {
+        std::unordered_set<uint32_t> migrating(vnodeIds.begin(), vnodeIds.end());
+
+        // Metadata is the source of truth: it already excludes tombstoned
+        // pairs, so only live entries cross the wire
+        std::vector<IndexRecord> records;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    if (migrating.count(router->getVirtualNodeId(key)) > 0)
+                    {
+                        // Exports cross the wire in the external ID space
+                        records.emplace_back(key, value, externalObjectId(objectId));
+                    }
+                });
+        }
+
+        return records;
+    }
+
+    std::string DistributedIdiomsServer::exportSnapshotImage(
+        const std::vector<uint32_t> &vnodeIds)
+    {
+        std::vector<IndexRecord> records = exportVirtualNodes(vnodeIds);
+
+        // Same scalar/string encoding as the V2 checkpoint image, built in
+        // memory so the transport can slice it into chunks directly
+        std::string image;
+        image += "IDIOMS_SNAPSHOT_V1\n";
+        appendScalar(image, static_cast<uint64_t>(records.size()));
+        for (const IndexRecord &record : records)
+        {
+            appendString(image, record.key);
+            appendString(image, record.value);
+            appendScalar(image, static_cast<int32_t>(record.objectId));
+        }
+
+        return image;
+    }
+
+    bool DistributedIdiomsServer::importSnapshotImage(const std::string &image)
+    {
+        const std::string header = "IDIOMS_SNAPSHOT_V1\n";
+        if (image.compare(0, header.length(), header) != 0)
+        {
+            std::cerr << "Snapshot image has an unknown format header" << std::endl;
+            return false;
+        }
+
+        size_t offset = header.length();
+        uint64_t recordCount;
+        if (!readScalar(image, offset, recordCount))
+        {
+            return false;
+        }
+
+        // This server may already hold replica copies of some entries;
+        // load only the pairs not present so metadata never duplicates
+        std::unordered_set<std::string> present;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    // The incoming image carries external IDs; fingerprint
+                    // the local pairs in the same space
+                    present.insert(key + '\x1f' + value + '\x1f' +
+                                   std::to_string(externalObjectId(objectId)));
+                });
+        }
+
+        std::vector<IndexRecord> records;
+        records.reserve(recordCount);
+        for (uint64_t i = 0; i < recordCount; i++)
+        {
+            std::string key, value;
+            int32_t objectId;
+            if (!readString(image, offset, key) ||
+                !readString(image, offset, value) ||
+                !readScalar(image, offset, objectId))
+            {
+                return false;
+            }
+
+            std::string fingerprint = key + '\x1f' + value + '\x1f' +
+                                      std::to_string(objectId);
+            if (present.insert(std::move(fingerprint)).second)
+            {
+                records.emplace_back(key, value, objectId);
+            }
+        }
+
+        if (!records.empty())
+        {
+            bulkLoadIndexedKeys(std::move(records));
+        }
+
+        return true;
+    }
+
+    void DistributedIdiomsServer::dropVirtualNodes(const std::vector<uint32_t> &vnodeIds)
+    {
+        std::unordered_set<uint32_t> migrating(vnodeIds.begin(), vnodeIds.end());
+
+        // Exclude writers for the whole pass, same as compaction
+        std::unique_lock<std::shared_mutex> compactionLock(compactionMutex);
+
+        // Prune the migrated pairs from the metadata, then rebuild what
+        // remains; the dropped entries vanish from the tries, the numeric
+        // index and the filters in one pass
+        size_t droppedPairs = 0;
+        std::vector<IndexRecord> records;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &key, const std::string &value)
+                {
+                    if (migrating.count(router->getVirtualNodeId(key)) > 0)
+                    {
+                        droppedPairs++;
+                    }
+                    else
+                    {
+                        records.emplace_back(key, value, objectId);
+                    }
+                });
+
+            // Drop the store wholesale; the bulk load below re-records the
+            // survivors, which also squeezes any relocation holes out of
+            // the record arena
+            objectMetadata.clear();
+        }
+
+        std::cout << "Dropping " << vnodeIds.size() << " virtual nodes from server "
+                  << serverId << " (" << droppedPairs << " index entries)" << std::endl;
+
+        {
+            dropColdSegments();
+            std::unique_lock<std::shared_mutex> lock(shardsMutex);
+            shards.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> numLock(numericMutex);
+            numericIndex.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> filterLock(filterMutex);
+            keyFilter.clear();
+            keySuffixFilter.clear();
+            filterVersion.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> statsLock(keyStatsMutex);
+            keyStatsStore.clear();
+        }
+
+        bulkLoadRecords(std::move(records));
+
+        // The rebuilt shards cover everything that survives; retire the
+        // published snapshot before dropping the tombstones masking it
+        std::atomic_store(&snapshot, std::shared_ptr<const IndexSnapshot>());
+
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            tombstones.clear();
+            tombstoneCount = 0;
+        }
+
+        // Retire cached results last, once the drop is fully visible
+        indexVersion.fetch_add(1);
+
+        // The WAL still carries inserts for the migrated keys; checkpoint
+        // now so a crash cannot replay them back onto this server
+        checkpointIndex();
+    }
+
+    bool DistributedIdiomsServer::hasKey(std::string_view key) const
+    {
+        // The Bloom filter answers most negative probes without touching
+        // any shard; a positive may be false, so the trie check follows
+        {
+            std::shared_lock<std::shared_mutex> filterLock(filterMutex);
+            if (!keyFilter.mightContain(key))
+            {
+                return false;
+            }
+        }
+
+        // An exact key lives in exactly one virtual node's shard
+        uint32_t virtualNodeId = router->getVirtualNodeId(key);
+
+        // The published snapshot is immutable, so no lock is needed
+        auto snap = currentSnapshot();
+        if (snap != nullptr)
+        {
+            auto it = snap->shards.find(virtualNodeId);
+            if (it != snap->shards.end() && it->second->searchExactKey(key) != nullptr)
+            {
+                return true;
+            }
+        }
+
+        std::shared_ptr<const IndexShard> shard = findShard(virtualNodeId);
+        if (shard == nullptr)
+        {
+            return false;
+        }
+
+        ensureShardResident(*shard);
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        return shard->keyTrie->searchExactKey(key) != nullptr;
+    }
+
+    bool DistributedIdiomsServer::hasSuffix(std::string_view suffix) const
+    {
+        // In suffix-tree mode, we can check if a suffix is indexed
+        if (!useSuffixTreeMode)
+        {
+            return false;
+        }
+
+        // The suffix filter rules out most misses before the shard scan
+        {
+            std::shared_lock<std::shared_mutex> filterLock(filterMutex);
+            if (!keySuffixFilter.mightContain(suffix))
+            {
+                return false;
+            }
+        }
+
+        // A suffix can match keys in any shard, snapshot or delta
+        auto snap = currentSnapshot();
+        if (snap != nullptr)
+        {
+            for (const auto &[virtualNodeId, keyTrie] : snap->shards)
+            {
+                if (!keyTrie->searchKeySuffix(suffix).empty())
+                {
+                    return true;
+                }
+            }
+        }
+
+        for (const auto &shard : getAllShards())
+        {
+            ensureShardResident(*shard);
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            if (!shard->keyTrie->searchKeySuffix(suffix).empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool DistributedIdiomsServer::canHandleQuery(const std::string &query) const
+    {
+        // Parse the query string; the parts are slices of the query, so
+        // no substring is ever allocated on this path
+        std::string_view keyPart(query);
+        size_t pos = keyPart.find('=');
+        if (pos != std::string_view::npos)
+        {
+            keyPart = keyPart.substr(0, pos);
+        }
+
+        // Check if this server can handle the query based on the key part
+        if (keyPart == "*")
+        {
+            // Wildcard queries can be handled by any server
+            return true;
+        }
+        else if (keyPart.front() == '*' && keyPart.back() == '*' && keyPart.length() > 2)
+        {
+            // Infix query
+            std::string_view infix = keyPart.substr(1, keyPart.length() - 2);
+            auto snap = currentSnapshot();
+            if (snap != nullptr)
+            {
+                for (const auto &[virtualNodeId, keyTrie] : snap->shards)
+                {
+                    if (!keyTrie->searchKeyInfix(infix).empty())
+                    {
+                        return true;
+                    }
+                }
+            }
+            for (const auto &shard : getAllShards())
+            {
+                ensureShardResident(*shard);
+                std::shared_lock<std::shared_mutex> lock(shard->mutex);
+                if (!shard->keyTrie->searchKeyInfix(infix).empty())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        else if (keyPart.front() == '*')
+        {
+            // Suffix query
+            return hasSuffix(keyPart.substr(1));
+        }
+        else if (keyPart.back() == '*')
+        {
+            // Prefix query
+            std::string_view prefix = keyPart.substr(0, keyPart.length() - 1);
+            auto snap = currentSnapshot();
+            if (snap != nullptr)
+            {
+                for (const auto &[virtualNodeId, keyTrie] : snap->shards)
+                {
+                    if (!keyTrie->searchKeyPrefix(prefix).empty())
+                    {
+                        return true;
+                    }
+                }
+            }
+            for (const auto &shard : getAllShards())
+            {
+                ensureShardResident(*shard);
+                std::shared_lock<std::shared_mutex> lock(shard->mutex);
+                if (!shard->keyTrie->searchKeyPrefix(prefix).empty())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        else
+        {
+            // Exact query
+            return hasKey(keyPart);
+        }
+    }
+
+    PostingList DistributedIdiomsServer::computeQueryResult(const std::string &query) const
+    {
+        // Parse the query; the parts and every pattern below are slices of
+        // the query string, so the dispatch allocates no substrings
+        std::string_view keyPart(query), valuePart("*");
+        size_t pos = keyPart.find('=');
+        if (pos != std::string_view::npos)
+        {
+            valuePart = keyPart.substr(pos + 1);
+            keyPart = keyPart.substr(0, pos);
+        }
+
+        PostingList resultSet;
+
+        // Resolve the key part against one key trie and union the matching
+        // objects into the given posting set
+        auto queryTrie = [&](const KeyTrie *keyTrie, PostingList &results)
+        {
+            // Get value tries based on key condition
+            std::vector<std::shared_ptr<ValueTrie>> valueTries;
+
+            if (keyPart == "*")
+            {
+                // Wildcard key
+                valueTries = keyTrie->getAllValueTries();
+            }
+            else if (keyPart.front() == '*' && keyPart.back() == '*' && keyPart.length() > 2)
+            {
+                // Infix key
+                valueTries = keyTrie->searchKeyInfix(keyPart.substr(1, keyPart.length() - 2));
+            }
+            else if (keyPart.front() == '*')
+            {
+                // Suffix key
+                valueTries = keyTrie->searchKeySuffix(keyPart.substr(1));
+            }
+            else if (keyPart.back() == '*')
+            {
+                // Prefix key
+                valueTries = keyTrie->searchKeyPrefix(keyPart.substr(0, keyPart.length() - 1));
+            }
+            else
+            {
+                // Exact key
+                auto valueTrie = keyTrie->searchExactKey(keyPart);
+                if (valueTrie)
+                {
+                    valueTries.push_back(valueTrie);
+                }
+            }
+
+            // Determine value query type
+            for (const auto &valueTrie : valueTries)
+            {
+                if (valuePart == "*")
+                {
+                    // Wildcard value
+                    results.unionWith(valueTrie->getAllObjectIds());
+                }
+                else if (valuePart.front() == '[' && valuePart.back() == ']' &&
+                         valuePart.find("..") != std::string::npos)
+                {
+                    // Range value: "[min..max]" over the encoded numeric
+                    // entries, answered as a bounded trie walk
+                    size_t sep = valuePart.find("..");
+                    double minValue = query::parseNumeric(
+                        std::string(valuePart.substr(1, sep - 1)));
+                    double maxValue = query::parseNumeric(std::string(
+                        valuePart.substr(sep + 2, valuePart.length() - sep - 3)));
+                    results.unionWith(valueTrie->searchValueRange(
+                        ENCODED_VALUE_PREFIX + encodeOrderedDouble(minValue),
+                        ENCODED_VALUE_PREFIX + encodeOrderedDouble(maxValue)));
+                }
+                else if (valuePart.front() == '*' && valuePart.back() == '*' && valuePart.length() > 2)
+                {
+                    // Infix value
+                    results.unionWith(valueTrie->searchValueInfix(
+                        valuePart.substr(1, valuePart.length() - 2)));
+                }
+                else if (valuePart.front() == '*')
+                {
+                    // Suffix value
+                    results.unionWith(valueTrie->searchValueSuffix(valuePart.substr(1)));
+                }
+                else if (valuePart.back() == '*')
+                {
+                    // Prefix value
+                    results.unionWith(valueTrie->searchValuePrefix(
+                        valuePart.substr(0, valuePart.length() - 1)));
+                }
+                else
+                {
+                    // Exact value
+                    results.unionWith(valueTrie->searchExactValue(valuePart));
+                }
+            }
+        };
+
+        // Live delta shards need their reader lock; snapshot tries do not.
+        // Time the acquisition: lock wait is where write contention shows
+        // up in read latency.
+        auto queryShard = [&](const IndexShard *shard, PostingList &results)
+        {
+            // Spilled shards fault their records back in on first touch
+            ensureShardResident(*shard);
+
+            auto lockStart = std::chrono::steady_clock::now();
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            statLockWaitNs.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - lockStart)
+                    .count(),
+                std::memory_order_relaxed);
+            queryTrie(shard->keyTrie.get(), results);
+        };
+
+        bool exactKey = keyPart != "*" && keyPart.front() != '*' && keyPart.back() != '*';
+
+        auto snap = currentSnapshot();
+
+        if (exactKey)
+        {
+            // An exact key lives in exactly one virtual node's shard
+            uint32_t virtualNodeId = router->getVirtualNodeId(keyPart);
+
+            // Feed the load accounting that drives vnode rebalancing; only
+            // exact-key queries attribute cleanly to a single vnode
+            router->recordVnodeQuery(virtualNodeId);
+
+            if (snap != nullptr)
+            {
+                auto it = snap->shards.find(virtualNodeId);
+                if (it != snap->shards.end())
+                {
+                    queryTrie(it->second.get(), resultSet);
+                }
+            }
+
+            std::shared_ptr<const IndexShard> shard = findShard(virtualNodeId);
+            if (shard != nullptr)
+            {
+                queryShard(shard.get(), resultSet);
+            }
+        }
+        else
+        {
+            // Wildcard key conditions can match keys in any snapshot trie
+            // or delta shard. Those are independent subtrees, so they are
+            // scanned in parallel: workers claim targets off a shared
+            // counter (fast workers steal the slow ones' remainder) and the
+            // per-worker posting sets are merged at the end.
+            std::vector<const KeyTrie *> snapshotTries;
+            if (snap != nullptr)
+            {
+                snapshotTries.reserve(snap->shards.size());
+                for (const auto &[virtualNodeId, keyTrie] : snap->shards)
+                {
+                    snapshotTries.push_back(keyTrie.get());
+                }
+            }
+            // The shared_ptrs pin the delta shards for the whole fan-out,
+            // including the worker threads below
+            std::vector<std::shared_ptr<const IndexShard>> allShards = getAllShards();
+
+            size_t totalTargets = snapshotTries.size() + allShards.size();
+
+            auto queryTarget = [&](size_t i, PostingList &results)
+            {
+                if (i < snapshotTries.size())
+                {
+                    queryTrie(snapshotTries[i], results);
+                }
+                else
+                {
+                    queryShard(allShards[i - snapshotTries.size()].get(), results);
+                }
+            };
+
+            size_t numWorkers = std::thread::hardware_concurrency();
+            if (numWorkers == 0)
+            {
+                numWorkers = 1;
+            }
+            numWorkers = std::min(numWorkers, totalTargets);
+
+            if (numWorkers <= 1)
+            {
+                for (size_t i = 0; i < totalTargets; i++)
+                {
+                    queryTarget(i, resultSet);
+                }
+            }
+            else
+            {
+                std::atomic<size_t> nextTarget{0};
+                std::vector<PostingList> workerResults(numWorkers);
+                std::vector<std::thread> workers;
+                workers.reserve(numWorkers);
+
+                // The workers charge the calling thread's budget; a
+                // tripped checkpoint may not throw across the thread
+                // join, so workers swallow it and the caller's own
+                // checkpoint below rethrows off the shared flag
+                query::QueryBudget *budget = query::currentBudget();
+
+                for (size_t w = 0; w < numWorkers; w++)
+                {
+                    workers.emplace_back(
+                        [&, w]()
+                        {
+                            query::BudgetScope scope(budget);
+                            try
+                            {
+                                size_t i;
+                                while ((i = nextTarget.fetch_add(1)) < totalTargets)
+                                {
+                                    queryTarget(i, workerResults[w]);
+                                }
+                            }
+                            catch (const query::QueryCancelled &)
+                            {
+                                // The budget's cancelled flag is already
+                                // set; the other workers and the caller
+                                // stop at their next checkpoint
+                            }
+                        });
+                }
+
+                for (auto &worker : workers)
+                {
+                    worker.join();
+                }
+
+                query::checkBudget();
+
+                for (PostingList &workerResult : workerResults)
+                {
+                    resultSet.unionWith(workerResult);
+                }
+            }
+        }
+
+        // Deletes only tombstone postings; hide them from the result
+        subtractTombstones(keyPart, valuePart, resultSet);
+
+        return resultSet;
+    }
+
+    int DistributedIdiomsServer::classifyQueryShape(std::string_view condition)
+    {
+        // Shape of one pattern part, in rising cost order
+        auto partShape = [](std::string_view part) -> int
+        {
+            if (part.empty() || part == "*")
+            {
+                return SHAPE_WILDCARD;
+            }
+            if (part.front() == '*' && part.back() == '*' && part.length() > 2)
+            {
+                return SHAPE_INFIX;
+            }
+            if (part.front() == '*')
+            {
+                return SHAPE_SUFFIX;
+            }
+            if (part.back() == '*')
+            {
+                return SHAPE_PREFIX;
+            }
+            return SHAPE_EXACT;
+        };
+
+        size_t pos = condition.find('=');
+        std::string_view keyPart = pos != std::string_view::npos ? condition.substr(0, pos) : condition;
+        std::string_view valuePart = pos != std::string_view::npos ? condition.substr(pos + 1) : "*";
+
+        // The more expensive of the two parts dominates the cost
+        return std::max(partShape(keyPart), partShape(valuePart));
+    }
+
+    std::vector<int> DistributedIdiomsServer::executeQuery(const std::string &query) const
+    {
+        // A read-only replica has no tries; the mapped image answers
+        if (readOnlyReplica)
+        {
+            return executeQueryFromImage(query);
+        }
+
+        auto statStart = std::chrono::steady_clock::now();
+        int shape = classifyQueryShape(query);
+
+        // Serve repeated queries from the result cache while the index is
+        // unchanged. The version is read before the trie walk, so a write
+        // racing with this query leaves a stale-versioned entry behind that
+        // later lookups reject.
+        uint64_t version = indexVersion.load();
+
+        // COUNT results are scalars, not IDs; only ID results translate
+        // back to the external space at the response boundary
+        const bool idResults = !query::isCountDistinctQuery(query) &&
+                               !query::isCountQuery(query);
+
+        std::vector<int> cached;
+        if (lookupQueryCache(query, version, cached))
+        {
+            statQueryCount[shape].fetch_add(1, std::memory_order_relaxed);
+            statQueryLatencyNs[shape].fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - statStart)
+                    .count(),
+                std::memory_order_relaxed);
+            return idResults ? externalizeObjectIds(std::move(cached)) : cached;
+        }
+
+        std::vector<int> results;
+
+        if (query::isCountDistinctQuery(query))
+        {
+            // COUNT(DISTINCT key) ships one integer for the whole key
+            results.push_back(static_cast<int>(
+                countDistinctValues(query::countDistinctKey(query))));
+        }
+        else if (query::isCountQuery(query))
+        {
+            // COUNT(...) ships one integer instead of the whole ID set; the
+            // posting lists are still unioned (cheap word-at-a-time ORs) so
+            // objects matching through several values are not double counted
+            results.push_back(static_cast<int>(
+                computeQueryResult(query::countQueryCondition(query)).size()));
+        }
+        else
+        {
+            std::string condition;
+            size_t limit = query::parseLimitModifier(query, condition);
+
+            if (condition.find(" AND ") != std::string::npos ||
+                condition.find(" OR ") != std::string::npos)
+            {
+                // Compound conditions go through the semi-join evaluator
+                results = computeMultiConditionMatches(condition);
+                if (limit > 0 && results.size() > limit)
+                {
+                    results.resize(limit);
+                }
+            }
+            else if (limit > 0)
+            {
+                // LIMIT k stops materializing once k matches are collected
+                results = computeQueryResult(condition).toVector(limit);
+            }
+            else
+            {
+                // Posting lists materialize in sorted order already
+                results = computeQueryResult(query).toVector();
+            }
+        }
+
+        // The cache stays in the dense space so hits under an unchanged
+        // index revalidate for free
+        storeQueryCache(query, version, results);
+
+        statQueryCount[shape].fetch_add(1, std::memory_order_relaxed);
+        statQueryLatencyNs[shape].fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - statStart)
+                .count(),
+            std::memory_order_relaxed);
+
+        return idResults ? externalizeObjectIds(std::move(results)) : results;
+    }
+
+    void DistributedIdiomsServer::executeQueryStreaming(const std::string &query, size_t chunkSize,
+                                                        const std::function<void(const std::vector<int> &)> &onChunk) const
+    {
+        // Streamed results bypass the result cache deliberately: chunked
+        // consumers are exactly the queries whose materialized results we
+        // do not want to hold in memory
+        computeQueryResult(query).forEachChunk(
+            chunkSize,
+            [&](const std::vector<int> &chunk)
+            {
+                onChunk(externalizeObjectIds(chunk));
+            });
+    }
+
+    DistributedIdiomsServer::QueryPage DistributedIdiomsServer::executeQueryPage(
+        const std::string &query, uint64_t cursor, size_t pageSize) const
+    {
+        if (pageSize == 0)
+        {
+            pageSize = 1;
+        }
+
+        std::lock_guard<std::mutex> lock(pagedCursorMutex);
+        uint64_t nowMs = steadyNowMs();
+
+        // Reclaim cursors whose consumer went away
+        for (auto it = pagedCursors.begin(); it != pagedCursors.end();)
+        {
+            if (nowMs - it->second.lastAccessMs > PAGED_CURSOR_IDLE_MS)
+            {
+                it = pagedCursors.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        auto it = cursor != 0 ? pagedCursors.find(cursor) : pagedCursors.end();
+        if (it == pagedCursors.end())
+        {
+            // First page (or an expired cursor): evaluate once and pin
+            // the result set; later writes never shift or repeat what
+            // this cursor pages over
+            if (pagedCursors.size() >= PAGED_CURSOR_CAPACITY)
+            {
+                auto oldest = pagedCursors.begin();
+                for (auto candidate = pagedCursors.begin(); candidate != pagedCursors.end();
+                     ++candidate)
+                {
+                    if (candidate->second.lastAccessMs < oldest->second.lastAccessMs)
+                    {
+                        oldest = candidate;
+                    }
+                }
+                pagedCursors.erase(oldest);
+            }
+
+            PagedCursor pinned;
+            if (query.find(" AND ") != std::string::npos ||
+                query.find(" OR ") != std::string::npos)
+            {
+                for (int denseId : computeMultiConditionMatches(query))
+                {
+                    pinned.results.add(denseId);
+                }
+            }
+            else
+            {
+                pinned.results = computeQueryResult(query);
+            }
+
+            cursor = nextPagedCursorId++;
+            it = pagedCursors.emplace(cursor, std::move(pinned)).first;
+        }
+
+        PagedCursor &state = it->second;
+        state.lastAccessMs = nowMs;
+
+        QueryPage page;
+        page.results = externalizeObjectIds(state.results.slice(state.offset, pageSize));
+        state.offset += page.results.size();
+        page.exhausted = state.offset >= state.results.size();
+
+        if (page.exhausted)
+        {
+            pagedCursors.erase(it);
+        }
+        else
+        {
+            page.cursor = cursor;
+        }
+
+        return page;
+    }
+
+    size_t DistributedIdiomsServer::countDistinctValues(const std::string &key) const
+    {
+        // The metadata map has every surviving (key, value) pair; the
+        // result is one integer however many values the key has
+        std::unordered_set<std::string> values;
+
+        std::lock_guard<std::mutex> metaLock(metadataMutex);
+        objectMetadata.forEachPair(
+            [&](int, const std::string &entryKey, const std::string &entryValue)
+            {
+                if (entryKey == key)
+                {
+                    values.insert(entryValue);
+                }
+            });
+
+        return values.size();
+    }
+
+    std::vector<std::pair<std::string, int>> DistributedIdiomsServer::executeGroupByQuery(const std::string &key) const
+    {
+        // One (value, object count) row per distinct value, ordered by
+        // value; an object with the same value recorded more than once
+        // still counts once per group
+        std::map<std::string, std::unordered_set<int>> groups;
+
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.forEachPair(
+                [&](int objectId, const std::string &entryKey, const std::string &entryValue)
+                {
+                    if (entryKey == key)
+                    {
+                        groups[entryValue].insert(objectId);
+                    }
+                });
+        }
+
+        std::vector<std::pair<std::string, int>> rows;
+        rows.reserve(groups.size());
+        for (const auto &[value, objectIds] : groups)
+        {
+            rows.push_back({value, static_cast<int>(objectIds.size())});
+        }
+
+        return rows;
+    }
+
+    std::vector<int> DistributedIdiomsServer::executeMultiConditionQuery(const std::string &conditionStr) const
+    {
+        return externalizeObjectIds(computeMultiConditionMatches(conditionStr));
+    }
+
+    std::vector<int> DistributedIdiomsServer::computeMultiConditionMatches(const std::string &conditionStr) const
+    {
+        // Repeated query shapes reuse the cached parse instead of
+        // re-splitting the condition list on every call
+        std::shared_ptr<const query::MultiConditionQuery> multiQuery = query::parsedQuery(conditionStr);
+        const std::vector<query::QueryCondition> &conditions = multiQuery->getConditions();
+        const std::vector<query::LogicalOperator> &logicalOps = multiQuery->getOperators();
+
+        if (conditions.empty())
+        {
+            return {};
+        }
+
+        // Only the native key=value form has posting lists in the trie;
+        // other operators are checked per object
+        auto trieAnswerable = [](const query::QueryCondition &cond)
+        {
+            return cond.op == query::EQUALS;
+        };
+
+        // Does any of the object's key-value pairs satisfy the condition?
+        // The probe is a dense scan over the object's record-arena slice.
+        auto objectMatches = [this](int objectId, const query::QueryCondition &cond)
+        {
+            return objectMetadata.anyPairOf(objectId,
+                                            [&](const std::string &key, const std::string &value)
+                                            {
+                                                return cond.matches(key, value);
+                                            });
+        };
+
+        bool pureAnd = true;
+        for (query::LogicalOperator op : logicalOps)
+        {
+            if (op != query::AND)
+            {
+                pureAnd = false;
+                break;
+            }
+        }
+
+        if (pureAnd && conditions.size() > 1)
+        {
+            // Semi-join: seed a candidate set from the cheapest condition,
+            // then probe each survivor's own metadata for the remaining
+            // conditions instead of running them trie-wide
+            // The statistics store turns the static per-operator costs
+            // into actual cardinality estimates where it knows the keys
+            std::vector<size_t> order = multiQuery->planConditionOrder(
+                estimateConditionCardinalities(conditions));
+
+            std::vector<int> candidates;
+            size_t firstProbe = 0;
+
+            if (trieAnswerable(conditions[order[0]]))
+            {
+                candidates = computeQueryResult(conditions[order[0]].key + "=" +
+                                                conditions[order[0]].value)
+                                 .toVector();
+                firstProbe = 1;
+            }
+            else
+            {
+                // No indexed seed condition: start from every object
+                std::lock_guard<std::mutex> metaLock(metadataMutex);
+                candidates.reserve(objectMetadata.objectCount());
+                objectMetadata.forEachObject(
+                    [&](int objectId)
+                    {
+                        candidates.push_back(objectId);
+                    });
+                std::sort(candidates.begin(), candidates.end());
+            }
+
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            for (size_t i = firstProbe; i < order.size() && !candidates.empty(); i++)
+            {
+                const query::QueryCondition &cond = conditions[order[i]];
+
+                std::vector<int> survivors;
+                survivors.reserve(candidates.size());
+                for (int objectId : candidates)
+                {
+                    if (objectMatches(objectId, cond))
+                    {
+                        survivors.push_back(objectId);
+                    }
+                }
+                candidates.swap(survivors);
+            }
+
+            return candidates;
+        }
+
+        // Queries containing OR evaluate every condition fully; AND runs
+        // still intersect most selective first inside combineResults
+        std::vector<std::vector<int>> conditionResults(conditions.size());
+
+        auto evaluateCondition = [&](size_t i)
+        {
+            const query::QueryCondition &cond = conditions[i];
+
+            if (trieAnswerable(cond))
+            {
+                conditionResults[i] =
+                    computeQueryResult(cond.key + "=" + cond.value).toVector();
+                return;
+            }
+
+            std::vector<int> matched;
+            {
+                std::lock_guard<std::mutex> metaLock(metadataMutex);
+                objectMetadata.forEachObject(
+                    [&](int objectId)
+                    {
+                        if (objectMatches(objectId, cond))
+                        {
+                            matched.push_back(objectId);
+                        }
+                    });
+            }
+            std::sort(matched.begin(), matched.end());
+            conditionResults[i] = std::move(matched);
+        };
+
+        size_t numWorkers = std::thread::hardware_concurrency();
+        if (numWorkers == 0)
+        {
+            numWorkers = 1;
+        }
+        numWorkers = std::min(numWorkers, conditions.size());
+
+        if (conditions.size() < PARALLEL_CONDITION_THRESHOLD || numWorkers <= 1)
+        {
+            // Small queries stay serial: thread startup would cost more
+            // than the evaluations it overlaps
+            for (size_t i = 0; i < conditions.size(); i++)
+            {
+                evaluateCondition(i);
+            }
+        }
+        else
+        {
+            // The conditions are independent, so workers claim them off a
+            // shared counter like the wildcard-key trie scan does. Each
+            // condition writes its own slot, so no merge pass is needed
+            // and combineResults sees them in query order.
+            std::atomic<size_t> nextCondition{0};
+            std::vector<std::thread> workers;
+            workers.reserve(numWorkers);
+
+            for (size_t w = 0; w < numWorkers; w++)
+            {
+                workers.emplace_back(
+                    [&]()
+                    {
+                        size_t i;
+                        while ((i = nextCondition.fetch_add(1)) < conditions.size())
+                        {
+                            evaluateCondition(i);
+                        }
+                    });
+            }
+
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        return multiQuery->combineResults(std::move(conditionResults));
+    }
+
+    namespace
+    {
+
+        // Left-to-right fold of a parsed plan over one object's surviving
+        // metadata pairs, matching combineResults' associativity
+        bool planMatchesObject(const query::MultiConditionQuery &plan,
+                               const std::vector<std::pair<std::string, std::string>> &metadata)
+        {
+            const auto &conditions = plan.getConditions();
+            const auto &operators = plan.getOperators();
+
+            if (conditions.empty())
+            {
+                return false;
+            }
+
+            auto conditionMatches = [&](const query::QueryCondition &cond)
+            {
+                for (const auto &[key, value] : metadata)
+                {
+                    if (cond.matches(key, value))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            bool result = conditionMatches(conditions[0]);
+            for (size_t i = 0; i < operators.size(); i++)
+            {
+                bool next = conditionMatches(conditions[i + 1]);
+                result = operators[i] == query::AND ? (result && next) : (result || next);
+            }
+            return result;
+        }
+
+    } // namespace
+
+    int DistributedIdiomsServer::registerStandingQuery(const std::string &conditionStr,
+                                                       std::vector<int> &initialResults)
+    {
+        // Holding standingMutex across the initial evaluation blocks the
+        // writers' delta updates, so a record landing during registration
+        // is seen exactly once: in the snapshot or as a later delta
+        std::lock_guard<std::mutex> lock(standingMutex);
+
+        // Members track the dense space the delta updates work in; the
+        // caller's snapshot translates at the boundary
+        std::vector<int> matches = computeMultiConditionMatches(conditionStr);
+
+        StandingQuery subscription;
+        subscription.plan = query::parsedQuery(conditionStr);
+        subscription.members.insert(matches.begin(), matches.end());
+
+        initialResults = externalizeObjectIds(std::move(matches));
+
+        int subscriptionId = nextSubscriptionId++;
+        standingQueries.emplace(subscriptionId, std::move(subscription));
+
+        std::cout << "Registered standing query \"" << conditionStr
+                  << "\" as subscription " << subscriptionId
+                  << " on server " << serverId << std::endl;
+
+        return subscriptionId;
+    }
+
+    void DistributedIdiomsServer::unregisterStandingQuery(int subscriptionId)
+    {
+        std::lock_guard<std::mutex> lock(standingMutex);
+        standingQueries.erase(subscriptionId);
+    }
+
+    DistributedIdiomsServer::StandingQueryDelta
+    DistributedIdiomsServer::drainStandingQueryDeltas(int subscriptionId)
+    {
+        std::lock_guard<std::mutex> lock(standingMutex);
+
+        auto it = standingQueries.find(subscriptionId);
+        if (it == standingQueries.end())
+        {
+            return {};
+        }
+
+        StandingQueryDelta delta;
+        delta.added = externalizeObjectIds(std::move(it->second.pendingAdded));
+        delta.removed = externalizeObjectIds(std::move(it->second.pendingRemoved));
+        it->second.pendingAdded.clear();
+        it->second.pendingRemoved.clear();
+        return delta;
+    }
+
+    std::vector<std::pair<int, DistributedIdiomsServer::StandingQueryDelta>>
+    DistributedIdiomsServer::drainAllStandingQueryDeltas()
+    {
+        std::lock_guard<std::mutex> lock(standingMutex);
+
+        std::vector<std::pair<int, StandingQueryDelta>> drained;
+        for (auto &[subscriptionId, subscription] : standingQueries)
+        {
+            if (subscription.pendingAdded.empty() && subscription.pendingRemoved.empty())
+            {
+                continue;
+            }
+
+            StandingQueryDelta delta;
+            delta.added = externalizeObjectIds(std::move(subscription.pendingAdded));
+            delta.removed = externalizeObjectIds(std::move(subscription.pendingRemoved));
+            subscription.pendingAdded.clear();
+            subscription.pendingRemoved.clear();
+            drained.emplace_back(subscriptionId, std::move(delta));
+        }
+        return drained;
+    }
+
+    void DistributedIdiomsServer::updateStandingQueries(const std::string &key, int objectId)
+    {
+        {
+            // Cheap relevance screen: skip the re-test entirely unless some
+            // registered condition is keyed on this record's key
+            std::lock_guard<std::mutex> lock(standingMutex);
+            if (standingQueries.empty())
+            {
+                return;
+            }
+
+            bool relevant = false;
+            for (const auto &[subscriptionId, subscription] : standingQueries)
+            {
+                for (const auto &cond : subscription.plan->getConditions())
+                {
+                    if (cond.keyHasWildcard ? query::matchWildcard(key, cond.key)
+                                            : cond.key == key)
+                    {
+                        relevant = true;
+                        break;
+                    }
+                }
+                if (relevant)
+                {
+                    break;
+                }
+            }
+            if (!relevant)
+            {
+                return;
+            }
+        }
+
+        // Copy the object's surviving metadata; the re-test below must not
+        // hold metadataMutex while it takes standingMutex
+        std::vector<std::pair<std::string, std::string>> metadata;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            metadata = objectMetadata.pairsOf(objectId);
+        }
+
+        std::lock_guard<std::mutex> lock(standingMutex);
+        for (auto &[subscriptionId, subscription] : standingQueries)
+        {
+            bool nowMatches = !metadata.empty() && planMatchesObject(*subscription.plan, metadata);
+            bool wasMember = subscription.members.count(objectId) > 0;
+
+            if (nowMatches && !wasMember)
+            {
+                subscription.members.insert(objectId);
+                subscription.pendingAdded.push_back(objectId);
+            }
+            else if (!nowMatches && wasMember)
+            {
+                subscription.members.erase(objectId);
+                subscription.pendingRemoved.push_back(objectId);
+            }
+        }
+    }
+
+    bool DistributedIdiomsServer::mapCheckpointImage()
+    {
+        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
+        int fd = ::open(indexFile.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "Read-only replica: cannot open " << indexFile << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        size_t size = static_cast<size_t>(st.st_size);
+        void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps the pages; the descriptor is done
+        if (mapped == MAP_FAILED)
+        {
+            std::cerr << "Read-only replica: mmap of " << indexFile << " failed" << std::endl;
+            return false;
+        }
+
+        const char *base = static_cast<const char *>(mapped);
+        const char header[] = "IDIOMS_INDEX_V2\n";
+        const size_t headerBytes = sizeof(header) - 1;
+        if (size < headerBytes || std::memcmp(base, header, headerBytes) != 0)
+        {
+            std::cerr << "Read-only replica: " << indexFile
+                      << " is not a V2 checkpoint image" << std::endl;
+            ::munmap(mapped, size);
+            return false;
+        }
+
+        if (imageData != nullptr)
+        {
+            ::munmap(const_cast<char *>(imageData), imageSize);
+        }
+        imageData = base;
+        imageSize = size;
+        imageMtime = static_cast<int64_t>(st.st_mtime);
+        return true;
+    }
+
+    bool DistributedIdiomsServer::openReadOnlyReplica()
+    {
+        std::unique_lock<std::shared_mutex> lock(imageMutex);
+        if (!mapCheckpointImage())
+        {
+            return false;
+        }
+
+        readOnlyReplica = true;
+        std::cout << "Server " << serverId << " serving read-only from "
+                  << imageSize << " mapped checkpoint bytes" << std::endl;
+        return true;
+    }
+
+    bool DistributedIdiomsServer::refreshReadOnlyReplica()
+    {
+        if (!readOnlyReplica)
+        {
+            return false;
+        }
+
+        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
+        struct stat st;
+        if (::stat(indexFile.c_str(), &st) != 0)
+        {
+            return false;
+        }
+
+        {
+            std::shared_lock<std::shared_mutex> lock(imageMutex);
+            if (static_cast<size_t>(st.st_size) == imageSize &&
+                static_cast<int64_t>(st.st_mtime) == imageMtime)
+            {
+                return false; // Nothing newer published
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(imageMutex);
+        return mapCheckpointImage();
+    }
+
+    bool DistributedIdiomsServer::isReadOnlyReplica() const
+    {
+        return readOnlyReplica;
+    }
+
+    std::vector<int> DistributedIdiomsServer::executeQueryFromImage(const std::string &queryStr) const
+    {
+        std::shared_lock<std::shared_mutex> lock(imageMutex);
+
+        std::vector<int> results;
+        if (imageData == nullptr)
+        {
+            return results;
+        }
+
+        // COUNT shapes reduce to their condition and ship one integer,
+        // same as the indexed path
+        bool countDistinct = query::isCountDistinctQuery(queryStr);
+        bool countOnly = !countDistinct && query::isCountQuery(queryStr);
+
+        std::string condition;
+        size_t limit = 0;
+        if (countDistinct)
+        {
+            condition = query::countDistinctKey(queryStr);
+        }
+        else if (countOnly)
+        {
+            condition = query::countQueryCondition(queryStr);
+        }
+        else
+        {
+            limit = query::parseLimitModifier(queryStr, condition);
+        }
+
+        std::shared_ptr<const query::MultiConditionQuery> plan;
+        if (!countDistinct)
+        {
+            plan = query::parsedQuery(condition);
+        }
+
+        // One pass over the mapped records, object by object; the OS page
+        // cache decides which parts of the image stay resident
+        size_t offset = sizeof("IDIOMS_INDEX_V2\n") - 1;
+
+        auto readBytes = [&](void *out, size_t n)
+        {
+            if (offset + n > imageSize)
+            {
+                return false;
+            }
+            std::memcpy(out, imageData + offset, n);
+            offset += n;
+            return true;
+        };
+        auto readImageString = [&](std::string &s)
+        {
+            uint32_t length;
+            if (!readBytes(&length, sizeof(length)) || offset + length > imageSize)
+            {
+                return false;
+            }
+            s.assign(imageData + offset, length);
+            offset += length;
+            return true;
+        };
+
+        uint32_t storedServerId;
+        uint8_t storedSuffixMode;
+        uint64_t objectCount;
+        if (!readBytes(&storedServerId, sizeof(storedServerId)) ||
+            !readBytes(&storedSuffixMode, sizeof(storedSuffixMode)) ||
+            !readBytes(&objectCount, sizeof(objectCount)))
+        {
+            return results;
+        }
+
+        std::unordered_set<std::string> distinctValues;
+        std::vector<std::pair<std::string, std::string>> metadata;
+        std::string key, value;
+
+        for (uint64_t i = 0; i < objectCount; i++)
+        {
+            int32_t objectId;
+            uint32_t pairCount;
+            if (!readBytes(&objectId, sizeof(objectId)) ||
+                !readBytes(&pairCount, sizeof(pairCount)))
+            {
+                break; // Torn image: stop at the last complete object
+            }
+
+            metadata.clear();
+            bool torn = false;
+            for (uint32_t j = 0; j < pairCount; j++)
+            {
+                if (!readImageString(key) || !readImageString(value))
+                {
+                    torn = true;
+                    break;
+                }
+                if (countDistinct)
+                {
+                    if (key == condition)
+                    {
+                        distinctValues.insert(value);
+                    }
+                }
+                else
+                {
+                    metadata.emplace_back(key, value);
+                }
+            }
+            if (torn)
+            {
+                break;
+            }
+
+            if (!countDistinct && planMatchesObject(*plan, metadata))
+            {
+                // Checkpoint images carry external IDs, so no translation
+                results.push_back(static_cast<int>(objectId));
+                if (limit > 0 && results.size() >= limit)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (countDistinct)
+        {
+            return {static_cast<int>(distinctValues.size())};
+        }
+        if (countOnly)
+        {
+            return {static_cast<int>(results.size())};
+        }
+
+        std::sort(results.begin(), results.end());
+        return results;
+    }
+
+    std::vector<int> DistributedIdiomsServer::executeRangeQuery(const std::string &key,
+                                                                double minValue, double maxValue) const
+    {
+        PostingList results;
+        {
+            std::shared_lock<std::shared_mutex> numLock(numericMutex);
+            results = numericIndex.queryRange(key, minValue, maxValue);
+        }
+
+        // The numeric side index is not pruned on delete either; hide
+        // tombstoned pairs whose objects have no surviving match in range
+        PostingList candidates;
+        {
+            std::shared_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            for (const auto &[pairKey, deleted] : tombstones)
+            {
+                size_t sep = pairKey.find('\x1F');
+                std::string tombKey = pairKey.substr(0, sep);
+                std::string tombValue = pairKey.substr(sep + 1);
+                if (tombKey == key && query::isNumeric(tombValue))
+                {
+                    double numeric = query::parseNumeric(tombValue);
+                    if (numeric >= minValue && numeric <= maxValue)
+                    {
+                        candidates.unionWith(deleted);
+                    }
+                }
+            }
+        }
+
+        if (!candidates.empty())
+        {
+            PostingList removals;
+            for (int objectId : candidates.toVector())
+            {
+                if (results.contains(objectId) &&
+                    !objectHasLivePair(objectId,
+                                       [&](const std::string &liveKey, const std::string &liveValue)
+                                       {
+                                           if (liveKey != key || !query::isNumeric(liveValue))
+                                           {
+                                               return false;
+                                           }
+                                           double numeric = query::parseNumeric(liveValue);
+                                           return numeric >= minValue && numeric <= maxValue;
+                                       }))
+                {
+                    removals.add(objectId);
+                }
+            }
+            results.subtract(removals);
+        }
+
+        return externalizeObjectIds(results.toVector());
+    }
+
+    bool DistributedIdiomsServer::checkpointIndex()
+    {
+        // The checkpoint is the compaction of the log: everything applied
+        // before the metadata copy below lands in the full image, so the
+        // WAL restarts empty first. A write racing between the truncate and
+        // the copy ends up in both — replaying it twice is harmless.
+        {
+            std::lock_guard<std::mutex> lock(walMutex);
+            walBuffer.clear();
+            walBufferedRecords = 0;
+            if (walFile.is_open())
+            {
+                walFile.close();
+            }
+            walFile.open(walPath(), std::ios::binary | std::ios::trunc);
+        }
+
+        // Copy the metadata under the lock, then serialize from the frozen
+        // copy: writers only stall for the in-memory copy, never for disk IO
+        std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> metadataCopy;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            metadataCopy = objectMetadata.exportAll();
+        }
+
+        return writeCheckpointImage(metadataCopy);
+    }
+
+    bool DistributedIdiomsServer::checkpointIndexAsync()
+    {
+        if (checkpointInProgress.exchange(true))
+        {
+            return false; // A checkpoint is already writing
+        }
+        if (checkpointThread.joinable())
+        {
+            checkpointThread.join();
+        }
+
+        // Same quick part as the synchronous path: compact the WAL and
+        // freeze the metadata
+        {
+            std::lock_guard<std::mutex> lock(walMutex);
+            walBuffer.clear();
+            walBufferedRecords = 0;
+            if (walFile.is_open())
+            {
+                walFile.close();
+            }
+            walFile.open(walPath(), std::ios::binary | std::ios::trunc);
+        }
+
+        std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> metadataCopy;
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            metadataCopy = objectMetadata.exportAll();
+        }
+
+        // The slow part — serialization and the disk write — runs off the
+        // query path entirely
+        checkpointThread = std::thread(
+            [this, frozen = std::move(metadataCopy)]()
+            {
+                checkpointSucceeded.store(writeCheckpointImage(frozen));
+                checkpointInProgress.store(false);
+            });
+
+        return true;
+    }
+
+    bool DistributedIdiomsServer::checkpointIndexPrepare(uint64_t checkpointEpoch)
+    {
+        if (!checkpointIndex())
+        {
+            return false;
+        }
+
+        // The pending manifest names the set this image belongs to; it
+        // only becomes authoritative when the coordinator commits it
+        std::ofstream manifest(pendingManifestPath(), std::ios::trunc);
+        if (!manifest.is_open())
+        {
+            return false;
+        }
+        manifest << "IDIOMS_MANIFEST_V1\n"
+                 << checkpointEpoch << "\n";
+        manifest.close();
+
+        return manifest.good();
+    }
+
+    bool DistributedIdiomsServer::commitCheckpointManifest(uint64_t checkpointEpoch)
+    {
+        // The pending manifest must name the epoch being committed; a
+        // mismatch means this server missed the prepare (or another
+        // coordinated checkpoint raced in between)
+        std::ifstream pending(pendingManifestPath());
+        if (!pending.is_open())
+        {
+            return false;
+        }
+
+        std::string version;
+        uint64_t pendingEpoch = 0;
+        std::getline(pending, version);
+        pending >> pendingEpoch;
+        pending.close();
+
+        if (version != "IDIOMS_MANIFEST_V1" || pendingEpoch != checkpointEpoch)
+        {
+            std::cerr << "Server " << serverId
+                      << ": pending manifest epoch " << pendingEpoch
+                      << " does not match commit epoch " << checkpointEpoch
+                      << std::endl;
+            return false;
+        }
+
+        // One atomic rename promotes the set membership
+        if (std::rename(pendingManifestPath().c_str(),
+                        checkpointManifestPath().c_str()) != 0)
+        {
+            return false;
+        }
+
+        std::cout << "Server " << serverId << " committed checkpoint epoch "
+                  << checkpointEpoch << std::endl;
+        return true;
+    }
+
+    bool DistributedIdiomsServer::isCheckpointInProgress() const
+    {
+        return checkpointInProgress.load();
+    }
+
+    bool DistributedIdiomsServer::lastCheckpointSucceeded() const
+    {
+        return checkpointSucceeded.load();
+    }
+
+    bool DistributedIdiomsServer::writeCheckpointImage(
+        const std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> &metadataCopy)
+    {
+        // Both the synchronous and async checkpoint paths come through
+        // here, so timing this covers every checkpoint
+        auto checkpointStart = std::chrono::steady_clock::now();
+
+        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
+        std::ofstream file(indexFile, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        // Serialize the compact binary V2 image in memory and write it with
+        // a single call; field-by-field text formatting dominated checkpoint
+        // time on large indices
+        std::string buffer;
+        buffer += "IDIOMS_INDEX_V2\n";
+
+        appendScalar(buffer, static_cast<uint32_t>(serverId));
+        appendScalar(buffer, static_cast<uint8_t>(useSuffixTreeMode ? 1 : 0));
+
+        appendScalar(buffer, static_cast<uint64_t>(metadataCopy.size()));
+        for (const auto &[objectId, metadata] : metadataCopy)
+        {
+            // Checkpoints persist external IDs; the dense space is
+            // rebuilt from scratch at recovery
+            appendScalar(buffer, static_cast<int32_t>(externalObjectId(objectId)));
+            appendScalar(buffer, static_cast<uint32_t>(metadata.size()));
+            for (const auto &[key, value] : metadata)
+            {
+                appendString(buffer, key);
+                appendString(buffer, value);
+            }
+        }
+
+        file.write(buffer.data(), buffer.length());
+        file.close();
+
+        uint64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - checkpointStart)
+                                 .count();
+        statCheckpointCount.fetch_add(1, std::memory_order_relaxed);
+        statLastCheckpointMs.store(elapsedMs, std::memory_order_relaxed);
+        statTotalCheckpointMs.fetch_add(elapsedMs, std::memory_order_relaxed);
+
+        return file.good();
+    }
+
+    bool DistributedIdiomsServer::recoverIndex()
+    {
+        // Recovery rebuilds the tries wholesale; bind them to our node
+        numa::AllocationNodeGuard numaGuard(numaNode);
+
+        std::string indexFile = dataDir + "/server_" + std::to_string(serverId) + "/index.dat";
+        std::ifstream file(indexFile, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        // Read format version
+        std::string version;
+        std::getline(file, version);
+
+        std::vector<IndexRecord> records;
+
+        if (version == "IDIOMS_INDEX_V2")
+        {
+            // Binary image: bulk-read the rest of the file in one call and
+            // parse from memory instead of token-by-token stream extraction
+            file.seekg(0, std::ios::end);
+            size_t headerLength = version.length() + 1;
+            size_t imageLength = static_cast<size_t>(file.tellg()) - headerLength;
+            file.seekg(headerLength);
+
+            std::string buffer(imageLength, '\0');
+            file.read(&buffer[0], imageLength);
+            if (!file.good())
+            {
+                return false;
+            }
+
+            size_t offset = 0;
+            uint32_t storedServerId;
+            uint8_t storedSuffixMode;
+            uint64_t objectCount;
+            if (!readScalar(buffer, offset, storedServerId) ||
+                !readScalar(buffer, offset, storedSuffixMode) ||
+                !readScalar(buffer, offset, objectCount))
+            {
+                return false;
+            }
+
+            if (storedServerId != static_cast<uint32_t>(serverId))
+            {
+                std::cerr << "Warning: Stored server ID (" << storedServerId
+                          << ") doesn't match current server ID (" << serverId
+                          << ")." << std::endl;
+                return false;
+            }
+            if ((storedSuffixMode != 0) != useSuffixTreeMode)
+            {
+                std::cerr << "Warning: Checkpoint suffix mode differs; "
+                          << "rebuilding with the current setting." << std::endl;
+            }
+
+            for (uint64_t i = 0; i < objectCount; i++)
+            {
+                int32_t objectId;
+                uint32_t pairCount;
+                if (!readScalar(buffer, offset, objectId) ||
+                    !readScalar(buffer, offset, pairCount))
+                {
+                    return false;
+                }
+
+                for (uint32_t j = 0; j < pairCount; j++)
+                {
+                    std::string key, value;
+                    if (!readString(buffer, offset, key) ||
+                        !readString(buffer, offset, value))
+                    {
+                        return false;
+                    }
+                    records.emplace_back(key, value, objectId);
+                }
+            }
+        }
+        else if (version == "IDIOMS_INDEX_V1")
+        {
+            // Legacy line-oriented text format
+            int storedServerId;
+            int storedSuffixMode;
+            file >> storedServerId >> storedSuffixMode;
+
+            if (storedServerId != serverId)
+            {
+                std::cerr << "Warning: Stored server ID (" << storedServerId
+                          << ") doesn't match current server ID (" << serverId
+                          << ")." << std::endl;
+                return false;
+            }
+
+            int objectCount;
+            file >> objectCount;
+
+            for (int i = 0; i < objectCount; i++)
+            {
+                int objectId, metadataCount;
+                file >> objectId >> metadataCount;
+                file.ignore(); // Skip newline
+
+                for (int j = 0; j < metadataCount; j++)
+                {
+                    std::string key, value;
+                    std::getline(file, key);
+                    std::getline(file, value);
+
+                    records.emplace_back(key, value, objectId);
+                }
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        file.close();
+
+        // Clear existing data; bump the version so cached results computed
+        // against the old index are rejected
+        indexVersion.fetch_add(1);
+        std::atomic_store(&snapshot, std::shared_ptr<const IndexSnapshot>());
+        {
+            dropColdSegments();
+            std::unique_lock<std::shared_mutex> lock(shardsMutex);
+            shards.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> numLock(numericMutex);
+            numericIndex.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> filterLock(filterMutex);
+            keyFilter.clear();
+            keySuffixFilter.clear();
+            filterVersion.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> statsLock(keyStatsMutex);
+            keyStatsStore.clear();
+        }
+        {
+            std::unique_lock<std::shared_mutex> tombLock(tombstoneMutex);
+            tombstones.clear();
+            tombstoneCount = 0;
+        }
+        {
+            std::lock_guard<std::mutex> metaLock(metadataMutex);
+            objectMetadata.clear();
+        }
+        {
+            std::lock_guard<std::mutex> lock(denseIdMutex);
+            denseIdByExternal.clear();
+            externalIdByDense.clear();
+        }
+
+        // The checkpoint carries external IDs; re-intern into the fresh
+        // dense space before the rebuild
+        for (auto &record : records)
+        {
+            record.objectId = internObjectId(record.objectId);
+        }
+
+        // Rebuild the shards through the bulk-load path, without re-logging
+        // what the checkpoint already covers
+        {
+            std::shared_lock<std::shared_mutex> compactionLock(compactionMutex);
+            bulkLoadRecords(std::move(records));
+        }
+
+        // Re-apply whatever was logged after the checkpoint
+        replayWal();
+
+        // Report which coordinated set this image belongs to, if any: a
+        // committed manifest means every server wrote the same epoch, a
+        // pending one means the cluster-wide commit never arrived (the
+        // local image plus WAL is still complete either way)
+        std::ifstream manifest(checkpointManifestPath());
+        if (manifest.is_open())
+        {
+            std::string version;
+            uint64_t manifestEpoch = 0;
+            std::getline(manifest, version);
+            manifest >> manifestEpoch;
+            if (version == "IDIOMS_MANIFEST_V1")
+            {
+                std::cout << "Server " << serverId
+                          << " recovered from committed checkpoint epoch "
+                          << manifestEpoch << std::endl;
+            }
+        }
+        else if (std::ifstream(pendingManifestPath()).is_open())
+        {
+            std::cout << "Warning: server " << serverId
+                      << " recovered from a checkpoint whose cluster-wide "
+                      << "commit never completed" << std::endl;
+        }
+
+        return true;
+    }
+
+    int DistributedIdiomsServer::getId() const
+    {
+        return serverId;
+    }
+
+    void DistributedIdiomsServer::setNumaNode(int node)
+    {
+        numaNode = node;
+    }
+
+    int DistributedIdiomsServer::getNumaNode() const
+    {
+        return numaNode;
+    }
+
+    ServerStats DistributedIdiomsServer::getStats() const
+    {
+        ServerStats stats;
+
+        stats.exactQueries = statQueryCount[SHAPE_EXACT].load(std::memory_order_relaxed);
+        stats.prefixQueries = statQueryCount[SHAPE_PREFIX].load(std::memory_order_relaxed);
+        stats.suffixQueries = statQueryCount[SHAPE_SUFFIX].load(std::memory_order_relaxed);
+        stats.infixQueries = statQueryCount[SHAPE_INFIX].load(std::memory_order_relaxed);
+        stats.wildcardQueries = statQueryCount[SHAPE_WILDCARD].load(std::memory_order_relaxed);
+
+        stats.exactLatencyNs = statQueryLatencyNs[SHAPE_EXACT].load(std::memory_order_relaxed);
+        stats.prefixLatencyNs = statQueryLatencyNs[SHAPE_PREFIX].load(std::memory_order_relaxed);
+        stats.suffixLatencyNs = statQueryLatencyNs[SHAPE_SUFFIX].load(std::memory_order_relaxed);
+        stats.infixLatencyNs = statQueryLatencyNs[SHAPE_INFIX].load(std::memory_order_relaxed);
+        stats.wildcardLatencyNs = statQueryLatencyNs[SHAPE_WILDCARD].load(std::memory_order_relaxed);
+
+        stats.lockWaitNs = statLockWaitNs.load(std::memory_order_relaxed);
+        stats.checkpointCount = statCheckpointCount.load(std::memory_order_relaxed);
+        stats.lastCheckpointMs = statLastCheckpointMs.load(std::memory_order_relaxed);
+        stats.totalCheckpointMs = statTotalCheckpointMs.load(std::memory_order_relaxed);
+
+        // Index shape: the trie node counts are arena counter reads, the
+        // posting-list distribution is the one real walk in here
+        auto accumulate = [&stats](const KeyTrie *keyTrie)
+        {
+            stats.keyTrieNodes += keyTrie->nodeCount();
+            for (const auto &valueTrie : keyTrie->getAllValueTries())
+            {
+                stats.valueTrieNodes += valueTrie->nodeCount();
+                valueTrie->collectPostingStats(stats.postingLists,
+                                               stats.postingEntries,
+                                               stats.maxPostingEntries);
+            }
+        };
+
+        // The published snapshot is immutable, so it needs no locks; the
+        // live delta shards take their reader locks like a query would.
+        // Spilled shards contribute their empty stub — stats do not fault
+        // cold data back in.
+        auto snap = currentSnapshot();
+        if (snap)
+        {
+            for (const auto &[vnodeId, keyTrie] : snap->shards)
+            {
+                accumulate(keyTrie.get());
+            }
+        }
+        for (const auto &shard : getAllShards())
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            accumulate(shard->keyTrie.get());
+        }
+
+        // Estimate, not an allocator report: node structs plus posting
+        // entries, ignoring the per-edge string storage
+        stats.indexMemoryBytes = stats.keyTrieNodes * sizeof(KeyTrieNode) +
+                                 stats.valueTrieNodes * sizeof(ValueTrieNode) +
+                                 stats.postingEntries * sizeof(int);
+
+        // The per-subsystem footprint comes straight from the counting
+        // hooks, so it reflects what the allocators actually hold
+        stats.trieArenaBytes = memoryAccounting().bytes(MEM_TRIE_ARENA);
+        stats.suffixIndexBytes = memoryAccounting().bytes(MEM_SUFFIX_INDEX);
+        stats.metadataBytes = memoryAccounting().bytes(MEM_OBJECT_METADATA);
+        stats.messageBufferBytes = memoryAccounting().bytes(MEM_MESSAGE_BUFFERS);
+
+        return stats;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>>
+    DistributedIdiomsServer::topMemoryKeys(size_t topN) const
+    {
+        // Charge each key its value trie's nodes and posting entries,
+        // merged across the snapshot and the live delta shards (a key
+        // can live in both while a rebuild is pending)
+        std::unordered_map<std::string, uint64_t> bytesByKey;
+
+        auto accumulate = [&bytesByKey](const KeyTrie *keyTrie)
+        {
+            std::vector<std::pair<std::string, std::shared_ptr<ValueTrie>>> keyTries;
+            keyTrie->collectKeyTries(keyTries);
+
+            for (const auto &[key, valueTrie] : keyTries)
+            {
+                uint64_t lists = 0, entries = 0, maxEntries = 0;
+                valueTrie->collectPostingStats(lists, entries, maxEntries);
+                bytesByKey[key] += valueTrie->nodeCount() * sizeof(ValueTrieNode) +
+                                   entries * sizeof(int);
+            }
+        };
+
+        auto snap = currentSnapshot();
+        if (snap)
+        {
+            for (const auto &[vnodeId, keyTrie] : snap->shards)
+            {
+                accumulate(keyTrie.get());
+            }
+        }
+        for (const auto &shard : getAllShards())
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            accumulate(shard->keyTrie.get());
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> ranked(bytesByKey.begin(),
+                                                             bytesByKey.end());
+        std::sort(ranked.begin(), ranked.end(),
+                  [](const auto &a, const auto &b)
+                  { return a.second > b.second; });
+
+        if (ranked.size() > topN)
+        {
+            ranked.resize(topN);
+        }
+        return ranked;
+    }
+
+    uint64_t DistributedIdiomsServer::getFilterVersion() const
+    {
+        return filterVersion.load();
+    }
+
+    std::vector<uint64_t> DistributedIdiomsServer::getKeyFilterDigest() const
+    {
+        std::shared_lock<std::shared_mutex> lock(filterMutex);
+        return keyFilter.getDigest();
+    }
+
+    std::vector<uint64_t> DistributedIdiomsServer::getKeySuffixFilterDigest() const
+    {
+        std::shared_lock<std::shared_mutex> lock(filterMutex);
+        return keySuffixFilter.getDigest();
+    }
+
+    uint64_t DistributedIdiomsServer::getCacheHits() const
+    {
+        return cacheHits.load();
+    }
+
+    uint64_t DistributedIdiomsServer::getCacheMisses() const
+    {
+        return cacheMisses.load();
     }
 
-} // namespace idioms
\ No newline at end of file
+} // namespace idioms
@@ -2,16 +2,99 @@
 #define IDIOMS_SERVER_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <random>
+#include <thread>
 #include "../dart/DART.hpp"
 #include "../index/Trie.hpp"
+#include "../index/NumericIndex.hpp"
+#include "../index/KeyBloomFilter.hpp"
+#include "MetadataStore.hpp"
 
 namespace idioms
 {
+    namespace query
+    {
+        class MultiConditionQuery;
+        struct QueryCondition;
+    }
+
+    /**
+     * A single (key, value, objectId) record for bulk ingest
+     */
+    struct IndexRecord
+    {
+        std::string key;
+        std::string value;
+        int objectId;
+
+        IndexRecord() : objectId(0) {}
+        IndexRecord(const std::string &k, const std::string &v, int id)
+            : key(k), value(v), objectId(id) {}
+    };
+
+    /**
+     * Per-key statistics for selectivity estimation
+     *
+     * Maintained incrementally on every insert and delete, so the query
+     * planner and remote clients read cardinalities without walking the
+     * trie. The sample is a fixed-size reservoir over inserted values.
+     */
+    struct KeyStatistics
+    {
+        uint64_t records = 0;                  // Live postings under the key
+        uint64_t distinctValues = 0;           // Live distinct values under the key
+        std::vector<std::string> sampleValues; // Reservoir sample of the key's values
+    };
+
+    /**
+     * Point-in-time operational statistics for one server
+     *
+     * Query counters and latencies come from relaxed atomics updated on
+     * every query; the index-shape numbers are computed by a walk at
+     * snapshot time, so reading the stats costs something but recording
+     * them costs almost nothing.
+     */
+    struct ServerStats
+    {
+        // Query counts and cumulative latency by shape
+        uint64_t exactQueries = 0, prefixQueries = 0, suffixQueries = 0,
+                 infixQueries = 0, wildcardQueries = 0;
+        uint64_t exactLatencyNs = 0, prefixLatencyNs = 0, suffixLatencyNs = 0,
+                 infixLatencyNs = 0, wildcardLatencyNs = 0;
+
+        // Index shape; memory is an estimate from node and entry counts
+        uint64_t keyTrieNodes = 0;
+        uint64_t valueTrieNodes = 0;
+        uint64_t indexMemoryBytes = 0;
+        uint64_t postingLists = 0;
+        uint64_t postingEntries = 0;
+        uint64_t maxPostingEntries = 0;
+
+        // Contention and checkpointing
+        uint64_t lockWaitNs = 0;
+        uint64_t checkpointCount = 0;
+        uint64_t lastCheckpointMs = 0;
+        uint64_t totalCheckpointMs = 0;
+
+        // Live per-subsystem footprint from the counting hooks (see
+        // MemoryAccounting.hpp; process-wide, one server per rank under MPI)
+        uint64_t trieArenaBytes = 0;
+        uint64_t suffixIndexBytes = 0;
+        uint64_t metadataBytes = 0;
+        uint64_t messageBufferBytes = 0;
+    };
 
     /**
      * A server in the IDIOMS distributed system
@@ -24,13 +107,426 @@ namespace idioms
         std::string dataDir;
         std::shared_ptr<DARTRouter> router;
         bool useSuffixTreeMode;
-        std::mutex indexMutex;
+        bool usePathCompression;
+
+        // NUMA node this server's index memory and query work should stay
+        // on; -1 leaves placement to the kernel (see numa/NumaPolicy.hpp)
+        int numaNode = -1;
+        /**
+         * One independently locked index shard covering a single DART virtual node
+         *
+         * Queries take the shard's lock in shared mode, writers in exclusive
+         * mode, so operations touching different virtual nodes never contend.
+         */
+        struct IndexShard
+        {
+            mutable std::shared_mutex mutex;
+            mutable std::unique_ptr<KeyTrie> keyTrie;
+
+            // Virtual node this shard covers; fixed at creation
+            uint32_t virtualNodeId = 0;
+
+            // True while the shard's records live in its on-disk segment;
+            // the trie above is then an empty stub until an access faults
+            // them back in
+            mutable bool spilled = false;
+
+            // Last query or write touch, for choosing spill victims
+            mutable std::atomic<uint64_t> lastAccessMs{0};
+        };
+
+        // Index shards keyed by virtual node ID. shardsMutex guards the map
+        // itself; each shard carries its own reader-writer lock. Shards are
+        // held by shared_ptr because maintenance passes (compaction,
+        // snapshot publish, vnode drops, recovery) clear the map while
+        // queries run: readers copy the shared_ptr, so a cleared shard is
+        // destroyed only after the last reader drains, never under a lock
+        // a reader still holds.
+        mutable std::shared_mutex shardsMutex;
+        std::unordered_map<uint32_t, std::shared_ptr<IndexShard>> shards;
+
+        /**
+         * An immutable, fully built copy of the key tries, produced by
+         * publishSnapshot
+         *
+         * Once published a snapshot is never mutated, so readers traverse
+         * it without taking any lock; the live shards above only hold the
+         * delta written since the last publish.
+         */
+        struct IndexSnapshot
+        {
+            std::unordered_map<uint32_t, std::unique_ptr<KeyTrie>> shards;
+        };
+
+        // Current published snapshot (may be null); swapped atomically
+        std::shared_ptr<const IndexSnapshot> snapshot;
+
+        // Atomically load the published snapshot
+        std::shared_ptr<const IndexSnapshot> currentSnapshot() const;
+
+        // Tiered storage: RAM budget for the trie arenas, 0 = unlimited.
+        // Writes that push the arena footprint past it trigger a spill pass.
+        std::atomic<uint64_t> ramBudgetBytes{0};
+
+        std::thread spillThread;
+        std::atomic<bool> spillRunning{false};
+
+        // Milliseconds on the steady clock, for the shard access stamps
+        static uint64_t steadyNowMs();
+
+        // On-disk segment holding one spilled shard's records
+        std::string segmentPath(uint32_t virtualNodeId) const;
+
+        // Stamp a shard's access time and fault its records back in if
+        // they were spilled; cheap no-op while the shard is resident
+        void ensureShardResident(const IndexShard &shard) const;
+
+        // Rebuild a spilled shard's trie from its segment (mmap), or from
+        // the metadata map if the segment is unreadable
+        void faultInShard(const IndexShard &shard) const;
+
+        // Serialize one resident shard's records to its segment and swap
+        // in an empty stub trie; compactionMutex must be held exclusively
+        bool spillShard(uint32_t virtualNodeId);
+
+        // Spill coldest-first until the arena footprint fits the budget
+        size_t spillPass();
+
+        // Kick off a background spill pass when writes push past the budget
+        void maybeStartSpill();
+
+        // Remove the segment files of currently spilled shards; called
+        // before the shards map is rebuilt from metadata, which makes the
+        // segments stale
+        void dropColdSegments();
+
+        // Insert one key's sorted run of records into a key trie, one
+        // descent per distinct key and value; returns the index one past
+        // the run
+        size_t insertKeyRun(KeyTrie &keyTrie, const std::vector<IndexRecord> &records,
+                            size_t i) const;
+
+        // Secondary index over values that parse as numbers, for range queries
+        mutable std::shared_mutex numericMutex;
+        NumericIndex numericIndex;
+
+        // Reverse map from object ID to its metadata pairs, held as interned
+        // references in a contiguous record arena (see MetadataStore.hpp)
+        mutable std::mutex metadataMutex;
+        MetadataStore objectMetadata;
+
+        /**
+         * One registered standing query: its parsed plan, the objects
+         * currently matching it, and the membership changes accumulated
+         * since the subscriber last drained
+         */
+        struct StandingQuery
+        {
+            std::shared_ptr<const query::MultiConditionQuery> plan;
+            std::unordered_set<int> members;
+            std::vector<int> pendingAdded;
+            std::vector<int> pendingRemoved;
+        };
+
+        // Registered standing queries keyed by subscription ID.
+        // standingMutex guards the map and every entry's pending lists.
+        mutable std::mutex standingMutex;
+        std::unordered_map<int, StandingQuery> standingQueries;
+        int nextSubscriptionId = 1;
+
+        // Re-test an object against every standing query after one of its
+        // records changed, recording membership transitions as deltas
+        void updateStandingQueries(const std::string &key, int objectId);
+
+        // Find or create the shard for a virtual node
+        IndexShard &getShard(uint32_t virtualNodeId);
+
+        // Find the shard for a virtual node without creating it. The
+        // returned shared_ptr keeps the shard alive across a concurrent
+        // map clear by a maintenance pass.
+        std::shared_ptr<const IndexShard> findShard(uint32_t virtualNodeId) const;
+
+        // Snapshot of all current shards, for queries that span virtual
+        // nodes; the shared_ptrs pin the shards for the caller's lifetime
+        std::vector<std::shared_ptr<const IndexShard>> getAllShards() const;
+
+        // Insert one record into a shard whose lock is already held exclusively
+        void addToShardLocked(IndexShard &shard, const std::string &key,
+                              const std::string &value, int objectId);
+
+        // Statistics registry: relaxed atomics on the hot paths, cheap
+        // enough to stay on by default
+        enum QueryShape
+        {
+            SHAPE_EXACT = 0,
+            SHAPE_PREFIX = 1,
+            SHAPE_SUFFIX = 2,
+            SHAPE_INFIX = 3,
+            SHAPE_WILDCARD = 4,
+            SHAPE_COUNT = 5
+        };
+
+        mutable std::atomic<uint64_t> statQueryCount[SHAPE_COUNT];
+        mutable std::atomic<uint64_t> statQueryLatencyNs[SHAPE_COUNT];
+        mutable std::atomic<uint64_t> statLockWaitNs{0};
+        std::atomic<uint64_t> statCheckpointCount{0};
+        std::atomic<uint64_t> statLastCheckpointMs{0};
+        std::atomic<uint64_t> statTotalCheckpointMs{0};
+
+        // Query shape of a single condition, for the statistics registry;
+        // the more expensive shape of the key and value parts wins
+        static int classifyQueryShape(std::string_view condition);
+
+        // Asynchronous checkpoint state: the snapshot copy is taken on the
+        // calling thread, the image serialization and disk write run here
+        std::thread checkpointThread;
+        std::atomic<bool> checkpointInProgress{false};
+        std::atomic<bool> checkpointSucceeded{true};
+
+        // Serialize a metadata image to index.dat
+        bool writeCheckpointImage(
+            const std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> &metadataCopy);
+
+        // Write-ahead log: every add/remove is appended (group-committed in
+        // batches of WAL_GROUP_SIZE) so writes since the last checkpoint
+        // survive a crash. checkpointIndex compacts the log away once the
+        // full image is durable; recoverIndex replays the surviving tail.
+        static const size_t WAL_GROUP_SIZE = 64;
+        mutable std::mutex walMutex;
+        std::ofstream walFile;
+        std::string walBuffer;
+        size_t walBufferedRecords = 0;
+        bool walReplaying = false;
+
+        // Path of this server's log file
+        std::string walPath() const;
+
+        // Paths of the coordinated-checkpoint manifest: pending while the
+        // image is written, committed once the whole cluster acknowledged
+        std::string checkpointManifestPath() const;
+        std::string pendingManifestPath() const;
+
+        // Append one operation to the log (op 1 = add, 2 = remove)
+        void appendToWal(uint8_t op, const std::string &key,
+                         const std::string &value, int objectId);
+
+        // Write the buffered group to disk; walMutex must be held
+        void flushWalLocked();
+
+        // Re-apply every complete record in the log
+        void replayWal();
+
+        // Tombstoned deletions, keyed by key + '\x1F' + value. Deletes only
+        // mark IDs here; queries subtract matching tombstones, and a
+        // background compaction pass physically rebuilds the tries once
+        // enough tombstones accumulate.
+        mutable std::shared_mutex tombstoneMutex;
+        std::unordered_map<std::string, PostingList> tombstones;
+        size_t tombstoneCount = 0;
+
+        // Above this many tombstoned postings a background compaction starts
+        static const size_t COMPACTION_THRESHOLD = 1024;
+
+        std::thread compactionThread;
+        std::atomic<bool> compactionRunning{false};
+
+        // True if a stored (key, value) pair satisfies a parsed condition
+        static bool pairMatchesCondition(std::string_view keyPart, std::string_view valuePart,
+                                         const std::string &key, const std::string &value);
+
+        // True if the object has a live metadata pair satisfying pred
+        bool objectHasLivePair(int objectId,
+                               const std::function<bool(const std::string &, const std::string &)> &pred) const;
+
+        // Drop tombstoned objects with no remaining live match from results
+        void subtractTombstones(std::string_view keyPart, std::string_view valuePart,
+                                PostingList &results) const;
+
+        // Tombstone and un-index a batch of records already translated to
+        // dense object IDs; caller holds the compaction lock shared and
+        // has written the WAL entries
+        void removeRecordsDense(const std::vector<IndexRecord> &denseRecords);
+
+        // Remove every record of the given dense objects through the
+        // batched tombstone pass; shared by delete-by-query and time
+        // window expiry. Returns the number of records removed.
+        size_t removeObjectsDense(const std::vector<int> &victims);
+
+        // Time-window partitions: each window's members by dense object
+        // ID, keyed by window start. A span of zero means partitioning is
+        // off. Never held while calling into the index paths.
+        mutable std::mutex windowMutex;
+        std::map<int64_t, PostingList> timeWindows;
+        int64_t windowSpanMs = 0;
+        size_t maxTimeWindows = 0;
+
+        // Kick off a background compaction when enough tombstones piled up
+        void maybeStartCompaction();
+
+        // Rebuild the shards from surviving metadata and clear tombstones
+        void compactionPass();
+
+        // Shared by writers; held exclusively for the whole compaction pass
+        // so a rebuild never loses a concurrent insert or delete
+        mutable std::shared_mutex compactionMutex;
+
+        // Bulk-load body; callers must hold compactionMutex
+        void bulkLoadRecords(std::vector<IndexRecord> records);
+
+        // Bloom filters over indexed keys (and key suffixes in suffix mode),
+        // consulted before any trie walk so negative probes stay cheap. The
+        // filters only grow; recovery rebuilds them from scratch.
+        mutable std::shared_mutex filterMutex;
+        KeyBloomFilter keyFilter;
+        KeyBloomFilter keySuffixFilter;
+
+        // Bumped whenever the filters change, so clients know when a fetched
+        // digest has gone stale
+        std::atomic<uint64_t> filterVersion{0};
+
+        // Record a newly indexed key (and its suffixes in suffix mode)
+        void recordKeyInFilters(const std::string &key);
+
+        /**
+         * Incrementally maintained statistics entry for one key
+         *
+         * The per-value refcounts make the distinct count exact under
+         * deletes; the reservoir is a sample of inserted values and is
+         * not rewound when postings die.
+         */
+        struct KeyStatsEntry
+        {
+            uint64_t records = 0;
+            std::unordered_map<std::string, uint32_t> valueRefs; // Value -> live postings
+            std::vector<std::string> sampleValues;               // Reservoir sample
+            uint64_t sampleSeen = 0;                             // Inserts the reservoir observed
+        };
+
+        // Values kept per key in the reservoir sample
+        static const size_t KEY_STATS_SAMPLE_SIZE = 32;
 
-        // In-memory trie-based index
-        std::unique_ptr<KeyTrie> keyTrie;
+        // Per-key statistics store; the mutex also guards the RNG below.
+        // Rebuilds clear the store and let the bulk load repopulate it,
+        // the same way the key filters are refreshed.
+        mutable std::mutex keyStatsMutex;
+        std::unordered_map<std::string, KeyStatsEntry> keyStatsStore;
+        std::mt19937 keyStatsRng{0x5eed};
 
-        // Map of object ID to its metadata (key-value pairs) for more efficient lookup
-        std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> objectMetadata;
+        // Fold one insert / delete into the key's statistics entry
+        void recordKeyStatsInsert(const std::string &key, const std::string &value);
+        void recordKeyStatsDelete(const std::string &key, const std::string &value);
+
+        // Per-condition cardinality estimates for the planner, SIZE_MAX
+        // where the statistics cannot say
+        std::vector<size_t> estimateConditionCardinalities(
+            const std::vector<query::QueryCondition> &conditions) const;
+
+        // Dense internal object IDs: external object IDs intern into a
+        // compact sequential space on first sight, and every internal
+        // structure (tries, tombstones, numeric index, metadata, standing
+        // queries) works in that space. External IDs reappear only at the
+        // response, checkpoint and wire boundaries, so posting-list
+        // containers stay packed however sparse the external space is.
+        mutable std::mutex denseIdMutex;
+        std::unordered_map<int, int> denseIdByExternal;
+        std::vector<int> externalIdByDense;
+
+        // Dense ID for an external object ID, interning it on first sight
+        int internObjectId(int externalId);
+
+        // Dense ID for an external object ID, or -1 if never interned
+        int lookupDenseObjectId(int externalId) const;
+
+        // External object ID a dense ID was interned from
+        int externalObjectId(int denseId) const;
+
+        // Translate dense IDs back to external IDs, sorted
+        std::vector<int> externalizeObjectIds(std::vector<int> denseIds) const;
+
+        // executeMultiConditionQuery's evaluator, in the dense space; the
+        // public wrapper translates at the boundary while internal callers
+        // (standing queries, compound executeQuery) stay dense
+        std::vector<int> computeMultiConditionMatches(const std::string &conditionStr) const;
+
+        // Pinned result set for one in-progress paged query
+        struct PagedCursor
+        {
+            PostingList results; // Pinned dense result set
+            size_t offset = 0;
+            uint64_t lastAccessMs = 0;
+        };
+
+        // At most this many cursors stay pinned at once; the least
+        // recently used one is dropped to admit a new query
+        static const size_t PAGED_CURSOR_CAPACITY = 64;
+
+        // Cursors idle longer than this are reclaimed
+        static const uint64_t PAGED_CURSOR_IDLE_MS = 5 * 60 * 1000;
+
+        // Mutable for the same reason as the query cache: paging is
+        // logically a read
+        mutable std::mutex pagedCursorMutex;
+        mutable std::unordered_map<uint64_t, PagedCursor> pagedCursors;
+        mutable uint64_t nextPagedCursorId = 1;
+
+        // Read-only replica mode: the checkpoint image stays mapped and
+        // queries scan it per object instead of walking tries. Refresh
+        // swaps the mapping under the exclusive lock; queries share it.
+        bool readOnlyReplica = false;
+        mutable std::shared_mutex imageMutex;
+        const char *imageData = nullptr;
+        size_t imageSize = 0;
+        int64_t imageMtime = 0;
+
+        // Map the checkpoint image file; imageMutex must be held
+        bool mapCheckpointImage();
+
+        // Evaluate a query by scanning the mapped checkpoint image
+        std::vector<int> executeQueryFromImage(const std::string &queryStr) const;
+
+        // Maximum number of cached query results
+        static const size_t QUERY_CACHE_CAPACITY = 128;
+
+        // Minimum number of conditions before a compound query fans its
+        // per-condition evaluations out across worker threads
+        static const size_t PARALLEL_CONDITION_THRESHOLD = 4;
+
+        /**
+         * One cached query result, tagged with the index version it was
+         * computed against
+         */
+        struct QueryCacheEntry
+        {
+            uint64_t version;
+            std::vector<int> results;
+            std::list<std::string>::iterator lruPosition;
+        };
+
+        // Monotonic index version, bumped by every write; a cache entry is
+        // valid only while its version matches
+        std::atomic<uint64_t> indexVersion{0};
+
+        // Bounded LRU cache of query results, keyed by query string.
+        // cacheMutex guards the map and the recency list.
+        mutable std::mutex cacheMutex;
+        mutable std::unordered_map<std::string, QueryCacheEntry> queryCache;
+        mutable std::list<std::string> queryCacheLru; // Most recent at front
+
+        // Cache effectiveness counters
+        mutable std::atomic<uint64_t> cacheHits{0};
+        mutable std::atomic<uint64_t> cacheMisses{0};
+
+        // Look up a query in the result cache; true on a fresh hit
+        bool lookupQueryCache(const std::string &query, uint64_t version,
+                              std::vector<int> &results) const;
+
+        // Store a computed result in the cache, evicting the least recently
+        // used entry if the cache is full
+        void storeQueryCache(const std::string &query, uint64_t version,
+                             const std::vector<int> &results) const;
+
+        // Evaluate a query against the shards into a compressed posting list
+        PostingList computeQueryResult(const std::string &query) const;
 
     public:
         /**
@@ -40,10 +536,18 @@ namespace idioms
          * @param dataDirectory Directory for storing index data
          * @param dartRouter Shared DART router instance
          * @param useSuffixMode Whether to use suffix-tree mode for efficient infix queries
+         * @param usePathCompressedMode Whether to use the path-compressed (radix)
+         *        trie layout, collapsing single-child chains into one edge
          */
         DistributedIdiomsServer(int id, const std::string &dataDirectory,
                                 std::shared_ptr<DARTRouter> dartRouter,
-                                bool useSuffixMode = false);
+                                bool useSuffixMode = false,
+                                bool usePathCompressedMode = false);
+
+        /**
+         * Destructor; waits for any in-flight background compaction
+         */
+        ~DistributedIdiomsServer();
 
         /**
          * Add an indexed key to this server
@@ -54,22 +558,232 @@ namespace idioms
          */
         void addIndexedKey(const std::string &key, const std::string &value, int objectId);
 
+        /**
+         * Bulk-load a batch of index records into this server
+         *
+         * The batch is sorted by (key, value), then each distinct key and each
+         * distinct value within a key is inserted with a single trie descent,
+         * under a single acquisition of the index lock. Intended for large
+         * ingest batches where per-record addIndexedKey overhead dominates.
+         *
+         * @param records Index records to load (taken by value; sorted internally)
+         */
+        void bulkLoadIndexedKeys(std::vector<IndexRecord> records);
+
         /**
          * Remove an indexed key from this server
          *
+         * The deletion is lazy: the object ID is tombstoned for this
+         * (key, value) pair and hidden from queries immediately, while the
+         * trie nodes are pruned later by background compaction.
+         *
          * @param key Metadata attribute key
          * @param value Metadata attribute value
          * @param objectId Object ID associated with this metadata
          */
         void removeIndexedKey(const std::string &key, const std::string &value, int objectId);
 
+        /**
+         * Remove a batch of index records from this server
+         *
+         * The whole batch is tombstoned under a single acquisition of each
+         * lock, so per-record locking overhead does not dominate large
+         * deletes. Records whose object ID was never indexed here are
+         * silently skipped.
+         *
+         * @param records Index records to remove (taken by value)
+         */
+        void bulkRemoveIndexedKeys(std::vector<IndexRecord> records);
+
+        /**
+         * Delete every record of every object matching a query
+         *
+         * The query is evaluated once to find the victims, then each
+         * victim's surviving metadata pairs are removed through the same
+         * batched tombstone pass bulkRemoveIndexedKeys uses.
+         *
+         * @param queryStr Query condition selecting the objects to delete
+         * @return Number of objects deleted
+         */
+        size_t deleteByQuery(const std::string &queryStr);
+
+        /**
+         * Partition timestamped inserts into fixed time windows
+         *
+         * Each window tracks the objects inserted into it, so retention
+         * drops a whole window at once instead of deleting record by
+         * record, and time-bounded queries skip the windows outside their
+         * range. The ring keeps at most maxWindows windows; inserting into
+         * a new window past that expires the oldest one.
+         *
+         * The partitions are an in-memory routing structure: after a
+         * recovery they rebuild from subsequent timestamped inserts, while
+         * the records themselves recover through the checkpoint and WAL.
+         *
+         * @param spanMs Width of each window in milliseconds
+         * @param maxWindows Number of windows kept before the oldest expires
+         */
+        void enableTimePartitioning(int64_t spanMs, size_t maxWindows);
+
+        /**
+         * Create a metadata index record carrying a record timestamp
+         *
+         * Indexes exactly like the untimestamped overload and additionally
+         * routes the object into the time window covering the timestamp.
+         *
+         * @param key Metadata attribute key
+         * @param value Metadata attribute value
+         * @param objectId Object ID to associate with this metadata
+         * @param timestampMs Record timestamp, milliseconds since the epoch
+         */
+        void addIndexedKey(const std::string &key, const std::string &value, int objectId,
+                           int64_t timestampMs);
+
+        /**
+         * Execute a query against only the windows overlapping a time range
+         *
+         * The query is evaluated once and the matches are intersected with
+         * the membership of the overlapping windows, so objects outside
+         * [fromMs, toMs) never surface however well they match.
+         *
+         * @param query Query string
+         * @param fromMs Start of the time range (inclusive), milliseconds
+         * @param toMs End of the time range (exclusive), milliseconds
+         * @return Vector of matching object IDs within the range
+         */
+        std::vector<int> executeQueryInWindow(const std::string &query, int64_t fromMs,
+                                              int64_t toMs) const;
+
+        /**
+         * Drop every time window that ended at or before the cutoff
+         *
+         * The expired windows' objects are removed through the batched
+         * tombstone pass — one lock acquisition per structure, no per-record
+         * trie surgery — and the next compaction rebuilds the tries without
+         * them, reclaiming their arena space wholesale.
+         *
+         * @param cutoffMs Expiry cutoff, milliseconds since the epoch
+         * @return Number of windows dropped
+         */
+        size_t expireWindowsBefore(int64_t cutoffMs);
+
+        /**
+         * Rebuild the index from surviving metadata, pruning tombstoned
+         * postings and the trie nodes that held them
+         *
+         * Runs synchronously; the threshold-triggered path runs the same
+         * pass on a background thread instead.
+         */
+        void compactIndex();
+
+        /**
+         * Publish an immutable snapshot of the current index
+         *
+         * The snapshot is built from the surviving metadata (so tombstoned
+         * postings are folded out), swapped in atomically, and the live
+         * shards are reset to an empty delta. Readers traverse the
+         * published snapshot without any locking; only records written
+         * after the publish touch the shard locks.
+         */
+        void publishSnapshot();
+
+        /**
+         * Rewrite every live shard's key trie into traversal order
+         *
+         * Each trie's nodes are cloned into a fresh arena breadth-first,
+         * heaviest subtree first (see KeyTrie::freeze), so prefix descent
+         * touches sequential cache lines. Meant after a bulk load, before
+         * the read-mostly phase; writers are excluded for the pass and
+         * later inserts work unchanged on the frozen layout.
+         */
+        void freezeIndexes();
+
+        /**
+         * Extract every index record whose key routes to one of the given
+         * virtual nodes
+         *
+         * Used by the rebalancing protocol to ship exactly the migrating
+         * vnodes' entries to their new owner.
+         *
+         * @param vnodeIds Virtual nodes being migrated away
+         * @return Index records belonging to those virtual nodes
+         */
+        std::vector<IndexRecord> exportVirtualNodes(const std::vector<uint32_t> &vnodeIds);
+
+        /**
+         * Drop every index record whose key routes to one of the given
+         * virtual nodes
+         *
+         * Rebuilds the remaining index through the bulk-load path, the same
+         * way compaction does, so the migrated entries disappear from the
+         * tries, the numeric index and the filters in one pass.
+         *
+         * @param vnodeIds Virtual nodes this server no longer owns
+         */
+        void dropVirtualNodes(const std::vector<uint32_t> &vnodeIds);
+
+        /**
+         * Encode the given virtual nodes' live records as a binary
+         * snapshot image
+         *
+         * Uses the same scalar/string encoding as the V2 checkpoint, so a
+         * joining server parses the whole image in one bulk pass instead
+         * of replaying ingest record by record.
+         *
+         * @param vnodeIds Virtual nodes to include
+         * @return Snapshot image bytes (IDIOMS_SNAPSHOT_V1 format)
+         */
+        std::string exportSnapshotImage(const std::vector<uint32_t> &vnodeIds);
+
+        /**
+         * Load a snapshot image produced by exportSnapshotImage
+         *
+         * Pairs already present locally are skipped, so a receiver holding
+         * replica copies never duplicates metadata; the rest go through
+         * the bulk-load path.
+         *
+         * @param image Snapshot image bytes
+         * @return True if the image parsed and loaded cleanly
+         */
+        bool importSnapshotImage(const std::string &image);
+
+        /**
+         * Serve as a read-only replica straight from the checkpoint image
+         *
+         * Maps this server's binary V2 checkpoint with mmap instead of
+         * rebuilding tries from it: queries scan the mapped records per
+         * object and the OS page cache decides what stays resident, so a
+         * replica starts in the time of an mmap call and holds no index
+         * in RAM. Write operations are rejected while the mode is active.
+         *
+         * @return True if the image was mapped and validated
+         */
+        bool openReadOnlyReplica();
+
+        /**
+         * Remap the checkpoint image if a newer one has been published
+         *
+         * Cheap to call periodically: the file's size and mtime are
+         * compared first and the remap only happens on a change.
+         *
+         * @return True if a newer image replaced the mapping
+         */
+        bool refreshReadOnlyReplica();
+
+        /**
+         * Check whether this server is serving in read-only replica mode
+         *
+         * @return True if queries are answered from the mapped image
+         */
+        bool isReadOnlyReplica() const;
+
         /**
          * Check if this server has a specific key
          *
          * @param key Metadata attribute key
          * @return True if this server has at least one object with this key
          */
-        bool hasKey(const std::string &key) const;
+        bool hasKey(std::string_view key) const;
 
         /**
          * Check if this server has a specific suffix
@@ -77,7 +791,7 @@ namespace idioms
          * @param suffix Key suffix to check
          * @return True if this server has at least one key ending with the suffix
          */
-        bool hasSuffix(const std::string &suffix) const;
+        bool hasSuffix(std::string_view suffix) const;
 
         /**
          * Check if this server can handle a specific query
@@ -90,21 +804,232 @@ namespace idioms
         /**
          * Execute a query on this server
          *
+         * Two modifiers are recognized: "COUNT(<condition>)" returns the
+         * match count as a single-element result without materializing the
+         * ID set, and "<condition> LIMIT k" returns at most k matches,
+         * stopping traversal early.
+         *
          * @param query Query string to execute
-         * @return Vector of matching object IDs
+         * @return Vector of matching object IDs (or the count for COUNT)
          */
         std::vector<int> executeQuery(const std::string &query) const;
 
+        /**
+         * Execute a query, delivering results in fixed-size chunks
+         *
+         * The result stays in its compressed posting-list form and is handed
+         * to onChunk at most chunkSize IDs at a time, so callers (e.g. the
+         * MPI layer) can forward blocks without materializing the full set.
+         *
+         * @param query Query string to execute
+         * @param chunkSize Maximum number of object IDs per chunk
+         * @param onChunk Callback invoked for each chunk of sorted object IDs
+         */
+        void executeQueryStreaming(const std::string &query, size_t chunkSize,
+                                   const std::function<void(const std::vector<int> &)> &onChunk) const;
+
+        /**
+         * One page of a paged query, with the cursor to resume from
+         */
+        struct QueryPage
+        {
+            std::vector<int> results;
+            uint64_t cursor = 0; // 0 once the result set is exhausted
+            bool exhausted = false;
+        };
+
+        /**
+         * Execute a query one page at a time, resumable by cursor
+         *
+         * The first call (cursor 0) evaluates the query once and pins the
+         * result set against the returned cursor; later calls with that
+         * cursor slice the next page out of the pinned set instead of
+         * recomputing, so writes landing mid-export never shift or repeat
+         * what the consumer pages over. A cursor is reclaimed when its set
+         * is exhausted, after PAGED_CURSOR_IDLE_MS without use, or when
+         * the cursor table overflows (oldest first); an unknown cursor
+         * starts the query over under a fresh one.
+         *
+         * @param query Query string to execute
+         * @param cursor 0 for the first page, else the returned cursor
+         * @param pageSize Maximum number of object IDs in the page
+         * @return The page, the cursor to continue under, and whether the
+         *         result set is exhausted
+         */
+        QueryPage executeQueryPage(const std::string &query, uint64_t cursor,
+                                   size_t pageSize) const;
+
+        /**
+         * Execute a multi-condition (AND/OR) query
+         *
+         * Pure-AND queries run as a semi-join: the cheapest condition is
+         * answered from the trie to seed a candidate set, and every later
+         * condition is probed per candidate against the object metadata
+         * map instead of trie-wide. A query like
+         * "run_id=7741 AND *comment*=*calib*" therefore touches a few
+         * hundred objects rather than scanning every comment value.
+         * Queries containing OR evaluate each condition fully and combine
+         * the posting lists.
+         *
+         * @param conditionStr Conditions joined with " AND " / " OR "
+         * @return Sorted vector of matching object IDs
+         */
+        std::vector<int> executeMultiConditionQuery(const std::string &conditionStr) const;
+
+        /**
+         * Count the distinct values stored under a metadata key
+         *
+         * Backs COUNT(DISTINCT key): the answer is computed here and ships
+         * as a single integer instead of the full ID or value set.
+         *
+         * @param key Metadata attribute key
+         * @return Number of distinct values recorded for the key
+         */
+        size_t countDistinctValues(const std::string &key) const;
+
+        /**
+         * Group the objects on this server by the values of a metadata key
+         *
+         * Backs GROUP BY(key): each row is one distinct value and the
+         * number of objects carrying it, ordered by value so partials from
+         * several servers merge with a single pass.
+         *
+         * @param key Metadata attribute key
+         * @return Sorted (value, object count) rows
+         */
+        std::vector<std::pair<std::string, int>> executeGroupByQuery(const std::string &key) const;
+
+        /**
+         * Membership changes for one standing query since the last drain
+         */
+        struct StandingQueryDelta
+        {
+            std::vector<int> added;
+            std::vector<int> removed;
+        };
+
+        /**
+         * Register a standing query and evaluate it once
+         *
+         * After registration every insert and delete re-tests the changed
+         * object against the predicate, so a subscriber that used to poll
+         * pays O(changes) drained as deltas instead of a full evaluation
+         * per poll.
+         *
+         * @param conditionStr Conditions joined with " AND " / " OR "
+         * @param initialResults Receives the objects matching at registration
+         * @return Subscription ID for draining and unregistering
+         */
+        int registerStandingQuery(const std::string &conditionStr,
+                                  std::vector<int> &initialResults);
+
+        /**
+         * Drop a standing query
+         *
+         * @param subscriptionId ID returned by registerStandingQuery
+         */
+        void unregisterStandingQuery(int subscriptionId);
+
+        /**
+         * Collect one standing query's membership changes since the
+         * previous drain
+         *
+         * @param subscriptionId ID returned by registerStandingQuery
+         * @return Object IDs that started and stopped matching
+         */
+        StandingQueryDelta drainStandingQueryDeltas(int subscriptionId);
+
+        /**
+         * Collect pending changes across all standing queries; used by the
+         * MPI layer to push notifications after index mutations
+         *
+         * @return (subscription ID, delta) pairs, nonempty deltas only
+         */
+        std::vector<std::pair<int, StandingQueryDelta>> drainAllStandingQueryDeltas();
+
+        /**
+         * Execute a numeric range query against the secondary index
+         *
+         * Only values that parsed as numbers at insert time are considered,
+         * so this answers key in [min, max] with two binary searches instead
+         * of scanning every object's metadata.
+         *
+         * @param key Metadata attribute key
+         * @param minValue Lower bound (inclusive)
+         * @param maxValue Upper bound (inclusive)
+         * @return Vector of matching object IDs
+         */
+        std::vector<int> executeRangeQuery(const std::string &key,
+                                           double minValue, double maxValue) const;
+
         /**
          * Checkpoint index to disk
          *
+         * Writes the compact binary IDIOMS_INDEX_V2 image in a single call.
+         *
          * @return True if successful, false otherwise
          */
         bool checkpointIndex();
 
+        /**
+         * Start a checkpoint without blocking queries or writers
+         *
+         * Only the quick part — truncating the WAL and copying the metadata
+         * map — runs on the calling thread; serialization and the disk
+         * write happen on a dedicated background thread. Completion is
+         * observable through isCheckpointInProgress and
+         * lastCheckpointSucceeded.
+         *
+         * @return True if a checkpoint was started; false if one is
+         *         already running
+         */
+        bool checkpointIndexAsync();
+
+        /**
+         * Write a checkpoint as one server's part of a coordinated set
+         *
+         * Same image as checkpointIndex, plus a pending manifest stamped
+         * with the cluster-wide checkpoint epoch. The checkpoint is
+         * locally complete and recoverable from this point; the manifest
+         * only records whether the rest of the cluster got as far.
+         *
+         * @param checkpointEpoch Epoch the coordinator stamped on the set
+         * @return True if the image and pending manifest were written
+         */
+        bool checkpointIndexPrepare(uint64_t checkpointEpoch);
+
+        /**
+         * Mark this server's checkpoint as part of a complete cluster set
+         *
+         * Promotes the pending manifest written by checkpointIndexPrepare
+         * to the committed manifest (an atomic rename), once the
+         * coordinator saw every server's acknowledgement.
+         *
+         * @param checkpointEpoch Epoch of the set being committed
+         * @return True if a matching pending manifest was promoted
+         */
+        bool commitCheckpointManifest(uint64_t checkpointEpoch);
+
+        /**
+         * Check whether a background checkpoint is still writing
+         *
+         * @return True while the background write is in flight
+         */
+        bool isCheckpointInProgress() const;
+
+        /**
+         * Get the outcome of the most recently completed checkpoint
+         *
+         * @return True if the last checkpoint wrote successfully
+         */
+        bool lastCheckpointSucceeded() const;
+
         /**
          * Recover index from disk
          *
+         * Reads both the binary V2 image (one bulk read, parsed in memory)
+         * and the legacy line-oriented V1 text format.
+         *
          * @return True if successful, false otherwise
          */
         bool recoverIndex();
@@ -115,6 +1040,141 @@ namespace idioms
          * @return Server ID
          */
         int getId() const;
+
+        /**
+         * Assign this server to a NUMA node
+         *
+         * Arena blocks allocated by later index mutations are bound to
+         * the node's memory, and the client pins its query workers to
+         * the node before traversing this server's tries.
+         *
+         * @param node NUMA node ID, or -1 to leave placement to the kernel
+         */
+        void setNumaNode(int node);
+
+        /**
+         * Get this server's NUMA node assignment
+         *
+         * @return Node ID, or -1 when unassigned
+         */
+        int getNumaNode() const;
+
+        /**
+         * Cap the RAM held by the index tries
+         *
+         * When the arena footprint pushes past the budget, the least
+         * recently accessed shards are serialized to on-disk segments and
+         * their tries dropped; a later query or write against a spilled
+         * shard faults the records back in from the segment via mmap.
+         *
+         * @param bytes Budget for the trie arenas, 0 for unlimited
+         */
+        void setRamBudget(size_t bytes);
+
+        /**
+         * Spill cold shards until the index fits the RAM budget
+         *
+         * Runs synchronously; the budget-triggered path runs the same
+         * pass on a background thread instead. Shards covered by the
+         * published snapshot are skipped, since dropping their delta
+         * would not release the snapshot's copy.
+         *
+         * @return Number of shards spilled
+         */
+        size_t spillColdShards();
+
+        /**
+         * Collect a point-in-time statistics snapshot
+         *
+         * Counter fields are relaxed-atomic reads; the index-shape fields
+         * walk the published snapshot lock-free plus the live delta
+         * shards under their reader locks.
+         *
+         * @return The statistics snapshot
+         */
+        ServerStats getStats() const;
+
+        /**
+         * Read one key's statistics
+         *
+         * A map lookup against the incrementally maintained store, so
+         * clients can estimate a query's fan-out cost before paying for
+         * an expensive wildcard.
+         *
+         * @param key Metadata attribute key
+         * @return Counts and sampled values; zeroed when the key is unknown
+         */
+        KeyStatistics getKeyStatistics(const std::string &key) const;
+
+        /**
+         * Estimate how many postings a query may touch before running it
+         *
+         * Reads the statistics store only: exact keys cost their live
+         * postings (divided by distinct values for an exact pair), and a
+         * wildcard or pattern key is bounded by the server's total
+         * postings since it can match any key. Compound conditions sum
+         * their parts. The governor compares this against its cost cap
+         * to reject runaway queries before they start.
+         *
+         * @param query Query string in the same form executeQuery takes
+         * @return Estimated upper bound on postings touched
+         */
+        uint64_t estimateQueryCost(const std::string &query) const;
+
+        /**
+         * Attribute index memory to the metadata keys that own it
+         *
+         * Walks every key trie and charges each key its value trie's
+         * nodes and posting entries, so the keys driving the footprint
+         * can be named instead of guessed.
+         *
+         * @param topN How many of the heaviest keys to return
+         * @return (key, bytes) pairs, heaviest first
+         */
+        std::vector<std::pair<std::string, uint64_t>> topMemoryKeys(size_t topN) const;
+
+        /**
+         * Get the current version of the key filters
+         *
+         * Clients compare this against the version of their cached digest to
+         * decide whether a refetch is needed.
+         *
+         * @return Filter version, bumped on every filter change
+         */
+        uint64_t getFilterVersion() const;
+
+        /**
+         * Get a compact digest of the indexed-key Bloom filter
+         *
+         * A client holding this digest can prove locally that this server
+         * has no objects for a given exact key and skip the query entirely.
+         *
+         * @return Raw filter words (see KeyBloomFilter)
+         */
+        std::vector<uint64_t> getKeyFilterDigest() const;
+
+        /**
+         * Get a compact digest of the key-suffix Bloom filter
+         *
+         * Only populated in suffix-tree mode; empty of set bits otherwise.
+         *
+         * @return Raw filter words (see KeyBloomFilter)
+         */
+        std::vector<uint64_t> getKeySuffixFilterDigest() const;
+
+        /**
+         * Get the number of query result cache hits
+         *
+         * @return Hit count since server start
+         */
+        uint64_t getCacheHits() const;
+
+        /**
+         * Get the number of query result cache misses
+         *
+         * @return Miss count since server start
+         */
+        uint64_t getCacheMisses() const;
     };
 
 } // namespace idioms
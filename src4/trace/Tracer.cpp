@@ -0,0 +1,77 @@
+#include "Tracer.hpp"
+#include <fstream>
+#include <iostream>
+
+namespace idioms
+{
+    namespace trace
+    {
+
+        Tracer::Tracer() : sampleRate(0), spans(SPAN_CAPACITY), nextSlot(0)
+        {
+            // IDIOMS_TRACE_SAMPLE=100 samples one request in a hundred;
+            // unset or 0 keeps tracing off
+            const char *env = std::getenv("IDIOMS_TRACE_SAMPLE");
+            if (env != nullptr)
+            {
+                sampleRate = std::strtoull(env, nullptr, 10);
+            }
+        }
+
+        Tracer &Tracer::instance()
+        {
+            static Tracer instance;
+            return instance;
+        }
+
+        void Tracer::setSampleRate(uint64_t rate)
+        {
+            sampleRate = rate;
+        }
+
+        void Tracer::record(uint64_t traceId, const char *stage,
+                            uint64_t startNs, uint64_t endNs)
+        {
+            size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) %
+                          SPAN_CAPACITY;
+            spans[slot] = {traceId, stage, startNs, endNs};
+        }
+
+        void Tracer::dump(const std::string &path) const
+        {
+            uint64_t recorded = nextSlot.load(std::memory_order_relaxed);
+            if (recorded == 0)
+            {
+                return;
+            }
+
+            std::ofstream out(path);
+            if (!out)
+            {
+                std::cerr << "Failed to open trace dump " << path << std::endl;
+                return;
+            }
+
+            out << "# traceId stage startNs endNs durationNs" << std::endl;
+
+            size_t retained = recorded < SPAN_CAPACITY ? recorded : SPAN_CAPACITY;
+            for (size_t i = 0; i < retained; i++)
+            {
+                const TraceSpan &span = spans[i];
+                out << span.traceId << " " << span.stage << " "
+                    << span.startNs << " " << span.endNs << " "
+                    << (span.endNs - span.startNs) << std::endl;
+            }
+
+            if (recorded > SPAN_CAPACITY)
+            {
+                out << "# dropped " << (recorded - SPAN_CAPACITY)
+                    << " spans (ring wrapped)" << std::endl;
+            }
+
+            std::cout << "Dumped " << retained << " trace spans to "
+                      << path << std::endl;
+        }
+
+    } // namespace trace
+} // namespace idioms
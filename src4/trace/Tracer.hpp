@@ -0,0 +1,131 @@
+#ifndef IDIOMS_TRACER_HPP
+#define IDIOMS_TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace idioms
+{
+    namespace trace
+    {
+
+        // One timestamped stage of a sampled request. The stage label is a
+        // string literal so recording never allocates.
+        struct TraceSpan
+        {
+            uint64_t traceId;
+            const char *stage;
+            uint64_t startNs;
+            uint64_t endNs;
+        };
+
+        /**
+         * Sampled per-request tracer
+         *
+         * The trace ID rides the request ID the wire header already
+         * carries, so client and server spans for one request join on the
+         * same key with no header change. Sampling is a modulo test on
+         * that ID: every rank makes the same decision for the same
+         * request, and when the decision is "no" the hot path does one
+         * compare and nothing else — no clock reads charged to the span,
+         * no allocation, no lock.
+         *
+         * Sampled spans land in a fixed ring buffer (an overwritten slot
+         * is an old span, never a stall) and are dumped at shutdown as
+         * whitespace-separated lines for offline aggregation.
+         */
+        class Tracer
+        {
+        private:
+            // Spans retained before the ring wraps
+            static const size_t SPAN_CAPACITY = 65536;
+
+            // 0 disables tracing; N samples every Nth trace ID
+            uint64_t sampleRate;
+
+            std::vector<TraceSpan> spans;
+            std::atomic<uint64_t> nextSlot;
+
+            Tracer();
+
+        public:
+            // The process-wide tracer
+            static Tracer &instance();
+
+            /**
+             * Whether this trace ID is in the sample
+             *
+             * @param traceId The request's trace ID
+             * @return true if spans for this ID should be recorded
+             */
+            bool sampled(uint64_t traceId) const
+            {
+                return sampleRate != 0 && traceId % sampleRate == 0;
+            }
+
+            /**
+             * Whether tracing is enabled at all
+             *
+             * @return true if the sample rate is nonzero
+             */
+            bool enabled() const
+            {
+                return sampleRate != 0;
+            }
+
+            /**
+             * Override the sample rate read from the environment
+             *
+             * @param rate 0 to disable, N to sample every Nth trace ID
+             */
+            void setSampleRate(uint64_t rate);
+
+            /**
+             * Record one span for a sampled request
+             *
+             * @param traceId The request's trace ID
+             * @param stage   Stage label; must be a string literal
+             * @param startNs Stage start, from now()
+             * @param endNs   Stage end, from now()
+             */
+            void record(uint64_t traceId, const char *stage,
+                        uint64_t startNs, uint64_t endNs);
+
+            /**
+             * Write the retained spans to a file
+             *
+             * One line per span: traceId, stage, start, end and duration
+             * in nanoseconds. Dropped (overwritten) spans are counted in
+             * a trailing comment line.
+             *
+             * @param path Output file path
+             */
+            void dump(const std::string &path) const;
+
+            /**
+             * Monotonic timestamp for span endpoints
+             *
+             * @return Nanoseconds on the steady clock
+             */
+            static uint64_t now()
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+            }
+        };
+
+        // Shorthand for the process-wide tracer
+        inline Tracer &tracer()
+        {
+            return Tracer::instance();
+        }
+
+    } // namespace trace
+} // namespace idioms
+
+#endif // IDIOMS_TRACER_HPP
@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+# Cross-variant regression benchmark runner.
+#
+# Builds variant_driver.cpp once against each coexisting implementation
+# (src .. src4), runs the identical seed-fixed workload against every
+# binary, and prints a comparison table of ingest rate, read latency
+# percentiles and resident memory. Run it when a deployment is about to
+# track a new variant:
+#
+#   ./variant_bench.sh [workload.conf]
+#
+# Per-variant logs and binaries land in bin/variant_bench/.
+
+set -e
+cd "$(dirname "$0")"
+
+CONF="${1:-}"
+OUT=bin/variant_bench
+CXX="${CXX:-g++}"
+FLAGS="-std=c++17 -O2 -Wall -pthread -I."
+
+mkdir -p "$OUT"
+
+# The workload generator and histogram are shared by every variant's
+# binary; they live in their own namespace, so they link cleanly next
+# to any variant's objects
+$CXX $FLAGS -c src4/benchmark/WorkloadGenerator.cpp -o "$OUT/WorkloadGenerator.o"
+$CXX $FLAGS -c src4/benchmark/LatencyHistogram.cpp -o "$OUT/LatencyHistogram.o"
+
+RESULTS="$OUT/results.txt"
+: > "$RESULTS"
+
+for V in src src1 src2 src3 src4; do
+    # The standalone client surface only: the MPI transport, fault
+    # tolerance and the MPI-aware client manager stay out of the build.
+    # src3's RangeQuery.cpp shipped without its header and nothing in
+    # that snapshot references it, so it is skipped too. numa/ exists
+    # only in src4; find tolerates its absence elsewhere.
+    SRCS=$(find "$V/client" "$V/server" "$V/index" "$V/query" "$V/dart" \
+        "$V/popularity" "$V/numa" -name '*.cpp' 2>/dev/null |
+        grep -v -e ClientManager -e 'src3/query/RangeQuery' || true)
+
+    DEFS=(-DVARIANT_NAME="\"$V\"")
+    if [ "$V" = "src" ]; then
+        DEFS+=(-DVARIANT_NO_CLIENT_HEADER)
+    fi
+
+    echo "== building $V"
+    # shellcheck disable=SC2086
+    $CXX $FLAGS -I"$V" "${DEFS[@]}" variant_driver.cpp $SRCS \
+        "$OUT/WorkloadGenerator.o" "$OUT/LatencyHistogram.o" -o "$OUT/bench_$V"
+
+    echo "== running $V"
+    rm -rf ./variant_bench_data
+    "$OUT/bench_$V" $CONF > "$OUT/$V.log"
+    grep '^RESULT' "$OUT/$V.log" >> "$RESULTS"
+done
+rm -rf ./variant_bench_data
+
+echo
+printf '%-8s %14s %9s %9s %9s %10s %9s\n' \
+    variant 'ingest(ops/s)' 'p50(us)' 'p90(us)' 'p99(us)' 'p99.9(us)' 'rss(MB)'
+awk '{
+    for (i = 3; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+    printf "%-8s %14s %9s %9s %9s %10s %9s\n", \
+        $2, v["ingest"], v["p50"], v["p90"], v["p99"], v["p999"], v["rss"]
+}' "$RESULTS"
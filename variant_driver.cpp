@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+// One driver for every implementation variant: variant_bench.sh compiles
+// this file once per variant (-Isrc .. -Isrc4) against the common client
+// surface they all share — DistributedIdiomsClient, create_md_index,
+// md_search — and feeds each the identical seed-fixed workload from the
+// src4 generator, so a regression between variants shows up as a diff
+// between RESULT lines rather than a production incident.
+
+#ifdef VARIANT_NO_CLIENT_HEADER
+// The earliest variant keeps the client in the server header
+#include "server/Server.hpp"
+#else
+#include "client/Client.hpp"
+#endif
+
+#include "src4/benchmark/WorkloadGenerator.hpp"
+#include "src4/benchmark/LatencyHistogram.hpp"
+
+#ifndef VARIANT_NAME
+#define VARIANT_NAME "unknown"
+#endif
+
+using idioms::benchmark::LatencyHistogram;
+using idioms::benchmark::Operation;
+using idioms::benchmark::OpType;
+using idioms::benchmark::WorkloadConfig;
+using idioms::benchmark::WorkloadGenerator;
+
+// Resident set size from /proc/self/status, in kilobytes
+static uint64_t rssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            std::istringstream fields(line.substr(6));
+            uint64_t kb = 0;
+            fields >> kb;
+            return kb;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    WorkloadConfig config;
+    if (argc > 1)
+    {
+        try
+        {
+            config = WorkloadConfig::fromFile(argv[1]);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Failed to load workload config: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "===== Variant benchmark: " << VARIANT_NAME << " =====" << std::endl;
+    std::cout << "Operations: " << config.numOperations
+              << ", read fraction " << config.readFraction
+              << ", seed " << config.seed << std::endl;
+
+    WorkloadGenerator generator(config);
+    idioms::DistributedIdiomsClient client(4, "./variant_bench_data", true);
+
+    LatencyHistogram readHist, writeHist;
+    uint64_t writes = 0;
+    double writeSeconds = 0.0;
+    int nextObjectId = 1;
+
+    while (generator.hasNext())
+    {
+        Operation op = generator.next();
+        auto start = std::chrono::steady_clock::now();
+
+        if (op.type == OpType::WRITE)
+        {
+            client.create_md_index(op.key, op.value, nextObjectId++);
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            writeHist.record(static_cast<uint64_t>(elapsed.count() * 1e9));
+            writeSeconds += elapsed.count();
+            writes++;
+        }
+        else
+        {
+            volatile size_t sink = client.md_search(op.key + "=" + op.value).size();
+            (void)sink;
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            readHist.record(static_cast<uint64_t>(elapsed.count() * 1e9));
+        }
+    }
+
+    readHist.printSummary("read");
+    writeHist.printSummary("write");
+
+    double ingestOpsPerSec = writeSeconds > 0.0 ? writes / writeSeconds : 0.0;
+    double rssMb = rssKb() / 1024.0;
+
+    // Machine-readable line the runner scrapes into its comparison table
+    std::cout << std::fixed << std::setprecision(1)
+              << "RESULT " << VARIANT_NAME
+              << " ingest=" << ingestOpsPerSec
+              << " p50=" << readHist.valueAtPercentile(50.0) / 1000.0
+              << " p90=" << readHist.valueAtPercentile(90.0) / 1000.0
+              << " p99=" << readHist.valueAtPercentile(99.0) / 1000.0
+              << " p999=" << readHist.valueAtPercentile(99.9) / 1000.0
+              << " rss=" << std::setprecision(1) << rssMb
+              << std::endl;
+
+    return 0;
+}